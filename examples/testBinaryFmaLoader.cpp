@@ -0,0 +1,135 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "loader/tbffmaloader.hpp"
+#include "loader/tbfbinaryfmaloader.hpp"
+#include "loader/tbfbinaryfmawriter.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -f, --file: an ASCII FMA file to convert (random particles otherwise)" << std::endl;
+        std::cout << "[HELP]   -o, --output: the binary FMA file to write (default tbf-particles.bfma)" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of random particles" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -k, --keep: do not remove the binary file at the end" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions;
+    std::array<RealType, Dim> BoxWidths;
+    std::array<RealType, Dim> BoxCenter;
+
+    if(TbfParams::ExistParameter(argc, argv, {"-f", "--file"})){
+        const std::string filename = TbfParams::GetStr(argc, argv, {"-f", "--file"}, "");
+        TbfFmaLoader<RealType, Dim, Dim+1> loader(filename);
+
+        if(!loader.isOpen()){
+            std::cout << "[Error] There is a problem, the given file '" << filename << "' cannot be open." << std::endl;
+            return -1;
+        }
+
+        TbfTimer timerAscii;
+        particlePositions = loader.loadAllParticles();
+        timerAscii.stop();
+        std::cout << "Load the ASCII file in " << timerAscii.getElapsed() << "s" << std::endl;
+
+        BoxWidths = loader.getBoxWidths();
+        BoxCenter = loader.getBoxCenter();
+    }
+    else {
+        BoxWidths = std::array<RealType, Dim>{{1, 1, 1}};
+        BoxCenter = std::array<RealType, Dim>{{0.5, 0.5, 0.5}};
+
+        const long int nbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 10000000);
+
+        TbfRandom<RealType, Dim> randomGenerator(BoxWidths);
+
+        particlePositions.resize(nbParticles);
+
+        for(long int idxPart = 0 ; idxPart < nbParticles ; ++idxPart){
+            auto position = randomGenerator.getNewItem();
+            particlePositions[idxPart][0] = position[0];
+            particlePositions[idxPart][1] = position[1];
+            particlePositions[idxPart][2] = position[2];
+            particlePositions[idxPart][3] = 0.1;
+        }
+    }
+
+    const long int nbParticles = static_cast<long int>(particlePositions.size());
+    std::cout << "Number of particles = " << nbParticles << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::string outputFilename = TbfParams::GetStr(argc, argv, {"-o", "--output"}, "tbf-particles.bfma");
+
+    {
+        TbfTimer timerWrite;
+        TbfBinaryFmaWriter<RealType, Dim> writer(outputFilename);
+        if(!writer.isOpen() || !writer.writeParticles(BoxCenter, BoxWidths, nbParticles, particlePositions)){
+            std::cout << "[Error] Cannot write the file '" << outputFilename << "'." << std::endl;
+            return -1;
+        }
+        timerWrite.stop();
+        std::cout << "Write the binary file in " << timerWrite.getElapsed() << "s" << std::endl;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 6);
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    constexpr long int NbRhsValuesPerParticle = 4;
+    using TreeClass = TbfTree<RealType, RealType, NbDataValuesPerParticle, RealType, NbRhsValuesPerParticle,
+                              std::array<RealType,1>, std::array<RealType,1>>;
+
+    TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(outputFilename);
+    if(!loader.isOpen()){
+        std::cout << "[Error] Cannot read the file '" << outputFilename << "'." << std::endl;
+        return -1;
+    }
+    std::cout << loader << std::endl;
+
+    {
+        TbfTimer timerLoad;
+        const auto loadedParticles = loader.loadAllParticles();
+        timerLoad.stop();
+        std::cout << "Load the binary file in " << timerLoad.getElapsed() << "s" << std::endl;
+
+        TbfTimer timerBuildTree;
+        TreeClass tree(configuration, loadedParticles);
+        timerBuildTree.stop();
+        std::cout << "Build the tree from the loaded particles in " << timerBuildTree.getElapsed() << "s" << std::endl;
+    }
+    {
+        TbfTimer timerBuildTree;
+        TreeClass tree(configuration, loader.viewAllParticles());
+        timerBuildTree.stop();
+        std::cout << "Build the tree from the mapped file (zero-copy) in " << timerBuildTree.getElapsed() << "s" << std::endl;
+    }
+
+    if(!TbfParams::ExistParameter(argc, argv, {"-k", "--keep"})){
+        std::remove(outputFilename.c_str());
+    }
+
+    return 0;
+}
+
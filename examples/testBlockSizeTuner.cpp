@@ -0,0 +1,120 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "algorithms/tbfblocksizefinder.hpp"
+#include "algorithms/tbfblocksizetuner.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -ns, --nb-subsample: the maximum number of particles used to calibrate" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 5);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        auto position = randomGenerator.getNewItem();
+        particlePositions[idxPart][0] = position[0];
+        particlePositions[idxPart][1] = position[1];
+        particlePositions[idxPart][2] = position[2];
+        particlePositions[idxPart][3] = 0.1;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const unsigned int P = 8;
+    using ParticleDataType = RealType;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    using ParticleRhsType = RealType;
+    constexpr long int NbRhsValuesPerParticle = 4;
+
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using KernelClass = FRotationKernel<RealType, P>;
+    using AlgorithmClass = TbfAlgorithmSelecter::type<RealType, KernelClass>;
+    using TreeClass = TbfTree<RealType,
+                              ParticleDataType,
+                              NbDataValuesPerParticle,
+                              ParticleRhsType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass>;
+
+    std::cout << "Algorithm name " << AlgorithmClass::GetName() << std::endl;
+    std::cout << "Number of threads " << AlgorithmClass::GetNbThreads() << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    TbfBlockSizeTuner::Parameters parameters;
+    parameters.maxSubsampleSize = TbfParams::GetValue<long int>(argc, argv, {"-ns", "--nb-subsample"}, 20000);
+
+    TbfTimer timerTune;
+    const auto result = TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(configuration, particlePositions, parameters);
+    timerTune.stop();
+
+    std::cout << "Calibration on " << result.subsampleSize << " particles (tree height "
+              << result.subsampleTreeHeight << ") in " << timerTune.getElapsed() << "s" << std::endl;
+    for(const auto& timing : result.timings){
+        std::cout << " - block size " << timing.first << " => " << timing.second << "s" << std::endl;
+    }
+
+    TbfTimer timerCached;
+    const auto resultCached = TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(configuration, particlePositions, parameters);
+    timerCached.stop();
+    std::cout << "Second call " << (resultCached.fromCache ? "from cache" : "not cached") << " in " << timerCached.getElapsed() << "s" << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int estimatedBlockSize = TbfBlockSizeFinder::Estimate<RealType>(particlePositions, configuration, AlgorithmClass::GetNbThreads());
+
+    for(const auto& nameAndBlockSize : std::vector<std::pair<const char*, long int>>{{"Estimated", estimatedBlockSize},
+                                                                                      {"Tuned", result.blockSize}}){
+        const long int blockSize = nameAndBlockSize.second;
+        TreeClass tree(configuration, TbfUtils::make_const(particlePositions), blockSize);
+        std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(configuration));
+
+        TbfTimer timerExecute;
+        algorithm->execute(tree);
+        timerExecute.stop();
+
+        std::cout << nameAndBlockSize.first << " block size " << blockSize
+                  << " => execute in " << timerExecute.getElapsed() << "s" << std::endl;
+    }
+
+    return 0;
+}
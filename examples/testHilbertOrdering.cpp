@@ -0,0 +1,177 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfhilbertspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <random>
+#include <set>
+
+
+template <class TreeClass>
+void CountInterGroupInteractions(TreeClass& inTree, const char* inName){
+    const auto& spaceSystem = inTree.getSpacialSystem();
+
+    long int nbM2LInteractions = 0;
+    std::set<std::pair<const void*, const void*>> m2lGroupPairs;
+    for(long int idxLevel = 2 ; idxLevel < inTree.getHeight() ; ++idxLevel){
+        for(const auto& group : inTree.getCellGroupsAtLevel(idxLevel)){
+            const auto externalInteractions = spaceSystem.getInteractionListForBlock(group, idxLevel).second;
+            for(const auto& interaction : externalInteractions){
+                auto foundGroup = inTree.findGroupWithCell(idxLevel, interaction.indexSrc);
+                if(foundGroup){
+                    nbM2LInteractions += 1;
+                    m2lGroupPairs.insert(std::make_pair(&group, &(*foundGroup).first.get()));
+                }
+            }
+        }
+    }
+
+    long int nbP2PInteractions = 0;
+    std::set<std::pair<const void*, const void*>> p2pGroupPairs;
+    for(const auto& group : inTree.getParticleGroups()){
+        const auto externalInteractions = spaceSystem.getNeighborListForBlock(group, inTree.getHeight()-1).second;
+        for(const auto& interaction : externalInteractions){
+            auto foundGroup = inTree.findGroupWithLeaf(interaction.indexSrc);
+            if(foundGroup){
+                nbP2PInteractions += 1;
+                p2pGroupPairs.insert(std::make_pair(&group, &(*foundGroup).first.get()));
+            }
+        }
+    }
+
+    std::cout << " - " << inName << " inter-group M2L: " << nbM2LInteractions << " interactions between "
+              << m2lGroupPairs.size() << " pairs of groups" << std::endl;
+    std::cout << " - " << inName << " inter-group P2P: " << nbP2PInteractions << " interactions between "
+              << p2pGroupPairs.size() << " pairs of groups" << std::endl;
+}
+
+template <class SpaceIndexType, class RealType, long int Dim>
+void Bench(const char* inName, const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+           const std::vector<std::array<RealType, Dim+1>>& inParticlePositions, const long int inNbElementsPerGroup){
+    const unsigned int P = 8;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    constexpr long int NbRhsValuesPerParticle = 4;
+
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using KernelClass = FRotationKernel<RealType, P, SpaceIndexType>;
+    using AlgorithmClass = typename TbfAlgorithmSelecter::type<RealType, KernelClass, SpaceIndexType>;
+    using TreeClass = TbfTree<RealType,
+                              RealType,
+                              NbDataValuesPerParticle,
+                              RealType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass,
+                              SpaceIndexType>;
+
+    TbfTimer timerBuildTree;
+    TreeClass tree(inConfiguration, inParticlePositions, inNbElementsPerGroup);
+    timerBuildTree.stop();
+    std::cout << " - " << inName << " build the tree in " << timerBuildTree.getElapsed() << "s" << std::endl;
+
+    CountInterGroupInteractions(tree, inName);
+
+    std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(inConfiguration));
+    TbfTimer timerExecute;
+    algorithm->execute(tree);
+    timerExecute.stop();
+    std::cout << " - " << inName << " execute in " << timerExecute.getElapsed() << "s" << std::endl;
+}
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -gs, --group-size: the number of elements per group" << std::endl;
+        std::cout << "[HELP]   -nc, --nb-clusters: the number of clusters for the clustered distribution" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 5);
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+    const long int NbElementsPerGroup = TbfParams::GetValue<long int>(argc, argv, {"-gs", "--group-size"}, 100);
+    const long int NbClusters = TbfParams::GetValue<long int>(argc, argv, {"-nc", "--nb-clusters"}, 8);
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    std::cout << "Tree height = " << TreeHeight << ", number of particles = " << NbParticles
+              << ", number of elements per group = " << NbElementsPerGroup << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::vector<std::array<RealType, Dim+1>> uniformPositions(NbParticles);
+    {
+        TbfRandom<RealType, Dim> randomGenerator(BoxWidths);
+        for(auto& particle : uniformPositions){
+            const auto position = randomGenerator.getNewItem();
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                particle[idxDim] = position[idxDim];
+            }
+            particle[Dim] = 0.1;
+        }
+    }
+
+    // Gaussian clusters with random centers and widths
+    std::vector<std::array<RealType, Dim+1>> clusteredPositions(NbParticles);
+    {
+        std::mt19937_64 randomEngine(0);
+        std::uniform_real_distribution<RealType> centerDistribution(0.1, 0.9);
+        std::uniform_real_distribution<RealType> sigmaDistribution(0.01, 0.08);
+
+        std::vector<std::array<RealType, Dim>> clusterCenters(NbClusters);
+        std::vector<RealType> clusterSigmas(NbClusters);
+        for(long int idxCluster = 0 ; idxCluster < NbClusters ; ++idxCluster){
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                clusterCenters[idxCluster][idxDim] = centerDistribution(randomEngine);
+            }
+            clusterSigmas[idxCluster] = sigmaDistribution(randomEngine);
+        }
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            const long int idxCluster = idxPart % NbClusters;
+            std::normal_distribution<RealType> positionDistribution(0, clusterSigmas[idxCluster]);
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                const RealType position = clusterCenters[idxCluster][idxDim] + positionDistribution(randomEngine);
+                clusteredPositions[idxPart][idxDim] = std::min(std::max(position, RealType(0)), BoxWidths[idxDim]);
+            }
+            clusteredPositions[idxPart][Dim] = 0.1;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using MortonType = TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>>;
+    using HilbertType = TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>>;
+
+    std::cout << "Uniform distribution:" << std::endl;
+    Bench<MortonType>("Morton", configuration, uniformPositions, NbElementsPerGroup);
+    Bench<HilbertType>("Hilbert", configuration, uniformPositions, NbElementsPerGroup);
+
+    std::cout << "Clustered distribution (" << NbClusters << " clusters):" << std::endl;
+    Bench<MortonType>("Morton", configuration, clusteredPositions, NbElementsPerGroup);
+    Bench<HilbertType>("Hilbert", configuration, clusteredPositions, NbElementsPerGroup);
+
+    return 0;
+}
+
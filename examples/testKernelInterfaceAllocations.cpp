@@ -0,0 +1,132 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Count the allocations performed by the process
+namespace {
+std::atomic<long int> NbAllocations(0);
+}
+
+void* operator new(std::size_t inSize){
+    NbAllocations += 1;
+    if(void* ptr = std::malloc(inSize == 0 ? 1 : inSize)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t inSize){
+    return operator new(inSize);
+}
+
+void operator delete(void* inPtr) noexcept{
+    std::free(inPtr);
+}
+
+void operator delete[](void* inPtr) noexcept{
+    std::free(inPtr);
+}
+
+void operator delete(void* inPtr, std::size_t) noexcept{
+    std::free(inPtr);
+}
+
+void operator delete[](void* inPtr, std::size_t) noexcept{
+    std::free(inPtr);
+}
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nr, --nb-repeat: the number of times the far field is computed" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 6);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+    const long int NbRepeat = TbfParams::GetValue<long int>(argc, argv, {"-nr", "--nb-repeat"}, 5);
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        particlePositions[idxPart] = randomGenerator.getNewItem();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using ParticleDataType = RealType;
+    constexpr long int NbDataValuesPerParticle = Dim;
+    using ParticleRhsType = long int;
+    constexpr long int NbRhsValuesPerParticle = 1;
+    using MultipoleClass = std::array<long int,1>;
+    using LocalClass = std::array<long int,1>;
+    const long int inNbElementsPerBlock = 50;
+    const bool inOneGroupPerParent = false;
+    using TreeClass = TbfTree<RealType,
+                              ParticleDataType,
+                              NbDataValuesPerParticle,
+                              ParticleRhsType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass>;
+    using KernelClass = TbfTestKernel<RealType>;
+    using AlgorithmClass = TbfAlgorithm<RealType, KernelClass>;
+
+    TreeClass tree(configuration, particlePositions, inNbElementsPerBlock, inOneGroupPerParent);
+    AlgorithmClass algorithm(configuration);
+
+    // A first execution builds the interaction lists
+    algorithm.execute(tree);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const int farFieldOperations = (TbfAlgorithmUtils::TbfM2M | TbfAlgorithmUtils::TbfM2L | TbfAlgorithmUtils::TbfL2L);
+
+    for(const auto& nameAndOperation : std::vector<std::pair<const char*, int>>{{"M2M", TbfAlgorithmUtils::TbfM2M},
+                                                                                {"M2L", TbfAlgorithmUtils::TbfM2L},
+                                                                                {"L2L", TbfAlgorithmUtils::TbfL2L},
+                                                                                {"Far field", farFieldOperations}}){
+        TbfTimer timer;
+        const long int nbAllocationsBefore = NbAllocations;
+        for(long int idxRepeat = 0 ; idxRepeat < NbRepeat ; ++idxRepeat){
+            algorithm.execute(tree, nameAndOperation.second);
+        }
+        const long int nbAllocations = NbAllocations - nbAllocationsBefore;
+        timer.stop();
+
+        std::cout << nameAndOperation.first << ": " << double(nbAllocations)/double(NbRepeat)
+                  << " allocations per execution, " << timer.getElapsed()/double(NbRepeat) << "s per execution" << std::endl;
+    }
+
+    return 0;
+}
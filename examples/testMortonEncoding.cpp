@@ -0,0 +1,151 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfmortonbits.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+
+#include <iostream>
+#include <random>
+
+
+template <long int Dim, class FuncClass>
+double BenchLoop(const long int inNbRepeat, FuncClass&& inFunc){
+    double bestTime = 0;
+    for(long int idxRepeat = 0 ; idxRepeat < inNbRepeat ; ++idxRepeat){
+        TbfTimer timer;
+        inFunc();
+        timer.stop();
+        if(idxRepeat == 0 || timer.getElapsed() < bestTime){
+            bestTime = timer.getElapsed();
+        }
+    }
+    return bestTime;
+}
+
+template <long int Dim>
+void BenchDim(const long int inNbItems, const long int inTreeHeight, const long int inNbRepeat){
+    using RealType = double;
+
+    std::cout << "Dim = " << Dim << ", tree height = " << inTreeHeight << ", number of items = " << inNbItems << std::endl;
+
+    std::mt19937_64 randomEngine(0);
+    std::vector<std::array<long int,Dim>> boxPositions(inNbItems);
+    for(auto& boxPos : boxPositions){
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            boxPos[idxDim] = static_cast<long int>(randomEngine() & ((1UL << (inTreeHeight-1)) - 1));
+        }
+    }
+
+    std::vector<long int> indexes(inNbItems);
+    long int checksum = 0;
+
+    auto benchEncode = [&](const char* inName, auto&& inEncode){
+        const double time = BenchLoop<Dim>(inNbRepeat, [&](){
+            for(long int idxItem = 0 ; idxItem < inNbItems ; ++idxItem){
+                indexes[idxItem] = inEncode(boxPositions[idxItem]);
+            }
+        });
+        long int sum = 0;
+        for(const long int index : indexes){
+            sum += index;
+        }
+        if(checksum == 0){
+            checksum = sum;
+        }
+        std::cout << " - Encode " << inName << ": " << time << "s" << (sum == checksum ? "" : " [Error] different result") << std::endl;
+        return time;
+    };
+
+    auto benchDecode = [&](const char* inName, auto&& inDecode){
+        long int sum = 0;
+        const double time = BenchLoop<Dim>(inNbRepeat, [&](){
+            sum = 0;
+            for(long int idxItem = 0 ; idxItem < inNbItems ; ++idxItem){
+                const auto boxPos = inDecode(indexes[idxItem]);
+                sum += boxPos[0] + boxPos[Dim-1];
+            }
+        });
+        std::cout << " - Decode " << inName << ": " << time << "s (checksum " << sum << ")" << std::endl;
+        return time;
+    };
+
+    const double timeEncodeLoop = benchEncode("loop", [](const auto& inBoxPos){ return TbfMortonBits::EncodeLoop<Dim>(inBoxPos); });
+    if constexpr(TbfMortonBits::HasMagicBits<Dim>()){
+        const double timeEncodeMagic = benchEncode("magic bits", [](const auto& inBoxPos){ return TbfMortonBits::EncodeMagicBits<Dim>(inBoxPos); });
+        std::cout << "   Speedup magic bits/loop = " << timeEncodeLoop/timeEncodeMagic << std::endl;
+    }
+#ifdef TBF_MORTON_USE_BMI2
+    const double timeEncodeBmi2 = benchEncode("pdep", [](const auto& inBoxPos){ return TbfMortonBits::EncodeBmi2<Dim>(inBoxPos); });
+    std::cout << "   Speedup pdep/loop = " << timeEncodeLoop/timeEncodeBmi2 << std::endl;
+#endif
+
+    const double timeDecodeLoop = benchDecode("loop", [](const long int inIndex){ return TbfMortonBits::DecodeLoop<Dim>(inIndex); });
+    if constexpr(TbfMortonBits::HasMagicBits<Dim>()){
+        const double timeDecodeMagic = benchDecode("magic bits", [](const long int inIndex){ return TbfMortonBits::DecodeMagicBits<Dim>(inIndex); });
+        std::cout << "   Speedup magic bits/loop = " << timeDecodeLoop/timeDecodeMagic << std::endl;
+    }
+#ifdef TBF_MORTON_USE_BMI2
+    const double timeDecodeBmi2 = benchDecode("pext", [](const long int inIndex){ return TbfMortonBits::DecodeBmi2<Dim>(inIndex); });
+    std::cout << "   Speedup pext/loop = " << timeDecodeLoop/timeDecodeBmi2 << std::endl;
+#endif
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::array<RealType, Dim> BoxWidths;
+    std::array<RealType, Dim> BoxCenter;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        BoxWidths[idxDim] = 1;
+        BoxCenter[idxDim] = 0.5;
+    }
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(inTreeHeight, BoxWidths, BoxCenter);
+    const TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>> morton(configuration);
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+    std::vector<std::array<RealType, Dim>> positions(inNbItems);
+    for(auto& position : positions){
+        position = randomGenerator.getNewItem();
+    }
+
+    const double timePerPosition = BenchLoop<Dim>(inNbRepeat, [&](){
+        for(long int idxItem = 0 ; idxItem < inNbItems ; ++idxItem){
+            indexes[idxItem] = morton.getIndexFromPosition(positions[idxItem]);
+        }
+    });
+    std::cout << " - getIndexFromPosition: " << timePerPosition << "s" << std::endl;
+
+    std::vector<long int> batchedIndexes(inNbItems);
+    const double timeBatched = BenchLoop<Dim>(inNbRepeat, [&](){
+        morton.getIndexesFromPositions(positions, 0, inNbItems, batchedIndexes.data());
+    });
+    std::cout << " - getIndexesFromPositions: " << timeBatched << "s" << (batchedIndexes == indexes ? "" : " [Error] different result") << std::endl;
+    std::cout << "   Speedup batched/per position = " << timePerPosition/timeBatched << std::endl;
+}
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-items: the number of indexes/positions" << std::endl;
+        std::cout << "[HELP]   -nr, --nb-repeat: the number of times each test is performed" << std::endl;
+        return 1;
+    }
+
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 10);
+    const long int NbItems = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-items"}, 4000000);
+    const long int NbRepeat = TbfParams::GetValue<long int>(argc, argv, {"-nr", "--nb-repeat"}, 3);
+
+    std::cout << "BMI2 is " << (TbfMortonBits::HasBmi2() ? "enabled" : "disabled") << std::endl;
+
+    BenchDim<2>(NbItems, TreeHeight, NbRepeat);
+    BenchDim<3>(NbItems, TreeHeight, NbRepeat);
+
+    return 0;
+}
+
@@ -0,0 +1,127 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -gs, --group-size: the number of elements per group" << std::endl;
+        std::cout << "[HELP]   -nt, --nb-threads: the maximum number of threads (the number of threads is doubled up to it)" << std::endl;
+        std::cout << "[HELP]   -nl, --nb-loops: the number of executions for each configuration" << std::endl;
+        std::cout << "[HELP]   -far, --far-field: also compute the far field" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 5);
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 1000000);
+    const long int NbElementsPerGroup = TbfParams::GetValue<long int>(argc, argv, {"-gs", "--group-size"}, 256);
+    const long int MaxNbThreads = TbfParams::GetValue<long int>(argc, argv, {"-nt", "--nb-threads"}, omp_get_max_threads());
+    const long int NbLoops = TbfParams::GetValue<long int>(argc, argv, {"-nl", "--nb-loops"}, 3);
+    const int OperationToProceed = (TbfParams::ExistParameter(argc, argv, {"-far", "--far-field"}) ?
+                                        TbfAlgorithmUtils::TbfNearAndFarFields : TbfAlgorithmUtils::TbfNearField);
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    std::cout << "Tree height = " << TreeHeight << ", number of particles = " << NbParticles
+              << ", number of elements per group = " << NbElementsPerGroup << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        auto minipos = randomGenerator.getNewItem();
+        particlePositions[idxPart] = std::array<RealType, Dim+1>{minipos[0], minipos[1], minipos[2], RealType(0.01)};
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const unsigned int P = 8;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    constexpr long int NbRhsValuesPerParticle = 4;
+
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using KernelClass = FRotationKernel<RealType, P, SpaceIndexType>;
+    using AlgorithmClass = TbfOpenmpAlgorithm<RealType, KernelClass, SpaceIndexType>;
+    using TreeClass = TbfTree<RealType,
+                              RealType,
+                              NbDataValuesPerParticle,
+                              RealType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass,
+                              SpaceIndexType>;
+
+    TreeClass tree(configuration, particlePositions, NbElementsPerGroup);
+    std::cout << "Number of particle groups " << tree.getNbParticleGroups() << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::vector<long int> threadCounts;
+    for(long int nbThreads = 1 ; nbThreads < MaxNbThreads ; nbThreads *= 2){
+        threadCounts.push_back(nbThreads);
+    }
+    threadCounts.push_back(MaxNbThreads);
+
+    std::array<double, 2> sequentialTimes{{0, 0}};
+
+    for(const long int nbThreads : threadCounts){
+        omp_set_num_threads(int(nbThreads));
+
+        for(const bool privateAccumulation : {false, true}){
+            AlgorithmClass algorithm(configuration);
+            algorithm.setPrivateP2PAccumulation(privateAccumulation);
+
+            // The first execution builds the interaction lists
+            algorithm.execute(tree, OperationToProceed);
+
+            TbfTimer timerExecute;
+            for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+                algorithm.execute(tree, OperationToProceed);
+            }
+            timerExecute.stop();
+
+            const double averageTime = timerExecute.getElapsed()/double(NbLoops);
+            if(nbThreads == 1){
+                sequentialTimes[privateAccumulation] = averageTime;
+            }
+
+            std::cout << " - " << nbThreads << " threads, " << (privateAccumulation ? "private accumulation" : "commute             ")
+                      << " : " << averageTime << "s (speedup " << sequentialTimes[privateAccumulation]/averageTime << ")" << std::endl;
+        }
+    }
+
+    return 0;
+}
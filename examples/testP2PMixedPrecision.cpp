@@ -0,0 +1,184 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "kernels/counterkernels/tbfinteractiontimer.hpp"
+#include "kernels/P2P/FP2PR.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <vector>
+
+// Compare the native (double) and mixed precision P2P in accuracy and speed,
+// first with a direct computation and then inside a full FMM with the rotation kernel.
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nbl, --nb-loops: the number of FMM iterations per precision" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const long int nbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 20000);
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 4);
+    const long int NbLoops = TbfParams::GetValue<long int>(argc, argv, {"-nbl", "--nb-loops"}, 3);
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions(nbParticles);
+    for(long int idxPart = 0 ; idxPart < nbParticles ; ++idxPart){
+        auto position = randomGenerator.getNewItem();
+        particlePositions[idxPart][0] = position[0];
+        particlePositions[idxPart][1] = position[1];
+        particlePositions[idxPart][2] = position[2];
+        particlePositions[idxPart][3] = 0.1;
+    }
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << nbParticles << std::endl;
+    std::cout << " - SIMD = " << FP2PRSimd::GetIsaName(FP2PRSimd::GetIsa()) << std::endl;
+    std::cout << " - Mixed precision available = " << (FP2PRSimd::IsMixedAvailable(FP2PRSimd::GetIsa()) ? "yes" : "no") << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+    /// Direct computation
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::array<std::vector<RealType>, 4> particles;
+    for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+        particles[idxValue].resize(nbParticles);
+        for(long int idxPart = 0 ; idxPart < nbParticles ; ++idxPart){
+            particles[idxValue][idxPart] = particlePositions[idxPart][idxValue];
+        }
+    }
+    std::array<RealType*, 4> particlesPtr{{particles[0].data(), particles[1].data(), particles[2].data(), particles[3].data()}};
+
+    std::array<std::vector<RealType>, 4> particlesRhsReference;
+    for(auto& vec : particlesRhsReference){
+        vec.resize(nbParticles, 0);
+    }
+    std::array<RealType*, 4> particlesRhsReferencePtr{{particlesRhsReference[0].data(), particlesRhsReference[1].data(),
+                                                       particlesRhsReference[2].data(), particlesRhsReference[3].data()}};
+    {
+        TbfTimer timerDirect;
+        FP2PR::template GenericInnerScalar<RealType>(particlesPtr, particlesRhsReferencePtr, nbParticles);
+        timerDirect.stop();
+        std::cout << "Direct scalar execute in " << timerDirect.getElapsed() << "s" << std::endl;
+    }
+
+    std::cout << "[DIRECT] precision,time(s),rhs0-rel-l2,rhs1-rel-l2,rhs2-rel-l2,rhs3-rel-l2" << std::endl;
+
+    for(const FP2PR::Precision precision : {FP2PR::Precision::Native, FP2PR::Precision::Mixed}){
+        std::array<std::vector<RealType>, 4> particlesRhs;
+        for(auto& vec : particlesRhs){
+            vec.resize(nbParticles, 0);
+        }
+        std::array<RealType*, 4> particlesRhsPtr{{particlesRhs[0].data(), particlesRhs[1].data(),
+                                                  particlesRhs[2].data(), particlesRhs[3].data()}};
+
+        TbfTimer timerDirect;
+        FP2PR::template GenericInner<RealType>(precision, particlesPtr, particlesRhsPtr, nbParticles);
+        timerDirect.stop();
+
+        std::cout << "[DIRECT] " << FP2PR::GetPrecisionName(precision) << "," << timerDirect.getElapsed();
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            TbfAccuracyChecker<RealType> accuracy;
+            accuracy.addManyValues(particlesRhsReference[idxValue], particlesRhs[idxValue], nbParticles);
+            std::cout << "," << accuracy.getRelativeL2Norm();
+        }
+        std::cout << std::endl;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+    /// FMM
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const unsigned int P = 12;
+    using ParticleDataType = RealType;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    using ParticleRhsType = RealType;
+    constexpr long int NbRhsValuesPerParticle = 4;
+
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using KernelClass = TbfInteractionTimer<FRotationKernel<RealType, P>>;
+    using AlgorithmClass = TbfAlgorithmSelecter::type<RealType, KernelClass>;
+    using TreeClass = TbfTree<RealType,
+                              ParticleDataType,
+                              NbDataValuesPerParticle,
+                              ParticleRhsType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass>;
+
+    std::cout << "[FMM] precision,loop,time(s),p2p-time(s),rhs0-rel-l2,rhs1-rel-l2,rhs2-rel-l2,rhs3-rel-l2" << std::endl;
+
+    for(const FP2PR::Precision precision : {FP2PR::Precision::Native, FP2PR::Precision::Mixed}){
+        // Here we put the kernel and the algorithm in the heap to make sure not to overflow the stack
+        std::unique_ptr<KernelClass> kernel(new KernelClass(configuration));
+        kernel->setP2PPrecision(precision);
+
+        // The algorithm copies the kernel (with its precision) for each thread
+        std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(configuration, *kernel));
+
+        for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+            // A new tree to start from empty cells and results
+            TreeClass tree(configuration, TbfUtils::make_const(particlePositions));
+
+            TbfTimer timerExecute;
+            algorithm->execute(tree);
+            timerExecute.stop();
+
+            // The timers are cumulated over the iterations
+            KernelClass::ReduceType timers;
+            algorithm->applyToAllKernels([&](const auto& inKernel){
+                timers = KernelClass::ReduceType::Reduce(timers, inKernel.getReduceData());
+            });
+
+            std::array<TbfAccuracyChecker<RealType>, NbRhsValuesPerParticle> partcilesRhsAccuracy;
+            tree.applyToAllLeaves([&particlesRhsReference,&partcilesRhsAccuracy]
+                                  (auto&& leafHeader, const long int* particleIndexes,
+                                  const std::array<ParticleDataType*, 4> /*particleDataPtr*/,
+                                  const std::array<ParticleRhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                        partcilesRhsAccuracy[idxValue].addValues(particlesRhsReference[idxValue][particleIndexes[idxPart]],
+                                                                 particleRhsPtr[idxValue][idxPart]);
+                    }
+                }
+            });
+
+            std::cout << "[FMM] " << FP2PR::GetPrecisionName(precision) << "," << idxLoop << "," << timerExecute.getElapsed()
+                      << "," << (timers.P2P.getCumulated() + timers.P2PInner.getCumulated())/double(idxLoop+1);
+            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                std::cout << "," << partcilesRhsAccuracy[idxValue].getRelativeL2Norm();
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftimer.hpp"
+#include "kernels/P2P/FP2PR.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <vector>
+
+// Compare the mutual P2P with a periodic image of the sources when the shifted sources are copied
+// (as TbfPeriodicShifter::Neighbor::DuplicatePositionsAndApplyShift does)
+// and when the shift is given to the P2P, for different numbers of particles per leaf.
+
+template <class RealType>
+struct LeafBuffer{
+    std::array<std::vector<RealType>, 4> values;
+    std::array<std::vector<RealType>, 4> rhs;
+
+    LeafBuffer(const long int inNbParticles, TbfRandom<RealType, 3>& inRandomGenerator){
+        for(auto& vec : values){
+            vec.resize(inNbParticles);
+        }
+        for(auto& vec : rhs){
+            vec.resize(inNbParticles, 0);
+        }
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            const auto pos = inRandomGenerator.getNewItem();
+            values[0][idxPart] = pos[0];
+            values[1][idxPart] = pos[1];
+            values[2][idxPart] = pos[2];
+            values[3][idxPart] = RealType(0.01);
+        }
+    }
+
+    std::array<const RealType*, 4> getValues() const{
+        return {{values[0].data(), values[1].data(), values[2].data(), values[3].data()}};
+    }
+
+    std::array<RealType*, 4> getRhs(){
+        return {{rhs[0].data(), rhs[1].data(), rhs[2].data(), rhs[3].data()}};
+    }
+};
+
+template <class RealType>
+void Benchmark(const long int inNbInteractions){
+    std::cout << "[SHIFT] type,particles-per-leaf,nb-loops,copy(s),shift(s),speedup,max-rel-l2" << std::endl;
+
+    const std::array<RealType, 3> BoxWidths{{1, 1, 1}};
+    TbfRandom<RealType, 3> randomGenerator(BoxWidths);
+    // The sources are on the other side of the box
+    const std::array<RealType, 3> sourcesShift{{-1, 0, 0}};
+
+    for(long int nbParticles = 16 ; nbParticles <= 1024 ; nbParticles *= 4){
+        LeafBuffer<RealType> sources(nbParticles, randomGenerator);
+        LeafBuffer<RealType> targets(nbParticles, randomGenerator);
+        LeafBuffer<RealType> sourcesShifted = sources;
+        LeafBuffer<RealType> targetsShifted = targets;
+
+        const long int nbLoops = std::max(1L, inNbInteractions/(nbParticles*nbParticles));
+
+        TbfTimer timerCopy;
+        for(long int idxLoop = 0 ; idxLoop < nbLoops ; ++idxLoop){
+            std::array<RealType*, 4> copyPositions;
+            for(long int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                copyPositions[idxValue] = new RealType[nbParticles];
+                for(long int idxPart = 0 ; idxPart < nbParticles ; ++idxPart){
+                    copyPositions[idxValue][idxPart] = sources.values[idxValue][idxPart] + (idxValue < 3 ? sourcesShift[idxValue] : 0);
+                }
+            }
+            const std::array<const RealType*, 4> copySources{{copyPositions[0], copyPositions[1], copyPositions[2], copyPositions[3]}};
+            auto sourcesRhs = sources.getRhs();
+            auto targetsRhs = targets.getRhs();
+            FP2PR::template FullMutual<RealType>(FP2PR::Precision::Native, copySources, sourcesRhs, nbParticles,
+                                                 targets.getValues(), targetsRhs, nbParticles);
+            for(auto ptr : copyPositions){
+                delete[] ptr;
+            }
+        }
+        timerCopy.stop();
+
+        TbfTimer timerShift;
+        for(long int idxLoop = 0 ; idxLoop < nbLoops ; ++idxLoop){
+            auto sourcesRhs = sourcesShifted.getRhs();
+            auto targetsRhs = targetsShifted.getRhs();
+            FP2PR::template FullMutual<RealType>(FP2PR::Precision::Native, sourcesShifted.getValues(), sourcesRhs, nbParticles,
+                                                 targetsShifted.getValues(), targetsRhs, nbParticles, sourcesShift);
+        }
+        timerShift.stop();
+
+        RealType maxRelativeL2 = 0;
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            TbfAccuracyChecker<RealType> accuracySources;
+            accuracySources.addManyValues(sources.rhs[idxValue].data(), sourcesShifted.rhs[idxValue].data(), nbParticles);
+            TbfAccuracyChecker<RealType> accuracyTargets;
+            accuracyTargets.addManyValues(targets.rhs[idxValue].data(), targetsShifted.rhs[idxValue].data(), nbParticles);
+            maxRelativeL2 = std::max(maxRelativeL2, std::max(accuracySources.getRelativeL2Norm(), accuracyTargets.getRelativeL2Norm()));
+        }
+
+        std::cout << "[SHIFT] " << (std::is_same<RealType, float>::value ? "float" : "double") << "," << nbParticles << ","
+                  << nbLoops << "," << timerCopy.getElapsed() << "," << timerShift.getElapsed() << ","
+                  << timerCopy.getElapsed()/timerShift.getElapsed() << "," << maxRelativeL2 << std::endl;
+    }
+}
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -ni, --nb-interactions: the number of interactions for each leaf size" << std::endl;
+        return 1;
+    }
+
+    const long int NbInteractions = TbfParams::GetValue<long int>(argc, argv, {"-ni", "--nb-interactions"}, 200000000);
+
+    std::cout << "SIMD = " << FP2PRSimd::GetIsaName(FP2PRSimd::GetIsa()) << std::endl;
+
+    Benchmark<double>(NbInteractions);
+    Benchmark<float>(NbInteractions);
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftimer.hpp"
+#include "kernels/P2P/FP2PRSimd.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <vector>
+
+// Compare the mutual P2P between two leaves with and without the tiling of the sources,
+// for different numbers of particles per leaf.
+
+template <class RealType>
+struct LeafBuffer{
+    std::array<std::vector<RealType>, 4> values;
+    std::array<std::vector<RealType>, 4> rhs;
+
+    LeafBuffer(const long int inNbParticles, TbfRandom<RealType, 3>& inRandomGenerator, const RealType inShift){
+        for(auto& vec : values){
+            vec.resize(inNbParticles);
+        }
+        for(auto& vec : rhs){
+            vec.resize(inNbParticles, 0);
+        }
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            const auto pos = inRandomGenerator.getNewItem();
+            values[0][idxPart] = pos[0] + inShift;
+            values[1][idxPart] = pos[1];
+            values[2][idxPart] = pos[2];
+            values[3][idxPart] = RealType(0.01);
+        }
+    }
+
+    std::array<const RealType*, 4> getValues() const{
+        return {{values[0].data(), values[1].data(), values[2].data(), values[3].data()}};
+    }
+
+    std::array<RealType*, 4> getRhs(){
+        return {{rhs[0].data(), rhs[1].data(), rhs[2].data(), rhs[3].data()}};
+    }
+};
+
+template <class RealType>
+void Benchmark(const long int inNbInteractions){
+    std::cout << "[TILING] type,particles-per-leaf,nb-loops,stream(s),tiled(s),speedup,max-rel-l2" << std::endl;
+
+    const std::array<RealType, 3> BoxWidths{{1, 1, 1}};
+    TbfRandom<RealType, 3> randomGenerator(BoxWidths);
+
+    for(long int nbParticles = 64 ; nbParticles <= 16384 ; nbParticles *= 4){
+        LeafBuffer<RealType> sources(nbParticles, randomGenerator, 1);
+        LeafBuffer<RealType> targets(nbParticles, randomGenerator, 0);
+        LeafBuffer<RealType> sourcesTiled = sources;
+        LeafBuffer<RealType> targetsTiled = targets;
+
+        const long int nbLoops = std::max(1L, inNbInteractions/(nbParticles*nbParticles));
+
+        std::array<double, 2> timings;
+        for(const bool useTiling : {false, true}){
+            LeafBuffer<RealType>& loopSources = (useTiling ? sourcesTiled : sources);
+            LeafBuffer<RealType>& loopTargets = (useTiling ? targetsTiled : targets);
+
+            TbfTimer timer;
+            for(long int idxLoop = 0 ; idxLoop < nbLoops ; ++idxLoop){
+                FP2PRSimd::FullMutual<RealType>(FP2PRSimd::GetIsa(), loopSources.getValues(), loopSources.getRhs(), nbParticles,
+                                                loopTargets.getValues(), loopTargets.getRhs(), nbParticles, useTiling);
+            }
+            timer.stop();
+            timings[useTiling ? 1 : 0] = timer.getElapsed();
+        }
+
+        RealType maxRelativeL2 = 0;
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            TbfAccuracyChecker<RealType> accuracySources;
+            accuracySources.addManyValues(sources.rhs[idxValue], sourcesTiled.rhs[idxValue], nbParticles);
+            TbfAccuracyChecker<RealType> accuracyTargets;
+            accuracyTargets.addManyValues(targets.rhs[idxValue], targetsTiled.rhs[idxValue], nbParticles);
+            maxRelativeL2 = std::max(maxRelativeL2, std::max(accuracySources.getRelativeL2Norm(), accuracyTargets.getRelativeL2Norm()));
+        }
+
+        std::cout << "[TILING] " << (std::is_same<RealType, float>::value ? "float" : "double") << "," << nbParticles << ","
+                  << nbLoops << "," << timings[0] << "," << timings[1] << "," << timings[0]/timings[1] << "," << maxRelativeL2 << std::endl;
+    }
+}
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -ni, --nb-interactions: the number of interactions for each leaf size" << std::endl;
+        return 1;
+    }
+
+    const long int NbInteractions = TbfParams::GetValue<long int>(argc, argv, {"-ni", "--nb-interactions"}, 500000000);
+
+    std::cout << "SIMD = " << FP2PRSimd::GetIsaName(FP2PRSimd::GetIsa()) << std::endl;
+    std::cout << "Tile size = " << FP2PRSimd::FullMutualTileSize<double>() << " (double), "
+              << FP2PRSimd::FullMutualTileSize<float>() << " (float)" << std::endl;
+
+    Benchmark<double>(NbInteractions);
+    Benchmark<float>(NbInteractions);
+
+    return 0;
+}
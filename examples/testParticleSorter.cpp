@@ -0,0 +1,105 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbfparticlesorter.hpp"
+#include "core/tbftree.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+
+#include <iostream>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nr, --nb-repeat: the number of times each sort is performed" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 8);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 1000000);
+    const long int NbRepeat = TbfParams::GetValue<long int>(argc, argv, {"-nr", "--nb-repeat"}, 3);
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << NbParticles << std::endl;
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        particlePositions[idxPart] = randomGenerator.getNewItem();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using SorterClass = TbfParticleSorter<RealType, SpaceIndexType>;
+
+    const SpaceIndexType spaceSystem(configuration);
+
+    auto benchSorter = [&](const char* inName, const SorterClass::SortMethod inMethod){
+        double bestTime = 0;
+        long int nbLeaves = 0;
+        for(long int idxRepeat = 0 ; idxRepeat < NbRepeat ; ++idxRepeat){
+            TbfTimer timerSort;
+            SorterClass sorter(spaceSystem, particlePositions, inMethod);
+            timerSort.stop();
+            nbLeaves = sorter.getNbLeaves();
+            if(idxRepeat == 0 || timerSort.getElapsed() < bestTime){
+                bestTime = timerSort.getElapsed();
+            }
+        }
+        std::cout << inName << ": " << bestTime << "s (" << nbLeaves << " leaves)" << std::endl;
+        return bestTime;
+    };
+
+    const double timeStdSort = benchSorter("std::sort", SorterClass::SortMethod::StdSort);
+    const double timeRadix = benchSorter("Parallel radix", SorterClass::SortMethod::ParallelRadix);
+
+    std::cout << "Speedup radix/std::sort = " << timeStdSort/timeRadix << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using ParticleDataType = RealType;
+    constexpr long int NbDataValuesPerParticle = Dim;
+    using ParticleRhsType = long int;
+    constexpr long int NbRhsValuesPerParticle = 1;
+    using MultipoleClass = std::array<long int,1>;
+    using LocalClass = std::array<long int,1>;
+    using TreeClass = TbfTree<RealType,
+                              ParticleDataType,
+                              NbDataValuesPerParticle,
+                              ParticleRhsType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass>;
+
+    TbfTimer timerBuildTree;
+
+    TreeClass tree(configuration, particlePositions);
+
+    timerBuildTree.stop();
+    std::cout << "Build the tree in " << timerBuildTree.getElapsed() << "s" << std::endl;
+
+    return 0;
+}
@@ -10,11 +10,14 @@
 #include "utils/tbftimer.hpp"
 #include "kernels/counterkernels/tbfinteractioncounter.hpp"
 #include "kernels/counterkernels/tbfinteractiontimer.hpp"
+#include "kernels/counterkernels/tbfinteractionprofiler.hpp"
 
 #include "utils/tbfparams.hpp"
 
 
 #include <iostream>
+#include <fstream>
+#include <string>
 
 
 int main(int argc, char** argv){
@@ -24,6 +27,7 @@ int main(int argc, char** argv){
         std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
         std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
         std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles (when no file are given)" << std::endl;
+        std::cout << "[HELP]   -pcsv, --profile-csv: the file where the interaction profile is saved in CSV (not saved by default)" << std::endl;
         return 1;
     }
 
@@ -167,6 +171,36 @@ int main(int argc, char** argv){
         std::cout << counters << std::endl;
         std::cout << timers << std::endl;
     }
+    /////////////////////////////////////////////////////////////////////////////////////////
+    { // Same as above but with interaction profiler (cycles per call and per size)
+        using KernelClass = TbfInteractionProfiler<TbfTestKernel<RealType>>;
+        using AlgorithmClass = TbfAlgorithmSelecter::type<RealType, KernelClass>;
+
+        AlgorithmClass algorithm(configuration);
+
+        TbfTimer timerExecute;
+
+        algorithm.execute(tree);
+
+        timerExecute.stop();
+        std::cout << "Execute in " << timerExecute.getElapsed() << "s" << std::endl;
+
+        // Print the profiler's result
+        auto profile = typename KernelClass::ReduceType();
+
+        algorithm.applyToAllKernels([&](const auto& inKernel){
+            profile = KernelClass::ReduceType::Reduce(profile, inKernel.getReduceData());
+        });
+
+        std::cout << profile << std::endl;
+        // The histograms can be used to fit a cost model
+        const std::string profileFilename = TbfParams::GetStr(argc, argv, {"-pcsv", "--profile-csv"}, "");
+        if(profileFilename.size()){
+            std::ofstream profileFile(profileFilename);
+            profile.writeCsv(profileFile);
+            std::cout << "Profile saved in " << profileFilename << std::endl;
+        }
+    }
 
     return 0;
 }
@@ -0,0 +1,130 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "utils/tbftimer.hpp"
+#include "utils/tbftasktracer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <map>
+#include <string>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -gs, --group-size: the number of elements per group" << std::endl;
+        std::cout << "[HELP]   -o, --output: the trace file (Chrome trace-event format, for chrome://tracing or ui.perfetto.dev)" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 5);
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+    const long int NbElementsPerGroup = TbfParams::GetValue<long int>(argc, argv, {"-gs", "--group-size"}, 128);
+    const std::string traceFilename = TbfParams::GetStr(argc, argv, {"-o", "--output"}, "trace.json");
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        auto minipos = randomGenerator.getNewItem();
+        particlePositions[idxPart] = std::array<RealType, Dim+1>{minipos[0], minipos[1], minipos[2], RealType(0.01)};
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const unsigned int P = 8;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    constexpr long int NbRhsValuesPerParticle = 4;
+
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using KernelClass = FRotationKernel<RealType, P, SpaceIndexType>;
+    using AlgorithmClass = typename TbfAlgorithmSelecter::type<RealType, KernelClass, SpaceIndexType>;
+    using TreeClass = TbfTree<RealType,
+                              RealType,
+                              NbDataValuesPerParticle,
+                              RealType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass,
+                              SpaceIndexType>;
+
+    TreeClass tree(configuration, particlePositions, NbElementsPerGroup);
+    std::cout << "Number of particle groups " << tree.getNbParticleGroups() << std::endl;
+
+    AlgorithmClass algorithm(configuration);
+    std::cout << "Algorithm name " << algorithm.GetName() << std::endl;
+
+    // The first execution builds the interaction lists
+    algorithm.execute(tree);
+
+    TbfTaskTracer tracer;
+    algorithm.setTracer(&tracer);
+
+    TbfTimer timerExecute;
+    algorithm.execute(tree);
+    timerExecute.stop();
+    std::cout << "Execute in " << timerExecute.getElapsed() << "s" << std::endl;
+
+    algorithm.setTracer(nullptr);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::map<std::string, std::pair<long int, double>> tasksPerOperator;
+    std::vector<double> busyTimePerThread(tracer.getNbThreads(), 0);
+    for(const auto& event : tracer.getEvents()){
+        auto& operatorStat = tasksPerOperator[event.name];
+        operatorStat.first += 1;
+        operatorStat.second += double(event.endTime - event.startTime)/1e9;
+        busyTimePerThread[event.idxThread] += double(event.endTime - event.startTime)/1e9;
+    }
+
+    std::cout << "Number of traced tasks " << tracer.getEvents().size() << " on " << tracer.getNbThreads() << " threads" << std::endl;
+    for(const auto& operatorStat : tasksPerOperator){
+        std::cout << " - " << operatorStat.first << " : " << operatorStat.second.first << " tasks, "
+                  << operatorStat.second.second << "s" << std::endl;
+    }
+    for(long int idxThread = 0 ; idxThread < static_cast<long int>(busyTimePerThread.size()) ; ++idxThread){
+        std::cout << " - Thread " << idxThread << " busy " << 100*busyTimePerThread[idxThread]/timerExecute.getElapsed() << "%" << std::endl;
+    }
+
+    if(tracer.exportChromeTrace(traceFilename)){
+        std::cout << "Trace written in " << traceFilename << std::endl;
+    }
+    else{
+        std::cout << "[ERROR] Cannot write the trace in " << traceFilename << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
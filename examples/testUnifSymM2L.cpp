@@ -0,0 +1,119 @@
+#include "kernels/unifkernel/FUnifM2LHandler.hpp"
+#include "kernels/unifkernel/FUnifSymM2LHandler.hpp"
+#include "kernels/unifkernel/FInterpMatrixKernel.hpp"
+#include "utils/tbftimer.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <algorithm>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_FFTW
+// -- END --
+
+// Compare the memory and the M2L throughput of the full operator table (FUnifM2LHandler)
+// and of the symmetry-reduced operators (FUnifSymM2LHandler), for different batch sizes.
+// The symmetric handler stores the canonical operators in Fourier space and permutes
+// their frequencies when they are applied, its canonical memory in the spatial domain
+// is the size of its cache file.
+// The two handlers use different DFTs, the results are compared after the inverse DFT.
+
+template <class M2LHandlerClass, class RealType>
+double ApplyAllFarInteractions(const M2LHandlerClass& inHandler, const long int inNbPairs, const long int inNbLoops,
+                               const std::vector<const std::complex<RealType>*>& inFYs,
+                               const std::vector<std::complex<RealType>*>& inFXs){
+    TbfTimer timer;
+    for(long int idxLoop = 0 ; idxLoop < inNbLoops ; ++idxLoop){
+        for(unsigned int idxInteraction = 0 ; idxInteraction < 343 ; ++idxInteraction){
+            inHandler.applyFCBatch(idxInteraction, 2, RealType(1), inNbPairs, inFYs.data(), inFXs.data());
+        }
+    }
+    timer.stop();
+    return timer.getElapsed();
+}
+
+template <class RealType, int ORDER>
+void Benchmark(const long int inNbApplications){
+    using MatrixKernelClass = FInterpMatrixKernelR<RealType>;
+    constexpr unsigned int nnodes = ORDER*ORDER*ORDER;
+    constexpr unsigned int rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1);
+    const unsigned int TreeHeight = 5;
+    const RealType BoxWidth = 1;
+
+    const MatrixKernelClass matrixKernel;
+    const FUnifM2LHandler<RealType, ORDER, MatrixKernelClass::Type> fullHandler(&matrixKernel, TreeHeight, BoxWidth);
+    const FUnifSymM2LHandler<RealType, ORDER, MatrixKernelClass::Type> symHandler(&matrixKernel, TreeHeight, BoxWidth);
+
+    std::cout << "[MEMORY] " << (std::is_same<RealType, float>::value ? "float" : "double") << "," << ORDER << ","
+              << fullHandler.getMemory() << "," << symHandler.getMemory() << ","
+              << symHandler.getCanonicalMemory() << ","
+              << double(fullHandler.getMemory())/double(symHandler.getMemory()) << std::endl;
+
+    for(const long int nbPairs : {1L, 8L, 64L, 512L}){
+        std::vector<RealType> ys(nbPairs*nnodes);
+        for(long int idxValue = 0 ; idxValue < nbPairs*long(nnodes) ; ++idxValue){
+            ys[idxValue] = RealType(1)/RealType(idxValue%97+1) - RealType(idxValue%13)/RealType(13);
+        }
+        std::vector<std::complex<RealType>> FYsFull(nbPairs*rc);
+        std::vector<std::complex<RealType>> FYsSym(nbPairs*rc);
+        std::vector<std::complex<RealType>> FXsFull(nbPairs*rc);
+        std::vector<std::complex<RealType>> FXsSym(nbPairs*rc);
+
+        std::vector<const std::complex<RealType>*> FYsFullPtr(nbPairs);
+        std::vector<const std::complex<RealType>*> FYsSymPtr(nbPairs);
+        std::vector<std::complex<RealType>*> FXsFullPtr(nbPairs);
+        std::vector<std::complex<RealType>*> FXsSymPtr(nbPairs);
+        for(long int idxPair = 0 ; idxPair < nbPairs ; ++idxPair){
+            fullHandler.applyZeroPaddingAndDFT(&ys[idxPair*nnodes], &FYsFull[idxPair*rc]);
+            symHandler.applyZeroPaddingAndDFT(&ys[idxPair*nnodes], &FYsSym[idxPair*rc]);
+            FYsFullPtr[idxPair] = &FYsFull[idxPair*rc];
+            FYsSymPtr[idxPair] = &FYsSym[idxPair*rc];
+            FXsFullPtr[idxPair] = &FXsFull[idxPair*rc];
+            FXsSymPtr[idxPair] = &FXsSym[idxPair*rc];
+        }
+
+        const long int nbLoops = std::max(1L, inNbApplications/(343*nbPairs));
+
+        const double timeFull = ApplyAllFarInteractions(fullHandler, nbPairs, nbLoops, FYsFullPtr, FXsFullPtr);
+        const double timeSym = ApplyAllFarInteractions(symHandler, nbPairs, nbLoops, FYsSymPtr, FXsSymPtr);
+
+        TbfAccuracyChecker<RealType> accuracy;
+        for(long int idxPair = 0 ; idxPair < nbPairs ; ++idxPair){
+            RealType xFull[nnodes];
+            RealType xSym[nnodes];
+            fullHandler.unapplyZeroPaddingAndDFT(&FXsFull[idxPair*rc], xFull);
+            symHandler.unapplyZeroPaddingAndDFT(&FXsSym[idxPair*rc], xSym);
+            accuracy.addManyValues(xFull, xSym, nnodes);
+        }
+
+        const double nbApplied = double(nbLoops*343*nbPairs);
+        std::cout << "[M2L] " << (std::is_same<RealType, float>::value ? "float" : "double") << "," << ORDER << ","
+                  << nbPairs << "," << nbApplied/timeFull << "," << nbApplied/timeSym << ","
+                  << timeFull/timeSym << "," << accuracy.getRelativeL2Norm() << std::endl;
+    }
+}
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -na, --nb-applications: the number of M2L applied for each batch size" << std::endl;
+        return 1;
+    }
+
+    const long int NbApplications = TbfParams::GetValue<long int>(argc, argv, {"-na", "--nb-applications"}, 20000);
+
+    std::cout << "[MEMORY] type,order,full(B),symmetric(B),symmetric-canonical(B),ratio" << std::endl;
+    std::cout << "[M2L] type,order,batch-size,full(M2L/s),symmetric(M2L/s),speedup,rel-l2" << std::endl;
+
+    Benchmark<double, 5>(NbApplications);
+    Benchmark<double, 8>(NbApplications);
+    Benchmark<float, 8>(NbApplications);
+
+    return 0;
+}
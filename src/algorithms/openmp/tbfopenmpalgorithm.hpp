@@ -6,12 +6,17 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfinteractionplan.hpp"
+#include "utils/tbftasktracer.hpp"
 
 #include <omp.h>
 
 
 #include <cassert>
 #include <iterator>
+#include <array>
+#include <vector>
+#include <algorithm>
 
 #if _OPENMP >= 201811
 #ifndef mutexinout
@@ -40,6 +45,25 @@ protected:
 
     TbfAlgorithmUtils::TbfOperationsPriorities priorities;
 
+    TbfInteractionPlan<typename SpaceIndexType::IndexType> interactionPlan;
+
+    // The levels above this one are processed by a single task (-1 to select it from the tree)
+    long int topTreeLevel;
+
+    // When enabled, the P2P between groups write in buffers private to each thread
+    // which are added to the particle groups at the end
+    bool privateP2PAccumulation;
+
+    struct PrivateRhsBuffer{
+        std::vector<unsigned char> memory;
+        bool isUsed = false;
+    };
+    // privateRhsBuffers[idxThread][idxParticleGroup]
+    std::vector<std::vector<PrivateRhsBuffer>> privateRhsBuffers;
+
+    // Record the tasks if not null
+    TbfTaskTracer* tracer;
+
     template <class TreeClass>
     void P2M(TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -60,6 +84,7 @@ protected:
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
                 auto leafGroupObj = &(*currentLeafGroup);
                 const auto particleGroupObj = &(*currentParticleGroup);
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
 
                 const auto particleGroupObjGetDataPtr = particleGroupObj->getDataPtr();
                 auto leafGroupObjGetMultipolePtr = leafGroupObj->getMultipolePtr();
@@ -69,8 +94,9 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj, kernelsPtr) priority(priorities.getP2MPriority())
+#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj, kernelsPtr, idxGroup) priority(priorities.getP2MPriority(idxGroup))
                 {
+                    TbfTaskTracer::Scope traceScope(tracer, "P2M", configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj->getNbParticles());
                     kernelWrapper.P2M(kernelsPtr[omp_get_thread_num()], *particleGroupObj, *leafGroupObj);
                 }
                 ++currentParticleGroup;
@@ -80,8 +106,8 @@ protected:
     }
 
     template <class TreeClass>
-    void M2M(TreeClass& inTree){
-        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= stopUpperLevel ; --idxLevel){
+    void M2M(TreeClass& inTree, const long int inTopTreeLevel){
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= inTopTreeLevel ; --idxLevel){
             auto& upperCellGroup = inTree.getCellGroupsAtLevel(idxLevel);
             const auto& lowerCellGroup = inTree.getCellGroupsAtLevel(idxLevel+1);
 
@@ -97,6 +123,8 @@ protected:
 
                 auto upperGroup = &(*currentUpperGroup);
                 const auto lowerGroup = &(*currentLowerGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
 
                 const auto lowerGroupGetMultipolePtr = lowerGroup->getMultipolePtr();
                 const auto upperGroupGetMultipolePtr = upperGroup->getMultipolePtr();
@@ -106,8 +134,9 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(upperGroup, lowerGroup, kernelsPtr)  priority(priorities.getM2MPriority(idxLevel))
+#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, kernelsPtr, idxUpperGroup, idxLowerGroup)  priority(priorities.getM2MPriority(idxLevel, idxUpperGroup))
                 {
+                    TbfTaskTracer::Scope traceScope(tracer, "M2M", idxLevel, idxUpperGroup, idxLowerGroup, lowerGroup->getNbCells());
                     kernelWrapper.M2M(idxLevel, kernelsPtr[omp_get_thread_num()], *lowerGroup, *upperGroup);
                 }
 
@@ -125,41 +154,37 @@ protected:
     }
 
     template <class TreeClass>
-    void M2L(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
-        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+    void M2L(TreeClass& inTree, const long int inTopTreeLevel){
+        for(long int idxLevel = inTopTreeLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
             auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            const auto& levelPlan = interactionPlan.getM2LPlan(inTree, idxLevel);
 
-            auto currentCellGroup = cellGroups.begin();
-            const auto endCellGroup = cellGroups.end();
+            assert(std::size(levelPlan) == std::size(cellGroups));
 
-            while(currentCellGroup != endCellGroup){
-                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
-                                               [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
-                    const auto groupSrcPtr = &groupSrc;
-                    auto groupTargetPtr = &groupTarget;
-                    assert(&groupTarget == &*currentCellGroup);
-                    auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                for(const auto& betweenGroups : levelPlan[idxGroup].betweenGroups){
+                    const long int idxSourceGroup = betweenGroups.idxSourceGroup;
+                    const auto groupSrcPtr = &cellGroups[idxSourceGroup];
+                    auto groupTargetPtr = &cellGroups[idxGroup];
+                    const auto indexesVec = &betweenGroups.indexes;
 
-                    auto groupTargetGetLocalPtr = groupTarget.getLocalPtr();
-                    const auto groupSrcGetMultipolePtr = groupSrc.getMultipolePtr();
+                    auto groupTargetGetLocalPtr = groupTargetPtr->getLocalPtr();
+                    const auto groupSrcGetMultipolePtr = groupSrcPtr->getMultipolePtr();
 
                     const unsigned char* ptr_groupSrcGetMultipolePtr = reinterpret_cast<const unsigned char*>(&groupSrcGetMultipolePtr[0]);
                     const unsigned char* ptr_groupTargetGetLocalPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetLocalPtr[0]);
 
                     auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesVec, groupSrcPtr, groupTargetPtr, kernelsPtr)  priority(priorities.getM2LPriority(idxLevel))
+#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesVec, groupSrcPtr, groupTargetPtr, kernelsPtr, idxGroup, idxSourceGroup)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
                     {
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, std::move(*indexesVec));
-                        delete indexesVec;
+                        TbfTaskTracer::Scope traceScope(tracer, "M2L", idxLevel, idxGroup, idxSourceGroup, static_cast<long int>(std::size(*indexesVec)));
+                        kernelWrapper.M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, *indexesVec);
                     }
-                });
+                }
 
-                auto currentGroup = &(*currentCellGroup);
-                auto indexesForGroup_first = TbfUtils::CreateNew(std::move(indexesForGroup.first));
+                auto currentGroup = &cellGroups[idxGroup];
+                const auto indexesForGroup_first = &levelPlan[idxGroup].inGroup;
 
                 const auto currentGroupGetMultipolePtr = currentGroup->getMultipolePtr();
                 auto currentGroupGetLocalPtr = currentGroup->getLocalPtr();
@@ -169,20 +194,18 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_currentGroupGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesForGroup_first, currentGroup, kernelsPtr)  priority(priorities.getM2LPriority(idxLevel))
+#pragma omp task depend(in:ptr_currentGroupGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesForGroup_first, currentGroup, kernelsPtr, idxGroup)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
                 {
-                    kernelWrapper.M2LInGroup(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, std::move(*indexesForGroup_first));
-                    delete indexesForGroup_first;
+                    TbfTaskTracer::Scope traceScope(tracer, "M2L-IN", idxLevel, idxGroup, -1, static_cast<long int>(std::size(*indexesForGroup_first)));
+                    kernelWrapper.M2LInGroup(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, *indexesForGroup_first);
                 }
-
-                ++currentCellGroup;
             }
         }
     }
 
     template <class TreeClass>
-    void L2L(TreeClass& inTree){
-        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
+    void L2L(TreeClass& inTree, const long int inTopTreeLevel){
+        for(long int idxLevel = std::max(stopUpperLevel, inTopTreeLevel-1) ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
             const auto& upperCellGroup = inTree.getCellGroupsAtLevel(idxLevel);
             auto& lowerCellGroup = inTree.getCellGroupsAtLevel(idxLevel+1);
 
@@ -198,6 +221,8 @@ protected:
 
                 const auto upperGroup = &(*currentUpperGroup);
                 auto lowerGroup = &(*currentLowerGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
 
                 const auto upperGroupGetLocalPtr = upperGroup->getLocalPtr();
                 auto lowerGroupGetLocalPtr = lowerGroup->getLocalPtr();
@@ -207,8 +232,9 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, kernelsPtr)  priority(priorities.getL2LPriority(idxLevel))
+#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, kernelsPtr, idxUpperGroup, idxLowerGroup)  priority(priorities.getL2LPriority(idxLevel, idxLowerGroup))
                 {
+                    TbfTaskTracer::Scope traceScope(tracer, "L2L", idxLevel+1, idxLowerGroup, idxUpperGroup, lowerGroup->getNbCells());
                     kernelWrapper.L2L(idxLevel, kernelsPtr[omp_get_thread_num()], *upperGroup, *lowerGroup);
                 }
 
@@ -225,6 +251,162 @@ protected:
         }
     }
 
+#if _OPENMP >= 201811
+    template <class TreeClass>
+    long int getTopTreeLevelFor(const TreeClass& inTree) const {
+        long int level = topTreeLevel;
+        if(level < 0){
+            level = stopUpperLevel;
+            while(level < configuration.getTreeHeight()-1 && inTree.getNbCellGroupsAtLevel(level) < omp_get_max_threads()){
+                level += 1;
+            }
+        }
+        return std::max(stopUpperLevel, std::min(level, configuration.getTreeHeight()-1));
+    }
+#else
+    // The top-tree task needs the iterators of the depend clause (OpenMP 5.0),
+    // the levels are always processed with the regular tasks
+    template <class TreeClass>
+    long int getTopTreeLevelFor(const TreeClass& /*inTree*/) const {
+        return stopUpperLevel;
+    }
+#endif
+
+    // Split the cells of a level in chunks of consecutive cells of the same group
+    template <class CellGroupContainerClass>
+    static std::vector<std::array<long int,3>> GetTopTreeChunks(const CellGroupContainerClass& inCellGroups){
+        long int nbCells = 0;
+        for(const auto& group : inCellGroups){
+            nbCells += group.getNbCells();
+        }
+        const long int chunkSize = std::max(1L, nbCells/(4*omp_get_max_threads()));
+
+        std::vector<std::array<long int,3>> chunks;
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(inCellGroups)) ; ++idxGroup){
+            const long int nbCellsInGroup = inCellGroups[idxGroup].getNbCells();
+            for(long int idxFirstCell = 0 ; idxFirstCell < nbCellsInGroup ; idxFirstCell += chunkSize){
+                chunks.emplace_back(std::array<long int,3>{{idxGroup, idxFirstCell, std::min(idxFirstCell+chunkSize, nbCellsInGroup)}});
+            }
+        }
+        return chunks;
+    }
+
+    // Process the M2M, M2L and L2L of the levels [stopUpperLevel, inTopTreeLevel[ in a single task.
+    // Inside it, each level is parallelized over the cells, while the other threads
+    // keep working on the tasks of the lower levels and on the P2P.
+#if _OPENMP >= 201811
+    template <class TreeClass>
+    void TopTree(TreeClass& inTree, const long int inTopTreeLevel, const int inOperationToProceed){
+        if(inTopTreeLevel <= stopUpperLevel
+                || (inOperationToProceed & (TbfAlgorithmUtils::TbfM2M | TbfAlgorithmUtils::TbfM2L | TbfAlgorithmUtils::TbfL2L)) == 0){
+            return;
+        }
+
+        using LevelPlanType = typename std::remove_reference<decltype(interactionPlan.getM2LPlan(inTree, 0))>::type;
+        // The plans are built here since the master thread keeps using the interaction plan
+        std::vector<const LevelPlanType*> levelPlans;
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
+            for(long int idxLevel = stopUpperLevel ; idxLevel < inTopTreeLevel ; ++idxLevel){
+                levelPlans.emplace_back(&interactionPlan.getM2LPlan(inTree, idxLevel));
+            }
+        }
+
+        std::vector<const unsigned char*> multipolesBelow;
+        for(auto& group : inTree.getCellGroupsAtLevel(inTopTreeLevel)){
+            multipolesBelow.emplace_back(reinterpret_cast<const unsigned char*>(&group.getMultipolePtr()[0]));
+        }
+        std::vector<const unsigned char*> localsOfLastLevel;
+        for(auto& group : inTree.getCellGroupsAtLevel(inTopTreeLevel-1)){
+            localsOfLastLevel.emplace_back(reinterpret_cast<const unsigned char*>(&group.getLocalPtr()[0]));
+        }
+
+        const auto ptr_multipolesBelow = multipolesBelow.data();
+        const long int nbMultipolesBelow = static_cast<long int>(multipolesBelow.size());
+        const auto ptr_localsOfLastLevel = localsOfLastLevel.data();
+        const long int nbLocalsOfLastLevel = static_cast<long int>(localsOfLastLevel.size());
+
+        auto* treePtr = &inTree;
+        auto* kernelsPtr = kernels.data();
+
+#pragma omp task depend(iterator(idxPtr=0:nbMultipolesBelow), in:ptr_multipolesBelow[idxPtr][0]) depend(iterator(idxPtr=0:nbLocalsOfLastLevel), inout:ptr_localsOfLastLevel[idxPtr][0]) default(shared) firstprivate(inTopTreeLevel, inOperationToProceed, levelPlans, treePtr, kernelsPtr) priority(priorities.getM2MPriority(stopUpperLevel))
+        {
+            if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
+                for(long int idxLevel = inTopTreeLevel-1 ; idxLevel >= stopUpperLevel ; --idxLevel){
+                    auto& cellGroups = treePtr->getCellGroupsAtLevel(idxLevel);
+                    const auto chunks = GetTopTreeChunks(cellGroups);
+
+#pragma omp taskloop default(shared) grainsize(1) firstprivate(idxLevel) priority(priorities.getM2MPriority(idxLevel))
+                    for(long int idxChunk = 0 ; idxChunk < static_cast<long int>(std::size(chunks)) ; ++idxChunk){
+                        const auto& chunk = chunks[idxChunk];
+                        TbfTaskTracer::Scope traceScope(tracer, "M2M", idxLevel, chunk[0], -1, chunk[2]-chunk[1]);
+                        for(long int idxCell = chunk[1] ; idxCell < chunk[2] ; ++idxCell){
+                            kernelWrapper.M2MCell(idxLevel, kernelsPtr[omp_get_thread_num()], *treePtr, cellGroups[chunk[0]], idxCell);
+                        }
+                    }
+                }
+            }
+            if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
+                for(long int idxLevel = stopUpperLevel ; idxLevel < inTopTreeLevel ; ++idxLevel){
+                    auto& cellGroups = treePtr->getCellGroupsAtLevel(idxLevel);
+                    const auto& levelPlan = *levelPlans[idxLevel-stopUpperLevel];
+                    const auto chunks = GetTopTreeChunks(cellGroups);
+
+#pragma omp taskloop default(shared) grainsize(1) firstprivate(idxLevel) priority(priorities.getM2LPriority(idxLevel))
+                    for(long int idxChunk = 0 ; idxChunk < static_cast<long int>(std::size(chunks)) ; ++idxChunk){
+                        const auto& chunk = chunks[idxChunk];
+                        TbfTaskTracer::Scope traceScope(tracer, "M2L", idxLevel, chunk[0], -1, 0);
+                        long int nbInteractionsInChunk = 0;
+                        auto& targetGroup = cellGroups[chunk[0]];
+                        const auto& groupPlan = levelPlan[chunk[0]];
+
+                        typename TbfInteractionPlan<typename SpaceIndexType::IndexType>::InteractionVector indexesInChunk;
+                        auto selectIndexesInChunk = [&](const auto& inIndexes){
+                            indexesInChunk.clear();
+                            for(const auto& interaction : inIndexes){
+                                if(chunk[1] <= interaction.globalTargetPos && interaction.globalTargetPos < chunk[2]){
+                                    indexesInChunk.emplace_back(interaction);
+                                }
+                            }
+                            nbInteractionsInChunk += static_cast<long int>(indexesInChunk.size());
+                            return indexesInChunk.size() != 0;
+                        };
+
+                        for(const auto& betweenGroups : groupPlan.betweenGroups){
+                            if(selectIndexesInChunk(betweenGroups.indexes)){
+                                kernelWrapper.M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], targetGroup,
+                                                               TbfUtils::make_const(cellGroups[betweenGroups.idxSourceGroup]), indexesInChunk);
+                            }
+                        }
+                        if(selectIndexesInChunk(groupPlan.inGroup)){
+                            kernelWrapper.M2LInGroup(idxLevel, kernelsPtr[omp_get_thread_num()], targetGroup, indexesInChunk);
+                        }
+                        traceScope.setNbInteractions(nbInteractionsInChunk);
+                    }
+                }
+            }
+            if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
+                for(long int idxLevel = stopUpperLevel ; idxLevel < inTopTreeLevel-1 ; ++idxLevel){
+                    const auto& cellGroups = treePtr->getCellGroupsAtLevel(idxLevel);
+                    const auto chunks = GetTopTreeChunks(cellGroups);
+
+#pragma omp taskloop default(shared) grainsize(1) firstprivate(idxLevel) priority(priorities.getL2LPriority(idxLevel))
+                    for(long int idxChunk = 0 ; idxChunk < static_cast<long int>(std::size(chunks)) ; ++idxChunk){
+                        const auto& chunk = chunks[idxChunk];
+                        TbfTaskTracer::Scope traceScope(tracer, "L2L", idxLevel, chunk[0], -1, chunk[2]-chunk[1]);
+                        for(long int idxCell = chunk[1] ; idxCell < chunk[2] ; ++idxCell){
+                            kernelWrapper.L2LCell(idxLevel, kernelsPtr[omp_get_thread_num()], *treePtr, cellGroups[chunk[0]], idxCell);
+                        }
+                    }
+                }
+            }
+        }
+    }
+#else
+    template <class TreeClass>
+    void TopTree(TreeClass& /*inTree*/, const long int /*inTopTreeLevel*/, const int /*inOperationToProceed*/){
+    }
+#endif
+
     template <class TreeClass>
     void L2P(TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -246,6 +428,7 @@ protected:
 
                 const auto leafGroupObj = &(*currentLeafGroup);
                 auto particleGroupObj = &(*currentParticleGroup);
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
 
                 const auto leafGroupObjGetLocalPtr = leafGroupObj->getLocalPtr();
                 auto particleGroupObjGetDataPtr = particleGroupObj->getDataPtr();
@@ -257,8 +440,9 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0],ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj, kernelsPtr)  priority(priorities.getL2PPriority())
+#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0],ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj, kernelsPtr, idxGroup)  priority(priorities.getL2PPriority(idxGroup))
                 {
+                    TbfTaskTracer::Scope traceScope(tracer, "L2P", configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj->getNbParticles());
                     kernelWrapper.L2P(kernelsPtr[omp_get_thread_num()], *leafGroupObj, *particleGroupObj);
                 }
 
@@ -268,31 +452,135 @@ protected:
         }
     }
 
+    // Return a particle group that shares the data of inParticleGroup but whose rhs
+    // is the buffer of the current thread (filled with zeros at the first use)
+    template <class ParticleGroupClass>
+    ParticleGroupClass getPrivateRhsGroup(ParticleGroupClass& inParticleGroup, const long int inIdxGroup){
+        PrivateRhsBuffer& privateBuffer = privateRhsBuffers[omp_get_thread_num()][inIdxGroup];
+        if(privateBuffer.isUsed == false){
+            // The rhs of the group can be written by another task (in-group P2P), it must not be read here
+            privateBuffer.memory.resize(inParticleGroup.getRhsSize());
+            inParticleGroup.initEmptyRhs(privateBuffer.memory.data());
+            privateBuffer.isUsed = true;
+        }
+        return ParticleGroupClass(inParticleGroup.getDataPtr(), inParticleGroup.getDataSize(),
+                                  privateBuffer.memory.data(), privateBuffer.memory.size());
+    }
+
+    template <class ParticleGroupClass>
+    void reducePrivateRhs(ParticleGroupClass& inParticleGroup, const long int inIdxGroup){
+        for(auto& threadBuffers : privateRhsBuffers){
+            PrivateRhsBuffer& privateBuffer = threadBuffers[inIdxGroup];
+            if(privateBuffer.isUsed){
+                const ParticleGroupClass privateGroup(inParticleGroup.getDataPtr(), inParticleGroup.getDataSize(),
+                                                      privateBuffer.memory.data(), privateBuffer.memory.size());
+                for(long int idxLeaf = 0 ; idxLeaf < inParticleGroup.getNbLeaves() ; ++idxLeaf){
+                    auto&& particlesRhs = inParticleGroup.getParticleRhs(idxLeaf);
+                    const auto& privateRhs = privateGroup.getParticleRhs(idxLeaf);
+                    for(long int idxRhs = 0 ; idxRhs < static_cast<long int>(std::size(particlesRhs)) ; ++idxRhs){
+                        for(long int idxPart = 0 ; idxPart < inParticleGroup.getNbParticlesInLeaf(idxLeaf) ; ++idxPart){
+                            particlesRhs[idxRhs][idxPart] += privateRhs[idxRhs][idxPart];
+                        }
+                    }
+                }
+                // This task is the last one to use the buffers of the group
+                std::vector<unsigned char>().swap(privateBuffer.memory);
+                privateBuffer.isUsed = false;
+            }
+        }
+    }
+
     template <class TreeClass>
     void P2P(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
+        if(privateP2PAccumulation){
+            P2PPrivate(inTree);
+            return;
+        }
 
         auto& particleGroups = inTree.getParticleGroups();
+        const auto& groupsPlan = interactionPlan.getP2PPlan(inTree);
 
-        auto currentParticleGroup = particleGroups.begin();
-        const auto endParticleGroup = particleGroups.end();
+        assert(std::size(groupsPlan) == std::size(particleGroups));
 
-        while(currentParticleGroup != endParticleGroup){
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            for(const auto& betweenGroups : groupsPlan[idxGroup].betweenGroups){
+                const long int idxSourceGroup = betweenGroups.idxSourceGroup;
+                auto groupSrcPtr = &particleGroups[idxSourceGroup];
+                auto groupTargetPtr = &particleGroups[idxGroup];
 
-            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
-                                           [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
-                assert(&groupTarget == &*currentParticleGroup);
+                auto groupSrcGetDataPtr = groupSrcPtr->getDataPtr();
+                auto groupSrcGetRhsPtr = groupSrcPtr->getRhsPtr();
+                auto groupTargetGetRhsPtr = groupTargetPtr->getRhsPtr();
+                auto groupTargetGetDataPtr = groupTargetPtr->getDataPtr();
 
-                auto groupSrcPtr = &groupSrc;
-                auto groupTargetPtr = &groupTarget;
+                const auto indexesVec = &betweenGroups.indexes;
 
-                auto groupSrcGetDataPtr = groupSrc.getDataPtr();
-                auto groupSrcGetRhsPtr = groupSrc.getRhsPtr();
-                auto groupTargetGetRhsPtr = groupTarget.getRhsPtr();
-                auto groupTargetGetDataPtr = groupTarget.getDataPtr();
+                const unsigned char* ptr_groupSrcGetDataPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetDataPtr[0]);
+                const unsigned char* ptr_groupSrcGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetRhsPtr[0]);
+                const unsigned char* ptr_groupTargetGetDataPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetDataPtr[0]);
+                const unsigned char* ptr_groupTargetGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetRhsPtr[0]);
+
+                auto* kernelsPtr = kernels.data();
+
+#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupSrcGetRhsPtr[0],ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(indexesVec, groupSrcPtr, groupTargetPtr, kernelsPtr, idxGroup, idxSourceGroup) priority(priorities.getP2PPriority(idxGroup))
+                {
+                    TbfTaskTracer::Scope traceScope(tracer, "P2P-INOUT", configuration.getTreeHeight()-1, idxGroup, idxSourceGroup, static_cast<long int>(std::size(*indexesVec)));
+                    kernelWrapper.P2PBetweenGroups(kernelsPtr[omp_get_thread_num()], *groupSrcPtr, *groupTargetPtr, *indexesVec);
+                }
+            }
+
+            auto currentGroup = &particleGroups[idxGroup];
+
+            const auto currentGroupGetDataPtr = currentGroup->getDataPtr();
+            auto currentGroupGetRhsPtr = currentGroup->getRhsPtr();
+
+            const auto indexesForGroup_first = &groupsPlan[idxGroup].inGroup;
+
+            const unsigned char* ptr_currentGroupGetDataPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetDataPtr[0]);
+            const unsigned char* ptr_currentGroupGetRhsPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetRhsPtr[0]);
+
+            auto* kernelsPtr = kernels.data();
+
+#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(currentGroup, indexesForGroup_first, kernelsPtr, idxGroup) priority(priorities.getP2PPriority(idxGroup))
+            {
+                TbfTaskTracer::Scope traceScope(tracer, "P2P", configuration.getTreeHeight()-1, idxGroup, -1,
+                                                static_cast<long int>(std::size(*indexesForGroup_first)) + currentGroup->getNbLeaves());
+                kernelWrapper.P2PInGroup(kernelsPtr[omp_get_thread_num()], *currentGroup, *indexesForGroup_first);
+
+                kernelWrapper.P2PInner(kernelsPtr[omp_get_thread_num()], *currentGroup);
+            }
+        }
+    }
+
+
+    // The tasks only read the rhs of the particle groups (which allows them to run
+    // concurrently): the interactions between groups are accumulated in the buffers
+    // of the threads, and the interactions inside a group directly in the group, since
+    // a single task does it. A last task per group (inout) adds the buffers.
+    template <class TreeClass>
+    void P2PPrivate(TreeClass& inTree){
+        auto& particleGroups = inTree.getParticleGroups();
+        const auto& groupsPlan = interactionPlan.getP2PPlan(inTree);
+
+        assert(std::size(groupsPlan) == std::size(particleGroups));
+
+        privateRhsBuffers.resize(omp_get_max_threads());
+        for(auto& threadBuffers : privateRhsBuffers){
+            threadBuffers.resize(std::size(particleGroups));
+        }
 
-                auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            for(const auto& betweenGroups : groupsPlan[idxGroup].betweenGroups){
+                const long int idxSourceGroup = betweenGroups.idxSourceGroup;
+                auto groupSrcPtr = &particleGroups[idxSourceGroup];
+                auto groupTargetPtr = &particleGroups[idxGroup];
+
+                auto groupSrcGetDataPtr = groupSrcPtr->getDataPtr();
+                auto groupSrcGetRhsPtr = groupSrcPtr->getRhsPtr();
+                auto groupTargetGetRhsPtr = groupTargetPtr->getRhsPtr();
+                auto groupTargetGetDataPtr = groupTargetPtr->getDataPtr();
+
+                const auto indexesVec = &betweenGroups.indexes;
 
                 const unsigned char* ptr_groupSrcGetDataPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetDataPtr[0]);
                 const unsigned char* ptr_groupSrcGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetRhsPtr[0]);
@@ -301,34 +589,48 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupSrcGetRhsPtr[0],ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(indexesVec, groupSrcPtr, groupTargetPtr, kernelsPtr) priority(priorities.getP2PPriority())
+#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0],ptr_groupSrcGetRhsPtr[0],ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(indexesVec, idxGroup, idxSourceGroup, groupSrcPtr, groupTargetPtr, kernelsPtr) priority(priorities.getP2PPriority(idxGroup))
                 {
-                    kernelWrapper.P2PBetweenGroups(kernelsPtr[omp_get_thread_num()], *groupSrcPtr, *groupTargetPtr, std::move(*indexesVec));
-                    delete indexesVec;
+                    TbfTaskTracer::Scope traceScope(tracer, "P2P-INOUT", configuration.getTreeHeight()-1, idxGroup, idxSourceGroup, static_cast<long int>(std::size(*indexesVec)));
+                    auto privateSrc = getPrivateRhsGroup(*groupSrcPtr, idxSourceGroup);
+                    auto privateTarget = getPrivateRhsGroup(*groupTargetPtr, idxGroup);
+                    kernelWrapper.P2PBetweenGroups(kernelsPtr[omp_get_thread_num()], privateSrc, privateTarget, *indexesVec);
                 }
-            });
+            }
 
-            auto currentGroup = &(*currentParticleGroup);
+            auto currentGroup = &particleGroups[idxGroup];
 
             const auto currentGroupGetDataPtr = currentGroup->getDataPtr();
             auto currentGroupGetRhsPtr = currentGroup->getRhsPtr();
 
-            auto indexesForGroup_first = TbfUtils::CreateNew(std::move(indexesForGroup.first));
+            const auto indexesForGroup_first = &groupsPlan[idxGroup].inGroup;
 
             const unsigned char* ptr_currentGroupGetDataPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetDataPtr[0]);
             const unsigned char* ptr_currentGroupGetRhsPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetRhsPtr[0]);
 
             auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(currentGroup, indexesForGroup_first, kernelsPtr) priority(priorities.getP2PPriority())
+#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0],ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(currentGroup, indexesForGroup_first, kernelsPtr, idxGroup) priority(priorities.getP2PPriority(idxGroup))
             {
-                kernelWrapper.P2PInGroup(kernelsPtr[omp_get_thread_num()], *currentGroup, std::move(*indexesForGroup_first));
-                delete indexesForGroup_first;
+                TbfTaskTracer::Scope traceScope(tracer, "P2P", configuration.getTreeHeight()-1, idxGroup, -1,
+                                                static_cast<long int>(std::size(*indexesForGroup_first)) + currentGroup->getNbLeaves());
+                kernelWrapper.P2PInGroup(kernelsPtr[omp_get_thread_num()], *currentGroup, *indexesForGroup_first);
 
                 kernelWrapper.P2PInner(kernelsPtr[omp_get_thread_num()], *currentGroup);
             }
+        }
 
-            ++currentParticleGroup;
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            auto currentGroup = &particleGroups[idxGroup];
+
+            auto currentGroupGetRhsPtr = currentGroup->getRhsPtr();
+            const unsigned char* ptr_currentGroupGetRhsPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetRhsPtr[0]);
+
+#pragma omp task depend(inout:ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(currentGroup, idxGroup) priority(priorities.getP2PPriority(idxGroup))
+            {
+                TbfTaskTracer::Scope traceScope(tracer, "P2P-REDUCE", configuration.getTreeHeight()-1, idxGroup, -1, currentGroup->getNbParticles());
+                reducePrivateRhs(*currentGroup, idxGroup);
+            }
         }
     }
 
@@ -343,7 +645,7 @@ public:
     explicit TbfOpenmpAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), topTreeLevel(-1), privateP2PAccumulation(false), tracer(nullptr){
         kernels.emplace_back(configuration);
         increaseNumberOfKernels();
     }
@@ -354,7 +656,7 @@ public:
     TbfOpenmpAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), topTreeLevel(-1), privateP2PAccumulation(false), tracer(nullptr){
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
         increaseNumberOfKernels();
     }
@@ -365,6 +667,9 @@ public:
 
         increaseNumberOfKernels();
 
+        const long int currentTopTreeLevel = getTopTreeLevelFor(inTree);
+        priorities.updateWorkload(inTree);
+
 #pragma omp parallel
 #pragma omp master
 {
@@ -373,13 +678,14 @@ public:
             P2M(inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
-            M2M(inTree);
+            M2M(inTree, currentTopTreeLevel);
         }
+        TopTree(inTree, currentTopTreeLevel, inOperationToProceed);
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
-            M2L(inTree);
+            M2L(inTree, currentTopTreeLevel);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
-            L2L(inTree);
+            L2L(inTree, currentTopTreeLevel);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
             P2P(inTree);
@@ -389,8 +695,49 @@ public:
         }
 #pragma omp taskwait
 }// master
+
+        privateRhsBuffers.clear();
+        privateRhsBuffers.shrink_to_fit();
     }    
 
+    // The levels from stopUpperLevel to inTopTreeLevel-1 are processed by a single task
+    // parallelized over the cells, a value lower or equal to stopUpperLevel disables it
+    // and -1 selects the first level with at least one group per thread
+    // (it is ignored when the OpenMP runtime does not support the iterators, before 5.0)
+    void setTopTreeLevel(const long int inTopTreeLevel){
+        topTreeLevel = inTopTreeLevel;
+    }
+
+    long int getTopTreeLevel() const{
+        return topTreeLevel;
+    }
+
+    // Remove the mutual exclusion between the P2P tasks that write in the same group
+    // at the price of one copy of the rhs per thread and per group.
+    // In the worst case (every thread touches every group) the P2P needs nbThreads
+    // extra copies of all the rhs of the tree. The copies of a group are released
+    // once they are added to it, and all the buffers are released at the end of execute.
+    void setPrivateP2PAccumulation(const bool inPrivateP2PAccumulation){
+        privateP2PAccumulation = inPrivateP2PAccumulation;
+    }
+
+    bool getPrivateP2PAccumulation() const{
+        return privateP2PAccumulation;
+    }
+
+    void setPriorityPolicy(const TbfAlgorithmUtils::TbfPriorityPolicy inPolicy){
+        priorities.setPolicy(inPolicy);
+    }
+
+    // The tracer must stay alive during the executions, nullptr disables the tracing
+    void setTracer(TbfTaskTracer* inTracer){
+        tracer = inTracer;
+    }
+
+    TbfTaskTracer* getTracer() const{
+        return tracer;
+    }
+
     template <class FuncType>
     auto applyToAllKernels(FuncType&& inFunc) const {
         for(const auto& kernel : kernels){
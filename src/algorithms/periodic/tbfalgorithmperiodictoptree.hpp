@@ -5,7 +5,10 @@
 
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "containers/tbfsmallvector.hpp"
 
+#include <array>
+#include <functional>
 #include <cassert>
 #include <iterator>
 
@@ -24,6 +27,9 @@ public:
     static constexpr long int Dim = SpaceIndexType::Dim;
 
 protected:
+    static constexpr long int NbChildrenPerCell = SpaceIndexType::getNbChildrenPerCell();
+    static constexpr long int NbInteractionsPerCell = SpaceIndexType::getNbInteractionsPerCell();
+
     const SpacialConfiguration originalConfiguration;
     const SpacialConfiguration configuration;
     const SpaceIndexType originalSpaceSystem;
@@ -40,8 +46,8 @@ protected:
     void M2M(TreeClass& inTree){
         {
             assert(inTree.getHeight() > 1);
-            std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-            long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+            TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbChildrenPerCell> children;
+            std::array<long int, NbChildrenPerCell> positionsOfChildren;
             long int nbChildren = 0;
 
             const long int idxLevelBase = 0;
@@ -60,7 +66,7 @@ protected:
                 for(long int idxCell = 0 ; idxCell < currentLowerGroup->getNbCells() ; ++idxCell){
                     assert(nbChildren < spaceSystem.getNbChildrenPerCell());
                     children.emplace_back(currentLowerGroup->getCellMultipole(idxCell));
-                    positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(currentLowerGroup->getCellSpacialIndex(idxCell));
+                    positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(currentLowerGroup->getCellSpacialIndex(idxCell), idxLevelBase+1);
                     nbChildren += 1;
                 }
 
@@ -72,12 +78,12 @@ protected:
 
             kernel.M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          configuration.getTreeHeight()-2, TbfUtils::make_const(children), multipoles[configuration.getTreeHeight()-2],
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
 
         for(long int idxLevel = configuration.getTreeHeight()-3 ; idxLevel >= 3 ; --idxLevel){
-            std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-            long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+            TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbChildrenPerCell> children;
+            std::array<long int, NbChildrenPerCell> positionsOfChildren;
             long int nbChildren = 0;
 
             for(long int idxCell = 0 ; idxCell < spaceSystem.getNbChildrenPerCell() ; ++idxCell){
@@ -90,7 +96,7 @@ protected:
             assert(std::size(inTree.getCellGroupsAtLevel(0)));
             kernel.M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          idxLevel, TbfUtils::make_const(children), multipoles[idxLevel],
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
     }
 
@@ -99,9 +105,9 @@ protected:
         if(nbLevelsAbove0 == 0){
             const long int idxLevel = configuration.getTreeHeight()-2;
             assert(idxLevel == 3);
-            std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
+            TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)> neighbors;
             static_assert (Dim != 3 || 316 == (TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)), "Simple check");
-            long int positionsOfNeighbors[TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)];
+            std::array<long int, TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)> positionsOfNeighbors;
             long int nbNeighbors = 0;
 
             std::array<long int, Dim> minLimits = TbfUtils::make_array<long int, Dim>(-3);
@@ -147,12 +153,12 @@ protected:
             assert(std::size(inTree.getCellGroupsAtLevel(0)));
 
             kernel.M2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
-                         idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors, nbNeighbors, locals[idxLevel]);
+                         idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors.data(), nbNeighbors, locals[idxLevel]);
         }
         else{
             for(long int idxLevel = 3 ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
-                std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-                long int* positionsOfNeighbors = new long int [spaceSystem.getNbInteractionsPerCell()];
+                TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbInteractionsPerCell> neighbors;
+                std::array<long int, NbInteractionsPerCell> positionsOfNeighbors;
                 long int nbNeighbors = 0;
 
                 std::array<long int, Dim> minLimits;
@@ -206,7 +212,7 @@ protected:
 
                 assert(std::size(inTree.getCellGroupsAtLevel(0)));
                 kernel.M2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
-                             idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors, nbNeighbors, locals[idxLevel]);
+                             idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors.data(), nbNeighbors, locals[idxLevel]);
             }
         }
     }
@@ -214,8 +220,8 @@ protected:
     template <class TreeClass>
     void L2L(TreeClass& inTree){        
         for(long int idxLevel = 3 ; idxLevel <= configuration.getTreeHeight()-3 ; ++idxLevel){
-            std::vector<std::reference_wrapper<CellLocalType>> children;
-            long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+            TbfSmallVector<std::reference_wrapper<CellLocalType>, NbChildrenPerCell> children;
+            std::array<long int, NbChildrenPerCell> positionsOfChildren;
 
             children.emplace_back(locals[idxLevel+1]);
             positionsOfChildren[0] = (0);
@@ -223,12 +229,12 @@ protected:
 
             kernel.L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          idxLevel, TbfUtils::make_const(locals[idxLevel]), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
         {
             assert(inTree.getHeight() > 1);
-            std::vector<std::reference_wrapper<CellLocalType>> children;
-            long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+            TbfSmallVector<std::reference_wrapper<CellLocalType>, NbChildrenPerCell> children;
+            std::array<long int, NbChildrenPerCell> positionsOfChildren;
             long int nbChildren = 0;
 
             const long int idxLevelBase = 0;
@@ -246,7 +252,7 @@ protected:
                 for(long int idxCell = 0 ; idxCell < currentLowerGroup->getNbCells() ; ++idxCell){
                     assert(nbChildren < spaceSystem.getNbChildrenPerCell());
                     children.emplace_back(currentLowerGroup->getCellLocal(idxCell));
-                    positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(currentLowerGroup->getCellSpacialIndex(idxCell));
+                    positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(currentLowerGroup->getCellSpacialIndex(idxCell), idxLevelBase+1);
                     nbChildren += 1;
                 }
 
@@ -257,7 +263,7 @@ protected:
 
             kernel.L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          configuration.getTreeHeight()-2, TbfUtils::make_const(locals[configuration.getTreeHeight()-2]), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
     }
 
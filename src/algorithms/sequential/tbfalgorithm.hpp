@@ -6,6 +6,7 @@
 #include "tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfinteractionplan.hpp"
 
 #include <cassert>
 #include <iterator>
@@ -27,6 +28,8 @@ protected:
     TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
     KernelClass kernel;
 
+    TbfInteractionPlan<typename SpaceIndexType::IndexType> interactionPlan;
+
     template <class TreeClass>
     void P2M(TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -83,27 +86,18 @@ protected:
 
     template <class TreeClass>
     void M2L(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
             auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            const auto& levelPlan = interactionPlan.getM2LPlan(inTree, idxLevel);
 
-            auto currentCellGroup = cellGroups.begin();
-            const auto endCellGroup = cellGroups.end();
-
-            while(currentCellGroup != endCellGroup){
-
-                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
-                                               [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
-                    assert(&groupTarget == &*currentCellGroup);
-                    kernelWrapper.M2LBetweenGroups(idxLevel, kernel, groupTarget, groupSrc, indexes);
-                });
-
-                kernelWrapper.M2LInGroup(idxLevel, kernel, *currentCellGroup, indexesForGroup.first);
+            assert(std::size(levelPlan) == std::size(cellGroups));
 
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                for(const auto& betweenGroups : levelPlan[idxGroup].betweenGroups){
+                    kernelWrapper.M2LBetweenGroups(idxLevel, kernel, cellGroups[idxGroup], cellGroups[betweenGroups.idxSourceGroup], betweenGroups.indexes);
+                }
 
-                ++currentCellGroup;
+                kernelWrapper.M2LInGroup(idxLevel, kernel, cellGroups[idxGroup], levelPlan[idxGroup].inGroup);
             }
         }
     }
@@ -164,27 +158,19 @@ protected:
 
     template <class TreeClass>
     void P2P(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         auto& particleGroups = inTree.getParticleGroups();
+        const auto& groupsPlan = interactionPlan.getP2PPlan(inTree);
 
-        auto currentParticleGroup = particleGroups.begin();
-        const auto endParticleGroup = particleGroups.end();
-
-        while(currentParticleGroup != endParticleGroup){
+        assert(std::size(groupsPlan) == std::size(particleGroups));
 
-            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
-                                           [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
-                assert(&groupTarget == &*currentParticleGroup);
-                kernelWrapper.P2PBetweenGroups(kernel, groupSrc, groupTarget, indexes);
-            });
-
-            kernelWrapper.P2PInGroup(kernel, *currentParticleGroup, indexesForGroup.first);
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            for(const auto& betweenGroups : groupsPlan[idxGroup].betweenGroups){
+                kernelWrapper.P2PBetweenGroups(kernel, particleGroups[betweenGroups.idxSourceGroup], particleGroups[idxGroup], betweenGroups.indexes);
+            }
 
-            kernelWrapper.P2PInner(kernel, *currentParticleGroup);
+            kernelWrapper.P2PInGroup(kernel, particleGroups[idxGroup], groupsPlan[idxGroup].inGroup);
 
-            ++currentParticleGroup;
+            kernelWrapper.P2PInner(kernel, particleGroups[idxGroup]);
         }
     }
 
@@ -3,13 +3,54 @@
 
 #include "tbfglobal.hpp"
 #include "utils/tbfutils.hpp"
+#include "containers/tbfsmallvector.hpp"
+#include "core/tbfm2lbatch.hpp"
 
+#include <array>
+#include <functional>
 #include <cassert>
 
 template <class SpaceIndexType>
 class TbfGroupKernelInterface{
     const SpaceIndexType spaceSystem;
 
+    // The buffers passed to the kernels live on the stack
+    static constexpr long int NbChildrenPerCell = SpaceIndexType::getNbChildrenPerCell();
+    static constexpr long int NbInteractionsPerCell = SpaceIndexType::getNbInteractionsPerCell();
+
+    template <class CellGroupClassTarget, class CellGroupClassSource>
+    using M2LBatchType = TbfM2LBatch<std::remove_cv_t<std::remove_reference_t<decltype(std::declval<const CellGroupClassTarget&>().getCellSymbData(0))>>,
+                                     std::remove_cv_t<std::remove_reference_t<decltype(std::declval<const CellGroupClassSource&>().getCellMultipole(0))>>,
+                                     std::remove_cv_t<std::remove_reference_t<decltype(std::declval<CellGroupClassTarget&>().getCellLocal(0))>>>;
+
+    // Gather all the interactions of the block and give them to the kernel in one call
+    template <class KernelClass, class CellGroupClassTarget, class CellGroupClassSource, class IndexClass>
+    void M2LBatched(const long int inLevel, KernelClass& inKernel, CellGroupClassTarget& inCellGroup,
+                    const CellGroupClassSource& inOtherCellGroup, const IndexClass& inIndexes) const {
+        using BatchClass = M2LBatchType<CellGroupClassTarget, CellGroupClassSource>;
+        // Reused by the successive calls of the same thread
+        static thread_local BatchClass batch;
+        batch.clear();
+
+        long int srcCursor = 0;
+        for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(inIndexes.size()) ; ++idxInteraction){
+            const auto interaction = inIndexes[idxInteraction];
+            auto foundSrc = inOtherCellGroup.getElementFromSpacialIndex(interaction.indexSrc, srcCursor);
+            if(foundSrc){
+                assert(inCellGroup.getElementFromSpacialIndex(interaction.indexTarget)
+                       && *inCellGroup.getElementFromSpacialIndex(interaction.indexTarget) == interaction.globalTargetPos);
+                batch.addInteraction(TbfUtils::make_const(inCellGroup).getCellSymbData(interaction.globalTargetPos),
+                                     inCellGroup.getCellLocal(interaction.globalTargetPos),
+                                     inOtherCellGroup.getCellMultipole(*foundSrc),
+                                     interaction.arrayIndexSrc);
+            }
+        }
+
+        if(batch.empty() == false){
+            inKernel.M2LBatch(inLevel, batch);
+        }
+    }
+
 public:
     TbfGroupKernelInterface(SpaceIndexType inSpaceIndex) : spaceSystem(std::move(inSpaceIndex)){}
 
@@ -31,8 +72,8 @@ public:
     void M2M(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inLowerGroup,
              CellGroupClass& inUpperGroup) const {
         using CellMultipoleType = typename std::remove_reference<decltype(inLowerGroup.getCellMultipole(0))>::type;
-        std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-        long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+        TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbChildrenPerCell> children;
+        std::array<long int, NbChildrenPerCell> positionsOfChildren;
         long int nbChildren = 0;
 
         const auto startingIndex = std::max(spaceSystem.getParentIndex(inLowerGroup.getStartingSpacialIndex()),
@@ -53,7 +94,7 @@ public:
 
             assert(nbChildren < spaceSystem.getNbChildrenPerCell());
             children.emplace_back(inLowerGroup.getCellMultipole(idxChild));
-            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild));
+            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild), inLevel+1);
             nbChildren += 1;
 
             idxChild += 1;
@@ -62,7 +103,7 @@ public:
 
                 inKernel.M2M(inUpperGroup.getCellSymbData(idxParent),
                              inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(idxParent),
-                             positionsOfChildren, nbChildren);
+                             positionsOfChildren.data(), nbChildren);
 
                 idxParent += 1;
                 assert(idxParent == inUpperGroup.getNbCells()
@@ -76,19 +117,26 @@ public:
         if(nbChildren){
             inKernel.M2M(inUpperGroup.getCellSymbData(idxParent),
                          inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(idxParent),
-                     positionsOfChildren, nbChildren);
+                     positionsOfChildren.data(), nbChildren);
         }
     }
 
     template <class KernelClass, class CellGroupClass, class IndexClass>
     void M2LInGroup(const long int inLevel, KernelClass& inKernel, CellGroupClass& inCellGroup, const IndexClass& inIndexes) const {
+        if constexpr(TbfKernelHasM2LBatch<KernelClass, M2LBatchType<CellGroupClass, CellGroupClass>>::value){
+            M2LBatched(inLevel, inKernel, inCellGroup, TbfUtils::make_const(inCellGroup), inIndexes);
+            return;
+        }
+
         using CellMultipoleType = typename std::remove_reference<decltype(inCellGroup.getCellMultipole(0))>::type;
         //using CellLocalType = typename std::remove_reference<decltype(inCellGroup.getCellLocal(0))>::type;
 
-        std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-        long int* positionsOfNeighbors = new long int [spaceSystem.getNbInteractionsPerCell()];
+        TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbInteractionsPerCell> neighbors;
+        std::array<long int, NbInteractionsPerCell> positionsOfNeighbors;
         long int nbNeighbors = 0;
 
+        // The sources are looked up in increasing order most of the time
+        long int srcCursor = 0;
         long int idxInteraction = 0;
 
         while(idxInteraction < static_cast<long int>(inIndexes.size())){
@@ -97,7 +145,7 @@ public:
             auto& targetCell = inCellGroup.getCellLocal(interaction.globalTargetPos);
 
             do{
-                auto foundSrc = inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexSrc);
+                auto foundSrc = inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexSrc, srcCursor);
                 assert(foundSrc);
                 assert(inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexTarget)
                        && *inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexTarget) == inIndexes[idxInteraction].globalTargetPos);
@@ -114,7 +162,7 @@ public:
             inKernel.M2L(inCellGroup.getCellSymbData(interaction.globalTargetPos),
                          inLevel,
                          TbfUtils::make_const(neighbors),
-                         positionsOfNeighbors,
+                         positionsOfNeighbors.data(),
                          nbNeighbors,
                          targetCell);
             neighbors.clear();
@@ -125,13 +173,20 @@ public:
     template <class KernelClass, class CellGroupClassTarget, class CellGroupClassSource, class IndexClass>
     void M2LBetweenGroups(const long int inLevel, KernelClass& inKernel, CellGroupClassTarget& inCellGroup,
                           const CellGroupClassSource& inOtherCellGroup, const IndexClass& inIndexes) const {
+        if constexpr(TbfKernelHasM2LBatch<KernelClass, M2LBatchType<CellGroupClassTarget, CellGroupClassSource>>::value){
+            M2LBatched(inLevel, inKernel, inCellGroup, inOtherCellGroup, inIndexes);
+            return;
+        }
+
         using CellMultipoleType = typename std::remove_reference<decltype(inOtherCellGroup.getCellMultipole(0))>::type;
         //using CellLocalType = typename std::remove_reference<decltype(inCellGroup.getCellLocal(0))>::type;
 
-        std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-        long int* positionsOfNeighbors = new long int [spaceSystem.getNbInteractionsPerCell()];
+        TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbInteractionsPerCell> neighbors;
+        std::array<long int, NbInteractionsPerCell> positionsOfNeighbors;
         long int nbNeighbors = 0;
 
+        // The sources are looked up in increasing order most of the time
+        long int srcCursor = 0;
         long int idxInteraction = 0;
 
         while(idxInteraction < static_cast<long int>(inIndexes.size())){
@@ -140,7 +195,7 @@ public:
             auto& targetCell = inCellGroup.getCellLocal(interaction.globalTargetPos);
 
             do{
-                auto foundSrc = inOtherCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexSrc);
+                auto foundSrc = inOtherCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexSrc, srcCursor);
                 if(foundSrc){
                     assert(inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexTarget)
                           && *inCellGroup.getElementFromSpacialIndex(inIndexes[idxInteraction].indexTarget) == inIndexes[idxInteraction].globalTargetPos);
@@ -159,7 +214,7 @@ public:
                 inKernel.M2L(inCellGroup.getCellSymbData(interaction.globalTargetPos),
                             inLevel,
                          TbfUtils::make_const(neighbors),
-                         positionsOfNeighbors,
+                         positionsOfNeighbors.data(),
                          nbNeighbors,
                          targetCell);
                 neighbors.clear();
@@ -172,8 +227,8 @@ public:
     void L2L(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inUpperGroup,
              CellGroupClass& inLowerGroup) const {
         using CellLocalType = typename std::remove_reference<decltype(inLowerGroup.getCellLocal(0))>::type;
-        std::vector<std::reference_wrapper<CellLocalType>> children;
-        long int* positionsOfChildren = new long int [spaceSystem.getNbChildrenPerCell()];
+        TbfSmallVector<std::reference_wrapper<CellLocalType>, NbChildrenPerCell> children;
+        std::array<long int, NbChildrenPerCell> positionsOfChildren;
         long int nbChildren = 0;
 
         const auto startingIndex = std::max(spaceSystem.getParentIndex(inLowerGroup.getStartingSpacialIndex()),
@@ -194,7 +249,7 @@ public:
 
             assert(nbChildren < spaceSystem.getNbChildrenPerCell());
             children.emplace_back(inLowerGroup.getCellLocal(idxChild));
-            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild));
+            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild), inLevel+1);
             nbChildren += 1;
 
             idxChild += 1;
@@ -203,7 +258,7 @@ public:
 
                 inKernel.L2L(inUpperGroup.getCellSymbData(idxParent),
                              inLevel, inUpperGroup.getCellLocal(idxParent), children,
-                             positionsOfChildren, nbChildren);
+                             positionsOfChildren.data(), nbChildren);
 
                 idxParent += 1;
                 assert(idxParent == inUpperGroup.getNbCells()
@@ -217,7 +272,61 @@ public:
         if(nbChildren){
             inKernel.L2L(inUpperGroup.getCellSymbData(idxParent),
                          inLevel, inUpperGroup.getCellLocal(idxParent), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
+        }
+    }
+
+    // Cell per cell versions of the M2M and L2L, the children are looked up in the tree
+    // such that the cells of the same level can be processed in parallel whatever the groups
+    template <class KernelClass, class TreeClass, class CellGroupClass>
+    void M2MCell(const long int inLevel, KernelClass& inKernel, TreeClass& inTree,
+                 CellGroupClass& inUpperGroup, const long int inIdxParent) const {
+        using CellMultipoleType = typename std::remove_reference<decltype(inUpperGroup.getCellMultipole(0))>::type;
+        TbfSmallVector<std::reference_wrapper<const CellMultipoleType>, NbChildrenPerCell> children;
+        std::array<long int, NbChildrenPerCell> positionsOfChildren;
+        long int nbChildren = 0;
+
+        const auto parentIndex = inUpperGroup.getCellSpacialIndex(inIdxParent);
+        for(long int idxChild = 0 ; idxChild < NbChildrenPerCell ; ++idxChild){
+            const auto childIndex = spaceSystem.getChildIndexFromParent(parentIndex, idxChild);
+            auto foundChild = inTree.findGroupWithCell(inLevel+1, childIndex);
+            if(foundChild){
+                children.emplace_back(TbfUtils::make_const((*foundChild).first.get()).getCellMultipole((*foundChild).second));
+                positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(childIndex, inLevel+1);
+                nbChildren += 1;
+            }
+        }
+
+        if(nbChildren){
+            inKernel.M2M(inUpperGroup.getCellSymbData(inIdxParent),
+                         inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(inIdxParent),
+                         positionsOfChildren.data(), nbChildren);
+        }
+    }
+
+    template <class KernelClass, class TreeClass, class CellGroupClass>
+    void L2LCell(const long int inLevel, KernelClass& inKernel, TreeClass& inTree,
+                 const CellGroupClass& inUpperGroup, const long int inIdxParent) const {
+        using CellLocalType = typename std::remove_reference<decltype(inTree.getCellGroupsAtLevel(inLevel+1)[0].getCellLocal(0))>::type;
+        TbfSmallVector<std::reference_wrapper<CellLocalType>, NbChildrenPerCell> children;
+        std::array<long int, NbChildrenPerCell> positionsOfChildren;
+        long int nbChildren = 0;
+
+        const auto parentIndex = inUpperGroup.getCellSpacialIndex(inIdxParent);
+        for(long int idxChild = 0 ; idxChild < NbChildrenPerCell ; ++idxChild){
+            const auto childIndex = spaceSystem.getChildIndexFromParent(parentIndex, idxChild);
+            auto foundChild = inTree.findGroupWithCell(inLevel+1, childIndex);
+            if(foundChild){
+                children.emplace_back((*foundChild).first.get().getCellLocal((*foundChild).second));
+                positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(childIndex, inLevel+1);
+                nbChildren += 1;
+            }
+        }
+
+        if(nbChildren){
+            inKernel.L2L(inUpperGroup.getCellSymbData(inIdxParent),
+                         inLevel, inUpperGroup.getCellLocal(inIdxParent), children,
+                         positionsOfChildren.data(), nbChildren);
         }
     }
 
@@ -238,10 +347,11 @@ public:
 
     template <class KernelClass, class ParticleGroupClass, class IndexClass>
     void P2PInGroup(KernelClass& inKernel, ParticleGroupClass& inParticleGroup, const IndexClass& inIndexes) const {
+        long int srcCursor = 0;
         for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(inIndexes.size()) ; ++idxInteraction){
             const auto interaction = inIndexes[idxInteraction];
 
-            auto foundSrc = inParticleGroup.getElementFromSpacialIndex(interaction.indexSrc);
+            auto foundSrc = inParticleGroup.getElementFromSpacialIndex(interaction.indexSrc, srcCursor);
             assert(foundSrc);
             assert(inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget)
                    && *inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget) == interaction.globalTargetPos);
@@ -281,10 +391,11 @@ public:
                           ParticleGroupClass& inOtherParticleGroup,
                           ParticleGroupClass& inParticleGroup,
                           const IndexClass& inIndexes) const {
+        long int srcCursor = 0;
         for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(inIndexes.size()) ; ++idxInteraction){
             const auto interaction = inIndexes[idxInteraction];
 
-            auto foundSrc = inOtherParticleGroup.getElementFromSpacialIndex(interaction.indexSrc);
+            auto foundSrc = inOtherParticleGroup.getElementFromSpacialIndex(interaction.indexSrc, srcCursor);
             if(foundSrc){
                 assert(inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget)
                        && *inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget) == interaction.globalTargetPos);
@@ -313,10 +424,11 @@ public:
     void P2PBetweenGroupsTsm(KernelClass& inKernel, ParticleGroupClassSource& inOtherParticleGroup,
                              ParticleGroupClassTarget& inParticleGroup,
                           const IndexClass& inIndexes) const {
+        long int srcCursor = 0;
         for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(inIndexes.size()) ; ++idxInteraction){
             const auto interaction = inIndexes[idxInteraction];
 
-            auto foundSrc = inOtherParticleGroup.getElementFromSpacialIndex(interaction.indexSrc);
+            auto foundSrc = inOtherParticleGroup.getElementFromSpacialIndex(interaction.indexSrc, srcCursor);
             if(foundSrc){
                 assert(inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget)
                        && *inParticleGroup.getElementFromSpacialIndex(interaction.indexTarget) == interaction.globalTargetPos);
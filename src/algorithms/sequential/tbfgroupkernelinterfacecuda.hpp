@@ -81,7 +81,7 @@ __global__ void M2M_core(const SpaceIndexType& spaceSystem, const long int inLev
 
         for(long int idxChild = 0 ; idxChild < nbChildren ; ++idxChild){
             children.emplace_back(inLowerGroup.getCellMultipole(idxChild));
-            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild));
+            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild), inLevel+1);
         }
 
         KernelClass::M2MCuda(inKernel, inUpperGroup.getCellSymbData(idxParent),
@@ -202,7 +202,7 @@ __global__ void L2L_core(const SpaceIndexType& spaceSystem, const long int inLev
 
         for(long int idxChild = 0 ; idxChild < nbChildren ; ++idxChild){
             children.emplace_back(inLowerGroup.getCellLocal(idxChild));
-            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild));
+            positionsOfChildren[nbChildren] = spaceSystem.childPositionFromParent(inLowerGroup.getCellSpacialIndex(idxChild), inLevel+1);
         }
 
         KernelClass::L2LCuda(inKernel, inUpperGroup.getCellSymbData(idxParent),
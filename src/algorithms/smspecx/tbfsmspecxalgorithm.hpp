@@ -6,6 +6,8 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfinteractionplan.hpp"
+#include "utils/tbftasktracer.hpp"
 
 #include <Legacy/SpRuntime.hpp>
 
@@ -32,6 +34,11 @@ protected:
 
     TbfAlgorithmUtils::TbfOperationsPriorities priorities;
 
+    TbfInteractionPlan<typename SpaceIndexType::IndexType> interactionPlan;
+
+    // Record the tasks if not null
+    TbfTaskTracer* tracer;
+
     template <class TreeClass>
     void P2M(SpTaskGraph<SpSpeculativeModel::SP_NO_SPEC>& runtime, TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -52,8 +59,10 @@ protected:
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
                 auto& leafGroupObj = *currentLeafGroup;
                 const auto& particleGroupObj = *currentParticleGroup;
-                runtime.task(SpPriority(priorities.getP2MPriority()), SpRead(*particleGroupObj.getDataPtr()), SpCommutativeWrite(*leafGroupObj.getMultipolePtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, unsigned char&){
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                runtime.task(SpPriority(priorities.getP2MPriority(idxGroup)), SpRead(*particleGroupObj.getDataPtr()), SpCommutativeWrite(*leafGroupObj.getMultipolePtr()),
+                                   [this, idxGroup, &leafGroupObj, &particleGroupObj](const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "P2M", configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj.getNbParticles());
                     kernelWrapper.P2M(kernels[SpUtils::GetThreadId()-1], particleGroupObj, leafGroupObj);
                 });
                 ++currentParticleGroup;
@@ -80,8 +89,11 @@ protected:
 
                 auto& upperGroup = *currentUpperGroup;
                 const auto& lowerGroup = *currentLowerGroup;
-                runtime.task(SpPriority(priorities.getM2MPriority(idxLevel)), SpRead(*lowerGroup.getMultipolePtr()), SpCommutativeWrite(*upperGroup.getMultipolePtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+                runtime.task(SpPriority(priorities.getM2MPriority(idxLevel, idxUpperGroup)), SpRead(*lowerGroup.getMultipolePtr()), SpCommutativeWrite(*upperGroup.getMultipolePtr()),
+                                   [this, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "M2M", idxLevel, idxUpperGroup, idxLowerGroup, lowerGroup.getNbCells());
                     kernelWrapper.M2M(idxLevel, kernels[SpUtils::GetThreadId()-1], lowerGroup, upperGroup);
                 });
 
@@ -100,33 +112,33 @@ protected:
 
     template <class TreeClass>
     void M2L(SpTaskGraph<SpSpeculativeModel::SP_NO_SPEC>& runtime, TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
             auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            const auto& levelPlan = interactionPlan.getM2LPlan(inTree, idxLevel);
 
-            auto currentCellGroup = cellGroups.begin();
-            const auto endCellGroup = cellGroups.end();
+            assert(std::size(levelPlan) == std::size(cellGroups));
 
-            while(currentCellGroup != endCellGroup){
-                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
-                                               [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
-                    assert(&groupTarget == &*currentCellGroup);
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                auto& currentGroup = cellGroups[idxGroup];
 
-                    runtime.task(SpPriority(priorities.getM2LPriority(idxLevel)), SpRead(*groupSrc.getMultipolePtr()), SpCommutativeWrite(*groupTarget.getLocalPtr()),
-                                       [this, idxLevel, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, unsigned char&){
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                for(const auto& betweenGroups : levelPlan[idxGroup].betweenGroups){
+                    const long int idxSourceGroup = betweenGroups.idxSourceGroup;
+                    const auto& groupSrc = cellGroups[idxSourceGroup];
+                    const auto& indexesVec = betweenGroups.indexes;
+
+                    runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*groupSrc.getMultipolePtr()), SpCommutativeWrite(*currentGroup.getLocalPtr()),
+                                       [this, idxLevel, idxGroup, idxSourceGroup, &indexesVec, &groupSrc, &currentGroup](const unsigned char&, unsigned char&){
+                        TbfTaskTracer::Scope traceScope(tracer, "M2L", idxLevel, idxGroup, idxSourceGroup, static_cast<long int>(std::size(indexesVec)));
+                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, groupSrc, indexesVec);
                     });
-                });
+                }
 
-                auto& currentGroup = *currentCellGroup;
-                runtime.task(SpPriority(priorities.getM2LPriority(idxLevel)), SpRead(*currentGroup.getMultipolePtr()), SpCommutativeWrite(*currentGroup.getLocalPtr()),
-                                   [this, idxLevel, indexesForGroup_first = std::move(indexesForGroup.first), &currentGroup](const unsigned char&, unsigned char&){
+                const auto& indexesForGroup_first = levelPlan[idxGroup].inGroup;
+                runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*currentGroup.getMultipolePtr()), SpCommutativeWrite(*currentGroup.getLocalPtr()),
+                                   [this, idxLevel, idxGroup, &indexesForGroup_first, &currentGroup](const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "M2L-IN", idxLevel, idxGroup, -1, static_cast<long int>(std::size(indexesForGroup_first)));
                     kernelWrapper.M2LInGroup(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, indexesForGroup_first);
                 });
-
-                ++currentCellGroup;
             }
         }
     }
@@ -149,8 +161,11 @@ protected:
 
                 const auto& upperGroup = *currentUpperGroup;
                 auto& lowerGroup = *currentLowerGroup;
-                runtime.task(SpPriority(priorities.getL2LPriority(idxLevel)), SpRead(*upperGroup.getLocalPtr()), SpCommutativeWrite(*lowerGroup.getLocalPtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                runtime.task(SpPriority(priorities.getL2LPriority(idxLevel, idxLowerGroup)), SpRead(*upperGroup.getLocalPtr()), SpCommutativeWrite(*lowerGroup.getLocalPtr()),
+                                   [this, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "L2L", idxLevel+1, idxLowerGroup, idxUpperGroup, lowerGroup.getNbCells());
                     kernelWrapper.L2L(idxLevel, kernels[SpUtils::GetThreadId()-1], upperGroup, lowerGroup);
                 });
 
@@ -188,9 +203,11 @@ protected:
 
                 const auto& leafGroupObj = *currentLeafGroup;
                 auto& particleGroupObj = *currentParticleGroup;
-                runtime.task(SpPriority(priorities.getL2PPriority()), SpRead(*leafGroupObj.getLocalPtr()),
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                runtime.task(SpPriority(priorities.getL2PPriority(idxGroup)), SpRead(*leafGroupObj.getLocalPtr()),
                              SpRead(*particleGroupObj.getDataPtr()), SpCommutativeWrite(*particleGroupObj.getRhsPtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, const unsigned char&, unsigned char&){
+                                   [this, idxGroup, &leafGroupObj, &particleGroupObj](const unsigned char&, const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "L2P", configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj.getNbParticles());
                     kernelWrapper.L2P(kernels[SpUtils::GetThreadId()-1], leafGroupObj, particleGroupObj);
                 });
 
@@ -202,37 +219,36 @@ protected:
 
     template <class TreeClass>
     void P2P(SpTaskGraph<SpSpeculativeModel::SP_NO_SPEC>& runtime, TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         auto& particleGroups = inTree.getParticleGroups();
+        const auto& groupsPlan = interactionPlan.getP2PPlan(inTree);
 
-        auto currentParticleGroup = particleGroups.begin();
-        const auto endParticleGroup = particleGroups.end();
+        assert(std::size(groupsPlan) == std::size(particleGroups));
 
-        while(currentParticleGroup != endParticleGroup){
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            auto& currentGroup = particleGroups[idxGroup];
 
-            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
-                                           [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
-                assert(&groupTarget == &*currentParticleGroup);
+            for(const auto& betweenGroups : groupsPlan[idxGroup].betweenGroups){
+                const long int idxSourceGroup = betweenGroups.idxSourceGroup;
+                auto& groupSrc = particleGroups[idxSourceGroup];
+                const auto& indexesVec = betweenGroups.indexes;
 
-                runtime.task(SpPriority(priorities.getP2PPriority()), SpRead(*groupSrc.getDataPtr()), SpCommutativeWrite(*groupSrc.getRhsPtr()),
-                             SpRead(*groupTarget.getDataPtr()), SpCommutativeWrite(*groupTarget.getRhsPtr()),
-                                   [this, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, unsigned char&, const unsigned char&, unsigned char&){
-                    kernelWrapper.P2PBetweenGroups(kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*groupSrc.getDataPtr()), SpCommutativeWrite(*groupSrc.getRhsPtr()),
+                             SpRead(*currentGroup.getDataPtr()), SpCommutativeWrite(*currentGroup.getRhsPtr()),
+                                   [this, idxGroup, idxSourceGroup, &indexesVec, &groupSrc, &currentGroup](const unsigned char&, unsigned char&, const unsigned char&, unsigned char&){
+                    TbfTaskTracer::Scope traceScope(tracer, "P2P-INOUT", configuration.getTreeHeight()-1, idxGroup, idxSourceGroup, static_cast<long int>(std::size(indexesVec)));
+                    kernelWrapper.P2PBetweenGroups(kernels[SpUtils::GetThreadId()-1], currentGroup, groupSrc, indexesVec);
                 });
+            }
 
-            });
-
-            auto& currentGroup = *currentParticleGroup;
-            runtime.task(SpPriority(priorities.getP2PPriority()), SpRead(*currentGroup.getDataPtr()),SpCommutativeWrite(*currentGroup.getRhsPtr()),
-                               [this, indexesForGroup_first = std::move(indexesForGroup.first), &currentGroup](const unsigned char&, unsigned char&){
+            const auto& indexesForGroup_first = groupsPlan[idxGroup].inGroup;
+            runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*currentGroup.getDataPtr()),SpCommutativeWrite(*currentGroup.getRhsPtr()),
+                               [this, idxGroup, &indexesForGroup_first, &currentGroup](const unsigned char&, unsigned char&){
+                TbfTaskTracer::Scope traceScope(tracer, "P2P", configuration.getTreeHeight()-1, idxGroup, -1,
+                                                static_cast<long int>(std::size(indexesForGroup_first)) + currentGroup.getNbLeaves());
                 kernelWrapper.P2PInGroup(kernels[SpUtils::GetThreadId()-1], currentGroup, indexesForGroup_first);
 
                 kernelWrapper.P2PInner(kernels[SpUtils::GetThreadId()-1], currentGroup);
             });
-
-            ++currentParticleGroup;
         }
     }
 
@@ -246,7 +262,7 @@ public:
     explicit TbfSmSpecxAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), tracer(nullptr){
         kernels.emplace_back(configuration);
     }
 
@@ -256,7 +272,7 @@ public:
     TbfSmSpecxAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), tracer(nullptr){
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
     }
 
@@ -269,6 +285,7 @@ public:
         tg.computeOn(ce);
 
         increaseNumberOfKernels(ce.getNbCpuWorkers());
+        priorities.updateWorkload(inTree);
 
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
             P2M(tg, inTree);
@@ -293,6 +310,19 @@ public:
         ce.stopIfNotAlreadyStopped();
     }
 
+    void setPriorityPolicy(const TbfAlgorithmUtils::TbfPriorityPolicy inPolicy){
+        priorities.setPolicy(inPolicy);
+    }
+
+    // The tracer must stay alive during the executions, nullptr disables the tracing
+    void setTracer(TbfTaskTracer* inTracer){
+        tracer = inTracer;
+    }
+
+    TbfTaskTracer* getTracer() const{
+        return tracer;
+    }
+
     template <class FuncType>
     auto applyToAllKernels(FuncType&& inFunc) const {
         for(const auto& kernel : kernels){
@@ -6,6 +6,7 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "utils/tbftasktracer.hpp"
 #include "tbfsmstarpucallbacks.hpp"
 
 #include <cassert>
@@ -182,6 +183,9 @@ protected:
 
     TbfAlgorithmUtils::TbfOperationsPriorities priorities;
 
+    // Record the tasks if not null, the callbacks receive it with the indexes of the groups
+    TbfTaskTracer* tracer;
+
     template <class TreeClass>
     void P2M(TreeClass& inTree, CellHandleContainer& cellHandles, ParticleHandleContainer& particleHandles){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -206,13 +210,17 @@ protected:
                 size_t groupCellsDataSize = inTree.getLeafGroups()[idxGroup].getDataSize();
                 unsigned char* groupParticlesData = inTree.getParticleGroups()[idxGroup].getDataPtr();
                 size_t groupParticlesDataSize = inTree.getParticleGroups()[idxGroup].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = idxGroup;
                 starpu_insert_task(&p2m_cl,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &groupCellsData, sizeof(void*),
                                    STARPU_VALUE, &groupCellsDataSize, sizeof(size_t),
                                    STARPU_VALUE, &groupParticlesData, sizeof(void*),
                                    STARPU_VALUE, &groupParticlesDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getP2MPriority(),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getP2MPriority(idxGroup),
                                    STARPU_R, particleHandles[idxGroup][0],
                                    STARPU_R, cellHandles[configuration.getTreeHeight()-1][idxGroup][0],
                                    starpu_data_access_mode(STARPU_RW|STARPU_COMMUTE), cellHandles[configuration.getTreeHeight()-1][idxGroup][1],
@@ -249,6 +257,9 @@ protected:
                 size_t groupCellsLowerDataSize = inTree.getCellGroupsAtLevel(idxLevel+1)[idxLowerGroup].getDataSize();
                 unsigned char* groupParticlesUpperData = inTree.getCellGroupsAtLevel(idxLevel)[idxUpperGroup].getDataPtr();
                 size_t groupParticlesUpperDataSize = inTree.getCellGroupsAtLevel(idxLevel)[idxUpperGroup].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = idxUpperGroup;
+                long int idxTraceOtherGroup = idxLowerGroup;
                 starpu_insert_task(&m2m_cl,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &idxLevel, sizeof(long int),
@@ -256,7 +267,10 @@ protected:
                                    STARPU_VALUE, &groupCellsLowerDataSize, sizeof(size_t),
                                    STARPU_VALUE, &groupParticlesUpperData, sizeof(void*),
                                    STARPU_VALUE, &groupParticlesUpperDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getM2MPriority(idxLevel),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_VALUE, &idxTraceOtherGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getM2MPriority(idxLevel, idxUpperGroup),
                                    STARPU_R, cellHandles[idxLevel+1][idxLowerGroup][0],
                                    STARPU_R, cellHandles[idxLevel+1][idxLowerGroup][1],
                                    STARPU_R, cellHandles[idxLevel][idxUpperGroup][0],
@@ -302,6 +316,9 @@ protected:
                     size_t groupCellsDataSrcSize = inTree.getCellGroupsAtLevel(idxLevel)[groupSrcIdx].getDataSize();
                     unsigned char* groupCellsTgtData = inTree.getCellGroupsAtLevel(idxLevel)[groupTargetIdx].getDataPtr();
                     size_t groupCellsDataTgtSize = inTree.getCellGroupsAtLevel(idxLevel)[groupTargetIdx].getDataSize();
+                    TbfTaskTracer* tracerPtr = tracer;
+                    long int idxTraceGroup = groupTargetIdx;
+                    long int idxTraceOtherGroup = groupSrcIdx;
                     starpu_insert_task(&m2l_cl_between_groups,
                                        STARPU_VALUE, &thisptr, sizeof(void*),
                                        STARPU_VALUE, &idxLevel, sizeof(int),
@@ -310,7 +327,10 @@ protected:
                                        STARPU_VALUE, &groupCellsDataSrcSize, sizeof(size_t),
                                        STARPU_VALUE, &groupCellsTgtData, sizeof(void*),
                                        STARPU_VALUE, &groupCellsDataTgtSize, sizeof(size_t),
-                                       STARPU_PRIORITY, priorities.getM2LPriority(idxLevel),
+                                       STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                       STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                       STARPU_VALUE, &idxTraceOtherGroup, sizeof(long int),
+                                       STARPU_PRIORITY, priorities.getM2LPriority(idxLevel, groupTargetIdx),
                                        STARPU_R, cellHandles[idxLevel][groupSrcIdx][0],
                                        STARPU_R, cellHandles[idxLevel][groupSrcIdx][1],
                                        STARPU_R, cellHandles[idxLevel][groupTargetIdx][0],
@@ -324,13 +344,17 @@ protected:
                 VecOfIndexes* indexesForGroup_firstPtr = &vecIndexBuffer.back();
                 unsigned char* groupCellsData = inTree.getCellGroupsAtLevel(idxLevel)[idxGroup].getDataPtr();
                 size_t groupCellsDataSize = inTree.getCellGroupsAtLevel(idxLevel)[idxGroup].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = idxGroup;
                 starpu_insert_task(&m2l_cl_inside,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &idxLevel, sizeof(int),
                                    STARPU_VALUE, &indexesForGroup_firstPtr, sizeof(void*),
                                    STARPU_VALUE, &groupCellsData, sizeof(void*),
                                    STARPU_VALUE, &groupCellsDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getM2LPriority(idxLevel),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getM2LPriority(idxLevel, idxGroup),
                                    STARPU_R, cellHandles[idxLevel][idxGroup][0],
                                    STARPU_R, cellHandles[idxLevel][idxGroup][1],
                                    starpu_data_access_mode(STARPU_RW|STARPU_COMMUTE), cellHandles[idxLevel][idxGroup][2],
@@ -366,6 +390,9 @@ protected:
                 size_t groupParticlesUpperDataSize = inTree.getCellGroupsAtLevel(idxLevel)[idxUpperGroup].getDataSize();
                 unsigned char* groupCellsLowerData = inTree.getCellGroupsAtLevel(idxLevel+1)[idxLowerGroup].getDataPtr();
                 size_t groupCellsLowerDataSize = inTree.getCellGroupsAtLevel(idxLevel+1)[idxLowerGroup].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = idxLowerGroup;
+                long int idxTraceOtherGroup = idxUpperGroup;
                 starpu_insert_task(&l2l_cl,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &idxLevel, sizeof(long int),
@@ -373,7 +400,10 @@ protected:
                                    STARPU_VALUE, &groupParticlesUpperDataSize, sizeof(size_t),
                                    STARPU_VALUE, &groupCellsLowerData, sizeof(void*),
                                    STARPU_VALUE, &groupCellsLowerDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getL2LPriority(idxLevel),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_VALUE, &idxTraceOtherGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getL2LPriority(idxLevel, idxLowerGroup),
                                    STARPU_R, cellHandles[idxLevel][idxUpperGroup][0],
                                    STARPU_R, cellHandles[idxLevel][idxUpperGroup][2],
                                    STARPU_R, cellHandles[idxLevel+1][idxLowerGroup][0],
@@ -423,13 +453,17 @@ protected:
                 size_t groupCellsDataSize = inTree.getLeafGroups()[idxGroup].getDataSize();
                 unsigned char* groupParticlesData = inTree.getParticleGroups()[idxGroup].getDataPtr();
                 size_t groupParticlesDataSize = inTree.getParticleGroups()[idxGroup].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = idxGroup;
                 starpu_insert_task(&l2p_cl,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &groupCellsData, sizeof(void*),
                                    STARPU_VALUE, &groupCellsDataSize, sizeof(size_t),
                                    STARPU_VALUE, &groupParticlesData, sizeof(void*),
                                    STARPU_VALUE, &groupParticlesDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getL2PPriority(),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getL2PPriority(idxGroup),
                                    STARPU_R, cellHandles[configuration.getTreeHeight()-1][idxGroup][0],
                                    STARPU_R, cellHandles[configuration.getTreeHeight()-1][idxGroup][2],
                                    STARPU_R, particleHandles[idxGroup][0],
@@ -467,6 +501,9 @@ protected:
                 size_t srcDataSize = inTree.getParticleGroups()[groupSrcIdx].getDataSize();
                 unsigned char* tgtData = inTree.getParticleGroups()[groupTargetIdx].getDataPtr();
                 size_t tgtDataSize = inTree.getParticleGroups()[groupTargetIdx].getDataSize();
+                TbfTaskTracer* tracerPtr = tracer;
+                long int idxTraceGroup = groupTargetIdx;
+                long int idxTraceOtherGroup = groupSrcIdx;
                 starpu_insert_task(&p2p_cl_twoleaves,
                                    STARPU_VALUE, &thisptr, sizeof(void*),
                                    STARPU_VALUE, &vecIndexesPtr, sizeof(void*),
@@ -474,7 +511,10 @@ protected:
                                    STARPU_VALUE, &srcDataSize, sizeof(size_t),
                                    STARPU_VALUE, &tgtData, sizeof(void*),
                                    STARPU_VALUE, &tgtDataSize, sizeof(size_t),
-                                   STARPU_PRIORITY, priorities.getP2PPriority(),
+                                   STARPU_VALUE, &tracerPtr, sizeof(void*),
+                                   STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                                   STARPU_VALUE, &idxTraceOtherGroup, sizeof(long int),
+                                   STARPU_PRIORITY, priorities.getP2PPriority(groupTargetIdx),
                                    STARPU_R, particleHandles[groupSrcIdx][0],
                                    starpu_data_access_mode(STARPU_RW|STARPU_COMMUTE), particleHandles[groupSrcIdx][1],
                                    STARPU_R, particleHandles[groupTargetIdx][0],
@@ -488,12 +528,16 @@ protected:
             VecOfIndexes* indexesForGroup_firstPtr = &vecIndexBuffer.back();
             unsigned char* groupData = inTree.getParticleGroups()[idxGroup].getDataPtr();
             size_t groupDataSize = inTree.getParticleGroups()[idxGroup].getDataSize();
+            TbfTaskTracer* tracerPtr = tracer;
+            long int idxTraceGroup = idxGroup;
             starpu_insert_task(&p2p_cl_oneleaf,
                                STARPU_VALUE, &thisptr, sizeof(void*),
                                STARPU_VALUE, &indexesForGroup_firstPtr, sizeof(void*),
                                STARPU_VALUE, &groupData, sizeof(void*),
                                STARPU_VALUE, &groupDataSize, sizeof(size_t),
-                               STARPU_PRIORITY, priorities.getP2PPriority(),
+                               STARPU_VALUE, &tracerPtr, sizeof(void*),
+                               STARPU_VALUE, &idxTraceGroup, sizeof(long int),
+                               STARPU_PRIORITY, priorities.getP2PPriority(idxGroup),
                                STARPU_R, particleHandles[idxGroup][0],
                                starpu_data_access_mode(STARPU_RW|STARPU_COMMUTE), particleHandles[idxGroup][1],
                                STARPU_NAME, "P2P",
@@ -514,7 +558,7 @@ public:
     explicit TbfSmStarpuAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), tracer(nullptr){
         kernels.emplace_back(configuration);
 
         [[maybe_unused]] const int ret = starpu_init(NULL);
@@ -528,7 +572,7 @@ public:
     TbfSmStarpuAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), tracer(nullptr){
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
 
         [[maybe_unused]] const int ret = starpu_init(NULL);
@@ -562,6 +606,8 @@ public:
 
         initCodelet<CellContainerClass, ParticleContainerClass>();
 
+        priorities.updateWorkload(inTree);
+
         starpu_resume();
 
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
@@ -591,6 +637,19 @@ public:
         TbfStarPUHandleBuilder::CleanParticleHandles(allParticlesHandles);
     }
 
+    void setPriorityPolicy(const TbfAlgorithmUtils::TbfPriorityPolicy inPolicy){
+        priorities.setPolicy(inPolicy);
+    }
+
+    // The tracer must stay alive during the executions, nullptr disables the tracing
+    void setTracer(TbfTaskTracer* inTracer){
+        tracer = inTracer;
+    }
+
+    TbfTaskTracer* getTracer() const{
+        return tracer;
+    }
+
     template <class FuncType>
     auto applyToAllKernels(FuncType&& inFunc) const {
         for(const auto& kernel : kernels){
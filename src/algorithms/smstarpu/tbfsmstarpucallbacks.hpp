@@ -3,7 +3,10 @@
 
 #include <starpu.h>
 
+#include "utils/tbftasktracer.hpp"
 
+// The tracer and the group indexes are the last arguments, they keep
+// their default values (no tracing) when a task does not provide them
 class TbfSmStarpuCallbacks{
 public:
     template<class ThisClass, class CellContainerClass, class ParticleContainerClass>
@@ -13,7 +16,10 @@ public:
         size_t groupCellsDataSize;
         unsigned char* groupParticlesData;
         size_t groupParticlesDataSize;
-        starpu_codelet_unpack_args(cl_arg, &thisptr, &groupCellsData, &groupCellsDataSize, &groupParticlesData, &groupParticlesDataSize);
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        starpu_codelet_unpack_args(cl_arg, &thisptr, &groupCellsData, &groupCellsDataSize, &groupParticlesData, &groupParticlesDataSize,
+                                   &tracer, &idxGroup);
 
 
         unsigned char* particleData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
@@ -31,6 +37,7 @@ public:
         const ParticleContainerClass particleGroupObj(particleData, particleDataSize,
                                                       nullptr, 0);
 
+        TbfTaskTracer::Scope traceScope(tracer, "P2M", thisptr->configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj.getNbParticles());
         thisptr->kernelWrapper.P2M(thisptr->kernels[starpu_worker_get_id()], particleGroupObj, leafGroupObj);
     }
 
@@ -42,8 +49,12 @@ public:
         size_t srcDataSizeCpu;
         unsigned char* tgtDataCpu;
         size_t tgtDataSizeCpu;
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        long int idxOtherGroup = -1;
         starpu_codelet_unpack_args(cl_arg, &thisptr, &indexesForGroup_first,
-                                   &srcDataCpu, &srcDataSizeCpu, &tgtDataCpu, &tgtDataSizeCpu);
+                                   &srcDataCpu, &srcDataSizeCpu, &tgtDataCpu, &tgtDataSizeCpu,
+                                   &tracer, &idxGroup, &idxOtherGroup);
 
         unsigned char* srcData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t srcDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -66,6 +77,8 @@ public:
         ParticleContainerClass groupTarget(tgtData, tgtDataSize,
                                            tgtRhs, tgtRhsSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "P2P-INOUT", thisptr->configuration.getTreeHeight()-1, idxGroup, idxOtherGroup,
+                                        static_cast<long int>(std::size(*indexesForGroup_first)));
         thisptr->kernelWrapper.P2PBetweenGroups(thisptr->kernels[starpu_worker_get_id()], groupSrc, groupTarget, *indexesForGroup_first);
     }
 
@@ -75,7 +88,10 @@ public:
         typename ThisClass::VecOfIndexes* indexesForGroup_first;
         unsigned char* particleDataCpu;
         size_t particleDataSizeCpu;
-        starpu_codelet_unpack_args(cl_arg, &thisptr, &indexesForGroup_first, &particleDataCpu, &particleDataSizeCpu);
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        starpu_codelet_unpack_args(cl_arg, &thisptr, &indexesForGroup_first, &particleDataCpu, &particleDataSizeCpu,
+                                   &tracer, &idxGroup);
 
         unsigned char* particleData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t particleDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -88,6 +104,8 @@ public:
         ParticleContainerClass currentGroup(particleData, particleDataSize,
                                             particleRhs, particleRhsSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "P2P", thisptr->configuration.getTreeHeight()-1, idxGroup, -1,
+                                        static_cast<long int>(std::size(*indexesForGroup_first)) + currentGroup.getNbLeaves());
         thisptr->kernelWrapper.P2PInGroup(thisptr->kernels[starpu_worker_get_id()], currentGroup, *indexesForGroup_first);
         thisptr->kernelWrapper.P2PInner(thisptr->kernels[starpu_worker_get_id()], currentGroup);
     }
@@ -100,8 +118,12 @@ public:
         size_t groupCellsLowerDataSize;
         unsigned char* groupCellsUpperData;
         size_t groupCellsUpperDataSize;
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        long int idxOtherGroup = -1;
         starpu_codelet_unpack_args(cl_arg, &thisptr, &idxLevel, &groupCellsLowerData, &groupCellsLowerDataSize,
-                                   &groupCellsUpperData, &groupCellsUpperDataSize);
+                                   &groupCellsUpperData, &groupCellsUpperDataSize,
+                                   &tracer, &idxGroup, &idxOtherGroup);
 
         unsigned char* lowerData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t lowerDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -120,6 +142,7 @@ public:
         CellContainerClass upperGroupObj(upperData, upperDataSize, upperMultipole, upperMultipoleSize,
                                          nullptr, 0);
 
+        TbfTaskTracer::Scope traceScope(tracer, "M2M", idxLevel, idxGroup, idxOtherGroup, lowerGroupObj.getNbCells());
         thisptr->kernelWrapper.M2M(idxLevel, thisptr->kernels[starpu_worker_get_id()], lowerGroupObj, upperGroupObj);
     }
 
@@ -132,8 +155,12 @@ public:
         size_t groupCellsSrcDataSize;
         unsigned char* groupCellsTgtData;
         size_t groupCellsTgtDataSize;
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        long int idxOtherGroup = -1;
         starpu_codelet_unpack_args(cl_arg, &thisptr, &idxLevel, &indexesForGroup_first,
-                                   &groupCellsSrcData, &groupCellsSrcDataSize, &groupCellsTgtData, &groupCellsTgtDataSize);
+                                   &groupCellsSrcData, &groupCellsSrcDataSize, &groupCellsTgtData, &groupCellsTgtDataSize,
+                                   &tracer, &idxGroup, &idxOtherGroup);
 
         unsigned char* srcData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t srcDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -151,6 +178,7 @@ public:
                                           nullptr, 0);
         CellContainerClass groupTarget(tgtData, tgtDataSize, nullptr, 0, tgtLocal, tgtLocalSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "M2L", idxLevel, idxGroup, idxOtherGroup, static_cast<long int>(std::size(*indexesForGroup_first)));
         thisptr->kernelWrapper.M2LBetweenGroups(idxLevel, thisptr->kernels[starpu_worker_get_id()], groupTarget, groupSrc, *indexesForGroup_first);
     }
 
@@ -161,7 +189,10 @@ public:
         typename ThisClass::VecOfIndexes* indexesForGroup_first;
         unsigned char* groupCellsData;
         size_t groupCellsDataSize;
-        starpu_codelet_unpack_args(cl_arg, &thisptr, &idxLevel, &indexesForGroup_first, &groupCellsData, &groupCellsDataSize);
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        starpu_codelet_unpack_args(cl_arg, &thisptr, &idxLevel, &indexesForGroup_first, &groupCellsData, &groupCellsDataSize,
+                                   &tracer, &idxGroup);
 
         unsigned char* srcData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t srcDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -175,6 +206,7 @@ public:
         CellContainerClass currentGroup(srcData, srcDataSize, srcMultipole, srcMultipoleSize,
                                         srcLocal, srcLocalSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "M2L-IN", idxLevel, idxGroup, -1, static_cast<long int>(std::size(*indexesForGroup_first)));
         thisptr->kernelWrapper.M2LInGroup(idxLevel, thisptr->kernels[starpu_worker_get_id()], currentGroup, *indexesForGroup_first);
     }
 
@@ -186,8 +218,12 @@ public:
         size_t groupCellsLowerDataSize;
         unsigned char* groupCellsUpperData;
         size_t groupCellsUpperDataSize;
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        long int idxOtherGroup = -1;
         starpu_codelet_unpack_args(cl_arg, &thisptr, &idxLevel, &groupCellsUpperData, &groupCellsUpperDataSize,
-                                   &groupCellsLowerData, &groupCellsLowerDataSize);
+                                   &groupCellsLowerData, &groupCellsLowerDataSize,
+                                   &tracer, &idxGroup, &idxOtherGroup);
 
         unsigned char* upperData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t upperDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -204,6 +240,7 @@ public:
         const CellContainerClass upperGroupObj(upperData, upperDataSize, nullptr, 0, upperLocal, upperLocalSize);
         CellContainerClass lowerGroupObj(lowerData, lowerDataSize, nullptr, 0, lowerLocal, lowerLocalSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "L2L", idxLevel+1, idxGroup, idxOtherGroup, lowerGroupObj.getNbCells());
         thisptr->kernelWrapper.L2L(idxLevel, thisptr->kernels[starpu_worker_get_id()], upperGroupObj, lowerGroupObj);
     }
 
@@ -214,7 +251,10 @@ public:
         size_t groupCellsDataSize;
         unsigned char* groupParticlesData;
         size_t groupParticlesDataSize;
-        starpu_codelet_unpack_args(cl_arg, &thisptr,  &groupCellsData, &groupCellsDataSize, &groupParticlesData, &groupParticlesDataSize);
+        TbfTaskTracer* tracer = nullptr;
+        long int idxGroup = -1;
+        starpu_codelet_unpack_args(cl_arg, &thisptr,  &groupCellsData, &groupCellsDataSize, &groupParticlesData, &groupParticlesDataSize,
+                                   &tracer, &idxGroup);
 
         unsigned char* leafData = (unsigned char*)STARPU_VARIABLE_GET_PTR(buffers[0]);
         size_t leafDataSize = STARPU_VARIABLE_GET_ELEMSIZE(buffers[0]);
@@ -231,6 +271,7 @@ public:
         const CellContainerClass leafGroupObj(leafData, leafDataSize, nullptr, 0, leafLocal, leafLocalSize);
         ParticleContainerClass particleGroupObj(particleData, particleDataSize, particleRhs, particleRhsSize);
 
+        TbfTaskTracer::Scope traceScope(tracer, "L2P", thisptr->configuration.getTreeHeight()-1, idxGroup, -1, particleGroupObj.getNbParticles());
         thisptr->kernelWrapper.L2P(thisptr->kernels[starpu_worker_get_id()], leafGroupObj, particleGroupObj);
     }
 
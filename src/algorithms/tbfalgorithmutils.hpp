@@ -7,6 +7,9 @@
 
 #include <cassert>
 #include <type_traits>
+#include <vector>
+#include <numeric>
+#include <algorithm>
 
 namespace TbfAlgorithmUtils{
 
@@ -155,25 +158,166 @@ enum TbfOperations {
     TbfTransferStages = (TbfM2L|TbfP2P)
 };
 
+enum TbfPriorityPolicy {
+    // The priorities only depend on the operator and on the level
+    TbfStaticPriorities,
+    // Inside each operator/level, the groups with the most work downstream come first:
+    // the number of particles below a cell group (for the far field), and the
+    // particle interactions of a particle group (for the P2P)
+    TbfWorkloadPriorities
+};
+
 class TbfOperationsPriorities {
     const int treeHeight;
 
-    const int prioP2P;
-    const int prioL2P;
-    const int prioL2L;
-    const int prioM2L;
-    const int prioM2M;
-    const int prioP2M;
+    TbfPriorityPolicy policy;
+    // Number of different priorities inside each operator/level
+    int nbSubPriorities;
+
+    int prioP2P;
+    int prioL2P;
+    int prioL2L;
+    int prioM2L;
+    int prioM2M;
+    int prioP2M;
+
+    long int workloadTreeVersion;
+    std::vector<std::vector<int>> cellGroupsSubPriorities;
+    std::vector<int> particleGroupsSubPriorities;
+    std::vector<int> p2pSubPriorities;
+
+    void setPriorities(){
+        nbSubPriorities = (policy == TbfWorkloadPriorities ? NbWorkloadSubPriorities : 1);
+        prioP2P = 0;
+        prioL2P = nbSubPriorities;
+        prioL2L = 2*nbSubPriorities;
+        prioM2L = prioL2L+treeHeight*nbSubPriorities;
+        prioM2M = prioM2L+treeHeight*nbSubPriorities;
+        prioP2M = prioM2M+treeHeight*nbSubPriorities;
+    }
+
+    // Convert the workloads into ranks in [0, nbSubPriorities[
+    std::vector<int> getSubPrioritiesFromWorkloads(const std::vector<double>& inWorkloads) const{
+        std::vector<long int> permutation(inWorkloads.size());
+        std::iota(permutation.begin(), permutation.end(), 0);
+        std::stable_sort(permutation.begin(), permutation.end(), [&](const long int idx1, const long int idx2){
+            return inWorkloads[idx1] < inWorkloads[idx2];
+        });
+
+        std::vector<int> subPriorities(inWorkloads.size());
+        for(long int idxRank = 0 ; idxRank < static_cast<long int>(permutation.size()) ; ++idxRank){
+            subPriorities[permutation[idxRank]] = int((idxRank*nbSubPriorities)/static_cast<long int>(permutation.size()));
+        }
+        return subPriorities;
+    }
+
+    static int GetSubPriority(const std::vector<int>& inSubPriorities, const long int inIdxGroup){
+        return (inIdxGroup < static_cast<long int>(inSubPriorities.size()) ? inSubPriorities[inIdxGroup] : 0);
+    }
+
+    int getCellGroupSubPriority(const long int inLevel, const long int inIdxGroup) const{
+        return (inLevel < static_cast<long int>(cellGroupsSubPriorities.size()) ?
+                    GetSubPriority(cellGroupsSubPriorities[inLevel], inIdxGroup) : 0);
+    }
 
 public:
-    TbfOperationsPriorities(const long int inTreeHeight)
-        : treeHeight(int(inTreeHeight)),
-          prioP2P(0),
-          prioL2P(1),
-          prioL2L(2),
-          prioM2L(prioL2L+treeHeight),
-          prioM2M(prioM2L+treeHeight),
-          prioP2M(prioM2M+treeHeight){}
+    static constexpr int NbWorkloadSubPriorities = 8;
+
+    TbfOperationsPriorities(const long int inTreeHeight, const TbfPriorityPolicy inPolicy = TbfStaticPriorities)
+        : treeHeight(int(inTreeHeight)), policy(inPolicy), workloadTreeVersion(-1){
+        setPriorities();
+    }
+
+    void setPolicy(const TbfPriorityPolicy inPolicy){
+        policy = inPolicy;
+        setPriorities();
+        workloadTreeVersion = -1;
+        cellGroupsSubPriorities.clear();
+        particleGroupsSubPriorities.clear();
+        p2pSubPriorities.clear();
+    }
+
+    TbfPriorityPolicy getPolicy() const{
+        return policy;
+    }
+
+    int getNbSubPriorities() const{
+        return nbSubPriorities;
+    }
+
+    // Compute the workload of the groups of the tree, it does nothing with the static
+    // policy or if the tree has not been rebuilt since the last call
+    template <class TreeClass>
+    void updateWorkload(TreeClass& inTree){
+        if(policy == TbfStaticPriorities || workloadTreeVersion == inTree.getVersion()){
+            return;
+        }
+        workloadTreeVersion = inTree.getVersion();
+
+        const auto& spaceSystem = inTree.getSpacialSystem();
+        const long int leafLevel = inTree.getHeight()-1;
+        auto& particleGroups = inTree.getParticleGroups();
+
+        // Far field: number of particles below each cell group
+        using IndexType = typename std::decay<decltype(particleGroups[0].getLeafSpacialIndex(0))>::type;
+        std::vector<std::pair<IndexType, double>> cellsWorkload;
+        for(const auto& particleGroup : particleGroups){
+            for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                cellsWorkload.emplace_back(particleGroup.getLeafSpacialIndex(idxLeaf), double(particleGroup.getNbParticlesInLeaf(idxLeaf)));
+            }
+        }
+
+        cellGroupsSubPriorities.clear();
+        cellGroupsSubPriorities.resize(inTree.getHeight());
+        for(long int idxLevel = leafLevel ; idxLevel >= 0 ; --idxLevel){
+            const auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            std::vector<double> groupsWorkload(std::size(cellGroups), 0);
+            long int idxCellWorkload = 0;
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                for(long int idxCell = 0 ; idxCell < cellGroups[idxGroup].getNbCells() ; ++idxCell){
+                    const auto cellIndex = cellGroups[idxGroup].getCellSpacialIndex(idxCell);
+                    while(idxCellWorkload < static_cast<long int>(cellsWorkload.size()) && cellsWorkload[idxCellWorkload].first < cellIndex){
+                        idxCellWorkload += 1;
+                    }
+                    if(idxCellWorkload < static_cast<long int>(cellsWorkload.size()) && cellsWorkload[idxCellWorkload].first == cellIndex){
+                        groupsWorkload[idxGroup] += cellsWorkload[idxCellWorkload].second;
+                    }
+                }
+            }
+            cellGroupsSubPriorities[idxLevel] = getSubPrioritiesFromWorkloads(groupsWorkload);
+
+            std::vector<std::pair<IndexType, double>> parentsWorkload;
+            for(const auto& cellWorkload : cellsWorkload){
+                const auto parentIndex = spaceSystem.getParentIndex(cellWorkload.first);
+                if(parentsWorkload.empty() || parentsWorkload.back().first != parentIndex){
+                    parentsWorkload.emplace_back(parentIndex, 0);
+                }
+                parentsWorkload.back().second += cellWorkload.second;
+            }
+            cellsWorkload = std::move(parentsWorkload);
+        }
+
+        // Near field: number of particle interactions of each particle group
+        std::vector<double> p2pWorkload(std::size(particleGroups), 0);
+        std::vector<double> particlesWorkload(std::size(particleGroups), 0);
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            const auto& particleGroup = particleGroups[idxGroup];
+            for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                const double nbParticlesInLeaf = double(particleGroup.getNbParticlesInLeaf(idxLeaf));
+                double nbNeighbors = nbParticlesInLeaf;
+                for(const auto& neighborIndex : spaceSystem.getNeighborListForIndex(particleGroup.getLeafSpacialIndex(idxLeaf), leafLevel)){
+                    auto foundLeaf = inTree.findGroupWithLeaf(neighborIndex);
+                    if(foundLeaf){
+                        nbNeighbors += double((*foundLeaf).first.get().getNbParticlesInLeaf((*foundLeaf).second));
+                    }
+                }
+                p2pWorkload[idxGroup] += nbParticlesInLeaf * nbNeighbors;
+            }
+            particlesWorkload[idxGroup] = double(particleGroup.getNbParticles());
+        }
+        p2pSubPriorities = getSubPrioritiesFromWorkloads(p2pWorkload);
+        particleGroupsSubPriorities = getSubPrioritiesFromWorkloads(particlesWorkload);
+    }
 
     int getP2PPriority() const{
         return prioP2P;
@@ -184,20 +328,46 @@ public:
     }
 
     int getM2MPriority(const long int inLevel) const{
-        return prioM2M+treeHeight-int(inLevel)-1;
+        return prioM2M+(treeHeight-int(inLevel)-1)*nbSubPriorities;
     }
 
     int getM2LPriority(const long int inLevel) const{
-        return prioM2L+treeHeight-int(inLevel)-1;
+        return prioM2L+(treeHeight-int(inLevel)-1)*nbSubPriorities;
     }
 
     int getL2LPriority(const long int inLevel) const{
-        return prioL2L+treeHeight-int(inLevel)-1;
+        return prioL2L+(treeHeight-int(inLevel)-1)*nbSubPriorities;
     }
 
     int getL2PPriority() const{
         return prioL2P;
     }
+
+    // Versions for a given group: the index of the particle group, or of the cell group
+    // at the given level (the upper group for the M2M and the lower group for the L2L)
+    int getP2PPriority(const long int inIdxGroup) const{
+        return getP2PPriority() + GetSubPriority(p2pSubPriorities, inIdxGroup);
+    }
+
+    int getP2MPriority(const long int inIdxGroup) const{
+        return getP2MPriority() + GetSubPriority(particleGroupsSubPriorities, inIdxGroup);
+    }
+
+    int getM2MPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getM2MPriority(inLevel) + getCellGroupSubPriority(inLevel, inIdxGroup);
+    }
+
+    int getM2LPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getM2LPriority(inLevel) + getCellGroupSubPriority(inLevel, inIdxGroup);
+    }
+
+    int getL2LPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getL2LPriority(inLevel) + getCellGroupSubPriority(inLevel+1, inIdxGroup);
+    }
+
+    int getL2PPriority(const long int inIdxGroup) const{
+        return getL2PPriority() + GetSubPriority(particleGroupsSubPriorities, inIdxGroup);
+    }
 };
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -3,66 +3,235 @@
 
 #include "tbfglobal.hpp"
 
+#include "core/tbfparticlesorter.hpp"
+
 #include <thread>
-#include <set>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 
 namespace TbfBlockSizeFinder{
 
-template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
-int Estimate(const ParticleContainer& inParticlePositions,
-             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
-             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+struct Statistics{
+    long int nbParticles = 0;
+    // Number of non-empty cells at each level, the last one is the leaf level
+    std::vector<long int> nbCellsPerLevel;
+
+    long int getNbLeaves() const{
+        return (nbCellsPerLevel.size() ? nbCellsPerLevel.back() : 0);
+    }
+};
+
+// The cost of creating/scheduling one group expressed in number of cell operations
+constexpr long int GroupOverheadInCells = 8;
+
+inline bool GetBlockSizeFromEnv(int* outBlockSize){
     if(getenv("TBFMM_BLOCK_SIZE")){
         std::istringstream iss(getenv("TBFMM_BLOCK_SIZE"),std::istringstream::in);
         int blockSize = -1;
         iss >> blockSize;
-        if( /*iss.tellg()*/ iss.eof() ) return blockSize;
+        if( /*iss.tellg()*/ iss.eof() ){
+            (*outBlockSize) = blockSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class SpaceIndexType, class IndexType = typename SpaceIndexType::IndexType>
+Statistics ComputeStatisticsFromLeaves(const SpaceIndexType& inSpaceSystem, const long int inTreeHeight,
+                                       std::vector<IndexType> inSortedLeafIndexes, const long int inNbParticles){
+    Statistics stats;
+    stats.nbParticles = inNbParticles;
+    stats.nbCellsPerLevel.resize(std::max(0L, inTreeHeight), 0);
+
+    // Parents of sorted cells are sorted, so each level is obtained
+    // by a linear pass over the level below
+    for(long int idxLevel = inTreeHeight-1 ; idxLevel >= 0 ; --idxLevel){
+        stats.nbCellsPerLevel[idxLevel] = static_cast<long int>(inSortedLeafIndexes.size());
+        if(idxLevel){
+            long int nbParents = 0;
+            for(long int idxCell = 0 ; idxCell < static_cast<long int>(inSortedLeafIndexes.size()) ; ++idxCell){
+                const IndexType parentIndex = inSpaceSystem.getParentIndex(inSortedLeafIndexes[idxCell]);
+                if(nbParents == 0 || inSortedLeafIndexes[nbParents-1] != parentIndex){
+                    inSortedLeafIndexes[nbParents++] = parentIndex;
+                }
+            }
+            inSortedLeafIndexes.resize(nbParents);
+        }
     }
 
+    return stats;
+}
+
+template <class RealType, class SpaceIndexType>
+Statistics ComputeStatisticsFromSorter(const SpaceIndexType& inSpaceSystem, const long int inTreeHeight,
+                                       const TbfParticleSorter<RealType, SpaceIndexType>& inSorter){
     using IndexType = typename SpaceIndexType::IndexType;
 
+    std::vector<IndexType> leafIndexes(inSorter.getNbLeaves());
+    for(long int idxLeaf = 0 ; idxLeaf < inSorter.getNbLeaves() ; ++idxLeaf){
+        leafIndexes[idxLeaf] = inSorter.getSpacialIndexForLeaf(idxLeaf);
+    }
+
+    return ComputeStatisticsFromLeaves(inSpaceSystem, inTreeHeight, std::move(leafIndexes), inSorter.getNbParticles());
+}
+
+template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+Statistics ComputeStatistics(const ParticleContainer& inParticlePositions,
+                             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration){
     SpaceIndexType spaceSystem(inConfiguration);
+    TbfParticleSorter<RealType, SpaceIndexType> sorter(spaceSystem, inParticlePositions);
+    return ComputeStatisticsFromSorter(spaceSystem, inConfiguration.getTreeHeight(), sorter);
+}
 
-    std::set<IndexType> allIndexes;
+template <class RealType, class ParticleContainerSource, class ParticleContainerTarget, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+Statistics ComputeStatisticsTsm(const ParticleContainerSource& inParticlePositionsSource,
+                                const ParticleContainerTarget& inParticlePositionsTarget,
+                                const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration){
+    using IndexType = typename SpaceIndexType::IndexType;
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositions)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
-        allIndexes.insert(index);
+    SpaceIndexType spaceSystem(inConfiguration);
+    TbfParticleSorter<RealType, SpaceIndexType> sorterSource(spaceSystem, inParticlePositionsSource);
+    TbfParticleSorter<RealType, SpaceIndexType> sorterTarget(spaceSystem, inParticlePositionsTarget);
+
+    std::vector<IndexType> leafIndexes;
+    leafIndexes.reserve(sorterSource.getNbLeaves() + sorterTarget.getNbLeaves());
+
+    long int idxSource = 0;
+    long int idxTarget = 0;
+    while(idxSource < sorterSource.getNbLeaves() || idxTarget < sorterTarget.getNbLeaves()){
+        IndexType nextIndex;
+        if(idxTarget == sorterTarget.getNbLeaves()
+                || (idxSource < sorterSource.getNbLeaves()
+                    && sorterSource.getSpacialIndexForLeaf(idxSource) <= sorterTarget.getSpacialIndexForLeaf(idxTarget))){
+            nextIndex = sorterSource.getSpacialIndexForLeaf(idxSource++);
+        }
+        else{
+            nextIndex = sorterTarget.getSpacialIndexForLeaf(idxTarget++);
+        }
+        if(leafIndexes.empty() || leafIndexes.back() != nextIndex){
+            leafIndexes.push_back(nextIndex);
+        }
     }
 
-    return std::max(1, static_cast<int>(allIndexes.size()/(inNbThreads*2)));
+    return ComputeStatisticsFromLeaves(spaceSystem, inConfiguration.getTreeHeight(), std::move(leafIndexes),
+                                       sorterSource.getNbParticles() + sorterTarget.getNbParticles());
 }
 
-template <class RealType, class ParticleContainerSource, class ParticleContainerTarget, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
-int EstimateTsm(const ParticleContainerSource& inParticlePositionsSource,
-                const ParticleContainerTarget& inParticlePositionsTarget,
-             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
-             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
-    if(getenv("TBFMM_BLOCK_SIZE")){
-        std::istringstream iss(getenv("TBFMM_BLOCK_SIZE"),std::istringstream::in);
-        int blockSize = -1;
-        iss >> blockSize;
-        if( /*iss.tellg()*/ iss.eof() ) return blockSize;
+// Estimated makespan when every level is cut in groups of inBlockSize cells:
+// the groups of a level are processed in waves of inNbThreads, each group
+// costs its number of cells (weighted by the particles per leaf at the leaf level)
+// plus a constant overhead.
+inline double EstimateCost(const Statistics& inStats, const long int inBlockSize, const int inNbThreads){
+    const long int nbThreads = std::max(1, inNbThreads);
+    const long int nbLevels = static_cast<long int>(inStats.nbCellsPerLevel.size());
+    double totalCost = 0;
+
+    for(long int idxLevel = 1 ; idxLevel < nbLevels ; ++idxLevel){
+        const long int nbCells = inStats.nbCellsPerLevel[idxLevel];
+        if(nbCells == 0){
+            continue;
+        }
+        const double cellWeight = (idxLevel == nbLevels-1 ?
+                                       1 + double(inStats.nbParticles)/double(nbCells)
+                                     : 1);
+        const long int nbGroups = (nbCells + inBlockSize - 1)/inBlockSize;
+        const long int nbWaves = (nbGroups + nbThreads - 1)/nbThreads;
+        totalCost += double(nbWaves) * double(std::min(inBlockSize, nbCells)) * cellWeight
+                     + double(nbGroups * GroupOverheadInCells) * cellWeight / double(nbThreads);
     }
 
-    using IndexType = typename SpaceIndexType::IndexType;
+    return totalCost;
+}
 
-    SpaceIndexType spaceSystem(inConfiguration);
+// The default block size: two groups of leaves per thread
+inline int EstimateFromNbLeaves(const long int inNbLeaves,
+                                const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+    return static_cast<int>(std::max(1L, inNbLeaves/(std::max(1, inNbThreads)*2)));
+}
+
+inline int EstimateFromStatistics(const Statistics& inStats,
+                                  const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+    return EstimateFromNbLeaves(inStats.getNbLeaves(), inNbThreads);
+}
+
+// Select among the default size and the powers of two the one that minimizes EstimateCost
+inline int EstimateWithCostModel(const Statistics& inStats,
+                                 const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+    const long int nbLeaves = inStats.getNbLeaves();
+    const long int defaultBlockSize = EstimateFromNbLeaves(nbLeaves, inNbThreads);
+    if(nbLeaves == 0){
+        return static_cast<int>(defaultBlockSize);
+    }
+
+    long int bestBlockSize = defaultBlockSize;
+    double bestCost = EstimateCost(inStats, bestBlockSize, inNbThreads);
+
+    for(long int candidate = 1 ; candidate <= nbLeaves ; candidate *= 2){
+        const double candidateCost = EstimateCost(inStats, candidate, inNbThreads);
+        if(candidateCost < bestCost || (candidateCost == bestCost && candidate > bestBlockSize)){
+            bestCost = candidateCost;
+            bestBlockSize = candidate;
+        }
+    }
+
+    return static_cast<int>(bestBlockSize);
+}
 
-    std::set<IndexType> allIndexes;
+// Values that can be passed as block size to the trees:
+// DefaultBlockSize uses EstimateFromStatistics, CostModelBlockSize uses EstimateWithCostModel
+constexpr long int DefaultBlockSize = -1;
+constexpr long int CostModelBlockSize = -2;
+
+// To be used when the particles are already sorted (the tree reuses the sorter of its build)
+template <class RealType, class SpaceIndexType>
+int EstimateFromSorter(const SpaceIndexType& inSpaceSystem, const long int inTreeHeight,
+                       const TbfParticleSorter<RealType, SpaceIndexType>& inSorter,
+                       const bool inUseCostModel = false,
+                       const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+    int blockSize;
+    if(GetBlockSizeFromEnv(&blockSize)){
+        return blockSize;
+    }
+
+    if(inUseCostModel){
+        return EstimateWithCostModel(ComputeStatisticsFromSorter(inSpaceSystem, inTreeHeight, inSorter), inNbThreads);
+    }
+    return EstimateFromNbLeaves(inSorter.getNbLeaves(), inNbThreads);
+}
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositionsSource)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositionsSource[idxPart]);
-        allIndexes.insert(index);
+template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+int Estimate(const ParticleContainer& inParticlePositions,
+             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
+             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency()),
+             const bool inUseCostModel = false){
+    int blockSize;
+    if(GetBlockSizeFromEnv(&blockSize)){
+        return blockSize;
     }
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositionsTarget)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositionsTarget[idxPart]);
-        allIndexes.insert(index);
+    SpaceIndexType spaceSystem(inConfiguration);
+    TbfParticleSorter<RealType, SpaceIndexType> sorter(spaceSystem, inParticlePositions);
+    return EstimateFromSorter(spaceSystem, inConfiguration.getTreeHeight(), sorter, inUseCostModel, inNbThreads);
+}
+
+template <class RealType, class ParticleContainerSource, class ParticleContainerTarget, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+int EstimateTsm(const ParticleContainerSource& inParticlePositionsSource,
+                const ParticleContainerTarget& inParticlePositionsTarget,
+             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
+             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency()),
+             const bool inUseCostModel = false){
+    int blockSize;
+    if(GetBlockSizeFromEnv(&blockSize)){
+        return blockSize;
     }
 
-    return std::max(1, static_cast<int>(allIndexes.size()/(inNbThreads*2)));
+    const Statistics stats = ComputeStatisticsTsm<RealType, ParticleContainerSource, ParticleContainerTarget, SpaceIndexType>(inParticlePositionsSource,
+                                                                                                                            inParticlePositionsTarget,
+                                                                                                                            inConfiguration);
+    return (inUseCostModel ? EstimateWithCostModel(stats, inNbThreads) : EstimateFromStatistics(stats, inNbThreads));
 }
 
 }
@@ -0,0 +1,194 @@
+#ifndef TBFBLOCKSIZETUNER_HPP
+#define TBFBLOCKSIZETUNER_HPP
+
+#include "tbfglobal.hpp"
+
+#include "algorithms/tbfblocksizefinder.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "utils/tbftimer.hpp"
+
+#include <vector>
+#include <memory>
+#include <map>
+#include <tuple>
+#include <string>
+#include <typeinfo>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+// Select the block size by timing a few candidates on a subsample of the particles.
+// The subsample is executed on a shallower tree such that the number of particles
+// per leaf stays close to the one of the full tree, and the best block size found
+// is scaled such that the full tree has the same number of groups per level.
+namespace TbfBlockSizeTuner{
+
+struct Parameters{
+    // Maximum number of particles used for the calibration runs
+    long int maxSubsampleSize = 100000;
+    // Block sizes to test on the subsample (if empty they are generated around
+    // the TbfBlockSizeFinder estimate)
+    std::vector<long int> candidates;
+    // Number of executions per candidate (the minimum time is kept)
+    long int nbRepeat = 1;
+    bool oneGroupPerParent = false;
+    int operationsToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields;
+    bool useCache = true;
+    // Added to the cache key, it should describe what the algorithm builder
+    // passes to the kernels (accuracy, kernel parameters, etc.)
+    std::string cacheKey;
+};
+
+struct Result{
+    long int blockSize = 1;
+    bool fromCache = false;
+    long int subsampleSize = 0;
+    long int subsampleTreeHeight = 0;
+    // Block sizes tested on the subsample with their execution times
+    std::vector<std::pair<long int, double>> timings;
+};
+
+// (number of particles, tree height, box widths and center, algorithm/kernel type, number of threads,
+//  operations to proceed, one group per parent, candidates, key given by the caller)
+using CacheKey = std::tuple<long int, long int, std::vector<double>, std::string, int,
+                            int, bool, std::vector<long int>, std::string>;
+
+template <class SpacialConfiguration>
+std::vector<double> GetBoxForCacheKey(const SpacialConfiguration& inConfiguration){
+    std::vector<double> box;
+    for(long int idxDim = 0 ; idxDim < SpacialConfiguration::Dim ; ++idxDim){
+        box.push_back(static_cast<double>(inConfiguration.getBoxWidths()[idxDim]));
+        box.push_back(static_cast<double>(inConfiguration.getBoxCenter()[idxDim]));
+    }
+    return box;
+}
+
+inline std::map<CacheKey, long int>& GetCache(){
+    static std::map<CacheKey, long int> cache;
+    return cache;
+}
+
+inline std::mutex& GetCacheMutex(){
+    static std::mutex cacheMutex;
+    return cacheMutex;
+}
+
+inline void ClearCache(){
+    std::lock_guard<std::mutex> lock(GetCacheMutex());
+    GetCache().clear();
+}
+
+template <class AlgorithmClass>
+struct DefaultAlgorithmBuilder{
+    template <class SpacialConfiguration>
+    std::unique_ptr<AlgorithmClass> operator()(const SpacialConfiguration& inConfiguration) const{
+        return std::unique_ptr<AlgorithmClass>(new AlgorithmClass(inConfiguration));
+    }
+};
+
+template <class AlgorithmClass, class TreeClass, class ParticleContainer,
+          class AlgorithmBuilder = DefaultAlgorithmBuilder<AlgorithmClass>>
+Result Tune(const typename TreeClass::SpacialConfiguration& inConfiguration,
+            const ParticleContainer& inParticlePositions,
+            const Parameters& inParameters = Parameters(),
+            AlgorithmBuilder&& inAlgorithmBuilder = AlgorithmBuilder()){
+    using SpacialConfiguration = typename TreeClass::SpacialConfiguration;
+    using RealType = typename AlgorithmClass::RealType;
+    using SpaceIndexType = typename AlgorithmClass::SpaceIndexType;
+    using ParticleType = typename std::decay<decltype(inParticlePositions[0])>::type;
+    constexpr long int Dim = SpacialConfiguration::Dim;
+
+    const long int nbParticles = static_cast<long int>(std::size(inParticlePositions));
+    const long int treeHeight = inConfiguration.getTreeHeight();
+    const int nbThreads = AlgorithmClass::GetNbThreads();
+
+    Result result;
+
+    const CacheKey key(nbParticles, treeHeight, GetBoxForCacheKey(inConfiguration), typeid(AlgorithmClass).name(), nbThreads,
+                       inParameters.operationsToProceed, inParameters.oneGroupPerParent, inParameters.candidates,
+                       inParameters.cacheKey);
+    if(inParameters.useCache){
+        std::lock_guard<std::mutex> lock(GetCacheMutex());
+        auto iter = GetCache().find(key);
+        if(iter != GetCache().end()){
+            result.blockSize = iter->second;
+            result.fromCache = true;
+            return result;
+        }
+    }
+
+    if(nbParticles == 0){
+        return result;
+    }
+
+    // Subsample with a constant stride
+    const long int stride = (nbParticles + inParameters.maxSubsampleSize - 1)/std::max(1L, inParameters.maxSubsampleSize);
+    std::vector<ParticleType> subsamplePositions;
+    subsamplePositions.reserve(nbParticles/std::max(1L, stride) + 1);
+    for(long int idxPart = 0 ; idxPart < nbParticles ; idxPart += std::max(1L, stride)){
+        subsamplePositions.emplace_back(inParticlePositions[idxPart]);
+    }
+    const long int subsampleSize = static_cast<long int>(subsamplePositions.size());
+
+    // Remove one level each time the number of particles is divided by the number of children
+    const long int nbLevelsToRemove = static_cast<long int>(std::floor(std::log2(double(nbParticles)/double(subsampleSize))/double(Dim)));
+    const long int subsampleTreeHeight = std::max(std::min(treeHeight, 3L), treeHeight - nbLevelsToRemove);
+    const SpacialConfiguration subsampleConfiguration(subsampleTreeHeight, inConfiguration.getBoxWidths(), inConfiguration.getBoxCenter());
+
+    const auto subsampleStats = TbfBlockSizeFinder::ComputeStatistics<RealType, std::vector<ParticleType>, SpaceIndexType>(subsamplePositions, subsampleConfiguration);
+    const long int subsampleNbLeaves = std::max(1L, subsampleStats.getNbLeaves());
+
+    std::vector<long int> candidates = inParameters.candidates;
+    if(candidates.empty()){
+        const long int estimate = TbfBlockSizeFinder::EstimateWithCostModel(subsampleStats, nbThreads);
+        for(const long int factor : {-2, -1, 0, 1, 2}){
+            const long int candidate = (factor < 0 ? estimate >> (-factor) : estimate << factor);
+            candidates.push_back(std::max(1L, std::min(subsampleNbLeaves, candidate)));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    long int bestCandidate = candidates.front();
+    double bestTime = std::numeric_limits<double>::max();
+
+    for(const long int candidate : candidates){
+        double candidateTime = std::numeric_limits<double>::max();
+        for(long int idxRepeat = 0 ; idxRepeat < std::max(1L, inParameters.nbRepeat) ; ++idxRepeat){
+            TreeClass tree(subsampleConfiguration, subsamplePositions, candidate, inParameters.oneGroupPerParent);
+            auto algorithm = inAlgorithmBuilder(subsampleConfiguration);
+
+            TbfTimer timerExecute;
+            algorithm->execute(tree, inParameters.operationsToProceed);
+            timerExecute.stop();
+
+            candidateTime = std::min(candidateTime, timerExecute.getElapsed());
+        }
+        result.timings.emplace_back(candidate, candidateTime);
+        if(candidateTime < bestTime){
+            bestTime = candidateTime;
+            bestCandidate = candidate;
+        }
+    }
+
+    // Keep the same number of groups per level on the full tree
+    const auto fullStats = TbfBlockSizeFinder::ComputeStatistics<RealType, ParticleContainer, SpaceIndexType>(inParticlePositions, inConfiguration);
+    const double scaling = double(std::max(1L, fullStats.getNbLeaves()))/double(subsampleNbLeaves);
+
+    result.blockSize = std::max(1L, static_cast<long int>(std::llround(double(bestCandidate)*scaling)));
+    result.subsampleSize = subsampleSize;
+    result.subsampleTreeHeight = subsampleTreeHeight;
+
+    if(inParameters.useCache){
+        std::lock_guard<std::mutex> lock(GetCacheMutex());
+        GetCache()[key] = result.blockSize;
+    }
+
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef TBFINTERACTIONPLAN_HPP
+#define TBFINTERACTIONPLAN_HPP
+
+#include "tbfglobal.hpp"
+
+#include "core/tbfinteraction.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+
+#include <vector>
+#include <cassert>
+
+// Store the result of the symbolic part of the M2L and P2P (the interaction lists
+// of each group split by source group), such that successive executions on the
+// same tree replay them instead of recomputing and sorting the indexes.
+// The plan is built lazily level by level and it is dropped as soon as the version
+// of the tree changes (i.e., after a rebuild).
+template <class IndexType_T>
+class TbfInteractionPlan {
+public:
+    using IndexType = IndexType_T;
+    using InteractionVector = std::vector<TbfXtoXInteraction<IndexType>>;
+
+    struct BetweenGroups{
+        long int idxSourceGroup;
+        InteractionVector indexes;
+    };
+
+    struct GroupPlan{
+        InteractionVector inGroup;
+        std::vector<BetweenGroups> betweenGroups;
+    };
+
+private:
+    long int treeVersion;
+
+    std::vector<std::vector<GroupPlan>> m2lPlans;
+    std::vector<bool> m2lIsBuilt;
+
+    std::vector<GroupPlan> p2pPlan;
+    bool p2pIsBuilt;
+
+    template <class TreeClass>
+    void resetIfOutdated(const TreeClass& inTree){
+        if(treeVersion != inTree.getVersion()){
+            clear();
+            treeVersion = inTree.getVersion();
+            const long int treeHeight = inTree.getSpacialConfiguration().getTreeHeight();
+            m2lPlans.resize(treeHeight);
+            m2lIsBuilt.resize(treeHeight, false);
+        }
+    }
+
+public:
+    TbfInteractionPlan() : treeVersion(-1), p2pIsBuilt(false){}
+
+    void clear(){
+        treeVersion = -1;
+        m2lPlans.clear();
+        m2lIsBuilt.clear();
+        p2pPlan.clear();
+        p2pIsBuilt = false;
+    }
+
+    template <class TreeClass>
+    bool isValidFor(const TreeClass& inTree) const{
+        return treeVersion == inTree.getVersion();
+    }
+
+    template <class TreeClass>
+    const std::vector<GroupPlan>& getM2LPlan(const TreeClass& inTree, const long int inLevel){
+        resetIfOutdated(inTree);
+        assert(0 <= inLevel && inLevel < static_cast<long int>(m2lPlans.size()));
+
+        if(m2lIsBuilt[inLevel] == false){
+            const auto& spacialSystem = inTree.getSpacialSystem();
+            const auto& cellGroups = inTree.getCellGroupsAtLevel(inLevel);
+
+            std::vector<GroupPlan>& levelPlan = m2lPlans[inLevel];
+            levelPlan.resize(std::size(cellGroups));
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                auto indexesForGroup = spacialSystem.getInteractionListForBlock(cellGroups[idxGroup], inLevel);
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocksIndexes(std::move(indexesForGroup.second), cellGroups, idxGroup,
+                                                                 [&](const long int idxTargetGroup, const long int idxSourceGroup, const auto& indexes){
+                    levelPlan[idxTargetGroup].betweenGroups.emplace_back(BetweenGroups{idxSourceGroup, indexes.toStdVector()});
+                });
+                levelPlan[idxGroup].inGroup = std::move(indexesForGroup.first);
+            }
+
+            m2lIsBuilt[inLevel] = true;
+        }
+
+        return m2lPlans[inLevel];
+    }
+
+    template <class TreeClass>
+    const std::vector<GroupPlan>& getP2PPlan(const TreeClass& inTree){
+        resetIfOutdated(inTree);
+
+        if(p2pIsBuilt == false){
+            const auto& spacialSystem = inTree.getSpacialSystem();
+            const auto& particleGroups = inTree.getParticleGroups();
+            const long int leafLevel = inTree.getSpacialConfiguration().getTreeHeight()-1;
+
+            p2pPlan.resize(std::size(particleGroups));
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+                auto indexesForGroup = spacialSystem.getNeighborListForBlock(particleGroups[idxGroup], leafLevel, true);
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocksIndexes(std::move(indexesForGroup.second), particleGroups, idxGroup,
+                                                                 [&](const long int idxTargetGroup, const long int idxSourceGroup, const auto& indexes){
+                    p2pPlan[idxTargetGroup].betweenGroups.emplace_back(BetweenGroups{idxSourceGroup, indexes.toStdVector()});
+                });
+                p2pPlan[idxGroup].inGroup = std::move(indexesForGroup.first);
+            }
+
+            p2pIsBuilt = true;
+        }
+
+        return p2pPlan;
+    }
+};
+
+#endif
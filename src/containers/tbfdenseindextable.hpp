@@ -0,0 +1,85 @@
+#ifndef TBFDENSEINDEXTABLE_HPP
+#define TBFDENSEINDEXTABLE_HPP
+
+#include "tbfglobal.hpp"
+
+#include <vector>
+#include <optional>
+#include <limits>
+#include <cassert>
+
+// Direct-mapped table from a spacial index to the position of the element
+// in a group. It is only built when the range of indexes covered by the group
+// is small compared to its number of elements (which is the case for dense groups),
+// otherwise the containers keep using a binary search.
+template <class IndexType_T>
+class TbfDenseIndexTable{
+public:
+    using IndexType = IndexType_T;
+
+    // Maximum ratio between the index range of a group and its number of elements
+    static constexpr long int DefaultMaxRangePerElement = 8;
+
+private:
+    IndexType startingIndex;
+    std::vector<int> positions;
+
+public:
+    TbfDenseIndexTable() : startingIndex(0){}
+
+    template <class GetIndexFunc>
+    bool build(const long int inNbElements, GetIndexFunc&& inGetIndex,
+               const long int inMaxRangePerElement = DefaultMaxRangePerElement){
+        clear();
+
+        if(inNbElements == 0 || inNbElements > std::numeric_limits<int>::max()){
+            return false;
+        }
+
+        const IndexType firstIndex = inGetIndex(0);
+        const IndexType lastIndex = inGetIndex(inNbElements-1);
+        assert(firstIndex <= lastIndex);
+
+        const long int range = static_cast<long int>(lastIndex - firstIndex) + 1;
+        if(range > inMaxRangePerElement * inNbElements){
+            return false;
+        }
+
+        startingIndex = firstIndex;
+        positions.resize(range, -1);
+        for(long int idxElement = 0 ; idxElement < inNbElements ; ++idxElement){
+            const IndexType index = inGetIndex(idxElement);
+            assert(firstIndex <= index && index <= lastIndex);
+            positions[static_cast<long int>(index - firstIndex)] = static_cast<int>(idxElement);
+        }
+        return true;
+    }
+
+    void clear(){
+        startingIndex = 0;
+        positions.clear();
+        positions.shrink_to_fit();
+    }
+
+    bool isBuilt() const{
+        return positions.empty() == false;
+    }
+
+    std::optional<long int> find(const IndexType inIndex) const{
+        assert(isBuilt());
+        if(inIndex < startingIndex || static_cast<long int>(inIndex - startingIndex) >= static_cast<long int>(positions.size())){
+            return std::nullopt;
+        }
+        const int position = positions[static_cast<long int>(inIndex - startingIndex)];
+        if(position < 0){
+            return std::nullopt;
+        }
+        return std::optional<long int>(position);
+    }
+
+    long int getMemoryFootprintInByte() const{
+        return static_cast<long int>(positions.size() * sizeof(int));
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef TBFSMALLVECTOR_HPP
+#define TBFSMALLVECTOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <cassert>
+
+// A vector with a capacity known at compile time and stored inline,
+// such that it can be declared on the stack without any heap allocation.
+// It supports element types without default constructor (like std::reference_wrapper).
+template <class ElementType_T, long int Capacity_T>
+class TbfSmallVector{
+public:
+    using ElementType = ElementType_T;
+    using value_type = ElementType_T;
+
+    static constexpr long int Capacity = Capacity_T;
+
+private:
+    static_assert(Capacity > 0, "Capacity must be positive");
+
+    typename std::aligned_storage<sizeof(ElementType), alignof(ElementType)>::type data[Capacity];
+    long int nbElements;
+
+    ElementType* getPtr(const long int inIndex){
+        return std::launder(reinterpret_cast<ElementType*>(&data[inIndex]));
+    }
+
+    const ElementType* getPtr(const long int inIndex) const{
+        return std::launder(reinterpret_cast<const ElementType*>(&data[inIndex]));
+    }
+
+public:
+    TbfSmallVector() : nbElements(0){}
+
+    TbfSmallVector(const TbfSmallVector&) = delete;
+    TbfSmallVector& operator=(const TbfSmallVector&) = delete;
+
+    ~TbfSmallVector(){
+        clear();
+    }
+
+    template <class ... Params>
+    ElementType& emplace_back(Params&& ... inParams){
+        assert(nbElements < Capacity);
+        ElementType* newElement = new (&data[nbElements]) ElementType(std::forward<Params>(inParams)...);
+        nbElements += 1;
+        return *newElement;
+    }
+
+    void clear(){
+        if constexpr(std::is_trivially_destructible<ElementType>::value == false){
+            for(long int idxElement = 0 ; idxElement < nbElements ; ++idxElement){
+                getPtr(idxElement)->~ElementType();
+            }
+        }
+        nbElements = 0;
+    }
+
+    long int size() const{
+        return nbElements;
+    }
+
+    static constexpr long int capacity(){
+        return Capacity;
+    }
+
+    bool empty() const{
+        return nbElements == 0;
+    }
+
+    ElementType& operator[](const long int inIndex){
+        assert(0 <= inIndex && inIndex < nbElements);
+        return *getPtr(inIndex);
+    }
+
+    const ElementType& operator[](const long int inIndex) const{
+        assert(0 <= inIndex && inIndex < nbElements);
+        return *getPtr(inIndex);
+    }
+
+    ElementType* begin(){
+        return getPtr(0);
+    }
+
+    ElementType* end(){
+        return getPtr(0) + nbElements;
+    }
+
+    const ElementType* begin() const{
+        return getPtr(0);
+    }
+
+    const ElementType* end() const{
+        return getPtr(0) + nbElements;
+    }
+};
+
+#endif
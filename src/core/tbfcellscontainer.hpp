@@ -6,6 +6,7 @@
 #include "containers/tbfmemoryblock.hpp"
 #include "containers/tbfmemoryscalar.hpp"
 #include "containers/tbfmemoryvector.hpp"
+#include "containers/tbfdenseindextable.hpp"
 
 #include <array>
 #include <optional>
@@ -46,6 +47,9 @@ private:
     MultipoleMemoryBlockType objectMultipole;
     LocalMemoryBlockType objectLocal;
 
+    // Host only, not part of the memory blocks
+    TbfDenseIndexTable<IndexType> denseIndexTable;
+
 public:
 #ifdef __NVCC__
     __device__ __host__
@@ -72,7 +76,8 @@ public:
     }
 
     template <class ContainerClass, class ConverterClass>
-    explicit TbfCellsContainer(const ContainerClass& inCellSpatialIndexes, const ConverterClass& inConverter){
+    explicit TbfCellsContainer(const ContainerClass& inCellSpatialIndexes, const ConverterClass& inConverter,
+                               const long int inLevel = -1){
         const long int nbCells = static_cast<long int>(std::size(inCellSpatialIndexes));
 
         if(nbCells == 0){
@@ -103,8 +108,11 @@ public:
 
         for(long int idxCell = 0 ; idxCell < nbCells ; ++idxCell){
             cellsViewer.getItem(idxCell).spaceIndex = inCellSpatialIndexes[idxCell];
-            cellsViewer.getItem(idxCell).boxCoord = inConverter.getBoxPosFromIndex(inCellSpatialIndexes[idxCell]);
+            cellsViewer.getItem(idxCell).boxCoord = (inLevel < 0 ? inConverter.getBoxPosFromIndex(inCellSpatialIndexes[idxCell])
+                                                                 : inConverter.getBoxPosFromIndex(inCellSpatialIndexes[idxCell], inLevel));
         }
+
+        buildDenseIndexTable();
     }
 
     TbfCellsContainer(const TbfCellsContainer&) = delete;
@@ -175,6 +183,20 @@ public:
         return objectLocal.template getViewerForBlockConst<0>().getItem(inIdxCell);
     }
 
+    void resetCellsValues(){
+        const long int nbCells = getNbCells();
+        if(!objectMultipole.isEmpty()){
+            for(long int idxCell = 0 ; idxCell < nbCells ; ++idxCell){
+                objectMultipole.template getViewerForBlock<0>().getItem(idxCell) = MultipoleClass();
+            }
+        }
+        if(!objectLocal.isEmpty()){
+            for(long int idxCell = 0 ; idxCell < nbCells ; ++idxCell){
+                objectLocal.template getViewerForBlock<0>().getItem(idxCell) = LocalClass();
+            }
+        }
+    }
+
     ///////////////////////////////////////////////////////////////////////////
 #ifdef __NVCC__
     __device__ __host__
@@ -237,6 +259,21 @@ public:
 
     ///////////////////////////////////////////////////////////////////////////
 
+    bool buildDenseIndexTable(const long int inMaxRangePerElement = TbfDenseIndexTable<IndexType>::DefaultMaxRangePerElement){
+        auto cellsViewer = objectData.template getViewerForBlockConst<1>();
+        return denseIndexTable.build(getNbCells(), [&cellsViewer](const long int idxCell){
+            return cellsViewer.getItem(idxCell).spaceIndex;
+        }, inMaxRangePerElement);
+    }
+
+    void clearDenseIndexTable(){
+        denseIndexTable.clear();
+    }
+
+    bool hasDenseIndexTable() const{
+        return denseIndexTable.isBuilt();
+    }
+
 #ifdef __NVCC__
     __device__ __host__
 #endif
@@ -247,6 +284,11 @@ public:
         //                return std::optional<long int>(idxCell);
         //            }
         //        }
+#ifndef __CUDA_ARCH__
+        if(denseIndexTable.isBuilt()){
+            return denseIndexTable.find(inIndex);
+        }
+#endif
         const ContainerHeader& header = objectData.template getViewerForBlockConst<0>().getItem();
 
         const long int idxCell = TbfUtils::lower_bound_indexes( 0, header.nbCells, inIndex, [this](const auto& idxCellIterate, const auto& index){
@@ -266,6 +308,29 @@ public:
         return std::optional<long int>(idxCell);
     }
 
+    // Lookup to use when the indexes are queried in increasing order:
+    // inOutCursor must be initialized to 0 and is updated after each call,
+    // such that the search continues from the position of the previous one.
+    std::optional<long int> getElementFromSpacialIndex(const IndexType inIndex, long int& inOutCursor) const {
+        if(denseIndexTable.isBuilt()){
+            return denseIndexTable.find(inIndex);
+        }
+
+        const ContainerHeader& header = objectData.template getViewerForBlockConst<0>().getItem();
+        auto cellsViewer = objectData.template getViewerForBlockConst<1>();
+
+        const long int idxCell = TbfUtils::lower_bound_indexes_from_hint( 0, header.nbCells, inOutCursor, inIndex, [&cellsViewer](const auto& idxCellIterate, const auto& index){
+            return cellsViewer.getItem(idxCellIterate).spaceIndex < index;
+        });
+        inOutCursor = idxCell;
+
+        if(idxCell == header.nbCells || cellsViewer.getItem(idxCell).spaceIndex != inIndex){
+            return std::nullopt;
+        }
+
+        return std::optional<long int>(idxCell);
+    }
+
 #ifdef __NVCC__
     __device__ __host__
 #endif
@@ -0,0 +1,114 @@
+#ifndef TBFM2LBATCH_HPP
+#define TBFM2LBATCH_HPP
+
+#include "tbfglobal.hpp"
+
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <cassert>
+
+// All the M2L interactions of a target group (or between a target group and
+// a source group), such that a kernel can process them in one call.
+// The interactions can be bucketed by interaction index (the relative position
+// of the source to the target) to apply each transfer operator to many pairs at once.
+template <class CellSymbolicData_T, class MultipoleClass_T, class LocalClass_T>
+class TbfM2LBatch{
+public:
+    using CellSymbolicData = CellSymbolicData_T;
+    using MultipoleClass = MultipoleClass_T;
+    using LocalClass = LocalClass_T;
+
+    struct Interaction{
+        const CellSymbolicData* targetSymb;
+        LocalClass* target;
+        const MultipoleClass* source;
+        long int interactionIndex;
+    };
+
+private:
+    std::vector<Interaction> interactions;
+
+    std::vector<Interaction> interactionsByIndex;
+    std::vector<long int> offsetsByIndex;
+
+public:
+    void clear(){
+        interactions.clear();
+        interactionsByIndex.clear();
+        offsetsByIndex.clear();
+    }
+
+    void addInteraction(const CellSymbolicData& inTargetSymb, LocalClass& inTarget,
+                        const MultipoleClass& inSource, const long int inInteractionIndex){
+        interactions.emplace_back(Interaction{&inTargetSymb, &inTarget, &inSource, inInteractionIndex});
+    }
+
+    long int size() const{
+        return static_cast<long int>(interactions.size());
+    }
+
+    bool empty() const{
+        return interactions.empty();
+    }
+
+    const Interaction& operator[](const long int inIdx) const{
+        return interactions[inIdx];
+    }
+
+    // Interactions in insertion order (grouped by target cell)
+    const std::vector<Interaction>& getInteractions() const{
+        return interactions;
+    }
+
+    // Stable counting sort of the interactions by interaction index
+    // (inNbInteractionIndexes is the size of the index range, usually 7^Dim)
+    void groupByInteractionIndex(const long int inNbInteractionIndexes){
+        offsetsByIndex.clear();
+        offsetsByIndex.resize(inNbInteractionIndexes + 1, 0);
+
+        for(const auto& interaction : interactions){
+            assert(0 <= interaction.interactionIndex && interaction.interactionIndex < inNbInteractionIndexes);
+            offsetsByIndex[interaction.interactionIndex + 1] += 1;
+        }
+        for(long int idxIndex = 0 ; idxIndex < inNbInteractionIndexes ; ++idxIndex){
+            offsetsByIndex[idxIndex + 1] += offsetsByIndex[idxIndex];
+        }
+
+        interactionsByIndex.resize(interactions.size());
+        std::vector<long int>& cursors = offsetsByIndex;
+        for(const auto& interaction : interactions){
+            interactionsByIndex[cursors[interaction.interactionIndex]++] = interaction;
+        }
+        // The cursors have been shifted by one bucket
+        for(long int idxIndex = inNbInteractionIndexes ; idxIndex > 0 ; --idxIndex){
+            offsetsByIndex[idxIndex] = offsetsByIndex[idxIndex - 1];
+        }
+        offsetsByIndex[0] = 0;
+    }
+
+    // inFunc(interactionIndex, const Interaction* interactions, nbInteractions)
+    // is called for each interaction index that is used at least once
+    template <class FuncClass>
+    void applyPerInteractionIndex(FuncClass&& inFunc) const{
+        assert(offsetsByIndex.size() != 0 || interactions.size() == 0);
+        for(long int idxIndex = 0 ; idxIndex + 1 < static_cast<long int>(offsetsByIndex.size()) ; ++idxIndex){
+            const long int nbInteractions = offsetsByIndex[idxIndex + 1] - offsetsByIndex[idxIndex];
+            if(nbInteractions){
+                inFunc(idxIndex, &interactionsByIndex[offsetsByIndex[idxIndex]], nbInteractions);
+            }
+        }
+    }
+};
+
+// To know if a kernel provides M2LBatch(inLevel, batch)
+template <class KernelClass, class BatchClass, class = void>
+struct TbfKernelHasM2LBatch : std::false_type {};
+
+template <class KernelClass, class BatchClass>
+struct TbfKernelHasM2LBatch<KernelClass, BatchClass,
+                            std::void_t<decltype(std::declval<KernelClass&>().M2LBatch(std::declval<long int>(),
+                                                                                       std::declval<BatchClass&>()))>>
+        : std::true_type {};
+
+#endif
@@ -7,9 +7,11 @@
 #include "containers/tbfmemoryscalar.hpp"
 #include "containers/tbfmemoryvector.hpp"
 #include "containers/tbfmemorymultirvector.hpp"
+#include "containers/tbfdenseindextable.hpp"
 #include "tbfparticlesorter.hpp"
 
 #include <array>
+#include <algorithm>
 #include <optional>
 #include <cassert>
 
@@ -53,6 +55,9 @@ private:
     SymbolcMemoryBlockType objectData;
     RhsMemoryBlockType objectRhs;
 
+    // Host only, not part of the memory blocks
+    TbfDenseIndexTable<IndexType> denseIndexTable;
+
 public:
 #ifdef __NVCC__
     __device__ __host__
@@ -135,6 +140,8 @@ public:
                 particlesRhsViewer.getItem(idxPart, idxValue) = RhsType();
             }
         }
+
+        buildDenseIndexTable();
     }
 
     template <class ContainerClass>
@@ -152,7 +159,7 @@ public:
             return;
         }
 
-        TbfParticleSorter<RealType> partSorter(inSpaceSystem, inParticlePositions);
+        TbfParticleSorter<RealType, SpaceIndexType> partSorter(inSpaceSystem, inParticlePositions);
         auto groups = partSorter.splitInGroups(partSorter.getNbLeaves());
         assert(std::size(groups) == 1);
 
@@ -302,6 +309,21 @@ const long int* getParticleIndexes(const long int inIdxLeaf) const {
     }
 
     ///////////////////////////////////////////////////////////////////////////
+    bool buildDenseIndexTable(const long int inMaxRangePerElement = TbfDenseIndexTable<IndexType>::DefaultMaxRangePerElement){
+        auto leavesViewer = objectData.template getViewerForBlockConst<1>();
+        return denseIndexTable.build(getNbLeaves(), [&leavesViewer](const long int idxLeaf){
+            return leavesViewer.getItem(idxLeaf).spaceIndex;
+        }, inMaxRangePerElement);
+    }
+
+    void clearDenseIndexTable(){
+        denseIndexTable.clear();
+    }
+
+    bool hasDenseIndexTable() const{
+        return denseIndexTable.isBuilt();
+    }
+
 #ifdef __NVCC__
     __device__ __host__
 #endif
@@ -312,6 +334,11 @@ const long int* getParticleIndexes(const long int inIdxLeaf) const {
         //                return std::optional<long int>(idxLeaf);
         //            }
         //        }
+#ifndef __CUDA_ARCH__
+        if(denseIndexTable.isBuilt()){
+            return denseIndexTable.find(inIndex);
+        }
+#endif
         const ContainerHeader& header = objectData.template getViewerForBlockConst<0>().getItem();
         auto leavesViewer = objectData.template getViewerForBlockConst<1>();
 
@@ -332,6 +359,29 @@ const long int* getParticleIndexes(const long int inIdxLeaf) const {
         return std::optional<long int>(idxLeaf);
     }
 
+    // Lookup to use when the indexes are queried in increasing order:
+    // inOutCursor must be initialized to 0 and is updated after each call,
+    // such that the search continues from the position of the previous one.
+    std::optional<long int> getElementFromSpacialIndex(const IndexType inIndex, long int& inOutCursor) const {
+        if(denseIndexTable.isBuilt()){
+            return denseIndexTable.find(inIndex);
+        }
+
+        const ContainerHeader& header = objectData.template getViewerForBlockConst<0>().getItem();
+        auto leavesViewer = objectData.template getViewerForBlockConst<1>();
+
+        const long int idxLeaf = TbfUtils::lower_bound_indexes_from_hint( 0, header.nbLeaves, inOutCursor, inIndex, [&leavesViewer](const auto& idxLeafIterate, const auto& index){
+            return (leavesViewer.getItem(idxLeafIterate).spaceIndex < index);
+        });
+        inOutCursor = idxLeaf;
+
+        if(idxLeaf == header.nbLeaves || leavesViewer.getItem(idxLeaf).spaceIndex != inIndex){
+            return std::nullopt;
+        }
+
+        return std::optional<long int>(idxLeaf);
+    }
+
     ///////////////////////////////////////////////////////////////////////////
 #ifdef __NVCC__
     __device__ __host__
@@ -377,6 +427,15 @@ const long int* getParticleIndexes(const long int inIdxLeaf) const {
         return objectRhs.getAllocatedMemorySizeInByte();
     }
 
+    /** Write in inRhsPtr (getRhsSize() bytes) a rhs block with the layout of this group
+      * and all values set to zero, without reading the rhs of this group.
+      */
+    void initEmptyRhs(unsigned char* inRhsPtr) const {
+        const RhsMemoryBlockType emptyRhs(std::array<long int, 1>{{getNbParticles()*NbRhsValuesPerParticle}});
+        assert(emptyRhs.getAllocatedMemorySizeInByte() == getRhsSize());
+        std::copy(emptyRhs.getPtr(), emptyRhs.getPtr() + emptyRhs.getAllocatedMemorySizeInByte(), inRhsPtr);
+    }
+
     ///////////////////////////////////////////////////////////////////////////
 
     template <class FuncClass>
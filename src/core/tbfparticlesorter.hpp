@@ -4,8 +4,26 @@
 #include "tbfglobal.hpp"
 
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <cassert>
+#include <type_traits>
+#include <utility>
+
+#ifdef TBF_USE_OPENMP
+#include <omp.h>
+#endif
+
+// To know if a space index can compute the indexes of several positions at once
+template <class SpaceIndexType, class ContainerClass, class = void>
+struct TbfSpaceIndexHasBatchedIndexes : std::false_type {};
+
+template <class SpaceIndexType, class ContainerClass>
+struct TbfSpaceIndexHasBatchedIndexes<SpaceIndexType, ContainerClass,
+                                      std::void_t<decltype(std::declval<const SpaceIndexType&>().getIndexesFromPositions(
+                                                               std::declval<const ContainerClass&>(), 0L, 0L,
+                                                               std::declval<typename SpaceIndexType::IndexType*>()))>>
+        : std::true_type {};
 
 template <class RealType_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
 class TbfParticleSorter {
@@ -13,27 +31,148 @@ public:
     using RealType = RealType_T;
     using SpaceIndexType = SpaceIndexType_T;
     using IndexType = typename SpaceIndexType::IndexType;
+    enum class SortMethod {
+        Auto,
+        StdSort,
+        ParallelRadix
+    };
+
+    static constexpr long int RadixThreshold = 16384;
+
 private:
+    static constexpr long int RadixBits = 8;
+    static constexpr long int IndexesBlockSize = 256;
+    static constexpr long int RadixNbBuckets = (1L << RadixBits);
+
     std::vector<std::pair<IndexType, long int>> leaves;
     std::vector<std::pair<IndexType, long int>> particleIndexes;
 
-public:
-    template <class ContainerClass>
-    explicit TbfParticleSorter(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions){
-        particleIndexes.resize(inParticlePositions.size());
+    static long int GetNbChunks(){
+#ifdef TBF_USE_OPENMP
+        return std::max(1L, static_cast<long int>(omp_get_max_threads()));
+#else
+        return 1;
+#endif
+    }
+
+    static long int GetChunkBegin(const long int inIdxChunk, const long int inNbChunks, const long int inNbItems){
+        return (inNbItems*inIdxChunk)/inNbChunks;
+    }
 
-        for(long int idxPart = 0 ; idxPart < static_cast<long int>(inParticlePositions.size()) ; ++idxPart){
-            particleIndexes[idxPart].first = inSpaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
-            particleIndexes[idxPart].second = idxPart;
+    template <class ContainerClass>
+    void computeIndexes(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions){
+        const long int nbParticles = static_cast<long int>(std::size(inParticlePositions));
+        particleIndexes.resize(nbParticles);
+
+        if constexpr(TbfSpaceIndexHasBatchedIndexes<SpaceIndexType, ContainerClass>::value){
+            const long int nbBlocks = (nbParticles + IndexesBlockSize - 1) / IndexesBlockSize;
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static) if(nbParticles >= RadixThreshold)
+#endif
+            for(long int idxBlock = 0 ; idxBlock < nbBlocks ; ++idxBlock){
+                const long int firstPart = idxBlock * IndexesBlockSize;
+                const long int lastPart = std::min(nbParticles, firstPart + IndexesBlockSize);
+                IndexType indexes[IndexesBlockSize];
+                inSpaceSystem.getIndexesFromPositions(inParticlePositions, firstPart, lastPart, indexes);
+                for(long int idxPart = firstPart ; idxPart < lastPart ; ++idxPart){
+                    particleIndexes[idxPart].first = indexes[idxPart - firstPart];
+                    particleIndexes[idxPart].second = idxPart;
+                }
+            }
         }
+        else{
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static) if(nbParticles >= RadixThreshold)
+#endif
+            for(long int idxPart = 0 ; idxPart < nbParticles ; ++idxPart){
+                particleIndexes[idxPart].first = inSpaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
+                particleIndexes[idxPart].second = idxPart;
+            }
+        }
+    }
 
+    void sortWithStdSort(){
         std::sort(particleIndexes.begin(), particleIndexes.end(),[](auto& p1, auto& p2){
             return p1.first < p2.first;
         });
+    }
 
-        leaves.reserve(inParticlePositions.size()/100);
+    // LSD radix sort on the spacial index, the number of passes is given
+    // by the largest index (so by tree height x Dim bits).
+    // Each chunk owns a contiguous part of the array which makes the sort stable.
+    void sortWithParallelRadix(){
+        const long int nbItems = static_cast<long int>(particleIndexes.size());
+        const long int nbChunks = std::min(GetNbChunks(), std::max(1L, nbItems/RadixThreshold));
 
-        for(long int idxPart = 0 ; idxPart < static_cast<long int>(inParticlePositions.size()) ; ++idxPart){
+        IndexType maxIndex = 0;
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static) reduction(max:maxIndex) if(nbChunks > 1)
+#endif
+        for(long int idxItem = 0 ; idxItem < nbItems ; ++idxItem){
+            maxIndex = std::max(maxIndex, particleIndexes[idxItem].first);
+        }
+        assert(maxIndex >= 0);
+
+        long int nbKeyBits = 0;
+        while(nbKeyBits < static_cast<long int>(sizeof(IndexType)*8) && (maxIndex >> nbKeyBits) != 0){
+            nbKeyBits += 1;
+        }
+
+        std::vector<std::pair<IndexType, long int>> buffer(nbItems);
+        std::vector<std::array<long int, RadixNbBuckets>> chunkCounters(nbChunks);
+
+        for(long int shift = 0 ; shift < nbKeyBits ; shift += RadixBits){
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static, 1) if(nbChunks > 1)
+#endif
+            for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+                auto& counters = chunkCounters[idxChunk];
+                counters.fill(0);
+                const long int chunkEnd = GetChunkBegin(idxChunk+1, nbChunks, nbItems);
+                for(long int idxItem = GetChunkBegin(idxChunk, nbChunks, nbItems) ; idxItem < chunkEnd ; ++idxItem){
+                    counters[(particleIndexes[idxItem].first >> shift) & (RadixNbBuckets-1)] += 1;
+                }
+            }
+
+            // Convert the counters into output positions (bucket major, then chunk)
+            long int offset = 0;
+            bool allInOneBucket = false;
+            for(long int idxBucket = 0 ; idxBucket < RadixNbBuckets ; ++idxBucket){
+                long int bucketSize = 0;
+                for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+                    const long int nbInBucket = chunkCounters[idxChunk][idxBucket];
+                    chunkCounters[idxChunk][idxBucket] = offset;
+                    offset += nbInBucket;
+                    bucketSize += nbInBucket;
+                }
+                allInOneBucket |= (bucketSize == nbItems);
+            }
+
+            if(allInOneBucket){
+                continue;
+            }
+
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static, 1) if(nbChunks > 1)
+#endif
+            for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+                auto& positions = chunkCounters[idxChunk];
+                const long int chunkEnd = GetChunkBegin(idxChunk+1, nbChunks, nbItems);
+                for(long int idxItem = GetChunkBegin(idxChunk, nbChunks, nbItems) ; idxItem < chunkEnd ; ++idxItem){
+                    const long int bucket = ((particleIndexes[idxItem].first >> shift) & (RadixNbBuckets-1));
+                    buffer[positions[bucket]] = particleIndexes[idxItem];
+                    positions[bucket] += 1;
+                }
+            }
+
+            std::swap(buffer, particleIndexes);
+        }
+    }
+
+    void buildLeavesSequential(){
+        leaves.reserve(particleIndexes.size()/100);
+
+        for(long int idxPart = 0 ; idxPart < static_cast<long int>(particleIndexes.size()) ; ++idxPart){
             if(leaves.empty() || leaves.back().first != particleIndexes[idxPart].first){
                 leaves.emplace_back();
                 leaves.back().first = particleIndexes[idxPart].first;
@@ -43,6 +182,79 @@ public:
         }
     }
 
+    // Each chunk counts the leaves that start inside its range, then
+    // the leaves are written at the position given by the prefix sum.
+    void buildLeavesParallel(){
+        const long int nbItems = static_cast<long int>(particleIndexes.size());
+        const long int nbChunks = std::min(GetNbChunks(), std::max(1L, nbItems/RadixThreshold));
+
+        std::vector<long int> nbLeavesPerChunk(nbChunks+1, 0);
+
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static, 1) if(nbChunks > 1)
+#endif
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            const long int chunkEnd = GetChunkBegin(idxChunk+1, nbChunks, nbItems);
+            long int nbLeavesInChunk = 0;
+            for(long int idxItem = GetChunkBegin(idxChunk, nbChunks, nbItems) ; idxItem < chunkEnd ; ++idxItem){
+                if(idxItem == 0 || particleIndexes[idxItem-1].first != particleIndexes[idxItem].first){
+                    nbLeavesInChunk += 1;
+                }
+            }
+            nbLeavesPerChunk[idxChunk+1] = nbLeavesInChunk;
+        }
+
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            nbLeavesPerChunk[idxChunk+1] += nbLeavesPerChunk[idxChunk];
+        }
+
+        // The second value temporary stores the position of the first particle of the leaf
+        leaves.resize(nbLeavesPerChunk[nbChunks]);
+
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static, 1) if(nbChunks > 1)
+#endif
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            const long int chunkEnd = GetChunkBegin(idxChunk+1, nbChunks, nbItems);
+            long int idxLeaf = nbLeavesPerChunk[idxChunk];
+            for(long int idxItem = GetChunkBegin(idxChunk, nbChunks, nbItems) ; idxItem < chunkEnd ; ++idxItem){
+                if(idxItem == 0 || particleIndexes[idxItem-1].first != particleIndexes[idxItem].first){
+                    leaves[idxLeaf].first = particleIndexes[idxItem].first;
+                    leaves[idxLeaf].second = idxItem;
+                    idxLeaf += 1;
+                }
+            }
+        }
+
+        const long int nbLeaves = static_cast<long int>(leaves.size());
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(static) if(nbChunks > 1)
+#endif
+        for(long int idxLeaf = 0 ; idxLeaf < nbLeaves ; ++idxLeaf){
+            const long int nextStart = (idxLeaf+1 == nbLeaves ? nbItems : leaves[idxLeaf+1].second);
+            leaves[idxLeaf].second = nextStart - leaves[idxLeaf].second;
+        }
+    }
+
+public:
+    template <class ContainerClass>
+    explicit TbfParticleSorter(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions,
+                               const SortMethod inSortMethod = SortMethod::Auto){
+        computeIndexes(inSpaceSystem, inParticlePositions);
+
+        const bool useRadix = (inSortMethod == SortMethod::ParallelRadix
+                               || (inSortMethod == SortMethod::Auto && static_cast<long int>(particleIndexes.size()) >= RadixThreshold));
+
+        if(useRadix){
+            sortWithParallelRadix();
+            buildLeavesParallel();
+        }
+        else{
+            sortWithStdSort();
+            buildLeavesSequential();
+        }
+    }
+
     TbfParticleSorter(const TbfParticleSorter&) = delete;
     TbfParticleSorter& operator=(const TbfParticleSorter&) = delete;
 
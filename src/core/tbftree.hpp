@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <array>
+#include <atomic>
 
 template <class RealType, class DataType, long int NbDataValuesPerParticle, class RhsType, long int NbRhsValuesPerParticle,
           class MultipoleClass, class LocalClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
@@ -31,37 +32,55 @@ protected:
 
     long int nbParticles;
 
-public:
+    // Changes each time the groups are modified
+    long int version;
 
-    template<class ParticleContainer>
-    TbfTree(const SpacialConfiguration& inConfiguration,
-               const ParticleContainer& inParticlePositions,
-               const long int inNbElementsPerBlock = -1,
-               const bool inOneGroupPerParent = false)
-        : configuration(inConfiguration), spaceSystem(configuration),
-          nbElementsPerBlock(inNbElementsPerBlock == -1 ? TbfBlockSizeFinder::Estimate<RealType, ParticleContainer, SpaceIndexType>(inParticlePositions,
-                                                                                                 inConfiguration):
-                                                          inNbElementsPerBlock),
-          oneGroupPerParent(inOneGroupPerParent), nbParticles(static_cast<long int>(std::size(inParticlePositions))){
+    static long int GetNewVersion(){
+        static std::atomic<long int> versionCounter(0);
+        return versionCounter++;
+    }
 
+    // Build the cell groups from the particle groups.
+    // If previous cell groups are given, the ones that have exactly the same
+    // indexes as a new group are moved (and their values reset) instead of being reallocated.
+    void buildCellGroups(std::vector<std::vector<CellGroupClass>> inPreviousCellBlocks = std::vector<std::vector<CellGroupClass>>()){
+        cellBlocks.clear();
         cellBlocks.resize(configuration.getTreeHeight());
-        if(std::size(inParticlePositions) == 0){
+
+        if(configuration.getTreeHeight() <= 0){
             return;
         }
 
-        {
-            TbfParticleSorter<RealType, SpaceIndexType> partSorter(spaceSystem, inParticlePositions);
-            const auto groupProperties = partSorter.splitInGroups(nbElementsPerBlock);
-            particleGroups.reserve(std::size(groupProperties));
+        inPreviousCellBlocks.resize(configuration.getTreeHeight());
+        std::vector<long int> previousCursors(configuration.getTreeHeight(), 0);
 
-            for(const auto& groupProperty : groupProperties){
-                particleGroups.emplace_back(groupProperty, inParticlePositions, spaceSystem);
+        auto addCellGroup = [&](const long int inIdxLevel, const std::vector<IndexType>& inCellIndexes){
+            auto& previousGroups = inPreviousCellBlocks[inIdxLevel];
+            long int& cursor = previousCursors[inIdxLevel];
+
+            while(cursor < static_cast<long int>(previousGroups.size())
+                  && previousGroups[cursor].getStartingSpacialIndex() < inCellIndexes.front()){
+                cursor += 1;
             }
-        }
 
-        if(configuration.getTreeHeight() <= 0){
-            return;
-        }
+            if(cursor < static_cast<long int>(previousGroups.size())
+                    && previousGroups[cursor].getNbCells() == static_cast<long int>(inCellIndexes.size())
+                    && previousGroups[cursor].getStartingSpacialIndex() == inCellIndexes.front()
+                    && previousGroups[cursor].getEndingSpacialIndex() == inCellIndexes.back()){
+                bool sameIndexes = true;
+                for(long int idxCell = 0 ; sameIndexes && idxCell < static_cast<long int>(inCellIndexes.size()) ; ++idxCell){
+                    sameIndexes = (previousGroups[cursor].getCellSpacialIndex(idxCell) == inCellIndexes[idxCell]);
+                }
+                if(sameIndexes){
+                    previousGroups[cursor].resetCellsValues();
+                    cellBlocks[inIdxLevel].emplace_back(std::move(previousGroups[cursor]));
+                    cursor += 1;
+                    return;
+                }
+            }
+
+            cellBlocks[inIdxLevel].emplace_back(inCellIndexes, spaceSystem, inIdxLevel);
+        };
 
         {
             std::vector<IndexType> leafIndexes;
@@ -74,7 +93,7 @@ public:
                     leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
                 }
 
-                cellBlocks[configuration.getTreeHeight()-1].emplace_back(leafIndexes, spaceSystem);
+                addCellGroup(configuration.getTreeHeight()-1, leafIndexes);
             }
         }
 
@@ -103,7 +122,7 @@ public:
                     }
 
                     if(cellIndexes.size()){
-                        cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
+                        addCellGroup(idxLevel, cellIndexes);
                     }
                 }
             }
@@ -120,7 +139,7 @@ public:
                             previousIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
 
                             if(static_cast<long int>(cellIndexes.size()) == nbElementsPerBlock){
-                                cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
+                                addCellGroup(idxLevel, cellIndexes);
                                 cellIndexes.clear();
                             }
                         }
@@ -128,13 +147,59 @@ public:
                 }
 
                 if(cellIndexes.size()){
-                    cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
+                    addCellGroup(idxLevel, cellIndexes);
                     cellIndexes.clear();
                 }
             }
         }
     }
 
+    // The particles are sorted once, the sorter is used for the block size estimate and the build
+    template<class ParticleContainer>
+    TbfTree(const SpacialConfiguration& inConfiguration,
+            const ParticleContainer& inParticlePositions,
+            const TbfParticleSorter<RealType, SpaceIndexType>& inPartSorter,
+            const long int inNbElementsPerBlock,
+            const bool inOneGroupPerParent)
+        : configuration(inConfiguration), spaceSystem(configuration),
+          nbElementsPerBlock(inNbElementsPerBlock < 0 ?
+                                 TbfBlockSizeFinder::EstimateFromSorter(spaceSystem, configuration.getTreeHeight(), inPartSorter,
+                                                                        inNbElementsPerBlock == TbfBlockSizeFinder::CostModelBlockSize):
+                                 inNbElementsPerBlock),
+          oneGroupPerParent(inOneGroupPerParent), nbParticles(static_cast<long int>(std::size(inParticlePositions))),
+          version(GetNewVersion()){
+
+        cellBlocks.resize(configuration.getTreeHeight());
+        if(std::size(inParticlePositions) == 0){
+            return;
+        }
+
+        {
+            const auto groupProperties = inPartSorter.splitInGroups(nbElementsPerBlock);
+            particleGroups.reserve(std::size(groupProperties));
+
+            for(const auto& groupProperty : groupProperties){
+                particleGroups.emplace_back(groupProperty, inParticlePositions, spaceSystem);
+            }
+        }
+
+        buildCellGroups();
+    }
+
+public:
+
+    // inNbElementsPerBlock can be TbfBlockSizeFinder::DefaultBlockSize (nbLeaves/(2*nbThreads))
+    // or TbfBlockSizeFinder::CostModelBlockSize (TbfBlockSizeFinder::EstimateWithCostModel)
+    template<class ParticleContainer>
+    TbfTree(const SpacialConfiguration& inConfiguration,
+               const ParticleContainer& inParticlePositions,
+               const long int inNbElementsPerBlock = TbfBlockSizeFinder::DefaultBlockSize,
+               const bool inOneGroupPerParent = false)
+        : TbfTree(inConfiguration, inParticlePositions,
+                  TbfParticleSorter<RealType, SpaceIndexType>(SpaceIndexType(inConfiguration), inParticlePositions),
+                  inNbElementsPerBlock, inOneGroupPerParent){
+    }
+
     //////////////////////////////////////////////////////////////////////////////
 
     long int getNbParticles() const{
@@ -157,6 +222,10 @@ public:
         return configuration.getTreeHeight();
     }
 
+    long int getVersion() const{
+        return version;
+    }
+
     long int getNbCellGroupsAtLevel(const long int inIdxLevel) const{
         return static_cast<long int>(cellBlocks[inIdxLevel].size());
     }
@@ -327,6 +396,7 @@ public:
 
         cellBlocks.clear();
         particleGroups.clear();
+        version = GetNewVersion();
 
         cellBlocks.resize(configuration.getTreeHeight());
         if(std::size(data) == 0){
@@ -334,7 +404,7 @@ public:
         }
 
         {
-            TbfParticleSorter<RealType> partSorter(spaceSystem, data);
+            TbfParticleSorter<RealType, SpaceIndexType> partSorter(spaceSystem, data);
             const auto groupProperties = partSorter.splitInGroups(nbElementsPerBlock);
             particleGroups.reserve(std::size(groupProperties));
 
@@ -343,91 +413,163 @@ public:
             }
         }
 
-        if(configuration.getTreeHeight() <= 0){
-            return;
-        }
+        buildCellGroups();
 
-        {
-            std::vector<IndexType> leafIndexes;
+        applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
+                                  const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                  const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+             for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                     particleRhsPtr[idxValue][idxPart] = rhs[particleIndexes[idxPart]][idxValue];
+                 }
+             }
+         });
 
-            cellBlocks[configuration.getTreeHeight()-1].reserve(particleGroups.size());
-            for(const auto& particleGroup : particleGroups){
-                leafIndexes.resize(particleGroup.getNbLeaves());
+    }
 
-                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
-                    leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
+    // Update the tree after the particles have moved, but only repack the
+    // particle groups that lose or receive particles (the migrants are
+    // attached to the group that covers their new leaf index, and a group
+    // that ends up with more leaves than nbElementsPerBlock is split).
+    // The cell groups are rebuilt only if their index set changed.
+    // Returns the number of particles that changed of leaf.
+    long int rebuildIncremental(){
+        struct MigrantParticle {
+            std::array<DataType, NbDataValuesPerParticle> data;
+            std::array<RhsType, NbRhsValuesPerParticle> rhs;
+            long int originalIndex;
+            long int idxTargetGroup;
+        };
+
+        const long int nbGroups = static_cast<long int>(particleGroups.size());
+
+        std::vector<MigrantParticle> migrants;
+        std::vector<bool> groupIsModified(nbGroups, false);
+
+        auto findGroupForIndex = [this](const IndexType inLeafIndex){
+            const auto iterGroup = std::upper_bound(particleGroups.begin(), particleGroups.end(), inLeafIndex, [](const auto& index, const auto& group){
+                return index < group.getStartingSpacialIndex();
+            });
+            return std::max(0L, static_cast<long int>(std::distance(particleGroups.begin(), iterGroup))-1);
+        };
+
+        for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+            particleGroups[idxGroup].applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                                      const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                                                      const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    std::array<DataType, NbDataValuesPerParticle> partData;
+                    for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                        partData[idxValue] = particleDataPtr[idxValue][idxPart];
+                    }
+
+                    const IndexType newLeafIndex = spaceSystem.getIndexFromPosition(partData);
+                    if(newLeafIndex != leafHeader.spaceIndex){
+                        MigrantParticle migrant;
+                        migrant.data = partData;
+                        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                            migrant.rhs[idxValue] = particleRhsPtr[idxValue][idxPart];
+                        }
+                        migrant.originalIndex = particleIndexes[idxPart];
+                        migrant.idxTargetGroup = findGroupForIndex(newLeafIndex);
+
+                        groupIsModified[idxGroup] = true;
+                        groupIsModified[migrant.idxTargetGroup] = true;
+                        migrants.emplace_back(migrant);
+                    }
                 }
+            });
+        }
 
-                cellBlocks[configuration.getTreeHeight()-1].emplace_back(leafIndexes, spaceSystem);
-            }
+        if(migrants.size() == 0){
+            return 0;
         }
 
-        std::vector<IndexType> cellIndexes;
-        cellIndexes.reserve(nbElementsPerBlock);
+        std::stable_sort(migrants.begin(), migrants.end(), [](const auto& m1, const auto& m2){
+            return m1.idxTargetGroup < m2.idxTargetGroup;
+        });
 
-        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= 0 ; --idxLevel){
-            if(oneGroupPerParent){
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size());
+        std::vector<LeafGroupClass> newParticleGroups;
+        newParticleGroups.reserve(nbGroups);
 
-                for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
-                    cellIndexes.clear();
-                    long int idxCell = 0;
+        std::vector<std::array<DataType, NbDataValuesPerParticle>> groupData;
+        std::vector<std::array<RhsType, NbRhsValuesPerParticle>> groupRhs;
+        std::vector<long int> groupOriginalIndexes;
 
-                    if(cellBlocks[idxLevel].size()){
-                        while(idxCell < lowerCellGroup.getNbCells()
-                              && spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)) <= cellBlocks[idxLevel].back().getEndingSpacialIndex()){
-                            idxCell += 1;
-                        }
-                    }
+        auto currentMigrant = migrants.cbegin();
 
-                    for( ; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(cellIndexes.size() == 0 || cellIndexes.back() != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
-                        }
+        for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+            if(groupIsModified[idxGroup] == false){
+                newParticleGroups.emplace_back(std::move(particleGroups[idxGroup]));
+                continue;
+            }
+
+            groupData.clear();
+            groupRhs.clear();
+            groupOriginalIndexes.clear();
+
+            particleGroups[idxGroup].applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                                      const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                                                      const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    std::array<DataType, NbDataValuesPerParticle> partData;
+                    for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                        partData[idxValue] = particleDataPtr[idxValue][idxPart];
                     }
 
-                    if(cellIndexes.size()){
-                        cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
+                    if(spaceSystem.getIndexFromPosition(partData) == leafHeader.spaceIndex){
+                        std::array<RhsType, NbRhsValuesPerParticle> partRhs;
+                        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                            partRhs[idxValue] = particleRhsPtr[idxValue][idxPart];
+                        }
+                        groupData.emplace_back(partData);
+                        groupRhs.emplace_back(partRhs);
+                        groupOriginalIndexes.emplace_back(particleIndexes[idxPart]);
                     }
                 }
+            });
+
+            while(currentMigrant != migrants.cend() && (*currentMigrant).idxTargetGroup == idxGroup){
+                groupData.emplace_back((*currentMigrant).data);
+                groupRhs.emplace_back((*currentMigrant).rhs);
+                groupOriginalIndexes.emplace_back((*currentMigrant).originalIndex);
+                ++currentMigrant;
             }
-            else{
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size()/8);
 
-                cellIndexes.clear();
-                IndexType previousIndex = -1;
+            if(groupData.size() == 0){
+                continue;
+            }
 
-                for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
-                    for(long int idxCell = 0; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(previousIndex != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
-                            previousIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
+            TbfParticleSorter<RealType, SpaceIndexType> partSorter(spaceSystem, groupData);
+            // A group that has more leaves than a block is split in balanced groups
+            const long int nbSubGroups = (partSorter.getNbLeaves() + nbElementsPerBlock - 1)/nbElementsPerBlock;
+            const long int subGroupSize = (partSorter.getNbLeaves() + nbSubGroups - 1)/nbSubGroups;
+            const auto groupProperties = partSorter.splitInGroups(subGroupSize);
 
-                            if(static_cast<long int>(cellIndexes.size()) == nbElementsPerBlock){
-                                cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                                cellIndexes.clear();
-                            }
+            for(const auto& groupProperty : groupProperties){
+                newParticleGroups.emplace_back(groupProperty, groupData, spaceSystem);
+
+                newParticleGroups.back().applyToAllLeaves([&](auto&& leafHeader, long int* particleIndexes,
+                                                          const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                                          const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                            particleRhsPtr[idxValue][idxPart] = groupRhs[particleIndexes[idxPart]][idxValue];
                         }
+                        particleIndexes[idxPart] = groupOriginalIndexes[particleIndexes[idxPart]];
                     }
-                }
-
-                if(cellIndexes.size()){
-                    cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                    cellIndexes.clear();
-                }
+                });
             }
         }
 
-        applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
-                                  const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
-                                  const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
-             for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
-                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                     particleRhsPtr[idxValue][idxPart] = rhs[particleIndexes[idxPart]][idxValue];
-                 }
-             }
-         });
+        assert(currentMigrant == migrants.cend());
+
+        particleGroups = std::move(newParticleGroups);
+        version = GetNewVersion();
+
+        buildCellGroups(std::move(cellBlocks));
 
+        return static_cast<long int>(migrants.size());
     }
 
 
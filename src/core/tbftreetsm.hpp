@@ -41,17 +41,21 @@ public:
     TbfTreeTsm(const SpacialConfiguration& inConfiguration,
                const ParticleContainer& inParticleSourcePositions,
                const ParticleContainer& inParticleTargetPositions,
-               const long int inNbElementsPerBlock = -1,
+               const long int inNbElementsPerBlock = TbfBlockSizeFinder::DefaultBlockSize,
                const bool inOneGroupPerParent = false)
         : configuration(inConfiguration), spaceSystem(configuration),
           treeSource(inConfiguration, inParticleSourcePositions,
-                     inNbElementsPerBlock == -1 ?
-                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration):
+                     inNbElementsPerBlock < 0 ?
+                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration,
+                                                                   static_cast<int>(std::thread::hardware_concurrency()),
+                                                                   inNbElementsPerBlock == TbfBlockSizeFinder::CostModelBlockSize):
                          inNbElementsPerBlock,
                      inOneGroupPerParent),
           treeTarget(inConfiguration, inParticleTargetPositions,
-                     inNbElementsPerBlock == -1 ?
-                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration):
+                     inNbElementsPerBlock < 0 ?
+                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration,
+                                                                   static_cast<int>(std::thread::hardware_concurrency()),
+                                                                   inNbElementsPerBlock == TbfBlockSizeFinder::CostModelBlockSize):
                          inNbElementsPerBlock,
                      inOneGroupPerParent){
     }
@@ -21,6 +21,7 @@
 #ifdef TBF_USE_INASTEMP
 #include "InastempGlobal.h"
 #endif
+#include "FP2PRSimd.hpp"
 
 /**
  * @brief The FP2PR namespace
@@ -87,9 +88,13 @@ inline void NonMutualParticles(const FReal sourceX,const FReal sourceY,const FRe
     *targetPotential += ( inv_distance * sourcePhysicalValue );
 }
 
+// In FullMutual and GenericFullRemote, inSourcesShift is added to the positions of the sources
+// (for the periodic images) without copying them: it is subtracted from the targets instead.
+
 template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
 static void FullMutualScalar(const ParticlesClassValues& inNeighbors, ParticlesClassRhs& inNeighborsRhs, const long int nbParticlesSources,
-                      const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+                      const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                      const std::array<FReal, 3>& inSourcesShift = {}){
 
     const FReal*const targetsX = GetPtr(inTargets[0]);
     const FReal*const targetsY = GetPtr(inTargets[1]);
@@ -112,9 +117,9 @@ static void FullMutualScalar(const ParticlesClassValues& inNeighbors, ParticlesC
     FReal*const sourcesPotentials = GetPtr(inNeighborsRhs[3]);
 
     for(long int idxTarget = 0 ; idxTarget < nbParticlesTargets ; ++idxTarget){
-        const FReal tx = targetsX[idxTarget];
-        const FReal ty = targetsY[idxTarget];
-        const FReal tz = targetsZ[idxTarget];
+        const FReal tx = targetsX[idxTarget] - inSourcesShift[0];
+        const FReal ty = targetsY[idxTarget] - inSourcesShift[1];
+        const FReal tz = targetsZ[idxTarget] - inSourcesShift[2];
         const FReal tv = targetsPhysicalValues[idxTarget];
         FReal  tfx = 0;
         FReal  tfy = 0;
@@ -156,9 +161,11 @@ static void FullMutualScalar(const ParticlesClassValues& inNeighbors, ParticlesC
 
 
 #ifdef TBF_USE_INASTEMP
+// The tiling of the sources is only provided by the built-in SIMD version
 template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
 static void FullMutual(const ParticlesClassValues& inNeighbors, ParticlesClassRhs& inNeighborsRhs, const long int nbParticlesSources,
-                      const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+                      const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                      const std::array<FReal, 3>& inSourcesShift = {}, const bool /*inUseTiling*/ = false){
     using VecType = InaVecBestType<FReal>;
 
     const FReal*const targetsX = GetPtr(inTargets[0]);
@@ -184,9 +191,9 @@ static void FullMutual(const ParticlesClassValues& inNeighbors, ParticlesClassRh
     for(long int idxTarget = 0 ; idxTarget < nbParticlesTargets ; ++idxTarget){
         const long int nbVectorizedInteractions = (nbParticlesSources/VecType::GetVecLength())*VecType::GetVecLength();
         {
-            const VecType tx = VecType(targetsX[idxTarget]);
-            const VecType ty = VecType(targetsY[idxTarget]);
-            const VecType tz = VecType(targetsZ[idxTarget]);
+            const VecType tx = VecType(targetsX[idxTarget] - inSourcesShift[0]);
+            const VecType ty = VecType(targetsY[idxTarget] - inSourcesShift[1]);
+            const VecType tz = VecType(targetsZ[idxTarget] - inSourcesShift[2]);
             const VecType tv = VecType(targetsPhysicalValues[idxTarget]);
             VecType  tfx = VecType::GetZero();
             VecType  tfy = VecType::GetZero();
@@ -226,9 +233,9 @@ static void FullMutual(const ParticlesClassValues& inNeighbors, ParticlesClassRh
             targetsPotentials[idxTarget] += (tpo.horizontalSum());
         }
         {
-            const FReal tx = targetsX[idxTarget];
-            const FReal ty = targetsY[idxTarget];
-            const FReal tz = targetsZ[idxTarget];
+            const FReal tx = targetsX[idxTarget] - inSourcesShift[0];
+            const FReal ty = targetsY[idxTarget] - inSourcesShift[1];
+            const FReal tz = targetsZ[idxTarget] - inSourcesShift[2];
             const FReal tv = targetsPhysicalValues[idxTarget];
             FReal  tfx = 0;
             FReal  tfy = 0;
@@ -269,7 +276,22 @@ static void FullMutual(const ParticlesClassValues& inNeighbors, ParticlesClassRh
     }
 }
 #else
-#define FullMutual FullMutualScalar
+// Use the built-in SIMD version selected at runtime (see FP2PRSimd.hpp),
+// inUseTiling enables the processing of the sources by tiles (FP2PRSimd::FullMutual)
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void FullMutual(const ParticlesClassValues& inNeighbors, ParticlesClassRhs& inNeighborsRhs, const long int nbParticlesSources,
+                      const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                      const std::array<FReal, 3>& inSourcesShift = {}, const bool inUseTiling = false){
+    const std::array<const FReal*, 4> sources{{GetPtr(inNeighbors[0]), GetPtr(inNeighbors[1]), GetPtr(inNeighbors[2]), GetPtr(inNeighbors[3])}};
+    const std::array<FReal*, 4> sourcesRhs{{GetPtr(inNeighborsRhs[0]), GetPtr(inNeighborsRhs[1]), GetPtr(inNeighborsRhs[2]), GetPtr(inNeighborsRhs[3])}};
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::FullMutual<FReal>(FP2PRSimd::GetIsa(), sources, sourcesRhs, nbParticlesSources,
+                                    targets, targetsRhs, nbParticlesTargets, inUseTiling, inSourcesShift) == false){
+        FullMutualScalar<FReal>(inNeighbors, inNeighborsRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
 #endif
 
 template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
@@ -419,14 +441,24 @@ static void GenericInner(const ParticlesClassValues& inTargets,
     }
 }
 #else
-#define GenericInner GenericInnerScalar
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericInner(const ParticlesClassValues& inTargets,
+                         ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::GenericInner<FReal>(FP2PRSimd::GetIsa(), targets, targetsRhs, nbParticlesTargets) == false){
+        GenericInnerScalar<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+    }
+}
 #endif
 
 
 
 template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
 static void GenericFullRemoteScalar(const ParticlesClassValues& inNeighbors, const long int nbParticlesSources,
-                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift = {}){
     const FReal*const targetsX = GetPtr(inTargets[0]);
     const FReal*const targetsY = GetPtr(inTargets[1]);
     const FReal*const targetsZ = GetPtr(inTargets[2]);
@@ -444,9 +476,9 @@ static void GenericFullRemoteScalar(const ParticlesClassValues& inNeighbors, con
     const FReal*const sourcesPhysicalValues = GetPtr(inNeighbors[3]);
 
     for(long int idxTarget = 0 ; idxTarget < nbParticlesTargets ; ++idxTarget){
-        const FReal tx = targetsX[idxTarget];
-        const FReal ty = targetsY[idxTarget];
-        const FReal tz = targetsZ[idxTarget];
+        const FReal tx = targetsX[idxTarget] - inSourcesShift[0];
+        const FReal ty = targetsY[idxTarget] - inSourcesShift[1];
+        const FReal tz = targetsZ[idxTarget] - inSourcesShift[2];
         const FReal tv = targetsPhysicalValues[idxTarget];
         FReal  tfx = 0;
         FReal  tfy = 0;
@@ -484,7 +516,8 @@ static void GenericFullRemoteScalar(const ParticlesClassValues& inNeighbors, con
 #ifdef TBF_USE_INASTEMP
 template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
 static void GenericFullRemote(const ParticlesClassValues& inNeighbors, const long int nbParticlesSources,
-                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift = {}){
     using VecType = InaVecBestType<FReal>;
 
     const FReal*const targetsX = GetPtr(inTargets[0]);
@@ -507,9 +540,9 @@ static void GenericFullRemote(const ParticlesClassValues& inNeighbors, const lon
 
     for(long int idxTarget = 0 ; idxTarget < nbParticlesTargets ; ++idxTarget){
         {
-            const VecType tx = VecType(targetsX[idxTarget]);
-            const VecType ty = VecType(targetsY[idxTarget]);
-            const VecType tz = VecType(targetsZ[idxTarget]);
+            const VecType tx = VecType(targetsX[idxTarget] - inSourcesShift[0]);
+            const VecType ty = VecType(targetsY[idxTarget] - inSourcesShift[1]);
+            const VecType tz = VecType(targetsZ[idxTarget] - inSourcesShift[2]);
             const VecType tv = VecType(targetsPhysicalValues[idxTarget]);
             VecType  tfx = VecType::GetZero();
             VecType  tfy = VecType::GetZero();
@@ -543,9 +576,9 @@ static void GenericFullRemote(const ParticlesClassValues& inNeighbors, const lon
             targetsPotentials[idxTarget] += (tpo.horizontalSum());
         }
         {
-            const FReal tx = targetsX[idxTarget];
-            const FReal ty = targetsY[idxTarget];
-            const FReal tz = targetsZ[idxTarget];
+            const FReal tx = targetsX[idxTarget] - inSourcesShift[0];
+            const FReal ty = targetsY[idxTarget] - inSourcesShift[1];
+            const FReal tz = targetsZ[idxTarget] - inSourcesShift[2];
             const FReal tv = targetsPhysicalValues[idxTarget];
             FReal  tfx = 0;
             FReal  tfy = 0;
@@ -581,9 +614,116 @@ static void GenericFullRemote(const ParticlesClassValues& inNeighbors, const lon
     }
 }
 #else
-#define GenericFullRemote GenericFullRemoteScalar
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericFullRemote(const ParticlesClassValues& inNeighbors, const long int nbParticlesSources,
+                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift = {}){
+    const std::array<const FReal*, 4> sources{{GetPtr(inNeighbors[0]), GetPtr(inNeighbors[1]), GetPtr(inNeighbors[2]), GetPtr(inNeighbors[3])}};
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::GenericFullRemote<FReal>(FP2PRSimd::GetIsa(), sources, nbParticlesSources,
+                                           targets, targetsRhs, nbParticlesTargets, inSourcesShift) == false){
+        GenericFullRemoteScalar<FReal>(inNeighbors, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
 #endif
 
+/**
+ * The precision used by the P2P of the kernels:
+ * - Native computes everything with FReal
+ * - Mixed computes the distances and 1/r in float but accumulates in double,
+ *   it is only used for FReal = double when the SIMD mixed versions are available
+ *   (see FP2PRSimd.hpp), the native version is used otherwise
+ */
+enum class Precision{
+    Native,
+    Mixed
+};
+
+inline const char* GetPrecisionName(const Precision inPrecision){
+    return (inPrecision == Precision::Mixed ? "Mixed" : "Native");
+}
+
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void FullMutualMixed(const ParticlesClassValues& inNeighbors, ParticlesClassRhs& inNeighborsRhs, const long int nbParticlesSources,
+                            const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                            const std::array<FReal, 3>& inSourcesShift = {}){
+    const std::array<const FReal*, 4> sources{{GetPtr(inNeighbors[0]), GetPtr(inNeighbors[1]), GetPtr(inNeighbors[2]), GetPtr(inNeighbors[3])}};
+    const std::array<FReal*, 4> sourcesRhs{{GetPtr(inNeighborsRhs[0]), GetPtr(inNeighborsRhs[1]), GetPtr(inNeighborsRhs[2]), GetPtr(inNeighborsRhs[3])}};
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::FullMutualMixed<FReal>(FP2PRSimd::GetIsa(), sources, sourcesRhs, nbParticlesSources,
+                                         targets, targetsRhs, nbParticlesTargets, inSourcesShift) == false){
+        FullMutual<FReal>(inNeighbors, inNeighborsRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
+
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericInnerMixed(const ParticlesClassValues& inTargets,
+                              ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::GenericInnerMixed<FReal>(FP2PRSimd::GetIsa(), targets, targetsRhs, nbParticlesTargets) == false){
+        GenericInner<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+    }
+}
+
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericFullRemoteMixed(const ParticlesClassValues& inNeighbors, const long int nbParticlesSources,
+                                   const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                                   const std::array<FReal, 3>& inSourcesShift = {}){
+    const std::array<const FReal*, 4> sources{{GetPtr(inNeighbors[0]), GetPtr(inNeighbors[1]), GetPtr(inNeighbors[2]), GetPtr(inNeighbors[3])}};
+    const std::array<const FReal*, 4> targets{{GetPtr(inTargets[0]), GetPtr(inTargets[1]), GetPtr(inTargets[2]), GetPtr(inTargets[3])}};
+    const std::array<FReal*, 4> targetsRhs{{GetPtr(inTargetsRhs[0]), GetPtr(inTargetsRhs[1]), GetPtr(inTargetsRhs[2]), GetPtr(inTargetsRhs[3])}};
+
+    if(FP2PRSimd::GenericFullRemoteMixed<FReal>(FP2PRSimd::GetIsa(), sources, nbParticlesSources,
+                                                targets, targetsRhs, nbParticlesTargets, inSourcesShift) == false){
+        GenericFullRemote<FReal>(inNeighbors, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
+
+// The versions used by the kernels, the precision is given at runtime
+
+// The tiling (inUseTiling) only exists for the native precision, it is ignored by the mixed one
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void FullMutual(const Precision inPrecision,
+                       const ParticlesClassValues& inNeighbors, ParticlesClassRhs& inNeighborsRhs, const long int nbParticlesSources,
+                       const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                       const std::array<FReal, 3>& inSourcesShift = {}, const bool inUseTiling = false){
+    if(inPrecision == Precision::Mixed){
+        FullMutualMixed<FReal>(inNeighbors, inNeighborsRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+    else{
+        FullMutual<FReal>(inNeighbors, inNeighborsRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift, inUseTiling);
+    }
+}
+
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericInner(const Precision inPrecision, const ParticlesClassValues& inTargets,
+                         ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets){
+    if(inPrecision == Precision::Mixed){
+        GenericInnerMixed<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+    }
+    else{
+        GenericInner<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+    }
+}
+
+template <class FReal, class ParticlesClassValues, class ParticlesClassRhs>
+static void GenericFullRemote(const Precision inPrecision,
+                              const ParticlesClassValues& inNeighbors, const long int nbParticlesSources,
+                              const ParticlesClassValues& inTargets, ParticlesClassRhs& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift = {}){
+    if(inPrecision == Precision::Mixed){
+        GenericFullRemoteMixed<FReal>(inNeighbors, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+    else{
+        GenericFullRemote<FReal>(inNeighbors, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
 
 } // End namespace
 
@@ -0,0 +1,606 @@
+#ifndef FP2PRSIMD_HPP
+#define FP2PRSIMD_HPP
+
+#include "kernels/unifkernel/FMath.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// The SIMD versions of the FP2PR kernels that do not need Inastemp.
+// On x86 with GCC or Clang, the AVX2 and AVX-512 versions are always compiled
+// (with target-specific code generation) and the best one supported by the CPU
+// is selected at runtime. On the other architectures, std::experimental::simd is used if available.
+// The inverse square root is obtained from the hardware approximation
+// refined with Newton steps.
+// The mixed precision versions (x86 only) compute the distances and 1/r in float
+// (twice more elements per vector) but accumulate the results in double.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TBF_P2P_USE_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// The portable version is only needed when the x86 versions are not available
+#if !defined(TBF_P2P_USE_X86_DISPATCH) && defined(__has_include)
+#if __has_include(<experimental/simd>)
+#include <experimental/simd>
+#if defined(__cpp_lib_experimental_parallel_simd)
+#define TBF_P2P_USE_STD_SIMD
+#endif
+#endif
+#endif
+
+namespace FP2PRSimd{
+
+enum class Isa{
+    Scalar,
+    StdSimd,
+    Avx2,
+    Avx512
+};
+
+inline const char* GetIsaName(const Isa inIsa){
+    switch(inIsa){
+    case Isa::StdSimd: return "std::experimental::simd";
+    case Isa::Avx2: return "AVX2";
+    case Isa::Avx512: return "AVX-512";
+    default: return "Scalar";
+    }
+}
+
+inline bool IsAvailable(const Isa inIsa){
+    switch(inIsa){
+    case Isa::Scalar:
+        return true;
+#ifdef TBF_P2P_USE_STD_SIMD
+    case Isa::StdSimd:
+        return true;
+#endif
+#ifdef TBF_P2P_USE_X86_DISPATCH
+    case Isa::Avx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+// The best available set, it can be forced with the environment variable TBF_P2P_ISA
+// (scalar, stdsimd, avx2 or avx512) if the CPU supports it
+inline Isa FindBestIsa(){
+    if(const char* forcedIsa = std::getenv("TBF_P2P_ISA")){
+        for(const Isa isa : {Isa::Scalar, Isa::StdSimd, Isa::Avx2, Isa::Avx512}){
+            const char* isaKey = (isa == Isa::Scalar ? "scalar" : isa == Isa::StdSimd ? "stdsimd" : isa == Isa::Avx2 ? "avx2" : "avx512");
+            if(std::strcmp(forcedIsa, isaKey) == 0 && IsAvailable(isa)){
+                return isa;
+            }
+        }
+    }
+    for(const Isa isa : {Isa::Avx512, Isa::Avx2, Isa::StdSimd}){
+        if(IsAvailable(isa)){
+            return isa;
+        }
+    }
+    return Isa::Scalar;
+}
+
+// Detected once
+inline Isa GetIsa(){
+    static const Isa bestIsa = FindBestIsa();
+    return bestIsa;
+}
+
+// The number of sources per tile in FullMutual, such that the positions, the physical values
+// and the local accumulation buffer of a tile (8 values per source) use 16KB of L1
+template <class FReal>
+constexpr long int FullMutualTileSize(){
+    return (16*1024)/(8*static_cast<long int>(sizeof(FReal)));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef TBF_P2P_USE_X86_DISPATCH
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace Avx2{
+
+struct VecDouble{
+    static constexpr long int Length = 4;
+    __m256d vec;
+
+    static VecDouble Load(const double* inPtr){ return VecDouble{_mm256_loadu_pd(inPtr)}; }
+    static VecDouble Set(const double inValue){ return VecDouble{_mm256_set1_pd(inValue)}; }
+    static VecDouble Zero(){ return VecDouble{_mm256_setzero_pd()}; }
+    void store(double* inPtr) const { _mm256_storeu_pd(inPtr, vec); }
+
+    static VecDouble MulAdd(const VecDouble& inV1, const VecDouble& inV2, const VecDouble& inV3){
+        return VecDouble{_mm256_fmadd_pd(inV1.vec, inV2.vec, inV3.vec)};
+    }
+
+    // AVX2 has no double precision approximation, and the single precision one
+    // is limited to the float range and to 48 bits after two Newton steps, so use the exact value
+    static VecDouble InvSqrt(const VecDouble& inV){
+        return VecDouble{_mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(inV.vec))};
+    }
+
+    double horizontalSum() const {
+        const __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(vec), _mm256_extractf128_pd(vec, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+    }
+};
+
+inline VecDouble operator+(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm256_add_pd(inV1.vec, inV2.vec)}; }
+inline VecDouble operator-(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm256_sub_pd(inV1.vec, inV2.vec)}; }
+inline VecDouble operator*(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm256_mul_pd(inV1.vec, inV2.vec)}; }
+
+struct VecFloat{
+    static constexpr long int Length = 8;
+    __m256 vec;
+
+    static VecFloat Load(const float* inPtr){ return VecFloat{_mm256_loadu_ps(inPtr)}; }
+    static VecFloat Set(const float inValue){ return VecFloat{_mm256_set1_ps(inValue)}; }
+    static VecFloat Zero(){ return VecFloat{_mm256_setzero_ps()}; }
+    void store(float* inPtr) const { _mm256_storeu_ps(inPtr, vec); }
+
+    static VecFloat MulAdd(const VecFloat& inV1, const VecFloat& inV2, const VecFloat& inV3){
+        return VecFloat{_mm256_fmadd_ps(inV1.vec, inV2.vec, inV3.vec)};
+    }
+
+    // Approximation (12 bits) and one Newton step
+    static VecFloat InvSqrt(const VecFloat& inV){
+        const __m256 half = _mm256_mul_ps(inV.vec, _mm256_set1_ps(0.5f));
+        __m256 res = _mm256_rsqrt_ps(inV.vec);
+        res = _mm256_mul_ps(res, _mm256_fnmadd_ps(half, _mm256_mul_ps(res, res), _mm256_set1_ps(1.5f)));
+        return VecFloat{res};
+    }
+
+    float horizontalSum() const {
+        __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(vec), _mm256_extractf128_ps(vec, 1));
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        return _mm_cvtss_f32(_mm_add_ss(sum4, _mm_movehdup_ps(sum4)));
+    }
+
+    // Used by the mixed precision kernels
+    double horizontalSumDouble() const {
+        return VecDouble{_mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(vec)),
+                                       _mm256_cvtps_pd(_mm256_extractf128_ps(vec, 1)))}.horizontalSum();
+    }
+
+    void addToDouble(double* inPtr) const {
+        _mm256_storeu_pd(inPtr, _mm256_add_pd(_mm256_loadu_pd(inPtr), _mm256_cvtps_pd(_mm256_castps256_ps128(vec))));
+        _mm256_storeu_pd(inPtr + 4, _mm256_add_pd(_mm256_loadu_pd(inPtr + 4), _mm256_cvtps_pd(_mm256_extractf128_ps(vec, 1))));
+    }
+};
+
+inline VecFloat operator+(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm256_add_ps(inV1.vec, inV2.vec)}; }
+inline VecFloat operator-(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm256_sub_ps(inV1.vec, inV2.vec)}; }
+inline VecFloat operator*(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm256_mul_ps(inV1.vec, inV2.vec)}; }
+
+template <class FReal>
+struct VecSelect;
+
+template <>
+struct VecSelect<double>{ using type = VecDouble; };
+
+template <>
+struct VecSelect<float>{ using type = VecFloat; };
+
+// 16 registers: two targets at a time
+constexpr long int NbTargetsPerStep = 2;
+
+#include "FP2PRSimdKernels.hpp"
+#include "FP2PRSimdMixedKernels.hpp"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace Avx512{
+
+struct VecDouble{
+    static constexpr long int Length = 8;
+    __m512d vec;
+
+    static VecDouble Load(const double* inPtr){ return VecDouble{_mm512_loadu_pd(inPtr)}; }
+    static VecDouble Set(const double inValue){ return VecDouble{_mm512_set1_pd(inValue)}; }
+    static VecDouble Zero(){ return VecDouble{_mm512_setzero_pd()}; }
+    void store(double* inPtr) const { _mm512_storeu_pd(inPtr, vec); }
+
+    static VecDouble MulAdd(const VecDouble& inV1, const VecDouble& inV2, const VecDouble& inV3){
+        return VecDouble{_mm512_fmadd_pd(inV1.vec, inV2.vec, inV3.vec)};
+    }
+
+    // Approximation (14 bits, valid over the double range) and two Newton steps (about 53 bits)
+    static VecDouble InvSqrt(const VecDouble& inV){
+        const __m512d half = _mm512_mul_pd(inV.vec, _mm512_set1_pd(0.5));
+        const __m512d threeHalves = _mm512_set1_pd(1.5);
+        __m512d res = _mm512_maskz_rsqrt14_pd(0xFF, inV.vec);
+        res = _mm512_mul_pd(res, _mm512_fnmadd_pd(half, _mm512_mul_pd(res, res), threeHalves));
+        res = _mm512_mul_pd(res, _mm512_fnmadd_pd(half, _mm512_mul_pd(res, res), threeHalves));
+        return VecDouble{res};
+    }
+
+    // The masked versions avoid the uninitialized values of the unmasked intrinsics
+    double horizontalSum() const {
+        const __m256d sum4 = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xF, vec, 0), _mm512_maskz_extractf64x4_pd(0xF, vec, 1));
+        const __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum4), _mm256_extractf128_pd(sum4, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+    }
+};
+
+inline VecDouble operator+(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm512_add_pd(inV1.vec, inV2.vec)}; }
+inline VecDouble operator-(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm512_sub_pd(inV1.vec, inV2.vec)}; }
+inline VecDouble operator*(const VecDouble& inV1, const VecDouble& inV2){ return VecDouble{_mm512_mul_pd(inV1.vec, inV2.vec)}; }
+
+struct VecFloat{
+    static constexpr long int Length = 16;
+    __m512 vec;
+
+    static VecFloat Load(const float* inPtr){ return VecFloat{_mm512_loadu_ps(inPtr)}; }
+    static VecFloat Set(const float inValue){ return VecFloat{_mm512_set1_ps(inValue)}; }
+    static VecFloat Zero(){ return VecFloat{_mm512_setzero_ps()}; }
+    void store(float* inPtr) const { _mm512_storeu_ps(inPtr, vec); }
+
+    static VecFloat MulAdd(const VecFloat& inV1, const VecFloat& inV2, const VecFloat& inV3){
+        return VecFloat{_mm512_fmadd_ps(inV1.vec, inV2.vec, inV3.vec)};
+    }
+
+    // Approximation (14 bits) and one Newton step
+    static VecFloat InvSqrt(const VecFloat& inV){
+        const __m512 half = _mm512_mul_ps(inV.vec, _mm512_set1_ps(0.5f));
+        __m512 res = _mm512_maskz_rsqrt14_ps(0xFFFF, inV.vec);
+        res = _mm512_mul_ps(res, _mm512_fnmadd_ps(half, _mm512_mul_ps(res, res), _mm512_set1_ps(1.5f)));
+        return VecFloat{res};
+    }
+
+    float horizontalSum() const {
+        const __m256 sum8 = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(vec), 0)),
+                                          _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(vec), 1)));
+        __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        return _mm_cvtss_f32(_mm_add_ss(sum4, _mm_movehdup_ps(sum4)));
+    }
+
+    // Used by the mixed precision kernels
+    __m256 half(const int inIdxHalf) const {
+        return inIdxHalf == 0 ? _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(vec), 0))
+                              : _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xF, _mm512_castps_pd(vec), 1));
+    }
+
+    double horizontalSumDouble() const {
+        return VecDouble{_mm512_add_pd(_mm512_maskz_cvtps_pd(0xFF, half(0)), _mm512_maskz_cvtps_pd(0xFF, half(1)))}.horizontalSum();
+    }
+
+    void addToDouble(double* inPtr) const {
+        _mm512_storeu_pd(inPtr, _mm512_add_pd(_mm512_loadu_pd(inPtr), _mm512_maskz_cvtps_pd(0xFF, half(0))));
+        _mm512_storeu_pd(inPtr + 8, _mm512_add_pd(_mm512_loadu_pd(inPtr + 8), _mm512_maskz_cvtps_pd(0xFF, half(1))));
+    }
+};
+
+inline VecFloat operator+(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm512_add_ps(inV1.vec, inV2.vec)}; }
+inline VecFloat operator-(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm512_sub_ps(inV1.vec, inV2.vec)}; }
+inline VecFloat operator*(const VecFloat& inV1, const VecFloat& inV2){ return VecFloat{_mm512_mul_ps(inV1.vec, inV2.vec)}; }
+
+template <class FReal>
+struct VecSelect;
+
+template <>
+struct VecSelect<double>{ using type = VecDouble; };
+
+template <>
+struct VecSelect<float>{ using type = VecFloat; };
+
+// 32 registers: four targets at a time
+constexpr long int NbTargetsPerStep = 4;
+
+#include "FP2PRSimdKernels.hpp"
+#include "FP2PRSimdMixedKernels.hpp"
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef TBF_P2P_USE_STD_SIMD
+
+namespace StdSimd{
+
+template <class FReal>
+struct Vec{
+    using SimdType = std::experimental::native_simd<FReal>;
+    static constexpr long int Length = static_cast<long int>(SimdType::size());
+    SimdType vec;
+
+    static Vec Load(const FReal* inPtr){ return Vec{SimdType(inPtr, std::experimental::element_aligned)}; }
+    static Vec Set(const FReal inValue){ return Vec{SimdType(inValue)}; }
+    static Vec Zero(){ return Vec{SimdType(0)}; }
+    void store(FReal* inPtr) const { vec.copy_to(inPtr, std::experimental::element_aligned); }
+
+    static Vec MulAdd(const Vec& inV1, const Vec& inV2, const Vec& inV3){
+        return Vec{inV1.vec * inV2.vec + inV3.vec};
+    }
+
+    // No portable approximation, use the exact value
+    static Vec InvSqrt(const Vec& inV){
+        return Vec{FReal(1) / std::experimental::sqrt(inV.vec)};
+    }
+
+    FReal horizontalSum() const {
+        return std::experimental::reduce(vec);
+    }
+};
+
+template <class FReal>
+inline Vec<FReal> operator+(const Vec<FReal>& inV1, const Vec<FReal>& inV2){ return Vec<FReal>{inV1.vec + inV2.vec}; }
+template <class FReal>
+inline Vec<FReal> operator-(const Vec<FReal>& inV1, const Vec<FReal>& inV2){ return Vec<FReal>{inV1.vec - inV2.vec}; }
+template <class FReal>
+inline Vec<FReal> operator*(const Vec<FReal>& inV1, const Vec<FReal>& inV2){ return Vec<FReal>{inV1.vec * inV2.vec}; }
+
+template <class FReal>
+struct VecSelect{ using type = Vec<FReal>; };
+
+constexpr long int NbTargetsPerStep = 2;
+
+#include "FP2PRSimdKernels.hpp"
+
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+// The dispatchers return false if the given set cannot be used (then the caller should use the scalar version).
+// inSourcesShift is added to the positions of the sources (used for the periodic images) without copying them.
+
+// FullMutual can process the sources by tiles that fit in L1 when they are numerous (inUseTiling = true),
+// it is disabled by default since no consistent gain was measured (see examples/testP2PTiling.cpp),
+// the kernels enable it with setP2PTiling
+template <class FReal>
+inline bool FullMutual(const Isa inIsa,
+                       const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                       const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                       const bool inUseTiling = false, const std::array<FReal, 3>& inSourcesShift = {}){
+    if constexpr (std::is_same<FReal, double>::value || std::is_same<FReal, float>::value){
+        switch(inIsa){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+        case Isa::Avx512:
+            Avx512::FullMutual<FReal>(inSources, inSourcesRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inUseTiling, inSourcesShift);
+            return true;
+        case Isa::Avx2:
+            Avx2::FullMutual<FReal>(inSources, inSourcesRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inUseTiling, inSourcesShift);
+            return true;
+#endif
+#ifdef TBF_P2P_USE_STD_SIMD
+        case Isa::StdSimd:
+            StdSimd::FullMutual<FReal>(inSources, inSourcesRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inUseTiling, inSourcesShift);
+            return true;
+#endif
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+template <class FReal>
+inline bool GenericFullRemote(const Isa inIsa,
+                              const std::array<const FReal*, 4>& inSources, const long int nbParticlesSources,
+                              const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift = {}){
+    if constexpr (std::is_same<FReal, double>::value || std::is_same<FReal, float>::value){
+        switch(inIsa){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+        case Isa::Avx512:
+            Avx512::GenericFullRemote<FReal>(inSources, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+            return true;
+        case Isa::Avx2:
+            Avx2::GenericFullRemote<FReal>(inSources, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+            return true;
+#endif
+#ifdef TBF_P2P_USE_STD_SIMD
+        case Isa::StdSimd:
+            StdSimd::GenericFullRemote<FReal>(inSources, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+            return true;
+#endif
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+template <class FReal>
+inline bool GenericInner(const Isa inIsa,
+                         const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+    if constexpr (std::is_same<FReal, double>::value || std::is_same<FReal, float>::value){
+        switch(inIsa){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+        case Isa::Avx512:
+            Avx512::GenericInner<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+            return true;
+        case Isa::Avx2:
+            Avx2::GenericInner<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+            return true;
+#endif
+#ifdef TBF_P2P_USE_STD_SIMD
+        case Isa::StdSimd:
+            StdSimd::GenericInner<FReal>(inTargets, inTargetsRhs, nbParticlesTargets);
+            return true;
+#endif
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+// The float copy of the particles used by the mixed precision versions.
+// The positions are relative to a reference point (the first target) such that
+// the differences between close particles keep most of their accuracy in float.
+// The arrays are padded with particles of null physical value, far from the others,
+// such that the kernels can always load full vectors.
+struct MixedBuffer{
+    static constexpr long int Padding = 16;
+    static constexpr float PaddingPosition = 1e6f;
+
+    std::array<std::vector<float>, 4> values;
+
+    std::array<const float*, 4> convert(const std::array<const double*, 4>& inParticles, const long int inNbParticles,
+                                        const std::array<double, 3>& inReference){
+        for(int idxValue = 0 ; idxValue < 3 ; ++idxValue){
+            values[idxValue].resize(inNbParticles + Padding);
+            std::fill(values[idxValue].begin() + inNbParticles, values[idxValue].end(), PaddingPosition);
+        }
+        values[3].resize(inNbParticles + Padding);
+        std::fill(values[3].begin() + inNbParticles, values[3].end(), 0.f);
+
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            values[0][idxPart] = static_cast<float>(inParticles[0][idxPart] - inReference[0]);
+            values[1][idxPart] = static_cast<float>(inParticles[1][idxPart] - inReference[1]);
+            values[2][idxPart] = static_cast<float>(inParticles[2][idxPart] - inReference[2]);
+            values[3][idxPart] = static_cast<float>(inParticles[3][idxPart]);
+        }
+        return {{values[0].data(), values[1].data(), values[2].data(), values[3].data()}};
+    }
+};
+
+// One pair of buffers per thread to avoid allocations at each call
+inline std::array<MixedBuffer, 2>& GetMixedBuffers(){
+    static thread_local std::array<MixedBuffer, 2> buffers;
+    return buffers;
+}
+
+inline bool IsMixedAvailable(const Isa inIsa){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+    return (inIsa == Isa::Avx2 || inIsa == Isa::Avx512) && IsAvailable(inIsa);
+#else
+    return false;
+#endif
+}
+
+// The mixed precision dispatchers only support double (they return false otherwise).
+// The shift of the sources is included in their float copy by moving the reference point.
+
+template <class FReal>
+inline bool FullMutualMixed(const Isa inIsa,
+                            const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                            const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                            const std::array<FReal, 3>& inSourcesShift = {}){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+    if constexpr (std::is_same<FReal, double>::value){
+        if(IsMixedAvailable(inIsa)){
+            if(nbParticlesSources && nbParticlesTargets){
+                const std::array<double, 3> reference{{inTargets[0][0], inTargets[1][0], inTargets[2][0]}};
+                const std::array<double, 3> referenceSources{{reference[0] - inSourcesShift[0], reference[1] - inSourcesShift[1],
+                                                              reference[2] - inSourcesShift[2]}};
+                auto& buffers = GetMixedBuffers();
+                const auto sourcesFloat = buffers[0].convert(inSources, nbParticlesSources, referenceSources);
+                const auto targetsFloat = buffers[1].convert(inTargets, nbParticlesTargets, reference);
+                if(inIsa == Isa::Avx512){
+                    Avx512::FullMutualMixed(sourcesFloat, inSourcesRhs, nbParticlesSources,
+                                            inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+                else{
+                    Avx2::FullMutualMixed(sourcesFloat, inSourcesRhs, nbParticlesSources,
+                                          inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+            }
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+template <class FReal>
+inline bool GenericFullRemoteMixed(const Isa inIsa,
+                                   const std::array<const FReal*, 4>& inSources, const long int nbParticlesSources,
+                                   const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                                   const std::array<FReal, 3>& inSourcesShift = {}){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+    if constexpr (std::is_same<FReal, double>::value){
+        if(IsMixedAvailable(inIsa)){
+            if(nbParticlesSources && nbParticlesTargets){
+                const std::array<double, 3> reference{{inTargets[0][0], inTargets[1][0], inTargets[2][0]}};
+                const std::array<double, 3> referenceSources{{reference[0] - inSourcesShift[0], reference[1] - inSourcesShift[1],
+                                                              reference[2] - inSourcesShift[2]}};
+                auto& buffers = GetMixedBuffers();
+                const auto sourcesFloat = buffers[0].convert(inSources, nbParticlesSources, referenceSources);
+                const auto targetsFloat = buffers[1].convert(inTargets, nbParticlesTargets, reference);
+                if(inIsa == Isa::Avx512){
+                    Avx512::GenericFullRemoteMixed(sourcesFloat, nbParticlesSources,
+                                                   inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+                else{
+                    Avx2::GenericFullRemoteMixed(sourcesFloat, nbParticlesSources,
+                                                 inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+            }
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+template <class FReal>
+inline bool GenericInnerMixed(const Isa inIsa,
+                              const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+#ifdef TBF_P2P_USE_X86_DISPATCH
+    if constexpr (std::is_same<FReal, double>::value){
+        if(IsMixedAvailable(inIsa)){
+            if(nbParticlesTargets){
+                const std::array<double, 3> reference{{inTargets[0][0], inTargets[1][0], inTargets[2][0]}};
+                const auto targetsFloat = GetMixedBuffers()[1].convert(inTargets, nbParticlesTargets, reference);
+                if(inIsa == Isa::Avx512){
+                    Avx512::GenericInnerMixed(inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+                else{
+                    Avx2::GenericInnerMixed(inTargets, targetsFloat, inTargetsRhs, nbParticlesTargets);
+                }
+            }
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+}
+
+#endif
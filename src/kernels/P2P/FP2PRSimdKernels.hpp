@@ -0,0 +1,211 @@
+// No include guard: this file is included by FP2PRSimd.hpp once per instruction set,
+// inside a namespace that provides VecSelect<FReal>::type and NbTargetsPerStep.
+
+// The scalar interaction used for the remaining sources and the pairs inside a block of targets.
+// In all the kernels, the shift of the sources (periodic images) is applied to the targets
+// in the opposite direction, only the differences between the positions matter.
+template <class FReal, bool Mutual>
+inline void ScalarInteraction(const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int idxTarget,
+                              const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int idxSource,
+                              const std::array<FReal, 3>& inSourcesShift){
+    FReal dx = inSources[0][idxSource] - (inTargets[0][idxTarget] - inSourcesShift[0]);
+    FReal dy = inSources[1][idxSource] - (inTargets[1][idxTarget] - inSourcesShift[1]);
+    FReal dz = inSources[2][idxSource] - (inTargets[2][idxTarget] - inSourcesShift[2]);
+
+    FReal inv_square_distance = FReal(1) / (dx*dx + dy*dy + dz*dz);
+    const FReal inv_distance = FMath::Sqrt(inv_square_distance);
+
+    inv_square_distance *= inv_distance;
+    inv_square_distance *= inTargets[3][idxTarget] * inSources[3][idxSource];
+
+    dx *= inv_square_distance;
+    dy *= inv_square_distance;
+    dz *= inv_square_distance;
+
+    inTargetsRhs[0][idxTarget] += dx;
+    inTargetsRhs[1][idxTarget] += dy;
+    inTargetsRhs[2][idxTarget] += dz;
+    inTargetsRhs[3][idxTarget] += inv_distance * inSources[3][idxSource];
+
+    if constexpr (Mutual){
+        inSourcesRhs[0][idxSource] -= dx;
+        inSourcesRhs[1][idxSource] -= dy;
+        inSourcesRhs[2][idxSource] -= dz;
+        inSourcesRhs[3][idxSource] += inv_distance * inTargets[3][idxTarget];
+    }
+}
+
+// Compute the interactions between NbTargets consecutive targets and the sources [idxFirstSource, idxLastSource[.
+// The targets are processed together so that each source vector is loaded (and stored if Mutual) only once.
+// The physical values are factorized out of the inner loop.
+template <class FReal, long int NbTargets, bool Mutual>
+inline void TargetsWithSources(const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int idxFirstTarget,
+                               const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs,
+                               const long int idxFirstSource, const long int idxLastSource,
+                               const std::array<FReal, 3>& inSourcesShift){
+    using VecType = typename VecSelect<FReal>::type;
+
+    VecType tx[NbTargets];
+    VecType ty[NbTargets];
+    VecType tz[NbTargets];
+    VecType tv[NbTargets];
+    VecType tfx[NbTargets];
+    VecType tfy[NbTargets];
+    VecType tfz[NbTargets];
+    VecType tpo[NbTargets];
+
+    for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+        tx[idxTarget] = VecType::Set(inTargets[0][idxFirstTarget+idxTarget] - inSourcesShift[0]);
+        ty[idxTarget] = VecType::Set(inTargets[1][idxFirstTarget+idxTarget] - inSourcesShift[1]);
+        tz[idxTarget] = VecType::Set(inTargets[2][idxFirstTarget+idxTarget] - inSourcesShift[2]);
+        tv[idxTarget] = VecType::Set(inTargets[3][idxFirstTarget+idxTarget]);
+        tfx[idxTarget] = VecType::Zero();
+        tfy[idxTarget] = VecType::Zero();
+        tfz[idxTarget] = VecType::Zero();
+        tpo[idxTarget] = VecType::Zero();
+    }
+
+    const long int idxLastVectorizedSource = idxFirstSource + ((idxLastSource-idxFirstSource)/VecType::Length)*VecType::Length;
+
+    for(long int idxSource = idxFirstSource ; idxSource < idxLastVectorizedSource ; idxSource += VecType::Length){
+        const VecType sx = VecType::Load(&inSources[0][idxSource]);
+        const VecType sy = VecType::Load(&inSources[1][idxSource]);
+        const VecType sz = VecType::Load(&inSources[2][idxSource]);
+        const VecType sv = VecType::Load(&inSources[3][idxSource]);
+
+        VecType sfx = VecType::Zero();
+        VecType sfy = VecType::Zero();
+        VecType sfz = VecType::Zero();
+        VecType spo = VecType::Zero();
+
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            const VecType dx = sx - tx[idxTarget];
+            const VecType dy = sy - ty[idxTarget];
+            const VecType dz = sz - tz[idxTarget];
+
+            const VecType inv_distance = VecType::InvSqrt(VecType::MulAdd(dx, dx, VecType::MulAdd(dy, dy, dz*dz)));
+            const VecType inv_cube_distance = inv_distance * inv_distance * inv_distance;
+
+            const VecType coefTarget = inv_cube_distance * sv;
+            tfx[idxTarget] = VecType::MulAdd(coefTarget, dx, tfx[idxTarget]);
+            tfy[idxTarget] = VecType::MulAdd(coefTarget, dy, tfy[idxTarget]);
+            tfz[idxTarget] = VecType::MulAdd(coefTarget, dz, tfz[idxTarget]);
+            tpo[idxTarget] = VecType::MulAdd(inv_distance, sv, tpo[idxTarget]);
+
+            if constexpr (Mutual){
+                const VecType coefSource = inv_cube_distance * tv[idxTarget];
+                sfx = VecType::MulAdd(coefSource, dx, sfx);
+                sfy = VecType::MulAdd(coefSource, dy, sfy);
+                sfz = VecType::MulAdd(coefSource, dz, sfz);
+                spo = VecType::MulAdd(inv_distance, tv[idxTarget], spo);
+            }
+        }
+
+        if constexpr (Mutual){
+            (VecType::Load(&inSourcesRhs[0][idxSource]) - sfx * sv).store(&inSourcesRhs[0][idxSource]);
+            (VecType::Load(&inSourcesRhs[1][idxSource]) - sfy * sv).store(&inSourcesRhs[1][idxSource]);
+            (VecType::Load(&inSourcesRhs[2][idxSource]) - sfz * sv).store(&inSourcesRhs[2][idxSource]);
+            (VecType::Load(&inSourcesRhs[3][idxSource]) + spo).store(&inSourcesRhs[3][idxSource]);
+        }
+    }
+
+    for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+        const FReal targetValue = inTargets[3][idxFirstTarget+idxTarget];
+        inTargetsRhs[0][idxFirstTarget+idxTarget] += targetValue * tfx[idxTarget].horizontalSum();
+        inTargetsRhs[1][idxFirstTarget+idxTarget] += targetValue * tfy[idxTarget].horizontalSum();
+        inTargetsRhs[2][idxFirstTarget+idxTarget] += targetValue * tfz[idxTarget].horizontalSum();
+        inTargetsRhs[3][idxFirstTarget+idxTarget] += tpo[idxTarget].horizontalSum();
+
+        for(long int idxSource = idxLastVectorizedSource ; idxSource < idxLastSource ; ++idxSource){
+            ScalarInteraction<FReal, Mutual>(inTargets, inTargetsRhs, idxFirstTarget+idxTarget, inSources, inSourcesRhs, idxSource, inSourcesShift);
+        }
+    }
+}
+
+template <class FReal>
+inline void FullMutualStream(const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                             const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                             const std::array<FReal, 3>& inSourcesShift){
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        TargetsWithSources<FReal, NbTargetsPerStep, true>(inTargets, inTargetsRhs, idxTarget, inSources, inSourcesRhs, 0, nbParticlesSources, inSourcesShift);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        TargetsWithSources<FReal, 1, true>(inTargets, inTargetsRhs, idxTarget, inSources, inSourcesRhs, 0, nbParticlesSources, inSourcesShift);
+    }
+}
+
+// The sources are processed by tiles against all the targets, the tile stays in L1
+// and its results are accumulated in a local buffer that is written back once per tile
+template <class FReal>
+inline void FullMutualTiled(const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                            const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                            const std::array<FReal, 3>& inSourcesShift){
+    constexpr long int TileSize = FullMutualTileSize<FReal>();
+    FReal tileRhsBuffer[4][TileSize];
+
+    for(long int idxTile = 0 ; idxTile < nbParticlesSources ; idxTile += TileSize){
+        const long int nbSourcesInTile = std::min(TileSize, nbParticlesSources - idxTile);
+        for(long int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            std::fill(tileRhsBuffer[idxValue], tileRhsBuffer[idxValue] + nbSourcesInTile, FReal(0));
+        }
+
+        const std::array<const FReal*, 4> tileSources{{inSources[0] + idxTile, inSources[1] + idxTile,
+                                                       inSources[2] + idxTile, inSources[3] + idxTile}};
+        const std::array<FReal*, 4> tileRhs{{tileRhsBuffer[0], tileRhsBuffer[1], tileRhsBuffer[2], tileRhsBuffer[3]}};
+
+        FullMutualStream<FReal>(tileSources, tileRhs, nbSourcesInTile, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+
+        for(long int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            for(long int idxSource = 0 ; idxSource < nbSourcesInTile ; ++idxSource){
+                inSourcesRhs[idxValue][idxTile + idxSource] += tileRhsBuffer[idxValue][idxSource];
+            }
+        }
+    }
+}
+
+// The tiling is used when it is enabled and the sources do not fit in one tile
+template <class FReal>
+inline void FullMutual(const std::array<const FReal*, 4>& inSources, const std::array<FReal*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                       const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                       const bool inUseTiling, const std::array<FReal, 3>& inSourcesShift){
+    if(inUseTiling && nbParticlesSources > FullMutualTileSize<FReal>()){
+        FullMutualTiled<FReal>(inSources, inSourcesRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+    else{
+        FullMutualStream<FReal>(inSources, inSourcesRhs, nbParticlesSources, inTargets, inTargetsRhs, nbParticlesTargets, inSourcesShift);
+    }
+}
+
+template <class FReal>
+inline void GenericFullRemote(const std::array<const FReal*, 4>& inSources, const long int nbParticlesSources,
+                              const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets,
+                              const std::array<FReal, 3>& inSourcesShift){
+    const std::array<FReal*, 4> noSourcesRhs{};
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        TargetsWithSources<FReal, NbTargetsPerStep, false>(inTargets, inTargetsRhs, idxTarget, inSources, noSourcesRhs, 0, nbParticlesSources, inSourcesShift);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        TargetsWithSources<FReal, 1, false>(inTargets, inTargetsRhs, idxTarget, inSources, noSourcesRhs, 0, nbParticlesSources, inSourcesShift);
+    }
+}
+
+template <class FReal>
+inline void GenericInner(const std::array<const FReal*, 4>& inTargets, const std::array<FReal*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+    const std::array<FReal, 3> noShift{};
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        // The pairs inside the block, then the block with all the next particles
+        for(long int idxTargetInBlock = idxTarget ; idxTargetInBlock < idxTarget + NbTargetsPerStep ; ++idxTargetInBlock){
+            for(long int idxSource = idxTargetInBlock+1 ; idxSource < idxTarget + NbTargetsPerStep ; ++idxSource){
+                ScalarInteraction<FReal, true>(inTargets, inTargetsRhs, idxTargetInBlock, inTargets, inTargetsRhs, idxSource, noShift);
+            }
+        }
+        TargetsWithSources<FReal, NbTargetsPerStep, true>(inTargets, inTargetsRhs, idxTarget, inTargets, inTargetsRhs,
+                                                          idxTarget + NbTargetsPerStep, nbParticlesTargets, noShift);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        TargetsWithSources<FReal, 1, true>(inTargets, inTargetsRhs, idxTarget, inTargets, inTargetsRhs, idxTarget+1, nbParticlesTargets, noShift);
+    }
+}
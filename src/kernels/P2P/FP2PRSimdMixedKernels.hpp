@@ -0,0 +1,179 @@
+// No include guard: this file is included by FP2PRSimd.hpp in the x86 namespaces,
+// after FP2PRSimdKernels.hpp, it needs VecFloat::addToDouble and VecFloat::horizontalSumDouble.
+// The float arrays must be padded with particles of null physical value (see MixedBuffer)
+// such that the sources can be processed by full vectors without scalar tail.
+
+// Add the first inNbValues of a vector in double
+inline void AddToDoublePartial(const VecFloat& inVec, double* inPtr, const long int inNbValues){
+    float values[VecFloat::Length];
+    inVec.store(values);
+    for(long int idxValue = 0 ; idxValue < inNbValues ; ++idxValue){
+        inPtr[idxValue] += values[idxValue];
+    }
+}
+
+// The mixed precision version of TargetsWithSources: the distances and the interactions
+// are computed in float (from positions relative to a common reference point), the float
+// partial sums are flushed in double after at most MixedBlockSize vectors of sources.
+template <long int NbTargets, bool Mutual>
+inline void MixedTargetsWithSources(const std::array<const double*, 4>& inTargets, const std::array<const float*, 4>& inTargetsFloat,
+                                    const std::array<double*, 4>& inTargetsRhs, const long int idxFirstTarget,
+                                    const std::array<const float*, 4>& inSourcesFloat,
+                                    const std::array<double*, 4>& inSourcesRhs, const long int idxFirstSource, const long int idxLastSource){
+    using VecType = VecFloat;
+    constexpr long int MixedBlockSize = 8;
+
+    VecType tx[NbTargets];
+    VecType ty[NbTargets];
+    VecType tz[NbTargets];
+    VecType tv[NbTargets];
+    double tfxSum[NbTargets];
+    double tfySum[NbTargets];
+    double tfzSum[NbTargets];
+    double tpoSum[NbTargets];
+
+    for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+        tx[idxTarget] = VecType::Set(inTargetsFloat[0][idxFirstTarget+idxTarget]);
+        ty[idxTarget] = VecType::Set(inTargetsFloat[1][idxFirstTarget+idxTarget]);
+        tz[idxTarget] = VecType::Set(inTargetsFloat[2][idxFirstTarget+idxTarget]);
+        tv[idxTarget] = VecType::Set(inTargetsFloat[3][idxFirstTarget+idxTarget]);
+        tfxSum[idxTarget] = 0;
+        tfySum[idxTarget] = 0;
+        tfzSum[idxTarget] = 0;
+        tpoSum[idxTarget] = 0;
+    }
+
+    // The last vector can contain padding particles
+    const long int idxLastVectorizedSource = idxFirstSource + ((idxLastSource-idxFirstSource+VecType::Length-1)/VecType::Length)*VecType::Length;
+
+    for(long int idxBlock = idxFirstSource ; idxBlock < idxLastVectorizedSource ; idxBlock += MixedBlockSize*VecType::Length){
+        const long int idxBlockEnd = std::min(idxBlock + MixedBlockSize*VecType::Length, idxLastVectorizedSource);
+
+        VecType tfx[NbTargets];
+        VecType tfy[NbTargets];
+        VecType tfz[NbTargets];
+        VecType tpo[NbTargets];
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            tfx[idxTarget] = VecType::Zero();
+            tfy[idxTarget] = VecType::Zero();
+            tfz[idxTarget] = VecType::Zero();
+            tpo[idxTarget] = VecType::Zero();
+        }
+
+        for(long int idxSource = idxBlock ; idxSource < idxBlockEnd ; idxSource += VecType::Length){
+            const VecType sx = VecType::Load(&inSourcesFloat[0][idxSource]);
+            const VecType sy = VecType::Load(&inSourcesFloat[1][idxSource]);
+            const VecType sz = VecType::Load(&inSourcesFloat[2][idxSource]);
+            const VecType sv = VecType::Load(&inSourcesFloat[3][idxSource]);
+
+            VecType sfx = VecType::Zero();
+            VecType sfy = VecType::Zero();
+            VecType sfz = VecType::Zero();
+            VecType spo = VecType::Zero();
+
+            for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+                const VecType dx = sx - tx[idxTarget];
+                const VecType dy = sy - ty[idxTarget];
+                const VecType dz = sz - tz[idxTarget];
+
+                const VecType inv_distance = VecType::InvSqrt(VecType::MulAdd(dx, dx, VecType::MulAdd(dy, dy, dz*dz)));
+                const VecType inv_cube_distance = inv_distance * inv_distance * inv_distance;
+
+                const VecType coefTarget = inv_cube_distance * sv;
+                tfx[idxTarget] = VecType::MulAdd(coefTarget, dx, tfx[idxTarget]);
+                tfy[idxTarget] = VecType::MulAdd(coefTarget, dy, tfy[idxTarget]);
+                tfz[idxTarget] = VecType::MulAdd(coefTarget, dz, tfz[idxTarget]);
+                tpo[idxTarget] = VecType::MulAdd(inv_distance, sv, tpo[idxTarget]);
+
+                if constexpr (Mutual){
+                    const VecType coefSource = inv_cube_distance * tv[idxTarget];
+                    sfx = VecType::MulAdd(coefSource, dx, sfx);
+                    sfy = VecType::MulAdd(coefSource, dy, sfy);
+                    sfz = VecType::MulAdd(coefSource, dz, sfz);
+                    spo = VecType::MulAdd(inv_distance, tv[idxTarget], spo);
+                }
+            }
+
+            if constexpr (Mutual){
+                if(idxSource + VecType::Length <= idxLastSource){
+                    (VecType::Zero() - sfx * sv).addToDouble(&inSourcesRhs[0][idxSource]);
+                    (VecType::Zero() - sfy * sv).addToDouble(&inSourcesRhs[1][idxSource]);
+                    (VecType::Zero() - sfz * sv).addToDouble(&inSourcesRhs[2][idxSource]);
+                    spo.addToDouble(&inSourcesRhs[3][idxSource]);
+                }
+                else{
+                    AddToDoublePartial(VecType::Zero() - sfx * sv, &inSourcesRhs[0][idxSource], idxLastSource - idxSource);
+                    AddToDoublePartial(VecType::Zero() - sfy * sv, &inSourcesRhs[1][idxSource], idxLastSource - idxSource);
+                    AddToDoublePartial(VecType::Zero() - sfz * sv, &inSourcesRhs[2][idxSource], idxLastSource - idxSource);
+                    AddToDoublePartial(spo, &inSourcesRhs[3][idxSource], idxLastSource - idxSource);
+                }
+            }
+        }
+
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            tfxSum[idxTarget] += tfx[idxTarget].horizontalSumDouble();
+            tfySum[idxTarget] += tfy[idxTarget].horizontalSumDouble();
+            tfzSum[idxTarget] += tfz[idxTarget].horizontalSumDouble();
+            tpoSum[idxTarget] += tpo[idxTarget].horizontalSumDouble();
+        }
+    }
+
+    for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+        const double targetValue = inTargets[3][idxFirstTarget+idxTarget];
+        inTargetsRhs[0][idxFirstTarget+idxTarget] += targetValue * tfxSum[idxTarget];
+        inTargetsRhs[1][idxFirstTarget+idxTarget] += targetValue * tfySum[idxTarget];
+        inTargetsRhs[2][idxFirstTarget+idxTarget] += targetValue * tfzSum[idxTarget];
+        inTargetsRhs[3][idxFirstTarget+idxTarget] += tpoSum[idxTarget];
+    }
+}
+
+inline void FullMutualMixed(const std::array<const float*, 4>& inSourcesFloat,
+                            const std::array<double*, 4>& inSourcesRhs, const long int nbParticlesSources,
+                            const std::array<const double*, 4>& inTargets, const std::array<const float*, 4>& inTargetsFloat,
+                            const std::array<double*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        MixedTargetsWithSources<NbTargetsPerStep, true>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                                        inSourcesFloat, inSourcesRhs, 0, nbParticlesSources);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        MixedTargetsWithSources<1, true>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                         inSourcesFloat, inSourcesRhs, 0, nbParticlesSources);
+    }
+}
+
+inline void GenericFullRemoteMixed(const std::array<const float*, 4>& inSourcesFloat,
+                                   const long int nbParticlesSources,
+                                   const std::array<const double*, 4>& inTargets, const std::array<const float*, 4>& inTargetsFloat,
+                                   const std::array<double*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+    const std::array<double*, 4> noSourcesRhs{};
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        MixedTargetsWithSources<NbTargetsPerStep, false>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                                         inSourcesFloat, noSourcesRhs, 0, nbParticlesSources);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        MixedTargetsWithSources<1, false>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                          inSourcesFloat, noSourcesRhs, 0, nbParticlesSources);
+    }
+}
+
+inline void GenericInnerMixed(const std::array<const double*, 4>& inTargets, const std::array<const float*, 4>& inTargetsFloat,
+                              const std::array<double*, 4>& inTargetsRhs, const long int nbParticlesTargets){
+    const std::array<double, 3> noShift{};
+    long int idxTarget = 0;
+    for( ; idxTarget + NbTargetsPerStep <= nbParticlesTargets ; idxTarget += NbTargetsPerStep){
+        for(long int idxTargetInBlock = idxTarget ; idxTargetInBlock < idxTarget + NbTargetsPerStep ; ++idxTargetInBlock){
+            for(long int idxSource = idxTargetInBlock+1 ; idxSource < idxTarget + NbTargetsPerStep ; ++idxSource){
+                ScalarInteraction<double, true>(inTargets, inTargetsRhs, idxTargetInBlock, inTargets, inTargetsRhs, idxSource, noShift);
+            }
+        }
+        MixedTargetsWithSources<NbTargetsPerStep, true>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                                        inTargetsFloat, inTargetsRhs,
+                                                        idxTarget + NbTargetsPerStep, nbParticlesTargets);
+    }
+    for( ; idxTarget < nbParticlesTargets ; ++idxTarget){
+        MixedTargetsWithSources<1, true>(inTargets, inTargetsFloat, inTargetsRhs, idxTarget,
+                                         inTargetsFloat, inTargetsRhs, idxTarget+1, nbParticlesTargets);
+    }
+}
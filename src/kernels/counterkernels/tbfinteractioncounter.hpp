@@ -3,6 +3,8 @@
 
 #include "tbfglobal.hpp"
 
+#include <utility>
+
 template <class RealKernel>
 class TbfInteractionCounter : public RealKernel {
 public:
@@ -72,6 +74,14 @@ public:
         RealKernel::M2L(inTargetIndex, inLevel, inInteractingCells, neighPos, inNbNeighbors, inOutCell);
     }
 
+    // Only available if the real kernel has it
+    template <class M2LBatchClass, class RealKernelClass = RealKernel>
+    auto M2LBatch(const long int inLevel, M2LBatchClass& inBatch)
+            -> decltype(std::declval<RealKernelClass&>().M2LBatch(inLevel, inBatch)) {
+        counters.M2L += inBatch.size();
+        return RealKernel::M2LBatch(inLevel, inBatch);
+    }
+
     template <class CellSymbolicData,class CellClass, class CellClassContainer>
     void L2L(const CellSymbolicData& inParentIndex,
              const long int inLevel, const CellClass& inUpperCell, CellClassContainer& inOutLowerCell,
@@ -71,6 +71,10 @@ public:
         RealKernel::M2L(inTargetIndex, inLevel, inInteractingCells, neighPos, inNbNeighbors, inOutCell);
     }
 
+    // The interactions are printed cell by cell, so the batched M2L of the real kernel is not used
+    template <class M2LBatchClass>
+    void M2LBatch(const long int inLevel, M2LBatchClass& inBatch) = delete;
+
     template <class CellSymbolicData,class CellClass, class CellClassContainer>
     void L2L(const CellSymbolicData& inParentIndex,
              const long int inLevel, const CellClass& inUpperCell, CellClassContainer& inOutLowerCell,
@@ -0,0 +1,306 @@
+#ifndef TBFINTERACTIONPROFILER_HPP
+#define TBFINTERACTIONPROFILER_HPP
+
+#include "tbfglobal.hpp"
+
+#include "utils/tbfcyclecounter.hpp"
+
+#include <utility>
+#include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+
+// Measure each kernel call with the cycle counter and record, per operator and per level,
+// an histogram of the duration against the size of the call:
+// - P2M/L2P : the number of particles
+// - M2M/L2L : the number of children
+// - M2L : the number of neighbors (or of interactions for the M2LBatch)
+// - P2P/P2PInner : the number of particle pairs (targets times sources), as in TbfInteractionCounter
+// The bins are the powers of two of the size, so that a cost model can be fitted from them.
+// The kernels do not receive the level of the leaves, so P2M/L2P/P2P/P2PInner are stored with level -1.
+template <class RealKernel>
+class TbfInteractionProfiler : public RealKernel {
+public:
+    using CycleType = TbfCycleCounter::CycleType;
+
+    enum OperatorType {
+        P2M_OP = 0,
+        M2M_OP,
+        M2L_OP,
+        L2L_OP,
+        L2P_OP,
+        P2P_OP,
+        P2PInner_OP,
+        NbOperators
+    };
+
+    static const char* GetOperatorName(const long int inOperator){
+        constexpr const char* OperatorNames[NbOperators] = {"P2M", "M2M", "M2L", "L2L", "L2P", "P2P", "P2PInner"};
+        return OperatorNames[inOperator];
+    }
+
+    struct Bin{
+        long int nbCalls = 0;
+        long int sumSizes = 0;
+        CycleType sumCycles = 0;
+        CycleType minCycles = std::numeric_limits<CycleType>::max();
+        CycleType maxCycles = 0;
+
+        void add(const long int inSize, const CycleType inCycles){
+            nbCalls += 1;
+            sumSizes += inSize;
+            sumCycles += inCycles;
+            minCycles = std::min(minCycles, inCycles);
+            maxCycles = std::max(maxCycles, inCycles);
+        }
+
+        void merge(const Bin& inOther){
+            nbCalls += inOther.nbCalls;
+            sumSizes += inOther.sumSizes;
+            sumCycles += inOther.sumCycles;
+            minCycles = std::min(minCycles, inOther.minCycles);
+            maxCycles = std::max(maxCycles, inOther.maxCycles);
+        }
+    };
+
+    // Bin 0 is for the size 0, then bin i holds the sizes in [2^(i-1), 2^i[
+    struct Histogram{
+        std::vector<Bin> bins;
+
+        static long int GetBinIndex(const long int inSize){
+            long int idxBin = 0;
+            while(idxBin < 63 && (inSize >> idxBin) != 0){
+                idxBin += 1;
+            }
+            return idxBin;
+        }
+
+        static long int GetBinMinSize(const long int inIdxBin){
+            return (inIdxBin == 0 ? 0 : (1L << (inIdxBin-1)));
+        }
+
+        static long int GetBinMaxSize(const long int inIdxBin){
+            return (inIdxBin == 0 ? 0 : (1L << inIdxBin)-1);
+        }
+
+        void add(const long int inSize, const CycleType inCycles){
+            const long int idxBin = GetBinIndex(inSize);
+            if(static_cast<long int>(bins.size()) <= idxBin){
+                bins.resize(idxBin+1);
+            }
+            bins[idxBin].add(inSize, inCycles);
+        }
+
+        void merge(const Histogram& inOther){
+            if(bins.size() < inOther.bins.size()){
+                bins.resize(inOther.bins.size());
+            }
+            for(long int idxBin = 0 ; idxBin < static_cast<long int>(inOther.bins.size()) ; ++idxBin){
+                bins[idxBin].merge(inOther.bins[idxBin]);
+            }
+        }
+
+        Bin getTotal() const{
+            Bin total;
+            for(const Bin& bin : bins){
+                total.merge(bin);
+            }
+            return total;
+        }
+    };
+
+    struct Profile{
+        // For each operator, the histograms of the levels shifted by one (index 0 is for level -1)
+        std::array<std::vector<Histogram>, NbOperators> histograms;
+
+        void add(const long int inOperator, const long int inLevel, const long int inSize, const CycleType inCycles){
+            std::vector<Histogram>& levels = histograms[inOperator];
+            if(static_cast<long int>(levels.size()) <= inLevel+1){
+                levels.resize(inLevel+2);
+            }
+            levels[inLevel+1].add(inSize, inCycles);
+        }
+
+        // Returns an empty histogram if nothing has been recorded
+        Histogram getHistogram(const long int inOperator, const long int inLevel) const{
+            const std::vector<Histogram>& levels = histograms[inOperator];
+            if(inLevel+1 < static_cast<long int>(levels.size())){
+                return levels[inLevel+1];
+            }
+            return Histogram();
+        }
+
+        Bin getTotal(const long int inOperator) const{
+            Bin total;
+            for(const Histogram& histogram : histograms[inOperator]){
+                total.merge(histogram.getTotal());
+            }
+            return total;
+        }
+
+        static Profile Reduce(const Profile& inOther1, const Profile& inOther2){
+            Profile result = inOther1;
+            for(long int idxOperator = 0 ; idxOperator < NbOperators ; ++idxOperator){
+                std::vector<Histogram>& levels = result.histograms[idxOperator];
+                const std::vector<Histogram>& otherLevels = inOther2.histograms[idxOperator];
+                if(levels.size() < otherLevels.size()){
+                    levels.resize(otherLevels.size());
+                }
+                for(long int idxLevel = 0 ; idxLevel < static_cast<long int>(otherLevels.size()) ; ++idxLevel){
+                    levels[idxLevel].merge(otherLevels[idxLevel]);
+                }
+            }
+            return result;
+        }
+
+        // One line per operator, level and non-empty bin
+        template <class StreamClass>
+        void writeCsv(StreamClass& output) const{
+            output << "operator,level,min_size,max_size,calls,sum_sizes,sum_cycles,min_cycles,max_cycles\n";
+            for(long int idxOperator = 0 ; idxOperator < NbOperators ; ++idxOperator){
+                const std::vector<Histogram>& levels = histograms[idxOperator];
+                for(long int idxLevel = 0 ; idxLevel < static_cast<long int>(levels.size()) ; ++idxLevel){
+                    const std::vector<Bin>& bins = levels[idxLevel].bins;
+                    for(long int idxBin = 0 ; idxBin < static_cast<long int>(bins.size()) ; ++idxBin){
+                        if(bins[idxBin].nbCalls){
+                            output << GetOperatorName(idxOperator) << "," << idxLevel-1 << ","
+                                   << Histogram::GetBinMinSize(idxBin) << "," << Histogram::GetBinMaxSize(idxBin) << ","
+                                   << bins[idxBin].nbCalls << "," << bins[idxBin].sumSizes << ","
+                                   << bins[idxBin].sumCycles << "," << bins[idxBin].minCycles << ","
+                                   << bins[idxBin].maxCycles << "\n";
+                        }
+                    }
+                }
+            }
+        }
+
+        template <class StreamClass>
+        friend StreamClass& operator<<(StreamClass& output, const Profile& inProfile){
+            output << "Profile (" << &inProfile << ") :\n";
+            for(long int idxOperator = 0 ; idxOperator < NbOperators ; ++idxOperator){
+                const Bin total = inProfile.getTotal(idxOperator);
+                output << " - " << GetOperatorName(idxOperator) << " : " << total.nbCalls << " calls, "
+                       << TbfCycleCounter::CyclesToSeconds(total.sumCycles) << "s";
+                if(total.nbCalls){
+                    output << " (" << double(total.sumCycles)/double(total.nbCalls) << " cycles per call, "
+                           << (total.sumSizes ? double(total.sumCycles)/double(total.sumSizes) : 0.) << " cycles per size unit)";
+                }
+                output << "\n";
+            }
+            return output;
+        }
+    };
+
+    using ReduceType = Profile;
+
+private:
+    Profile profile;
+
+public:
+    using RealKernel::RealKernel;
+
+    template <class CellSymbolicData, class ParticlesClass, class LeafClass>
+    void P2M(const CellSymbolicData& inLeafIndex, const long int particlesIndexes[],
+             const ParticlesClass& inParticles, const long int inNbParticles, LeafClass& inOutLeaf) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::P2M(inLeafIndex, particlesIndexes, inParticles, inNbParticles, inOutLeaf);
+        profile.add(P2M_OP, -1, inNbParticles, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class CellSymbolicData,class CellClassContainer, class CellClass>
+    void M2M(const CellSymbolicData& inCellIndex,
+             const long int inLevel, const CellClassContainer& inLowerCell, CellClass& inOutUpperCell,
+             const long int childrenPos[], const long int inNbChildren) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::M2M(inCellIndex, inLevel, inLowerCell, inOutUpperCell, childrenPos, inNbChildren);
+        profile.add(M2M_OP, inLevel, inNbChildren, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class CellSymbolicData,class CellClassContainer, class CellClass>
+    void M2L(const CellSymbolicData& inTargetIndex,
+             const long int inLevel, const CellClassContainer& inInteractingCells, const long int neighPos[], const long int inNbNeighbors,
+             CellClass& inOutCell) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::M2L(inTargetIndex, inLevel, inInteractingCells, neighPos, inNbNeighbors, inOutCell);
+        profile.add(M2L_OP, inLevel, inNbNeighbors, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    // Only available if the real kernel has it
+    template <class M2LBatchClass, class RealKernelClass = RealKernel>
+    auto M2LBatch(const long int inLevel, M2LBatchClass& inBatch)
+            -> decltype(std::declval<RealKernelClass&>().M2LBatch(inLevel, inBatch)) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::M2LBatch(inLevel, inBatch);
+        profile.add(M2L_OP, inLevel, inBatch.size(), TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class CellSymbolicData,class CellClass, class CellClassContainer>
+    void L2L(const CellSymbolicData& inParentIndex,
+             const long int inLevel, const CellClass& inUpperCell, CellClassContainer& inOutLowerCell,
+             const long int childrednPos[], const long int inNbChildren) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::L2L(inParentIndex, inLevel, inUpperCell, inOutLowerCell, childrednPos, inNbChildren);
+        profile.add(L2L_OP, inLevel, inNbChildren, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class CellSymbolicData,class LeafClass, class ParticlesClassValues, class ParticlesClassRhs>
+    void L2P(const CellSymbolicData& inLeafIndex,
+             const LeafClass& inLeaf, const long int particlesIndexes[],
+             const ParticlesClassValues& inOutParticles, ParticlesClassRhs& inOutParticlesRhs,
+             const long int inNbParticles) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::L2P(inLeafIndex, inLeaf, particlesIndexes, inOutParticles, inOutParticlesRhs, inNbParticles);
+        profile.add(L2P_OP, -1, inNbParticles, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class LeafSymbolicData,class ParticlesClassValues, class ParticlesClassRhs>
+    void P2P(const LeafSymbolicData& inNeighborIndex, const long int neighborsIndexes[],
+             const ParticlesClassValues& inParticlesNeighbors, ParticlesClassRhs& inParticlesNeighborsRhs,
+             const long int inNbParticlesNeighbors,
+             const LeafSymbolicData& inParticlesIndex, const long int targetIndexes[], const ParticlesClassValues& inOutParticles,
+             ParticlesClassRhs& inOutParticlesRhs, const long int inNbOutParticles,
+             const long arrayIndexSrc) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::P2P(inNeighborIndex, neighborsIndexes, inParticlesNeighbors, inParticlesNeighborsRhs, inNbParticlesNeighbors, inParticlesIndex,
+                        targetIndexes, inOutParticles, inOutParticlesRhs, inNbOutParticles, arrayIndexSrc);
+        profile.add(P2P_OP, -1, inNbParticlesNeighbors*inNbOutParticles, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class LeafSymbolicDataSource, class ParticlesClassValuesSource, class LeafSymbolicDataTarget, class ParticlesClassValuesTarget, class ParticlesClassRhs>
+    void P2PTsm(const LeafSymbolicDataSource& inNeighborIndex, const long int neighborsIndexes[],
+             const ParticlesClassValuesSource& inParticlesNeighbors,
+             const long int inNbParticlesNeighbors,
+             const LeafSymbolicDataTarget& inParticlesIndex, const long int targetIndexes[],
+             const ParticlesClassValuesTarget& inOutParticles,
+             ParticlesClassRhs& inOutParticlesRhs, const long int inNbOutParticles,
+             const long arrayIndexSrc) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::P2PTsm(inNeighborIndex, neighborsIndexes, inParticlesNeighbors, inNbParticlesNeighbors, inParticlesIndex,
+                           targetIndexes, inOutParticles, inOutParticlesRhs, inNbOutParticles, arrayIndexSrc);
+        profile.add(P2P_OP, -1, inNbParticlesNeighbors*inNbOutParticles, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    template <class LeafSymbolicData,class ParticlesClassValues, class ParticlesClassRhs>
+    void P2PInner(const LeafSymbolicData& inLeafIndex, const long int targetIndexes[],
+                  const ParticlesClassValues& inOutParticles,
+                  ParticlesClassRhs& inOutParticlesRhs, const long int inNbOutParticles) {
+        const CycleType startCycles = TbfCycleCounter::GetCycles();
+        RealKernel::P2PInner(inLeafIndex, targetIndexes, inOutParticles, inOutParticlesRhs, inNbOutParticles);
+        profile.add(P2PInner_OP, -1, inNbOutParticles*inNbOutParticles - inNbOutParticles, TbfCycleCounter::GetCycles() - startCycles);
+    }
+
+    void reset(){
+        profile = Profile();
+    }
+
+    const Profile& getReduceData() const{
+        return profile;
+    }
+
+    static Profile Reduce(const ReduceType& inOther1, const ReduceType& inOther2){
+        return Profile::Reduce(inOther1, inOther2);
+    }
+};
+
+#endif
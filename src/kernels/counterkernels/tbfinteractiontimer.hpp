@@ -5,6 +5,8 @@
 
 #include "utils/tbftimer.hpp"
 
+#include <utility>
+
 template <class RealKernel>
 class TbfInteractionTimer : public RealKernel {
 public:
@@ -77,6 +79,15 @@ public:
         counters.M2L.stop();
     }
 
+    // Only available if the real kernel has it
+    template <class M2LBatchClass, class RealKernelClass = RealKernel>
+    auto M2LBatch(const long int inLevel, M2LBatchClass& inBatch)
+            -> decltype(std::declval<RealKernelClass&>().M2LBatch(inLevel, inBatch)) {
+        counters.M2L.start();
+        RealKernel::M2LBatch(inLevel, inBatch);
+        counters.M2L.stop();
+    }
+
     template <class CellSymbolicData,class CellClass, class CellClassContainer>
     void L2L(const CellSymbolicData& inParentIndex,
              const long int inLevel, const CellClass& inUpperCell, CellClassContainer& inOutLowerCell,
@@ -116,10 +127,10 @@ public:
              const LeafSymbolicDataTarget& inParticlesIndex, const long int targetIndexes[],
              const ParticlesClassValuesTarget& inOutParticles,
              ParticlesClassRhs& inOutParticlesRhs, const long int inNbOutParticles,
-             const long arrayIndexSrc) const {
+             const long arrayIndexSrc) {
         counters.P2P.start();
-        RealKernel::P2P(inNeighborIndex, inParticlesNeighbors, neighborsIndexes, inNbParticlesNeighbors, inParticlesIndex,
-                        targetIndexes, inOutParticles, inOutParticlesRhs, inNbOutParticles, arrayIndexSrc);
+        RealKernel::P2PTsm(inNeighborIndex, neighborsIndexes, inParticlesNeighbors, inNbParticlesNeighbors, inParticlesIndex,
+                           targetIndexes, inOutParticles, inOutParticlesRhs, inNbOutParticles, arrayIndexSrc);
         counters.P2P.stop();
     }
 
@@ -141,7 +152,7 @@ public:
     }
 
     static Timers Reduce(const ReduceType& inOther1, const ReduceType& inOther2){
-        return Timers::Reduce(inOther1.counters, inOther2.counters);
+        return Timers::Reduce(inOther1, inOther2);
     }
 };
 
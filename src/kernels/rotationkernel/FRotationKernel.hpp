@@ -4,6 +4,7 @@
 
 #include "tbfglobal.hpp"
 #include <complex>
+#include <algorithm>
 
 #include "FSpherical.hpp"
 #include "FSmartPointer.hpp"
@@ -59,6 +60,10 @@ private:
     static const int SizeArray = ((P+2)*(P+1))/2;
     //< To have P*2 where needed
     static const int P2 = P*2;
+    //< Number of M2L pairs with the same relative position processed together in M2LBatch
+    static const int M2LBlockSize = 8;
+    //< Number of particles processed together (one per SIMD lane) in P2M and L2P
+    static const int ParticlesBlockSize = 16;
 
     ///////////////////////////////////////////////////////
     // Object attributes
@@ -72,6 +77,9 @@ private:
     const RealType widthAtLeafLevelDiv2;   //< width of box at leaf leve div 2
     const std::array<RealType,3> boxCorner;             //< position of the box corner
 
+    FP2PR::Precision p2pPrecision;         //< The precision of the P2P (native or mixed)
+    bool p2pTiling;                        //< To process the sources of the P2P by tiles (native precision only)
+
     RealType factorials[P2+1];             //< This contains the factorial until 2*P+1
 
     ///////////// Translation /////////////////////////////
@@ -803,6 +811,101 @@ private:
         }
     }
 
+    /** Same as computeLegendre for a block of particles,
+      * legendre[atLm(l,m)][idxPart] => P{l,m} of particle idxPart
+      */
+    static void computeLegendreBlock(RealType legendre[][ParticlesBlockSize], const RealType inCosTheta[],
+                                     const RealType inSinTheta[]) {
+        #pragma omp simd
+        for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+            legendre[0][idxPart] = 1.0;                   // P_0,0(1) = 1
+            legendre[1][idxPart] = inCosTheta[idxPart];   // P_1,0 = cos(theta)
+            legendre[2][idxPart] = -inSinTheta[idxPart];  // P_1,1 = -sin(theta)
+        }
+
+        int index_l1_m1 = 0; // P{l-2,m} starts with P_{0,0}
+        int index_l1_m  = 1; // P{l-1,m} starts with P_{1,0}
+        int index_lm  = 3;   // P{l,m} starts with P_{2,0}
+
+        RealType l2_minus_1 = 3; // 2 * l - 1
+        RealType fl = RealType(2.0);// To get 'l' as a float
+        for(int l = 2; l <= P ; ++l, ++fl ){
+            RealType lm_minus_1 = fl - RealType(1.0); // l + m - 1
+            RealType l_minus_m = fl;               // l - m
+            for( int m = 0; m < l - 1 ; ++m ){
+                #pragma omp simd
+                for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                    legendre[index_lm][idxPart] = (l2_minus_1 * inCosTheta[idxPart] * legendre[index_l1_m][idxPart]
+                                                   - lm_minus_1 * legendre[index_l1_m1][idxPart]) / l_minus_m;
+                }
+                ++index_lm;
+                ++index_l1_m;
+                ++index_l1_m1;
+                lm_minus_1 += RealType(1.0);
+                l_minus_m -= RealType(1.0);
+            }
+            #pragma omp simd
+            for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                // P_{l,l-1} = (2l-1) cos( \theta ) P_{l-1,l-1}
+                legendre[index_lm][idxPart] = l2_minus_1 * inCosTheta[idxPart] * legendre[index_l1_m][idxPart];
+                // P_{l,l} = (2l-1) sin( \theta ) P_{l-1,l-1}
+                legendre[index_lm+1][idxPart] = -l2_minus_1 * inSinTheta[idxPart] * legendre[index_l1_m][idxPart];
+            }
+            index_lm += 2;
+            // goto P_{l-1,0}
+            ++index_l1_m;
+            l2_minus_1 += RealType(2.0); // 2 * l - 1 => progress by two
+        }
+    }
+
+    /** Load a block of particles relatively to the cell center and compute
+      * the spherical coordinates as in FSpherical, with cos/sin(phi) = (x,y)/sqrt(x^2+y^2)
+      * instead of atan2.
+      * Then, angles[m] = exp(i (m phi + m PI/2)) is obtained by recurrence.
+      * The missing particles of the last block are copies of the first one.
+      */
+    static void computeSphericalBlock(const std::array<RealType,3>& cellPosition, const RealType*const positions[3],
+                                      const long int inFirstParticle, const int inNbParticlesInBlock,
+                                      RealType outR[], RealType outCosTheta[], RealType outSinTheta[],
+                                      RealType outCosPhi[], RealType outSinPhi[],
+                                      RealType outAnglesReal[][ParticlesBlockSize], RealType outAnglesImag[][ParticlesBlockSize]) {
+        RealType relativePosition[3][ParticlesBlockSize];
+        for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+            for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                const long int idxSrc = inFirstParticle + (idxPart < inNbParticlesInBlock ? idxPart : 0);
+                relativePosition[idxDim][idxPart] = positions[idxDim][idxSrc] - cellPosition[idxDim];
+            }
+        }
+
+        #pragma omp simd
+        for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+            const RealType x = relativePosition[0][idxPart];
+            const RealType y = relativePosition[1][idxPart];
+            const RealType z = relativePosition[2][idxPart];
+            const RealType x2y2 = x*x + y*y;
+            const RealType r = std::sqrt(x2y2 + z*z);
+            const RealType sqrtX2Y2 = std::sqrt(x2y2);
+            outR[idxPart] = r;
+            outCosTheta[idxPart] = z / r;
+            outSinTheta[idxPart] = sqrtX2Y2 / r;
+            outCosPhi[idxPart] = (x2y2 != 0 ? x / sqrtX2Y2 : RealType(1));
+            outSinPhi[idxPart] = (x2y2 != 0 ? y / sqrtX2Y2 : RealType(0));
+            outAnglesReal[0][idxPart] = 1;
+            outAnglesImag[0][idxPart] = 0;
+        }
+
+        // exp(i (m phi + m PI/2)) = exp(i ((m-1) phi + (m-1) PI/2)) x (-sin(phi) + i cos(phi))
+        for(int m = 1 ; m <= P ; ++m){
+            #pragma omp simd
+            for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                outAnglesReal[m][idxPart] = -outAnglesReal[m-1][idxPart] * outSinPhi[idxPart]
+                                            - outAnglesImag[m-1][idxPart] * outCosPhi[idxPart];
+                outAnglesImag[m][idxPart] = outAnglesReal[m-1][idxPart] * outCosPhi[idxPart]
+                                            - outAnglesImag[m-1][idxPart] * outSinPhi[idxPart];
+            }
+        }
+    }
+
     ///////////////////////////////////////////////////////
     // Multiplication for rotation
     // Here we have two function that are optimized
@@ -864,6 +967,86 @@ private:
         }
     }
 
+    ///////////////////////////////////////////////////////
+    // Same operations for a block of M2LBlockSize vectors.
+    // A block stores for each coefficient index_lm the M2LBlockSize real
+    // parts followed by the M2LBlockSize imaginary parts, such that
+    // each coefficient is applied to all the vectors of the block at once.
+    ///////////////////////////////////////////////////////
+
+    /** Same as RotationYWithDlmk but from src to dest */
+    static void RotationYWithDlmkBlock(RealType dest[], const RealType src[], const RealType* dlmkCoef){
+        int index_lm = 0;
+        for(int l = 0 ; l <= P ; ++l){
+            const RealType*const srcAtL0 = src + (index_lm * 2 * M2LBlockSize);
+            for(int m = 0 ; m <= l ; ++m, ++index_lm ){
+                RealType*const destReal = dest + (index_lm * 2 * M2LBlockSize);
+                RealType*const destImag = destReal + M2LBlockSize;
+                const RealType* iterSrc = srcAtL0;
+                { // for k == 0
+                    const RealType coef = (*dlmkCoef++);
+                    for(int idxVec = 0 ; idxVec < M2LBlockSize ; ++idxVec){
+                        destReal[idxVec] = coef * iterSrc[idxVec];
+                        destImag[idxVec] = coef * iterSrc[M2LBlockSize + idxVec];
+                    }
+                    iterSrc += 2 * M2LBlockSize;
+                }
+                for(int k = 1 ; k <= l ; ++k){
+                    const RealType coefReal = (*dlmkCoef++);
+                    const RealType coefImag = (*dlmkCoef++);
+                    for(int idxVec = 0 ; idxVec < M2LBlockSize ; ++idxVec){
+                        destReal[idxVec] += coefReal * iterSrc[idxVec];
+                        destImag[idxVec] += coefImag * iterSrc[M2LBlockSize + idxVec];
+                    }
+                    iterSrc += 2 * M2LBlockSize;
+                }
+            }
+        }
+    }
+
+    /** Same as RotationZVectorsMul, block[:] *= src[:] */
+    static void RotationZVectorsMulBlock(RealType block[], const std::complex<RealType>* src){
+        for(int index_lm = 0 ; index_lm < SizeArray ; ++index_lm){
+            RealType*const blockReal = block + (index_lm * 2 * M2LBlockSize);
+            RealType*const blockImag = blockReal + M2LBlockSize;
+            const RealType srcReal = src[index_lm].real();
+            const RealType srcImag = src[index_lm].imag();
+            for(int idxVec = 0 ; idxVec < M2LBlockSize ; ++idxVec){
+                const RealType real = blockReal[idxVec];
+                blockReal[idxVec] = real * srcReal - blockImag[idxVec] * srcImag;
+                blockImag[idxVec] = real * srcImag + blockImag[idxVec] * srcReal;
+            }
+        }
+    }
+
+    /** The transfer of the M2L from w (src) to u (dest) */
+    void M2LTransferBlock(RealType dest[], const RealType src[], const RealType*const coef) const {
+        int index_lm = 0;
+        for(int l = 0 ; l <= P ; ++l ){
+            RealType minus_1_pow_m = 1.0;
+            for(int m = 0 ; m <= l ; ++m, ++index_lm ){
+                RealType*const destReal = dest + (index_lm * 2 * M2LBlockSize);
+                RealType*const destImag = destReal + M2LBlockSize;
+                for(int idxVec = 0 ; idxVec < M2LBlockSize ; ++idxVec){
+                    destReal[idxVec] = 0;
+                    destImag[idxVec] = 0;
+                }
+                int index_jl = m + l;
+                int index_jm = atLm(m,m);
+                for(int j = m ; j <= P-l ; ++j, ++index_jl, index_jm += j ){
+                    const RealType factor = minus_1_pow_m * coef[index_jl];
+                    const RealType*const srcReal = src + (index_jm * 2 * M2LBlockSize);
+                    const RealType*const srcImag = srcReal + M2LBlockSize;
+                    for(int idxVec = 0 ; idxVec < M2LBlockSize ; ++idxVec){
+                        destReal[idxVec] += factor * srcReal[idxVec];
+                        destImag[idxVec] -= factor * srcImag[idxVec];
+                    }
+                }
+                minus_1_pow_m = -minus_1_pow_m;
+            }
+        }
+    }
+
     ///////////////////////////////////////////////////////
     // Utils
     ///////////////////////////////////////////////////////
@@ -903,7 +1086,9 @@ public:
         treeHeight(int(inConfiguration.getTreeHeight())),
         widthAtLeafLevel(inConfiguration.getLeafWidths()[0]),
         widthAtLeafLevelDiv2(widthAtLeafLevel/2),
-        boxCorner(inConfiguration.getBoxCorner())
+        boxCorner(inConfiguration.getBoxCorner()),
+        p2pPrecision(FP2PR::Precision::Native),
+        p2pTiling(false)
     {
         // simply does the precomputation
         precomputeFactorials();
@@ -918,7 +1103,9 @@ public:
         treeHeight(other.treeHeight),
         widthAtLeafLevel(other.widthAtLeafLevel),
         widthAtLeafLevelDiv2(other.widthAtLeafLevelDiv2),
-        boxCorner(other.boxCorner)
+        boxCorner(other.boxCorner),
+        p2pPrecision(other.p2pPrecision),
+        p2pTiling(other.p2pTiling)
     {
         // simply does the precomputation
         precomputeFactorials();
@@ -930,6 +1117,25 @@ public:
     virtual ~FRotationKernel(){
     }
 
+    /** The precision of the P2P, it must be set before the kernel is given to an algorithm */
+    void setP2PPrecision(const FP2PR::Precision inPrecision){
+        p2pPrecision = inPrecision;
+    }
+
+    FP2PR::Precision getP2PPrecision() const{
+        return p2pPrecision;
+    }
+
+    /** The tiling of the sources of the P2P (see FP2PRSimd::FullMutual), it is disabled by default
+      * and it must be set before the kernel is given to an algorithm */
+    void setP2PTiling(const bool inUseTiling){
+        p2pTiling = inUseTiling;
+    }
+
+    bool getP2PTiling() const{
+        return p2pTiling;
+    }
+
     /** P2M
       * The computation is based on the paper :
       * Parallelization of the fast multipole method
@@ -954,55 +1160,58 @@ public:
     void P2M(const CellSymbolicData& LeafIndex,  const long int /*particlesIndexes*/[],
              const ParticlesClass& SourceParticles, const long int inNbParticles, LeafClass& LeafCell)
     {
-        const RealType i_pow_m[4] = {0, PIDiv2, PI, -PIDiv2};
         // w is the multipole moment
         std::complex<RealType>* const w = &LeafCell[0];
 
         // Copying the position is faster than using cell position
         const std::array<RealType,SpaceIndexType_T::Dim> cellPosition = getLeafCenter(LeafIndex.boxCoord);
 
-        // We need a legendre array
-        RealType legendre[SizeArray];
-        RealType angles[P+1][2];
-
         // For all particles in the leaf box
         const RealType*const physicalValues = SourceParticles[3]; // pointer to contiguously allocated physical parameters (other than coordinates) 
-        const RealType*const positionsX = SourceParticles[0]; // x-coordinate
-        const RealType*const positionsY = SourceParticles[1]; // y-coordinate
-        const RealType*const positionsZ = SourceParticles[2]; // z-coordinate
-
-        for(unsigned long long idxPart = 0 ; idxPart < inNbParticles ; ++ idxPart){
-            // P2M is given with respect to the cell center
-            const std::array<RealType,SpaceIndexType_T::Dim> relativePosition{{positionsX[idxPart] - cellPosition[0],
-                                                   positionsY[idxPart] - cellPosition[1],
-                                                   positionsZ[idxPart] - cellPosition[2]}};
-            const FSpherical<RealType> sph(relativePosition);
-
-            // The physical value (charge, mass)
-            const RealType q = physicalValues[idxPart];
-            // The distance between the SH and the particle
-            const RealType a = sph.getR();
-
-            // Compute the legendre polynomial
-            computeLegendre(legendre, sph.getCosTheta(), sph.getSinTheta());
+        const RealType*const positions[3] = {SourceParticles[0], SourceParticles[1], SourceParticles[2]};
+
+        // The particles are processed by blocks, with one particle per SIMD lane
+        RealType a[ParticlesBlockSize];
+        RealType cosTheta[ParticlesBlockSize];
+        RealType sinTheta[ParticlesBlockSize];
+        RealType cosPhi[ParticlesBlockSize];
+        RealType sinPhi[ParticlesBlockSize];
+        RealType anglesReal[P+1][ParticlesBlockSize];
+        RealType anglesImag[P+1][ParticlesBlockSize];
+        RealType legendre[SizeArray][ParticlesBlockSize];
+        RealType q_aPowL[ParticlesBlockSize];
+
+        for(long int idxBlock = 0 ; idxBlock < inNbParticles ; idxBlock += ParticlesBlockSize){
+            const int nbParticlesInBlock = int(std::min(long(ParticlesBlockSize), inNbParticles - idxBlock));
+
+            computeSphericalBlock(cellPosition, positions, idxBlock, nbParticlesInBlock,
+                                  a, cosTheta, sinTheta, cosPhi, sinPhi, anglesReal, anglesImag);
+            computeLegendreBlock(legendre, cosTheta, sinTheta);
+
+            // The copies of the first particle have no charge
+            for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                q_aPowL[idxPart] = (idxPart < nbParticlesInBlock ? physicalValues[idxBlock + idxPart] : RealType(0));
+            }
 
             // w{l,m}(q,a) = q a^l/(l+|m|)! P{l,m}(cos(alpha)) exp(-i m Beta)
-            RealType q_aPowL = q; // To consutrct q*a^l continously
             int index_l_m = 0; // To construct the index of (l,m) continously
-            RealType fl = 0.0;
-            for(int l = 0 ; l <= P ; ++l, ++fl ){
-                { // We need to compute the angles to use in the "m" loop
-                    // So we can compute only the one needed after "l" inc
-                    const RealType angle = fl * sph.getPhi() + i_pow_m[l & 0x3];
-                    angles[l][0] = std::cos(angle);
-                    angles[l][1] = std::sin(angle);
-                }
+            for(int l = 0 ; l <= P ; ++l){
                 for(int m = 0 ; m <= l ; ++m, ++index_l_m){
-                    const RealType magnitude = q_aPowL * legendre[index_l_m] / factorials[l+m];
-                    w[index_l_m].real(w[index_l_m].real() + magnitude * angles[m][0]);
-                    w[index_l_m].imag(w[index_l_m].imag() + magnitude * angles[m][1]);
+                    RealType sumReal = 0;
+                    RealType sumImag = 0;
+                    #pragma omp simd reduction(+:sumReal,sumImag)
+                    for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                        const RealType magnitude = q_aPowL[idxPart] * legendre[index_l_m][idxPart];
+                        sumReal += magnitude * anglesReal[m][idxPart];
+                        sumImag += magnitude * anglesImag[m][idxPart];
+                    }
+                    w[index_l_m].real(w[index_l_m].real() + sumReal / factorials[l+m]);
+                    w[index_l_m].imag(w[index_l_m].imag() + sumImag / factorials[l+m]);
+                }
+                #pragma omp simd
+                for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                    q_aPowL[idxPart] *= a[idxPart];
                 }
-                q_aPowL *= a;
             }
         }
     }
@@ -1121,6 +1330,62 @@ public:
         }
     }
 
+    /** M2L for all the interactions of a group
+      * The pairs are bucketed by relative position (which gives the rotation
+      * matrices and the transfer coefficients), and each bucket is processed by
+      * blocks of M2LBlockSize pairs such that the rotations and the transfer
+      * are matrix-matrix products instead of matrix-vector products.
+      */
+    template <class M2LBatchClass>
+    void M2LBatch(const long int inLevel, M2LBatchClass& inBatch) {
+        inBatch.groupByInteractionIndex(343);
+        inBatch.applyPerInteractionIndex([&](const long int inNeighPos, const auto* inInteractions, const long int inNbInteractions){
+            const RealType*const coef = M2LTranslationCoef[inLevel][inNeighPos];
+
+            RealType blockW[2 * SizeArray * M2LBlockSize];
+            RealType blockU[2 * SizeArray * M2LBlockSize];
+
+            for(long int idxFirst = 0 ; idxFirst < inNbInteractions ; idxFirst += M2LBlockSize){
+                const int nbInBlock = int(std::min(long(M2LBlockSize), inNbInteractions - idxFirst));
+
+                // Copy the multipole data into the block (the unused columns are set to zero)
+                for(int index_lm = 0 ; index_lm < SizeArray ; ++index_lm){
+                    RealType*const blockReal = blockW + (index_lm * 2 * M2LBlockSize);
+                    RealType*const blockImag = blockReal + M2LBlockSize;
+                    for(int idxVec = 0 ; idxVec < nbInBlock ; ++idxVec){
+                        const std::complex<RealType> value = (*inInteractions[idxFirst + idxVec].source)[index_lm];
+                        blockReal[idxVec] = value.real();
+                        blockImag[idxVec] = value.imag();
+                    }
+                    for(int idxVec = nbInBlock ; idxVec < M2LBlockSize ; ++idxVec){
+                        blockReal[idxVec] = 0;
+                        blockImag[idxVec] = 0;
+                    }
+                }
+
+                // Rotate
+                RotationZVectorsMulBlock(blockW, rotationM2LExpMinusImPhi[inNeighPos]);
+                RotationYWithDlmkBlock(blockU, blockW, DlmkCoefM2LOTheta[inNeighPos]);
+
+                // Transfer to u
+                M2LTransferBlock(blockW, blockU, coef);
+
+                // Rotate it back
+                RotationYWithDlmkBlock(blockU, blockW, DlmkCoefM2LMMinusTheta[inNeighPos]);
+                RotationZVectorsMulBlock(blockU, rotationM2LExpMinusImPhi[inNeighPos]);
+
+                // Sum
+                for(int idxVec = 0 ; idxVec < nbInBlock ; ++idxVec){
+                    auto& target = (*inInteractions[idxFirst + idxVec].target);
+                    for(int index_lm = 0 ; index_lm < SizeArray ; ++index_lm){
+                        const RealType*const blockReal = blockU + (index_lm * 2 * M2LBlockSize);
+                        target[index_lm] += std::complex<RealType>(blockReal[idxVec], blockReal[M2LBlockSize + idxVec]);
+                    }
+                }
+            }
+        });
+    }
+
     /** L2L
       * The operator C has been taken from :
       * Implementation of rotation-based operators for Fast Multipole Method in X10
@@ -1199,7 +1464,6 @@ public:
              const LeafClass& LeafCell, const long int /*particlesIndexes*/[],
              const ParticlesClass& inOutParticles, ParticlesClassRhs& inOutParticlesRhs,
              const long int inNbParticles) {
-        const RealType i_pow_m[4] = {0, PIDiv2, PI, -PIDiv2};
         // Take the local value from the cell
         const std::complex<RealType>* const u = &LeafCell[0];
 
@@ -1208,147 +1472,135 @@ public:
 
         // For all particles in the leaf box
         const RealType*const physicalValues = inOutParticles[3];
-        const RealType*const positionsX = inOutParticles[0];
-        const RealType*const positionsY = inOutParticles[1];
-        const RealType*const positionsZ = inOutParticles[2];
+        const RealType*const positions[3] = {inOutParticles[0], inOutParticles[1], inOutParticles[2]};
         RealType*const forcesX = inOutParticlesRhs[0];
         RealType*const forcesY = inOutParticlesRhs[1];
         RealType*const forcesZ = inOutParticlesRhs[2];
         RealType*const potentials = inOutParticlesRhs[3];
 
-        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++ idxPart){
-            // L2P
-            const std::array<RealType,3> relativePosition{{positionsX[idxPart]-cellPosition[0],
-                                                   positionsY[idxPart]-cellPosition[1],
-                                                   positionsZ[idxPart]-cellPosition[2]}};
-            const FSpherical<RealType> sph(relativePosition);
-
-            // The distance between the SH and the particle
-            const RealType r = sph.getR();
-
-            // Compute the legendre polynomial
-            RealType legendre[SizeArray];
-            computeLegendre(legendre, sph.getCosTheta(), sph.getSinTheta());
+        RealType inverseFactorials[P2+1];
+        for(int idx = 0 ; idx <= P2 ; ++idx){
+            inverseFactorials[idx] = RealType(1) / factorials[idx];
+        }
 
-            // pre compute what is used more than once
-            RealType minus_r_pow_l_div_fact_lm[SizeArray];
-            RealType minus_r_pow_l_legendre_div_fact_lm[SizeArray];
-            {
-                int index_lm = 0;
-                RealType minus_r_pow_l = 1.0;  // To get (-1*r)^l
-                for(int l = 0 ; l <= P ; ++l){
-                    for(int m = 0 ; m <= l ; ++m, ++index_lm){
-                        minus_r_pow_l_div_fact_lm[index_lm] = minus_r_pow_l / factorials[l+m];
-                        minus_r_pow_l_legendre_div_fact_lm[index_lm] = minus_r_pow_l_div_fact_lm[index_lm] * legendre[index_lm];
-                    }
-                    minus_r_pow_l *= -r;
-                }
+        // The particles are processed by blocks, with one particle per SIMD lane
+        RealType r[ParticlesBlockSize];
+        RealType cosTheta[ParticlesBlockSize];
+        RealType sinTheta[ParticlesBlockSize];
+        RealType cosPhi[ParticlesBlockSize];
+        RealType sinPhi[ParticlesBlockSize];
+        RealType cos_m_phi_i_pow_m[P+1][ParticlesBlockSize];
+        RealType sin_m_phi_i_pow_m[P+1][ParticlesBlockSize];
+        RealType legendre[SizeArray][ParticlesBlockSize];
+
+        for(long int idxBlock = 0 ; idxBlock < inNbParticles ; idxBlock += ParticlesBlockSize){
+            const int nbParticlesInBlock = int(std::min(long(ParticlesBlockSize), inNbParticles - idxBlock));
+
+            computeSphericalBlock(cellPosition, positions, idxBlock, nbParticlesInBlock,
+                                  r, cosTheta, sinTheta, cosPhi, sinPhi, cos_m_phi_i_pow_m, sin_m_phi_i_pow_m);
+            computeLegendreBlock(legendre, cosTheta, sinTheta);
+
+            RealType Fr[ParticlesBlockSize] = {0};
+            RealType FO[ParticlesBlockSize] = {0};
+            RealType Fp[ParticlesBlockSize] = {0};
+            RealType magnitude[ParticlesBlockSize];
+            RealType minus_r_pow_l[ParticlesBlockSize]; // To get (-1*r)^l
+            RealType inverseSinTheta[ParticlesBlockSize];
+
+            #pragma omp simd
+            for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                // E = sum( l = 0:P, sum(m = -l:l, u{l,m} )), starts with l == 0
+                magnitude[idxPart] = u[0].real() * legendre[0][idxPart];
+                minus_r_pow_l[idxPart] = -r[idxPart];
+                inverseSinTheta[idxPart] = RealType(1) / sinTheta[idxPart];
             }
-            // pre compute what is use more than once
-            RealType cos_m_phi_i_pow_m[P+1];
-            RealType sin_m_phi_i_pow_m[P+1];
-            {
-                for(int m = 0 ; m <= P ; ++m){
-                    const RealType m_phi_i_pow_m = RealType(m) * sph.getPhi() + i_pow_m[m & 0x3];
-                    cos_m_phi_i_pow_m[m] = std::cos(m_phi_i_pow_m);
-                    sin_m_phi_i_pow_m[m] = std::sin(m_phi_i_pow_m);
-                }
-            }
-
-            // compute the forces
-            {
-                RealType Fr = 0;
-                RealType FO = 0;
-                RealType Fp = 0;
 
-                int index_lm = 1;          // To get atLm(l,m), warning starts with l = 1
-                RealType fl = 1.0;            // To get "l" as a float
+            int index_lm = 1;          // To get atLm(l,m), warning starts with l = 1
+            RealType fl = 1.0;            // To get "l" as a float
 
-                for(int l = 1 ; l <= P ; ++l, ++fl){
-                    // first m == 0
-                    {
-                        Fr += fl * u[index_lm].real() * minus_r_pow_l_legendre_div_fact_lm[index_lm];
-                    }
-                    {
-                        const RealType coef = minus_r_pow_l_div_fact_lm[index_lm] * (fl * (sph.getCosTheta()*legendre[index_lm]
-                                                                                        - legendre[index_lm-l]) / sph.getSinTheta());
-                        const RealType dI_real = coef;
+            for(int l = 1 ; l <= P ; ++l, ++fl){
+                // first m == 0
+                {
+                    const RealType u_real = u[index_lm].real();
+                    const RealType inverseFactorial = inverseFactorials[l];
+                    #pragma omp simd
+                    for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                        const RealType minus_r_pow_l_div_fact_lm = minus_r_pow_l[idxPart] * inverseFactorial;
+                        const RealType minus_r_pow_l_legendre_div_fact_lm = minus_r_pow_l_div_fact_lm * legendre[index_lm][idxPart];
+                        Fr[idxPart] += fl * u_real * minus_r_pow_l_legendre_div_fact_lm;
+                        const RealType dI_real = minus_r_pow_l_div_fact_lm * (fl * (cosTheta[idxPart]*legendre[index_lm][idxPart]
+                                                                                - legendre[index_lm-l][idxPart]) * inverseSinTheta[idxPart]);
                         // F(O) += 2 * Real(L dI/dO)
-                        FO += u[index_lm].real() * dI_real;
+                        FO[idxPart] += u_real * dI_real;
+                        magnitude[idxPart] += u_real * minus_r_pow_l_legendre_div_fact_lm;
                     }
-                    ++index_lm;
-                    // then 0 < m
-                    for(int m = 1 ; m <= l ; ++m, ++index_lm){
-                        {
-                            const RealType coef = minus_r_pow_l_legendre_div_fact_lm[index_lm];
-                            const RealType I_real = coef * cos_m_phi_i_pow_m[m];
-                            const RealType I_imag = coef * sin_m_phi_i_pow_m[m];
-                            // F(r) += 2 x l x Real(LI)
-                            Fr += 2 * fl * (u[index_lm].real() * I_real - u[index_lm].imag() * I_imag);
-                            // F(p) += -2 x m x Imag(LI)
-                            Fp -= 2 * RealType(m) * (u[index_lm].real() * I_imag + u[index_lm].imag() * I_real);
-                        }
-                        {
-                            const RealType legendre_l_minus_1 = (m == l) ? RealType(0.0) : RealType(l+m)*legendre[index_lm-l];
-                            const RealType coef = minus_r_pow_l_div_fact_lm[index_lm] * ((fl * sph.getCosTheta()*legendre[index_lm]
-                                                                                       - legendre_l_minus_1) / sph.getSinTheta());
-                            const RealType dI_real = coef * cos_m_phi_i_pow_m[m];
-                            const RealType dI_imag = coef * sin_m_phi_i_pow_m[m];
-                            // F(O) += 2 * Real(L dI/dO)
-                            FO += RealType(2.0) * (u[index_lm].real() * dI_real - u[index_lm].imag() * dI_imag);
-                        }
+                }
+                ++index_lm;
+                // then 0 < m
+                for(int m = 1 ; m <= l ; ++m, ++index_lm){
+                    const RealType u_real = u[index_lm].real();
+                    const RealType u_imag = u[index_lm].imag();
+                    const RealType inverseFactorial = inverseFactorials[l+m];
+                    const RealType fm = RealType(m);
+                    const RealType lm = (m == l) ? RealType(0.0) : RealType(l+m);
+                    const int index_l_minus_1 = (m == l) ? 0 : index_lm-l;
+                    #pragma omp simd
+                    for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                        const RealType minus_r_pow_l_div_fact_lm = minus_r_pow_l[idxPart] * inverseFactorial;
+                        const RealType coef = minus_r_pow_l_div_fact_lm * legendre[index_lm][idxPart];
+                        const RealType I_real = coef * cos_m_phi_i_pow_m[m][idxPart];
+                        const RealType I_imag = coef * sin_m_phi_i_pow_m[m][idxPart];
+                        const RealType uI_real = u_real * I_real - u_imag * I_imag;
+                        // F(r) += 2 x l x Real(LI)
+                        Fr[idxPart] += 2 * fl * uI_real;
+                        // F(p) += -2 x m x Imag(LI)
+                        Fp[idxPart] -= 2 * fm * (u_real * I_imag + u_imag * I_real);
+                        magnitude[idxPart] += RealType(2.0) * uI_real;
+
+                        const RealType legendre_l_minus_1 = lm * legendre[index_l_minus_1][idxPart];
+                        const RealType dcoef = minus_r_pow_l_div_fact_lm * ((fl * cosTheta[idxPart]*legendre[index_lm][idxPart]
+                                                                             - legendre_l_minus_1) * inverseSinTheta[idxPart]);
+                        const RealType dI_real = dcoef * cos_m_phi_i_pow_m[m][idxPart];
+                        const RealType dI_imag = dcoef * sin_m_phi_i_pow_m[m][idxPart];
+                        // F(O) += 2 * Real(L dI/dO)
+                        FO[idxPart] += RealType(2.0) * (u_real * dI_real - u_imag * dI_imag);
                     }
                 }
+                #pragma omp simd
+                for(int idxPart = 0 ; idxPart < ParticlesBlockSize ; ++idxPart){
+                    minus_r_pow_l[idxPart] *= -r[idxPart];
+                }
+            }
+
+            for(int idxPart = 0 ; idxPart < nbParticlesInBlock ; ++idxPart){
                 // div by r
-                Fr /= sph.getR();
-                FO /= sph.getR();
-                Fp /= sph.getR() * sph.getSinTheta();
+                const RealType Fr_r = Fr[idxPart] / r[idxPart];
+                const RealType FO_r = FO[idxPart] / r[idxPart];
+                const RealType Fp_r = Fp[idxPart] / (r[idxPart] * sinTheta[idxPart]);
 
-                // copy variable from spherical position
-                const RealType cosPhi     = std::cos(sph.getPhi());
-                const RealType sinPhi     = std::sin(sph.getPhi());
-                const RealType physicalValue = physicalValues[idxPart];
+                const RealType physicalValue = physicalValues[idxBlock + idxPart];
 
                 // compute forces
                 const RealType forceX = (
-                            cosPhi * sph.getSinTheta() * Fr  +
-                            cosPhi * sph.getCosTheta() * FO +
-                            (-sinPhi) * Fp) * physicalValue;
+                            cosPhi[idxPart] * sinTheta[idxPart] * Fr_r  +
+                            cosPhi[idxPart] * cosTheta[idxPart] * FO_r +
+                            (-sinPhi[idxPart]) * Fp_r) * physicalValue;
 
                 const RealType forceY = (
-                            sinPhi * sph.getSinTheta() * Fr  +
-                            sinPhi * sph.getCosTheta() * FO +
-                            cosPhi * Fp) * physicalValue;
+                            sinPhi[idxPart] * sinTheta[idxPart] * Fr_r  +
+                            sinPhi[idxPart] * cosTheta[idxPart] * FO_r +
+                            cosPhi[idxPart] * Fp_r) * physicalValue;
 
                 const RealType forceZ = (
-                            sph.getCosTheta() * Fr +
-                            (-sph.getSinTheta()) * FO) * physicalValue;
+                            cosTheta[idxPart] * Fr_r +
+                            (-sinTheta[idxPart]) * FO_r) * physicalValue;
 
                 // inc particles forces
-                forcesX[idxPart] += forceX;
-                forcesY[idxPart] += forceY;
-                forcesZ[idxPart] += forceZ;
-            }
-            // compute the potential
-            {
-                RealType magnitude = 0;
-                // E = sum( l = 0:P, sum(m = -l:l, u{l,m} ))
-                int index_lm = 0;
-                for(int l = 0 ; l <= P ; ++l ){
-                    {//for m == 0
-                        // (l-|m|)! * P{l,0} / r^(l+1)
-                        magnitude += u[index_lm].real() * minus_r_pow_l_legendre_div_fact_lm[index_lm];
-                        ++index_lm;
-                    }
-                    for(int m = 1 ; m <= l ; ++m, ++index_lm ){
-                        const RealType coef = minus_r_pow_l_legendre_div_fact_lm[index_lm];
-                        const RealType I_real = coef * cos_m_phi_i_pow_m[m];
-                        const RealType I_imag = coef * sin_m_phi_i_pow_m[m];
-                        magnitude += RealType(2.0) * ( u[index_lm].real() * I_real - u[index_lm].imag() * I_imag );
-                    }
-                }
+                forcesX[idxBlock + idxPart] += forceX;
+                forcesY[idxBlock + idxPart] += forceY;
+                forcesZ[idxBlock + idxPart] += forceZ;
                 // inc potential
-                potentials[idxPart] += magnitude;
+                potentials[idxBlock + idxPart] += magnitude[idxPart];
             }
         }
     }
@@ -1364,20 +1616,19 @@ public:
         if constexpr(SpaceIndexType::IsPeriodic){
             using PeriodicShifter = typename TbfPeriodicShifter<RealType, SpaceIndexType>::Neighbor;
             if(PeriodicShifter::NeedToShift(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc)){
-                const auto duplicateSources = PeriodicShifter::DuplicatePositionsAndApplyShift(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc,
-                                                                            inNeighbors, inNbParticlesNeighbors);
-                FP2PR::template FullMutual<RealType> ((duplicateSources),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
-                PeriodicShifter::FreePositions(duplicateSources);
+                // The shift is applied by the P2P, the sources are not duplicated
+                const auto sourcesShift = PeriodicShifter::GetShiftCoef(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc);
+                FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, sourcesShift, p2pTiling);
             }
             else{
-                FP2PR::template FullMutual<RealType> ((inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
+                FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, {}, p2pTiling);
             }
         }
         else{
-            FP2PR::template FullMutual<RealType> ((inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                                                       (inTargets), (inTargetsRhs), inNbOutParticles);
+            FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                                                       (inTargets), (inTargetsRhs), inNbOutParticles, {}, p2pTiling);
         }
     }
 
@@ -1392,19 +1643,17 @@ public:
         if constexpr(SpaceIndexType::IsPeriodic){
             using PeriodicShifter = typename TbfPeriodicShifter<RealType, SpaceIndexType>::Neighbor;
             if(PeriodicShifter::NeedToShift(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc)){
-                const auto duplicateSources = PeriodicShifter::DuplicatePositionsAndApplyShift(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc,
-                                                                            inNeighbors, inNbParticlesNeighbors);
-                FP2PR::template GenericFullRemote<RealType> ((duplicateSources), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
-                PeriodicShifter::FreePositions(duplicateSources);
+                const auto sourcesShift = PeriodicShifter::GetShiftCoef(inNeighborIndex, inTargetIndex, spaceIndexSystem, arrayIndexSrc);
+                FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, sourcesShift);
             }
             else{
-                FP2PR::template GenericFullRemote<RealType> ((inNeighbors), inNbParticlesNeighbors,
+                FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
                                                              (inTargets), (inTargetsRhs), inNbOutParticles);
             }
         }
         else{
-            FP2PR::template GenericFullRemote<RealType> ((inNeighbors), inNbParticlesNeighbors,
+            FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
                                                                                        (inTargets), (inTargetsRhs), inNbOutParticles);
         }
     }
@@ -1413,7 +1662,7 @@ public:
     void P2PInner(const LeafSymbolicData& /*inIndex*/, const long int /*indexes*/[],
                   const ParticlesClassValues& inTargets,
                   ParticlesClassRhs& inTargetsRhs, const long int inNbOutParticles) const {
-        FP2PR::template GenericInner<RealType>((inTargets),(inTargetsRhs), inNbOutParticles);
+        FP2PR::template GenericInner<RealType>(p2pPrecision, (inTargets),(inTargetsRhs), inNbOutParticles);
     }
 
 
@@ -16,6 +16,8 @@
 #ifndef FBLAS_HPP
 #define FBLAS_HPP
 
+#include <cstring>
+
 namespace FBlas {
 
 template <class Type>
@@ -19,6 +19,7 @@
 
 #include <iostream>
 #include <stdlib.h>
+#include <cstring>
 
 
 // for @class FDft only
@@ -17,6 +17,8 @@
 #define FINTERPMAPPING_HPP
 
 #include <limits>
+#include <array>
+#include <iostream>
 
 /**
  * @author Matthias Messner (matthias.matthias@inria.fr)
@@ -27,6 +27,8 @@
 
 #include "FBlas.hpp"
 
+#include <algorithm>
+
 
 
 /**
@@ -332,15 +334,20 @@ public:
   /**
    * Local to particle operation: application of \f$S_\ell(x,\bar x_m)\f$ and
    * \f$\nabla_x S_\ell(x,\bar x_m)\f$ (interpolation)
+   * Same result as applyL2P and applyL2PGradient, but the Lagrange polynomials
+   * and their derivatives are evaluated once and the local expansion is read once,
+   * for blocks of L2PBlockSize particles (the inner loops are over the particles).
    */
   template <class ContainerClass, class ContainerClassRhs>
   void applyL2PTotal(const std::array<FReal, Dim>& center,
                      const FReal width,
-                     const FReal * localExpansion,
+                     const FReal *const localExpansion,
                      const ContainerClass&& localParticles,
-                     ContainerClass&& localParticlesRhs,
+                     ContainerClassRhs&& localParticlesRhs,
                      const long int inNbParticles) const;
 
+  static constexpr int L2PBlockSize = 16;
+
   // PB: ORDER^6 version of applyM2M/L2L
   /*
     void applyM2M(const unsigned int ChildIndex,
@@ -672,4 +679,144 @@ inline void FUnifInterpolator<FReal, ORDER,MatrixKernelClass,NVALS>::applyL2PGra
 }
 
 
+
+/**
+ * Local to particle operation: application of \f$S_\ell(x,\bar x_m)\f$ and
+ * \f$\nabla_x S_\ell(x,\bar x_m)\f$ (interpolation)
+ */
+template <class FReal, int ORDER, class MatrixKernelClass, int NVALS>
+template <class ContainerClass,class ContainerClassRhs>
+inline void FUnifInterpolator<FReal, ORDER,MatrixKernelClass,NVALS>::applyL2PTotal(const std::array<FReal, Dim>& center,
+                                                                      const FReal width,
+                                                                      const FReal *const localExpansion,
+                                                                      const ContainerClass&& inParticles,
+                                                                      ContainerClassRhs&& inParticlesRhs,
+                                                                      const long int inNbParticles) const
+{
+  static_assert(Dim == 3, "Must be 3 here");
+  constexpr int BS = L2PBlockSize;
+
+  const map_glob_loc<FReal> map(center, width);
+  std::array<FReal, Dim> jacobian;
+  map.computeJacobian(jacobian);
+
+  // L_n(x) = scale_n * prod_{m!=n} t_m with t_m = (ORDER-1)(x+1) - 2m (see FUnifRoots::L)
+  FReal scale[ORDER];
+  for (unsigned int n=0; n<ORDER; ++n) {
+    const int omn = ORDER-int(n)-1;
+    scale[n] = FReal(omn%2 ? -1. : 1.)
+               / FReal(FMath::pow(FReal(2.),ORDER-1)*FMath::factorial<FReal>(int(n))*FMath::factorial<FReal>(omn));
+  }
+
+  FReal L_of_x[Dim][ORDER][BS];
+  FReal dL_of_x[Dim][ORDER][BS];
+
+  for(long int idxBlock = 0 ; idxBlock < inNbParticles ; idxBlock += BS){
+    const int nbInBlock = int(std::min(long(BS), inNbParticles-idxBlock));
+
+    // map global positions to [-1,1] (the padding particles are at the center)
+    FReal t[Dim][ORDER][BS];
+    for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+      std::array<FReal, Dim> localPosition = {{0, 0, 0}};
+      if(idxPart < nbInBlock){
+        std::array<FReal, Dim> globalPosition;
+        for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+          globalPosition[idxDim] = inParticles[idxDim][idxBlock+idxPart];
+        }
+        map(globalPosition, localPosition);
+      }
+      for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        // same clamp as FUnifRoots::L and dL (used by applyL2P and applyL2PGradient)
+        const FReal x = std::min(FReal(1.), std::max(FReal(-1.), localPosition[idxDim]));
+        for (unsigned int m=0; m<ORDER; ++m) {
+          t[idxDim][m][idxPart] = FReal(ORDER-1)*(x+FReal(1.)) - FReal(2.)*FReal(m);
+        }
+      }
+    }
+
+    // evaluate the Lagrange polynomials and their derivatives (d t_m / dx = ORDER-1)
+    for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+      for (unsigned int n=0; n<ORDER; ++n) {
+        FReal P[BS];
+        FReal dP[BS];
+        #pragma omp simd
+        for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+          P[idxPart] = FReal(1.);
+          dP[idxPart] = FReal(0.);
+        }
+        for (unsigned int m=0; m<ORDER; ++m) {
+          if(m != n){
+            #pragma omp simd
+            for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+              dP[idxPart] = dP[idxPart]*t[idxDim][m][idxPart] + P[idxPart]*FReal(ORDER-1);
+              P[idxPart] *= t[idxDim][m][idxPart];
+            }
+          }
+        }
+        #pragma omp simd
+        for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+          L_of_x[idxDim][n][idxPart] = scale[n]*P[idxPart];
+          dL_of_x[idxDim][n][idxPart] = scale[n]*dP[idxPart];
+        }
+      }
+    }
+
+    for(int idxLhs = 0 ; idxLhs < nLhs ; ++idxLhs){
+      for(int idxVals = 0 ; idxVals < nVals ; ++idxVals){
+        const FReal*const expansion = localExpansion + idxLhs*nVals*nnodes + idxVals*nnodes;
+
+        FReal potential[BS] = {0};
+        FReal forces[3][BS] = {{0}};
+
+        // sum over l (x), then m (y), then n (z)
+        for (unsigned int n=0; n<ORDER; ++n) {
+          FReal sumN[BS] = {0};
+          FReal sumNdx[BS] = {0};
+          FReal sumNdy[BS] = {0};
+          for (unsigned int m=0; m<ORDER; ++m) {
+            FReal sumM[BS] = {0};
+            FReal sumMdx[BS] = {0};
+            for (unsigned int l=0; l<ORDER; ++l) {
+              const FReal value = expansion[n*ORDER*ORDER + m*ORDER + l];
+              #pragma omp simd
+              for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+                sumM[idxPart] += L_of_x[0][l][idxPart] * value;
+                sumMdx[idxPart] += dL_of_x[0][l][idxPart] * value;
+              }
+            }
+            #pragma omp simd
+            for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+              sumN[idxPart] += L_of_x[1][m][idxPart] * sumM[idxPart];
+              sumNdx[idxPart] += L_of_x[1][m][idxPart] * sumMdx[idxPart];
+              sumNdy[idxPart] += dL_of_x[1][m][idxPart] * sumM[idxPart];
+            }
+          }
+          #pragma omp simd
+          for(int idxPart = 0 ; idxPart < BS ; ++idxPart){
+            potential[idxPart] += L_of_x[2][n][idxPart] * sumN[idxPart];
+            forces[0][idxPart] += L_of_x[2][n][idxPart] * sumNdx[idxPart];
+            forces[1][idxPart] += L_of_x[2][n][idxPart] * sumNdy[idxPart];
+            forces[2][idxPart] += dL_of_x[2][n][idxPart] * sumN[idxPart];
+          }
+        }
+
+        const FReal*const physicalValues = inParticles[Dim+idxVals];
+        FReal*const forcesX = inParticlesRhs[4*idxVals];
+        FReal*const forcesY = inParticlesRhs[4*idxVals+1];
+        FReal*const forcesZ = inParticlesRhs[4*idxVals+2];
+        FReal*const potentials = inParticlesRhs[4*idxVals+3];
+
+        for(int idxPart = 0 ; idxPart < nbInBlock ; ++idxPart){
+          const FReal physicalValue = physicalValues[idxBlock+idxPart];
+          forcesX[idxBlock+idxPart] += forces[0][idxPart] * jacobian[0] * physicalValue;
+          forcesY[idxBlock+idxPart] += forces[1][idxPart] * jacobian[1] * physicalValue;
+          forcesZ[idxBlock+idxPart] += forces[2][idxPart] * jacobian[2] * physicalValue;
+          potentials[idxBlock+idxPart] += potential[idxPart];
+        }
+      } // NVALS
+    } // NLHS
+  } // N * (2 * ORDER*ORDER*ORDER + 3 * ORDER*ORDER + 4 * ORDER + 6 * ORDER*(ORDER-1)) flops
+}
+
+
 #endif /* FUNIFINTERPOLATOR_HPP */
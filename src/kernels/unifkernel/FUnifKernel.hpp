@@ -20,13 +20,18 @@
 #define FUNIFKERNEL_HPP
 
 #include "FUnifM2LHandler.hpp"
+#include "FUnifSymM2LHandler.hpp"
 #include "FAbstractUnifKernel.hpp"
 #include "kernels/P2P/FP2PR.hpp"
 
 #include "utils/tbfperiodicshifter.hpp"
+#include "utils/tbfutils.hpp"
 
 #include "tbfglobal.hpp"
 
+#include <vector>
+#include <complex>
+
 
 /**
  * @author Pierre Blanchard (pierre.blanchard@inria.fr)
@@ -42,9 +47,11 @@
  * @tparam ContainerClass Type of container to store particles
  * @tparam MatrixKernelClass Type of matrix kernel function
  * @tparam ORDER Lagrange interpolation order
+ * @tparam M2LHandlerClass_T FUnifM2LHandler (all the M2L operators) or FUnifSymM2LHandler (symmetry-reduced storage)
  */
 template < class RealType_T, class MatrixKernelClass, int ORDER, int Dim = 3,
-           class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+           class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>,
+           class M2LHandlerClass_T = FUnifM2LHandler<RealType_T, ORDER, MatrixKernelClass::Type>>
 class FUnifKernel
   : public FAbstractUnifKernel<RealType_T, MatrixKernelClass, ORDER, Dim, SpaceIndexType_T>
 {
@@ -55,7 +62,7 @@ public:
 
 private:
     // private types
-    using M2LHandlerClass = FUnifM2LHandler<RealType, ORDER,MatrixKernelClass::Type>;
+    using M2LHandlerClass = M2LHandlerClass_T;
 
     // using from
     using AbstractBaseClass = FAbstractUnifKernel< RealType, MatrixKernelClass, ORDER, Dim, SpaceIndexType>;
@@ -69,6 +76,16 @@ private:
     /// Leaf level separation criterion
     const int LeafLevelSeparationCriterion;
 
+    /// Buffers of the batched M2L (each thread has its own copy of the kernel)
+    std::vector<const std::complex<RealType>*> batchSources;
+    std::vector<std::complex<RealType>*> batchTargets;
+
+    /// The precision of the P2P (native or mixed)
+    FP2PR::Precision p2pPrecision;
+
+    /// To process the sources of the P2P by tiles (native precision only)
+    bool p2pTiling;
+
 public:
     /**
     * The constructor initializes all constant attributes and it reads the
@@ -84,9 +101,35 @@ public:
                  int(inConfiguration.getTreeHeight()),
                  inConfiguration.getBoxWidths()[0],
                  inLeafLevelSeparationCriterion),
-      LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion)
+      LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion),
+      p2pPrecision(FP2PR::Precision::Native),
+      p2pTiling(false)
     { }
 
+    /// The precision of the P2P, it must be set before the kernel is given to an algorithm
+    void setP2PPrecision(const FP2PR::Precision inPrecision){
+        p2pPrecision = inPrecision;
+    }
+
+    FP2PR::Precision getP2PPrecision() const{
+        return p2pPrecision;
+    }
+
+    /// The tiling of the sources of the P2P (see FP2PRSimd::FullMutual), it is disabled by default
+    /// and it must be set before the kernel is given to an algorithm
+    void setP2PTiling(const bool inUseTiling){
+        p2pTiling = inUseTiling;
+    }
+
+    bool getP2PTiling() const{
+        return p2pTiling;
+    }
+
+    /// The memory used by the M2L operators (shared by the copies of the kernel)
+    unsigned long long getM2LMemory() const{
+        return M2LHandler.getMemory();
+    }
+
 
     template <class CellSymbolicData, class ParticlesClass, class LeafClass>
     void P2M(const CellSymbolicData& LeafIndex,  const long int /*particlesIndexes*/[],
@@ -134,6 +177,28 @@ public:
     }
 
 
+    /**
+     * Group-level M2L: the interactions of a block are bucketed by interaction index,
+     * and each M2L operator is applied to all the pairs of its bucket at once.
+     */
+    template <class M2LBatchClass>
+    void M2LBatch(const long int inLevel, M2LBatchClass& inBatch) {
+        const RealType CellWidth(AbstractBaseClass::BoxWidth / RealType(FMath::pow(2, int(inLevel))));
+        const RealType scale(MatrixKernel->getScaleFactor(CellWidth));
+
+        inBatch.groupByInteractionIndex(TbfUtils::lipow(7, Dim));
+        inBatch.applyPerInteractionIndex([&](const long int inInteractionIndex, const auto* inInteractions, const long int inNbInteractions){
+            batchSources.resize(inNbInteractions);
+            batchTargets.resize(inNbInteractions);
+            for(long int idxInteraction = 0 ; idxInteraction < inNbInteractions ; ++idxInteraction){
+                batchSources[idxInteraction] = inInteractions[idxInteraction].source->transformed_multipole_exp;
+                batchTargets[idxInteraction] = inInteractions[idxInteraction].target->transformed_local_exp;
+            }
+            M2LHandler.applyFCBatch(int(inInteractionIndex), int(inLevel), scale, inNbInteractions,
+                                    batchSources.data(), batchTargets.data());
+        });
+    }
+
     template <class CellSymbolicData, class CellClass, class CellClassContainer>
     void L2L(const CellSymbolicData& /*inParentIndex*/,
              const long int /*inLevel*/, const CellClass& inUpperCell, CellClassContainer& inOutLowerCell,
@@ -165,15 +230,10 @@ public:
                                             localExp);
         FBlas::add(AbstractBaseClass::nnodes,const_cast<RealType*>(LeafCell.local_exp),localExp);
 
-        // 2.a) apply Sx
-        AbstractBaseClass::Interpolator->applyL2P(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
-                                                  localExp, std::forward<const ParticlesClass>(inOutParticles),
-                                                  std::forward<ParticlesClassRhs>(inOutParticlesRhs), inNbParticles);
-
-        // 2.b) apply Px (grad Sx)
-        AbstractBaseClass::Interpolator->applyL2PGradient(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
-                                                          localExp, std::forward<const ParticlesClass>(inOutParticles),
-                                                          std::forward<ParticlesClassRhs>(inOutParticlesRhs), inNbParticles);
+        // 2) apply Sx and Px (grad Sx)
+        AbstractBaseClass::Interpolator->applyL2PTotal(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
+                                                       localExp, std::forward<const ParticlesClass>(inOutParticles),
+                                                       std::forward<ParticlesClassRhs>(inOutParticlesRhs), inNbParticles);
     }
 
     template <class LeafSymbolicData, class ParticlesClassValues, class ParticlesClassRhs>
@@ -186,20 +246,19 @@ public:
         if constexpr(SpaceIndexType::IsPeriodic){
             using PeriodicShifter = typename TbfPeriodicShifter<RealType, SpaceIndexType>::Neighbor;
             if(PeriodicShifter::NeedToShift(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc)){
-                const auto duplicateSources = PeriodicShifter::DuplicatePositionsAndApplyShift(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc,
-                                                                            inNeighbors, inNbParticlesNeighbors);
-                FP2PR::template FullMutual<RealType> ((duplicateSources),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
-                PeriodicShifter::FreePositions(duplicateSources);
+                // The shift is applied by the P2P, the sources are not duplicated
+                const auto sourcesShift = PeriodicShifter::GetShiftCoef(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc);
+                FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, sourcesShift, p2pTiling);
             }
             else{
-                FP2PR::template FullMutual<RealType> ((inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
+                FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, {}, p2pTiling);
             }
         }
         else{
-            FP2PR::template FullMutual<RealType> ((inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
-                                                                                       (inTargets), (inTargetsRhs), inNbOutParticles);
+            FP2PR::template FullMutual<RealType> (p2pPrecision, (inNeighbors),(inNeighborsRhs), inNbParticlesNeighbors,
+                                                                                       (inTargets), (inTargetsRhs), inNbOutParticles, {}, p2pTiling);
         }
     }
 
@@ -214,19 +273,17 @@ public:
         if constexpr(SpaceIndexType::IsPeriodic){
             using PeriodicShifter = typename TbfPeriodicShifter<RealType, SpaceIndexType>::Neighbor;
             if(PeriodicShifter::NeedToShift(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc)){
-                const auto duplicateSources = PeriodicShifter::DuplicatePositionsAndApplyShift(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc,
-                                                                            inNeighbors, inNbParticlesNeighbors);
-                FP2PR::template GenericFullRemote<RealType> ((duplicateSources), inNbParticlesNeighbors,
-                                                             (inTargets), (inTargetsRhs), inNbOutParticles);
-                PeriodicShifter::FreePositions(duplicateSources);
+                const auto sourcesShift = PeriodicShifter::GetShiftCoef(inNeighborIndex, inTargetIndex, AbstractBaseClass::spaceIndexSystem, arrayIndexSrc);
+                FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
+                                                             (inTargets), (inTargetsRhs), inNbOutParticles, sourcesShift);
             }
             else{
-                FP2PR::template GenericFullRemote<RealType> ((inNeighbors), inNbParticlesNeighbors,
+                FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
                                                              (inTargets), (inTargetsRhs), inNbOutParticles);
             }
         }
         else{
-            FP2PR::template GenericFullRemote<RealType> ((inNeighbors), inNbParticlesNeighbors,
+            FP2PR::template GenericFullRemote<RealType> (p2pPrecision, (inNeighbors), inNbParticlesNeighbors,
                                                                                        (inTargets), (inTargetsRhs), inNbOutParticles);
         }
     }
@@ -235,10 +292,19 @@ public:
     void P2PInner(const LeafSymbolicData& /*inIndex*/, const long int /*targetIndexes*/[],
                   const ParticlesClassValues& inTargets,
                   ParticlesClassRhs& inTargetsRhs, const long int inNbOutParticles) const {
-        FP2PR::template GenericInner<RealType>((inTargets),(inTargetsRhs), inNbOutParticles);
+        FP2PR::template GenericInner<RealType>(p2pPrecision, (inTargets),(inTargetsRhs), inNbOutParticles);
     }
 };
 
+/**
+ * The uniform kernel with the symmetry-reduced storage of the M2L operators
+ * (the matrix kernel must be invariant by the symmetries of the cube).
+ */
+template < class RealType_T, class MatrixKernelClass, int ORDER, int Dim = 3,
+           class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+using FUnifSymKernel = FUnifKernel<RealType_T, MatrixKernelClass, ORDER, Dim, SpaceIndexType_T,
+                                   FUnifSymM2LHandler<RealType_T, ORDER, MatrixKernelClass::Type>>;
+
 
 #endif //FUNIFKERNEL_HPP
 
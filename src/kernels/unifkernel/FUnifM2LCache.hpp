@@ -0,0 +1,237 @@
+#ifndef FUNIFM2LCACHE_HPP
+#define FUNIFM2LCACHE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FUNIFM2LCACHE_USE_MMAP
+#endif
+
+/**
+ * A persistent cache for the precomputed M2L operators of the uniform kernels.
+ *
+ * A file contains a versioned header, the key that describes the operators
+ * (matrix kernel and its parameters, precision, order, separation criterion, ...)
+ * and the values protected by a checksum. A file is used only if everything matches,
+ * otherwise the operators are recomputed and the file is replaced.
+ * The files are read with mmap when available, and written in a temporary file
+ * that is renamed at the end, such that concurrent processes never read a partial file.
+ *
+ * The cache is disabled by default, it is enabled by setting the environment variable
+ * TBFMM_M2L_CACHE_DIR to the directory where the files are written.
+ */
+class FUnifM2LCache{
+public:
+    static constexpr std::uint32_t Version = 1;
+
+private:
+    struct Header{
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t valueSize;
+        std::uint64_t keySize;
+        std::uint64_t nbValues;
+        std::uint64_t checksum;
+    };
+
+    static constexpr char Magic[8] = {'T', 'B', 'F', 'M', '2', 'L', 'C', '\0'};
+
+    // The values start at a multiple of this offset
+    static constexpr std::uint64_t Alignment = 64;
+
+    static std::uint64_t GetValuesOffset(const std::uint64_t inKeySize){
+        return ((sizeof(Header) + inKeySize + Alignment - 1)/Alignment)*Alignment;
+    }
+
+    // FNV-1a on the bytes
+    static std::uint64_t Hash(const void* inData, const std::uint64_t inSize, std::uint64_t inHash = 14695981039346656037ULL){
+        const unsigned char* bytes = static_cast<const unsigned char*>(inData);
+        for(std::uint64_t idx = 0 ; idx < inSize ; ++idx){
+            inHash = (inHash ^ bytes[idx]) * 1099511628211ULL;
+        }
+        return inHash;
+    }
+
+    // FNV-1a on 64 bits words (faster for the values)
+    static std::uint64_t Checksum(const void* inData, const std::uint64_t inSize){
+        const unsigned char* bytes = static_cast<const unsigned char*>(inData);
+        std::uint64_t hash = 14695981039346656037ULL;
+        std::uint64_t idx = 0;
+        for( ; idx + sizeof(std::uint64_t) <= inSize ; idx += sizeof(std::uint64_t)){
+            std::uint64_t word;
+            std::memcpy(&word, bytes + idx, sizeof(std::uint64_t));
+            hash = (hash ^ word) * 1099511628211ULL;
+        }
+        return Hash(bytes + idx, inSize - idx, hash);
+    }
+
+    static bool CheckHeader(const Header& inHeader, const std::string& inKey, const std::uint64_t inValueSize,
+                            const std::uint64_t inNbValues, const std::uint64_t inFileSize){
+        return std::memcmp(inHeader.magic, Magic, sizeof(Magic)) == 0
+                && inHeader.version == Version
+                && inHeader.valueSize == inValueSize
+                && inHeader.keySize == inKey.size()
+                && inHeader.nbValues == inNbValues
+                && inFileSize == GetValuesOffset(inHeader.keySize) + inNbValues*inValueSize;
+    }
+
+    static bool CheckContent(const char* inContent, const std::string& inKey, void* outValues, const std::uint64_t inValuesSize){
+        const Header& header = *reinterpret_cast<const Header*>(inContent);
+        if(std::memcmp(inContent + sizeof(Header), inKey.data(), inKey.size()) != 0){
+            return false;
+        }
+        const char* values = inContent + GetValuesOffset(header.keySize);
+        if(Checksum(values, inValuesSize) != header.checksum){
+            return false;
+        }
+        std::memcpy(outValues, values, inValuesSize);
+        return true;
+    }
+
+public:
+    static bool IsEnabled(){
+        const char* directory = std::getenv("TBFMM_M2L_CACHE_DIR");
+        return directory != nullptr && directory[0] != '\0';
+    }
+
+    static std::string GetDirectory(){
+        const char* directory = std::getenv("TBFMM_M2L_CACHE_DIR");
+        return (directory && directory[0] != '\0' ? std::string(directory) : std::string("."));
+    }
+
+    /**
+     * Build the key of a matrix kernel, the kernel is identified by its ID and
+     * by its values for some fixed couples of points (to take into account its parameters).
+     */
+    template <class FReal, class MatrixKernelClass>
+    static std::string BuildKey(const MatrixKernelClass *const inMatrixKernel, const int inOrder,
+                                const int inSeparationCriterion, const std::string& inExtra = std::string()){
+        const std::array<std::array<FReal, 3>, 4> points{{{{FReal(0), FReal(0), FReal(0)}},
+                                                          {{FReal(2.5), FReal(-1.25), FReal(3.75)}},
+                                                          {{FReal(-0.3), FReal(0.7), FReal(1.1)}},
+                                                          {{FReal(5), FReal(6), FReal(-7)}}}};
+        std::ostringstream stream;
+        stream << "kernel=" << MatrixKernelClass::getID()
+               << ";real=" << (std::is_same<FReal, double>::value ? "double" : std::is_same<FReal, float>::value ? "float" : "other")
+               << sizeof(FReal)
+               << ";order=" << inOrder
+               << ";separation=" << inSeparationCriterion
+               << ";fingerprint=" << std::hexfloat;
+        for(std::size_t idxPoint = 0 ; idxPoint + 1 < points.size() ; ++idxPoint){
+            stream << inMatrixKernel->evaluate(points[idxPoint], points[idxPoint+1]) << ",";
+        }
+        stream << ";" << inExtra;
+        return stream.str();
+    }
+
+    /** The file name is made of a readable prefix and of the hash of the key */
+    static std::string GetFilename(const std::string& inPrefix, const std::string& inKey){
+        std::ostringstream stream;
+        stream << GetDirectory() << "/" << inPrefix << "_" << std::hex << std::setw(16) << std::setfill('0')
+               << Hash(inKey.data(), inKey.size()) << ".bin";
+        return stream.str();
+    }
+
+    /** Load nbValues values, return false if the file does not exist or does not match */
+    template <class ValueType>
+    static bool Load(const std::string& inFilename, const std::string& inKey, ValueType* outValues, const std::uint64_t inNbValues){
+        static_assert(std::is_trivially_copyable<ValueType>::value, "The values must be trivially copyable");
+        const std::uint64_t valuesSize = inNbValues*sizeof(ValueType);
+#ifdef FUNIFM2LCACHE_USE_MMAP
+        const int fd = open(inFilename.c_str(), O_RDONLY);
+        if(fd < 0){
+            return false;
+        }
+        struct stat fileStat;
+        if(fstat(fd, &fileStat) != 0 || static_cast<std::uint64_t>(fileStat.st_size) < sizeof(Header)){
+            close(fd);
+            return false;
+        }
+        const std::uint64_t fileSize = static_cast<std::uint64_t>(fileStat.st_size);
+        void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(mapping == MAP_FAILED){
+            return false;
+        }
+        const char* content = static_cast<const char*>(mapping);
+        const bool isValid = CheckHeader(*reinterpret_cast<const Header*>(content), inKey, sizeof(ValueType), inNbValues, fileSize)
+                             && CheckContent(content, inKey, outValues, valuesSize);
+        munmap(mapping, fileSize);
+        return isValid;
+#else
+        std::ifstream stream(inFilename, std::ios::in | std::ios::binary | std::ios::ate);
+        if(!stream.good()){
+            return false;
+        }
+        const std::uint64_t fileSize = static_cast<std::uint64_t>(stream.tellg());
+        if(fileSize < sizeof(Header)){
+            return false;
+        }
+        std::vector<char> content(fileSize);
+        stream.seekg(0);
+        stream.read(content.data(), static_cast<std::streamsize>(fileSize));
+        return stream.good()
+                && CheckHeader(*reinterpret_cast<const Header*>(content.data()), inKey, sizeof(ValueType), inNbValues, fileSize)
+                && CheckContent(content.data(), inKey, outValues, valuesSize);
+#endif
+    }
+
+    /** Write the values in a temporary file and rename it, return false in case of error */
+    template <class ValueType>
+    static bool Save(const std::string& inFilename, const std::string& inKey, const ValueType* inValues, const std::uint64_t inNbValues){
+        static_assert(std::is_trivially_copyable<ValueType>::value, "The values must be trivially copyable");
+        const std::uint64_t valuesSize = inNbValues*sizeof(ValueType);
+
+        Header header;
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.valueSize = static_cast<std::uint32_t>(sizeof(ValueType));
+        header.keySize = inKey.size();
+        header.nbValues = inNbValues;
+        header.checksum = Checksum(inValues, valuesSize);
+
+        std::ostringstream temporaryFilename;
+        temporaryFilename << inFilename << ".tmp" << std::hex << reinterpret_cast<std::uintptr_t>(&header);
+#ifdef FUNIFM2LCACHE_USE_MMAP
+        temporaryFilename << "." << std::dec << getpid();
+#endif
+        {
+            std::ofstream stream(temporaryFilename.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if(!stream.good()){
+                return false;
+            }
+            const std::vector<char> padding(GetValuesOffset(inKey.size()) - sizeof(Header) - inKey.size(), 0);
+            stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            stream.write(inKey.data(), static_cast<std::streamsize>(inKey.size()));
+            stream.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            stream.write(reinterpret_cast<const char*>(inValues), static_cast<std::streamsize>(valuesSize));
+            stream.flush();
+            if(!stream.good()){
+                stream.close();
+                std::remove(temporaryFilename.str().c_str());
+                return false;
+            }
+        }
+        if(std::rename(temporaryFilename.str().c_str(), inFilename.c_str()) != 0){
+            std::remove(temporaryFilename.str().c_str());
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif
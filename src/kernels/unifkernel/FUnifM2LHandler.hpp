@@ -25,6 +25,7 @@
 #include <sstream>
 #include <fstream>
 #include <typeinfo>
+#include <algorithm>
 
 #include "FBlas.hpp"
 #include "FDft.hpp"
@@ -34,6 +35,7 @@
 
 #include "FUnifTensor.hpp"
 #include "FInterpMatrixKernel.hpp"
+#include "FUnifM2LCache.hpp"
 
 #include "utils/tbftimer.hpp"
 
@@ -144,6 +146,71 @@ static void Compute(const MatrixKernelClass *const MatrixKernel, const FReal Cel
 
 
 
+/*! The name of the cache file of the M2L operators (or an empty string if the cache is disabled). */
+template <class FReal, int ORDER, typename MatrixKernelClass>
+static std::string GetM2LCacheFilename(const std::string& inKey, const std::string& inName = "m2l")
+{
+    if (!FUnifM2LCache::IsEnabled()) return std::string();
+    std::stringstream stream;
+    stream << inName << "_" << MatrixKernelClass::getID() << "_" << (typeid(FReal)==typeid(double) ? 'd' : 'f')
+           << "_o" << ORDER;
+    return FUnifM2LCache::GetFilename(stream.str(), inKey);
+}
+
+/*! Load the inNbValues operators FC from the cache file if it matches the key,
+ * otherwise compute them with inCompute and write the cache file.
+ * Returns true if the operators have been loaded. */
+template <class ValueType, class ComputeFunc>
+static bool LoadOrComputeM2L(const std::string& inFilename, const std::string& inKey,
+                             ValueType* FC, const unsigned long inNbValues, ComputeFunc&& inCompute)
+{
+    if (!inFilename.empty() && FUnifM2LCache::Load(inFilename, inKey, FC, inNbValues)) return true;
+    inCompute();
+    if (!inFilename.empty() && !FUnifM2LCache::Save(inFilename, inKey, FC, inNbValues))
+        std::cout << "Cannot write the M2L operators in " << inFilename << std::endl;
+    return false;
+}
+
+
+/*! Apply one M2L operator (a slice of FC) to several pairs of transformed expansions:
+ * FXs[idxPair] += scale * FCslice .* FYs[idxPair]
+ * The entries are processed by blocks: the real and imaginary parts of the operator
+ * are first split (SoA) and scaled in small stack buffers, then applied to all the pairs,
+ * such that the block of the operator stays in L1 and the inner loop can be vectorized.
+ */
+template <class FReal>
+static void ApplyFCBatch(const std::complex<FReal>* const FCslice, const FReal scale, const unsigned int opt_rc,
+                         const long int nbPairs, const std::complex<FReal>* const FYs[], std::complex<FReal>* const FXs[])
+{
+    constexpr unsigned int BlockSize = 128;
+    FReal blockRe[BlockSize];
+    FReal blockIm[BlockSize];
+
+    for (unsigned int blockStart = 0 ; blockStart < opt_rc ; blockStart += BlockSize){
+        const unsigned int blockLength = std::min(BlockSize, opt_rc - blockStart);
+        for (unsigned int j = 0 ; j < blockLength ; ++j){
+            blockRe[j] = scale * FCslice[blockStart + j].real();
+            blockIm[j] = scale * FCslice[blockStart + j].imag();
+        }
+
+        for (long int idxPair = 0 ; idxPair < nbPairs ; ++idxPair){
+            // std::complex<FReal> is layout compatible with FReal[2]
+            const FReal* const FY = reinterpret_cast<const FReal*>(FYs[idxPair] + blockStart);
+            FReal* const FX = reinterpret_cast<FReal*>(FXs[idxPair] + blockStart);
+#ifdef TBF_USE_OPENMP
+            #pragma omp simd
+#endif
+            for (unsigned int j = 0 ; j < blockLength ; ++j){
+                const FReal yRe = FY[2*j];
+                const FReal yIm = FY[2*j+1];
+                FX[2*j]   += blockRe[j] * yRe - blockIm[j] * yIm;
+                FX[2*j+1] += blockRe[j] * yIm + blockIm[j] * yRe;
+            }
+        }
+    }
+}
+
+
 /**
  * @author Pierre Blanchard (pierre.blanchard@inria.fr)
  * @class FUnifM2LHandler
@@ -186,20 +253,15 @@ class FUnifM2LHandler<FReal, ORDER,HOMOGENEOUS>
     /// Leaf level separation criterion
     const int LeafLevelSeparationCriterion;
 
-    static const std::string getFileName()
-    {
-        const char precision_type = (typeid(FReal)==typeid(double) ? 'd' : 'f');
-        std::stringstream stream;
-        stream << "m2l_k"/*<< MatrixKernelClass::getID()*/ << "_" << precision_type
-                     << "_o" << order << ".bin";
-        return stream.str();
-    }
+    /// Persistent cache of the operators
+    std::string cacheFilename;
+    bool loadedFromCache;
 
-    
 public:
     template <typename MatrixKernelClass>
     FUnifM2LHandler(const MatrixKernelClass *const MatrixKernel, const unsigned int, const FReal, const int inLeafLevelSeparationCriterion = 1)
-        : FC(nullptr), Dft(rc), opt_rc(rc/2+1), LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion)
+        : FC(nullptr), Dft(rc), opt_rc(rc/2+1), LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion),
+          loadedFromCache(false)
     {    
 
         // initialize root node ids
@@ -214,7 +276,8 @@ public:
      * Copy constructor
      */
     FUnifM2LHandler(const FUnifM2LHandler& other)
-      : FC(other.FC), Dft(other.Dft), opt_rc(other.opt_rc), LeafLevelSeparationCriterion(other.LeafLevelSeparationCriterion)
+      : FC(other.FC), Dft(other.Dft), opt_rc(other.opt_rc), LeafLevelSeparationCriterion(other.LeafLevelSeparationCriterion),
+        cacheFilename(other.cacheFilename), loadedFromCache(other.loadedFromCache)
     {    
         // copy node_diff
         memcpy(node_diff,other.node_diff,sizeof(unsigned int)*nnodes*nnodes);
@@ -233,21 +296,39 @@ public:
         TbfTimer time;
         // check if aready set
         if (FC) throw std::runtime_error("M2L operator already set");
-        // Compute matrix of interactions
-        const FReal ReferenceCellWidth = FReal(2.);
-        std::complex<FReal>* pFC = NULL;
-        Compute<FReal,order>(MatrixKernel,ReferenceCellWidth,pFC,LeafLevelSeparationCriterion);
-        FC.reset(pFC);
+        FC.reset(new std::complex<FReal>[343*opt_rc]);
+
+        // Load or compute matrix of interactions
+        const std::string key = FUnifM2LCache::BuildKey<FReal>(MatrixKernel, order, LeafLevelSeparationCriterion);
+        cacheFilename = GetM2LCacheFilename<FReal,order,MatrixKernelClass>(key);
+        loadedFromCache = LoadOrComputeM2L(cacheFilename, key, FC.get(), 343*opt_rc, [&](){
+            const FReal ReferenceCellWidth = FReal(2.);
+            std::complex<FReal>* pFC = NULL;
+            Compute<FReal,order>(MatrixKernel,ReferenceCellWidth,pFC,LeafLevelSeparationCriterion);
+            std::copy(pFC, pFC + 343*opt_rc, FC.get());
+            delete [] pFC;
+        });
 
         // Compute memory usage
         unsigned long sizeM2L = 343*opt_rc*sizeof(std::complex<FReal>);
 
 
         // write info
-        std::cout << "Compute and set M2L operators ("<< long(sizeM2L/**1e-6*/) <<" B) in "
+        std::cout << (loadedFromCache ? "Load M2L operators (" : "Compute and set M2L operators (")
+                  << long(sizeM2L/**1e-6*/) <<" B) in "
                   << time.stopAndGetElapsed() << "sec."   << std::endl;
     }
 
+    /** The cache file of the operators (empty if the cache is disabled) */
+    const std::string& getCacheFilename() const {
+        return cacheFilename;
+    }
+
+    /** True if the operators have been loaded from the cache file */
+    bool isLoadedFromCache() const {
+        return loadedFromCache;
+    }
+
     unsigned long long getMemory() const {
         return 343*opt_rc*sizeof(std::complex<FReal>);
     }        
@@ -294,6 +375,15 @@ public:
         }
     }
 
+    /**
+     * Same as applyFC but for nbPairs pairs of expansions that share the same interaction idx.
+     */
+    void applyFCBatch(const unsigned int idx, const unsigned int, const FReal scale, const long int nbPairs,
+                      const std::complex<FReal> *const FYs[], std::complex<FReal> *const FXs[]) const
+    {
+        ApplyFCBatch(FC.get() + idx*opt_rc, scale, opt_rc, nbPairs, FYs, FXs);
+    }
+
 
     /**
      * Transform densities \f$Y= DFT(y)\f$ of a source cell. This operation
@@ -326,8 +416,8 @@ class FUnifM2LHandler<FReal,ORDER,NON_HOMOGENEOUS>
           ninteractions = 316, // 7^3 - 3^3 (max num cells in far-field)
           rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1)};
 
-    /// M2L Operators (stored in Fourier space for each level)
-    std::shared_ptr< std::complex<FReal>*[]> FC;
+    /// M2L Operators (stored in Fourier space for each level from 2, contiguously)
+    std::shared_ptr< std::complex<FReal>[]> FC;
     /// Homogeneity specific variables
     const unsigned int TreeHeight;
     const FReal RootCellWidth;
@@ -343,31 +433,29 @@ class FUnifM2LHandler<FReal,ORDER,NON_HOMOGENEOUS>
     /// Leaf level separation criterion
     const int LeafLevelSeparationCriterion;
 
-    static const std::string getFileName()
-    {
-        const char precision_type = (typeid(FReal)==typeid(double) ? 'd' : 'f');
-        std::stringstream stream;
-        stream << "m2l_k"/*<< MatrixKernelClass::getID()*/ << "_" << precision_type
-               << "_o" << order << ".bin";
-        return stream.str();
+    /// Persistent cache of the operators
+    std::string cacheFilename;
+    bool loadedFromCache;
+
+    unsigned long getNbValues() const {
+        return (TreeHeight > 2 ? (TreeHeight-2)*343*opt_rc : 0);
+    }
+
+    const std::complex<FReal>* getLevelFC(const unsigned int TreeLevel) const {
+        return FC.get() + (TreeLevel-2)*343*opt_rc;
     }
 
-    
 public:
     template <typename MatrixKernelClass>
     FUnifM2LHandler(const MatrixKernelClass *const MatrixKernel, const unsigned int inTreeHeight, const FReal inRootCellWidth, const int inLeafLevelSeparationCriterion = 1)
         : TreeHeight(inTreeHeight),
           RootCellWidth(inRootCellWidth),
-          Dft(rc), opt_rc(rc/2+1), LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion)
+          Dft(rc), opt_rc(rc/2+1), LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion),
+          loadedFromCache(false)
     {
 
         // initialize root node ids
         TensorType::setNodeIdsDiff(node_diff);
-        
-        // init M2L operators
-        FC = new std::complex<FReal>*[TreeHeight];
-        FC[0]       = NULL; FC[1]       = NULL;
-        for (unsigned int l=2; l<TreeHeight; ++l) FC[l] = NULL;
 
         // Compute and Set M2L Operators
         ComputeAndSet(MatrixKernel);
@@ -381,7 +469,8 @@ public:
       : FC(other.FC),
         TreeHeight(other.TreeHeight),
         RootCellWidth(other.RootCellWidth),
-        Dft(other.Dft), opt_rc(other.opt_rc), LeafLevelSeparationCriterion(other.LeafLevelSeparationCriterion)
+        Dft(other.Dft), opt_rc(other.opt_rc), LeafLevelSeparationCriterion(other.LeafLevelSeparationCriterion),
+        cacheFilename(other.cacheFilename), loadedFromCache(other.loadedFromCache)
     {    
         // copy node_diff
         memcpy(node_diff,other.node_diff,sizeof(unsigned int)*nnodes*nnodes);
@@ -390,10 +479,7 @@ public:
 
 
     ~FUnifM2LHandler()
-    {
-        for (unsigned int l=0; l<TreeHeight; ++l) 
-            if (FC[l] != NULL) delete [] FC[l];
-    }
+    { }
 
     /**
      * Computes and sets the matrix \f$C_t\f$
@@ -403,32 +489,55 @@ public:
     {
         // measure time
         TbfTimer time;
+        // check if already set
+        if (FC) throw std::runtime_error("M2L operator already set");
+        FC.reset(new std::complex<FReal>[getNbValues()]);
 
-        // Compute matrix of interactions at each level !! (since non homog)
-        FReal CellWidth = RootCellWidth / FReal(2.); // at level 1
-        CellWidth /= FReal(2.);                      // at level 2
-        for (unsigned int l=2; l<TreeHeight; ++l) {
+        // The operators depend on the width of the cells at each level
+        std::stringstream extraKey;
+        extraKey << "height=" << TreeHeight << ";width=" << std::hexfloat << RootCellWidth;
+        const std::string key = FUnifM2LCache::BuildKey<FReal>(MatrixKernel, order, LeafLevelSeparationCriterion, extraKey.str());
+        cacheFilename = (getNbValues() ? GetM2LCacheFilename<FReal,order,MatrixKernelClass>(key) : std::string());
 
-            // Determine separation criteria wrt level
-            const int SeparationCriterion = (l != TreeHeight-1 ? 1 : LeafLevelSeparationCriterion);
+        // Load or compute matrix of interactions at each level !! (since non homog)
+        loadedFromCache = LoadOrComputeM2L(cacheFilename, key, FC.get(), getNbValues(), [&](){
+            FReal CellWidth = RootCellWidth / FReal(2.); // at level 1
+            CellWidth /= FReal(2.);                      // at level 2
+            for (unsigned int l=2; l<TreeHeight; ++l) {
 
-            // check if already set
-            if (FC[l]) throw std::runtime_error("M2L operator already set");
-            Compute<FReal,order>(MatrixKernel,CellWidth,FC[l],SeparationCriterion);
-            CellWidth /= FReal(2.);                    // at level l+1 
+                // Determine separation criteria wrt level
+                const int SeparationCriterion = (l != TreeHeight-1 ? 1 : LeafLevelSeparationCriterion);
 
-        }
+                std::complex<FReal>* pFC = NULL;
+                Compute<FReal,order>(MatrixKernel,CellWidth,pFC,SeparationCriterion);
+                std::copy(pFC, pFC + 343*opt_rc, FC.get() + (l-2)*343*opt_rc);
+                delete [] pFC;
+                CellWidth /= FReal(2.);                    // at level l+1 
+
+            }
+        });
 
         // Compute memory usage
-        unsigned long sizeM2L = (TreeHeight-2)*343*opt_rc*sizeof(std::complex<FReal>);
+        unsigned long sizeM2L = getNbValues()*sizeof(std::complex<FReal>);
 
         // write info
-        std::cout << "Compute and set M2L operators ("<< long(sizeM2L/**1e-6*/) <<" B) in "
+        std::cout << (loadedFromCache ? "Load M2L operators (" : "Compute and set M2L operators (")
+                  << long(sizeM2L/**1e-6*/) <<" B) in "
                   << time.stopAndGetElapsed() << "sec."   << std::endl;
     }
 
+    /** The cache file of the operators (empty if the cache is disabled) */
+    const std::string& getCacheFilename() const {
+        return cacheFilename;
+    }
+
+    /** True if the operators have been loaded from the cache file */
+    bool isLoadedFromCache() const {
+        return loadedFromCache;
+    }
+
     unsigned long long getMemory() const {
-        return (TreeHeight-2)*343*opt_rc*sizeof(std::complex<FReal>);
+        return getNbValues()*sizeof(std::complex<FReal>);
     }   
 
     /**
@@ -468,10 +577,19 @@ public:
     {
         // Perform entrywise product manually
         for (unsigned int j=0; j<opt_rc; ++j){
-            FX[j] += (FC[TreeLevel][idx*opt_rc + j] * FY[j]);
+            FX[j] += (getLevelFC(TreeLevel)[idx*opt_rc + j] * FY[j]);
         }
     }
 
+    /**
+     * Same as applyFC but for nbPairs pairs of expansions that share the same interaction idx.
+     */
+    void applyFCBatch(const unsigned int idx, const unsigned int TreeLevel, const FReal, const long int nbPairs,
+                      const std::complex<FReal> *const FYs[], std::complex<FReal> *const FXs[]) const
+    {
+        ApplyFCBatch(getLevelFC(TreeLevel) + idx*opt_rc, FReal(1), opt_rc, nbPairs, FYs, FXs);
+    }
+
 
     /**
      * Transform densities \f$Y= DFT(y)\f$ of a source cell. This operation
@@ -4,430 +4,545 @@
 // This software is a computer program whose purpose is to compute the FMM.
 //
 // This software is governed by the CeCILL-C and LGPL licenses and
-// abiding by the rules of distribution of free software.  
-// 
+// abiding by the rules of distribution of free software.
+//
 // This program is distributed in the hope that it will be useful,
 // but WITHOUT ANY WARRANTY; without even the implied warranty of
 // MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 // GNU General Public and CeCILL-C Licenses for more details.
-// "http://www.cecill.info". 
+// "http://www.cecill.info".
 // "http://www.gnu.org/licenses".
 // ===================================================================================
 // Keep in private GIT
 // @SCALFMM_PRIVATE
-
 #ifndef FUNIFSYMM2LHANDLER_HPP
 #define FUNIFSYMM2LHANDLER_HPP
 
-#include <climits>
-
-#include "../../Utils/FBlas.hpp"
-#include "../../Utils/FDft.hpp"
-
-#include "../../Utils/FComplex.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-#include "./FUnifTensor.hpp"
-#include "../Interpolation/FInterpSymmetries.hpp"
-#include "./FUnifM2LHandler.hpp"
+#include "FUnifM2LHandler.hpp"
 
 /**
- * @author Pierre Blanchard (pierre.blanchard@inria.fr)
- * Please read the license
- */
-
-
-/*!  Precomputes the 16 far-field interactions (due to symmetries in their
-  arrangement all 316 far-field interactions can be represented by
-  permutations of the 16 we compute in this function).
+ * @class FUnifSymM2LHandlerCore
+ * Shared part of the symmetric M2L handlers.
+ *
+ * A far-field interaction t=(i,j,k) is obtained from a canonical interaction
+ * u=(u0,u1,u2) with 3 >= u0 >= u1 >= u2 >= 0 by a permutation and a reflection
+ * of the axes: t[a] = sign[a] * u[axis[a]]. For a matrix kernel that is invariant
+ * by these symmetries (a radial kernel for instance), the operator of t is the one
+ * of u with the same permutation and reflection of the differences of the node indexes.
+ *
+ * The expansions are embedded in a (2p-1)^3 grid and transformed with a 3D DFT
+ * (instead of the 1D DFT of FUnifM2LHandler). In the frequency domain, the permutation
+ * and the reflection of the axes are then a permutation of the frequency indexes
+ * (k[a] -> sign[a]*k[a] mod 2p-1). Therefore, only the 16 canonical operators (19 or 20
+ * when the leaf level separation criterion is 0 or -1) are stored in Fourier space, and the
+ * operator of t is read from the one of u with this permutation when the M2L is applied.
+ * The real-to-complex DFT keeps the half of the frequencies, the other half
+ * is obtained by conjugation (F(-k) = conj(F(k))).
+ * The canonical operators are saved in the cache file in the spatial domain.
  */
-template < class FReal, int ORDER, typename MatrixKernelClass>
-static void precompute(const MatrixKernelClass *const MatrixKernel, const FReal CellWidth,
-                       FComplex<FReal>* FC[343])
+template <class FReal, int ORDER>
+class FUnifSymM2LHandlerCore
 {
-  //	std::cout << "\nComputing 16 far-field interactions (l=" << ORDER << ", eps=" << Epsilon
-  //						<< ") for cells of width w = " << CellWidth << std::endl;
-
-	static const unsigned int nnodes = ORDER*ORDER*ORDER;
-
-	// interpolation points of source (Y) and target (X) cell
-    FPoint<FReal> X[nnodes], Y[nnodes];
-	// set roots of target cell (X)
-    FUnifTensor<FReal,ORDER>::setRoots(FPoint<FReal>(0.,0.,0.), CellWidth, X);
-	// temporary matrices
-	FReal *_C;
-    FComplex<FReal> *_FC;
-
-  // reduce storage from nnodes^2=order^6 to (2order-1)^3
-  const unsigned int rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1);
-	_C = new FReal [rc];
-    _FC = new FComplex<FReal> [rc]; // TODO: do it in the non-sym version!!!
-
-  // init Discrete Fourier Transformator
-  const int dimfft = 1; // unidim FFT since fully circulant embedding
-  const int steps[dimfft] = {rc};
-//	FDft Dft(rc);
-	FFft<FReal,dimfft> Dft(steps);
-
-  // reduce storage if real valued kernel
-  const unsigned int opt_rc = rc/2+1;
-
-  // get first column of K via permutation
-  unsigned int perm[rc];
-  for(unsigned int p=0; p<rc; ++p){
-    if(p<rc-1) perm[p]=p+1;
-    else perm[p]=p+1-rc;
-  }
-  unsigned int li,lj, mi,mj, ni,nj;
-  unsigned int idi, idj, ido;
-
-	// initialize timer
-	FTic time;
-	double overall_time(0.);
-	double elapsed_time(0.);
-
-	unsigned int counter = 0;
-	for (int i=2; i<=3; ++i) {
-		for (int j=0; j<=i; ++j) {
-			for (int k=0; k<=j; ++k) {
-
-				// set roots of source cell (Y)
-                const FPoint<FReal> cy(CellWidth*FReal(i), CellWidth*FReal(j), CellWidth*FReal(k));
-				FUnifTensor<FReal,ORDER>::setRoots(cy, CellWidth, Y);
-
-				// start timer
-				time.tic();
-
-        // evaluate m2l operator
-        ido=0;
-        for(unsigned int l=0; l<2*ORDER-1; ++l)
-          for(unsigned int m=0; m<2*ORDER-1; ++m)
-            for(unsigned int n=0; n<2*ORDER-1; ++n){   
-          
-              // l=0:(2*ORDER-1) => li-lj=-(ORDER-1):(ORDER-1)
-              // Convention:
-              // lj=ORDER-1 & li=0:ORDER-1 => li-lj=1-ORDER:0
-              // lj=1 & li=0:ORDER-1 => li-lj=1:ORDER-1
-              if(l<ORDER-1) lj=ORDER-1; else lj=0;
-              if(m<ORDER-1) mj=ORDER-1; else mj=0;
-              if(n<ORDER-1) nj=ORDER-1; else nj=0;
-              li=(l-(ORDER-1))+lj; mi=(m-(ORDER-1))+mj; ni=(n-(ORDER-1))+nj;
-              // deduce corresponding index of K[nnodes x nnodes] 
-              idi=li*ORDER*ORDER + mi*ORDER + ni;
-              idj=lj*ORDER*ORDER + mj*ORDER + nj;
-                
-              // store value at current position in C
-              // use permutation if DFT is used because 
-              // the storage of the first column is required
-              // i.e. C[0] C[rc-1] C[rc-2] .. C[1] < WRONG!
-              // i.e. C[rc-1] C[0] C[1] .. C[rc-2] < RIGHT!
-//                _C[counter*rc + ido]
-              _C[perm[ido]]
-                = MatrixKernel->evaluate(X[idi], Y[idj]);
-              ido++;
+protected:
+    enum {order = ORDER,
+          nnodes = TensorTraits<ORDER>::nnodes,
+          ninteractions = 316, // 7^3 - 3^3 (max num cells in far-field)
+          side = 2*ORDER-1,
+          rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1),
+          opt_rc = (2*ORDER-1)*(2*ORDER-1)*ORDER}; // specific to real valued kernel (side*side*(side/2+1))
+
+    struct Symmetry{
+        int canonical; // -1 if t is never in the far field
+        int distance;  // max(|i|,|j|,|k|)
+        int axis[3];
+        int sign[3];
+    };
+
+    /// Utils
+    typedef FUnifTensor<FReal,ORDER> TensorType;
+    unsigned int node_pos[nnodes]; // position of the nodes in the (2p-1)^3 grid
+
+    /// DFT specific
+    static const int dimfft = 3; // 3D FFT, the symmetries of the cube are permutations of the frequencies
+    typedef FFftw<FReal,std::complex<FReal>,dimfft> DftClass; // Fast Discrete Fourier Transformator
+    DftClass Dft;
+
+    /// Leaf level separation criterion
+    const int LeafLevelSeparationCriterion;
+
+    /// Symmetry of each of the 343 interactions and canonical interactions that are stored
+    std::array<Symmetry, 343> symmetries;
+    std::vector<std::array<int,3>> canonicalPositions;
+
+    /// Canonical operators (Fourier space, nbCanonical*opt_rc per level)
+    std::shared_ptr< std::complex<FReal>[] > FC;
+
+    /// Persistent cache of the operators
+    std::string cacheFilename;
+    bool loadedFromCache;
+
+    explicit FUnifSymM2LHandlerCore(const int inLeafLevelSeparationCriterion)
+        : Dft(side), LeafLevelSeparationCriterion(inLeafLevelSeparationCriterion),
+          loadedFromCache(false)
+    {
+        // the node (n,m,l) is at n + m*side + l*side*side, the first axis is the last
+        // dimension of the DFT (the one that is halved by the real-to-complex DFT)
+        unsigned int node_ids[nnodes][3];
+        TensorType::setNodeIds(node_ids);
+        for (unsigned int i=0; i<nnodes; ++i)
+            node_pos[i] = node_ids[i][0] + node_ids[i][1]*side + node_ids[i][2]*side*side;
+
+        // canonical interactions that can be in the far field at some level
+        const int minSeparationCriterion = std::min(1, LeafLevelSeparationCriterion);
+        int canonicalIndexes[4][4][4];
+        for (int u0=0; u0<=3; ++u0)
+            for (int u1=0; u1<=u0; ++u1)
+                for (int u2=0; u2<=u1; ++u2) {
+                    canonicalIndexes[u0][u1][u2] = -1;
+                    if (u0 > minSeparationCriterion) {
+                        canonicalIndexes[u0][u1][u2] = int(canonicalPositions.size());
+                        canonicalPositions.emplace_back(std::array<int,3>{{u0, u1, u2}});
+                    }
+                }
+
+        for (int i=-3; i<=3; ++i)
+            for (int j=-3; j<=3; ++j)
+                for (int k=-3; k<=3; ++k) {
+                    const unsigned int idx = (i+3)*7*7 + (j+3)*7 + (k+3);
+                    const int t[3] = {i, j, k};
+                    // sort the axes by decreasing absolute value
+                    int axesOrder[3] = {0, 1, 2};
+                    std::stable_sort(axesOrder, axesOrder+3, [&t](const int a, const int b){
+                        return std::abs(t[a]) > std::abs(t[b]);
+                    });
+                    Symmetry& symmetry = symmetries[idx];
+                    int u[3];
+                    for (int r=0; r<3; ++r) {
+                        u[r] = std::abs(t[axesOrder[r]]);
+                        symmetry.axis[axesOrder[r]] = r;
+                    }
+                    for (int a=0; a<3; ++a) symmetry.sign[a] = (t[a] < 0 ? -1 : 1);
+                    symmetry.distance = u[0];
+                    symmetry.canonical = canonicalIndexes[u[0]][u[1]][u[2]];
+                }
+    }
+
+    FUnifSymM2LHandlerCore(const FUnifSymM2LHandlerCore& other)
+        : Dft(other.Dft), LeafLevelSeparationCriterion(other.LeafLevelSeparationCriterion),
+          symmetries(other.symmetries), canonicalPositions(other.canonicalPositions), FC(other.FC),
+          cacheFilename(other.cacheFilename), loadedFromCache(other.loadedFromCache)
+    {
+        // copy node_pos
+        memcpy(node_pos,other.node_pos,sizeof(unsigned int)*nnodes);
+    }
+
+    unsigned long getNbValuesPerLevel() const {
+        return (unsigned long)(canonicalPositions.size())*rc;
+    }
+
+    unsigned long getNbFourierValuesPerLevel() const {
+        return (unsigned long)(canonicalPositions.size())*opt_rc;
+    }
+
+    /** Throw if the matrix kernel is not invariant by the symmetries of the cube */
+    template <typename MatrixKernelClass>
+    static void CheckSymmetries(const MatrixKernelClass *const MatrixKernel)
+    {
+        const std::array<FReal,3> x{{FReal(0.1), FReal(-0.35), FReal(0.7)}};
+        const std::array<FReal,3> y{{FReal(1.3), FReal(0.45), FReal(-0.9)}};
+        const FReal reference = MatrixKernel->evaluate(x, y);
+        // two generators of the permutations of the axes and one reflection
+        const int axes[3][3] = {{1,0,2}, {0,2,1}, {0,1,2}};
+        const FReal signs[3][3] = {{1,1,1}, {1,1,1}, {-1,1,1}};
+        for (int idxSymmetry=0; idxSymmetry<3; ++idxSymmetry) {
+            std::array<FReal,3> sx, sy;
+            for (int a=0; a<3; ++a) {
+                sx[a] = signs[idxSymmetry][a]*x[axes[idxSymmetry][a]];
+                sy[a] = signs[idxSymmetry][a]*y[axes[idxSymmetry][a]];
+            }
+            const FReal value = MatrixKernel->evaluate(sx, sy);
+            if (std::abs(value - reference) > FReal(100)*std::numeric_limits<FReal>::epsilon()*std::abs(reference))
+                throw std::runtime_error(std::string("The symmetric M2L cannot be used with the matrix kernel ")
+                                         + MatrixKernelClass::getID());
+        }
+    }
+
+    /** Evaluate the canonical operators that are in the far field for the given separation criterion */
+    template <typename MatrixKernelClass>
+    void computeCanonical(const MatrixKernelClass *const MatrixKernel, const FReal CellWidth,
+                          const int SeparationCriterion, FReal* LevelC) const
+    {
+        const int Dim = 3;
+        // interpolation points of source (Y) and target (X) cell
+        std::array<FReal, Dim> X[nnodes], Y[nnodes];
+        TensorType::setRoots(std::array<FReal, Dim>{{0.,0.,0.}}, CellWidth, X);
+        // initialize root node ids pairs
+        unsigned int node_ids_pairs[rc][2];
+        TensorType::setNodeIdsPairs(node_ids_pairs);
+
+        for (unsigned int idxCanonical=0; idxCanonical<canonicalPositions.size(); ++idxCanonical) {
+            const std::array<int,3>& u = canonicalPositions[idxCanonical];
+            FReal* Cu = LevelC + idxCanonical*rc;
+            if (u[0] > SeparationCriterion) {
+                const std::array<FReal, Dim> cy{{CellWidth*FReal(u[0]), CellWidth*FReal(u[1]), CellWidth*FReal(u[2])}};
+                TensorType::setRoots(cy, CellWidth, Y);
+                for (unsigned int ido=0; ido<rc; ++ido)
+                    Cu[ido] = MatrixKernel->evaluate(X[node_ids_pairs[ido][0]], Y[node_ids_pairs[ido][1]]);
+            }
+            else {
+                FBlas::setzero(rc, Cu);
+            }
+        }
+    }
+
+    /** Transform the canonical operators of one level in Fourier space */
+    void buildLevelFC(const FReal *const LevelC, std::complex<FReal> *const LevelFC) const
+    {
+        // Cu stores the difference delta (target minus source node indexes) at
+        // (delta+p-1) along each axis, it goes at delta mod side in the grid
+        FReal Gu[rc];
+        std::complex<FReal> FGu[rc];
+        for (unsigned int idxCanonical=0; idxCanonical<canonicalPositions.size(); ++idxCanonical) {
+            const FReal *const Cu = LevelC + idxCanonical*rc;
+            unsigned int ido=0;
+            for (int l=1-ORDER; l<ORDER; ++l)
+                for (int m=1-ORDER; m<ORDER; ++m)
+                    for (int n=1-ORDER; n<ORDER; ++n) {
+                        Gu[(n+side)%side + ((m+side)%side)*side + ((l+side)%side)*side*side] = Cu[ido];
+                        ++ido;
+                    }
+            Dft.applyDFT(Gu, FGu);
+            FBlas::c_copy(opt_rc, reinterpret_cast<FReal*>(FGu),
+                          reinterpret_cast<FReal*>(LevelFC + idxCanonical*opt_rc));
+        }
+    }
+
+    /**
+     * Write in FCt (opt_rc values) the operator of interaction idx in Fourier space
+     * from the canonical operators of a level, or return false if idx is never in the far field.
+     * The frequency k of t is the frequency k' of u with k'[axis[a]] = sign[a]*k[a] mod side.
+     */
+    bool buildFC(const unsigned int idx, const std::complex<FReal> *const LevelFC, std::complex<FReal> *const FCt) const
+    {
+        const Symmetry& symmetry = symmetries[idx];
+        if (symmetry.canonical < 0) return false;
+        const std::complex<FReal> *const FCu = LevelFC + symmetry.canonical*opt_rc;
+
+        // for each axis of t and frequency along it: the offset in FCu of k' and of -k'
+        // and if k' is not stored (its first component is in the conjugated half)
+        const unsigned int strides[3] = {1, ORDER, side*ORDER};
+        unsigned int offsets[3][side], conjOffsets[3][side];
+        bool conjugated[3][side];
+        for (int a=0; a<3; ++a)
+            for (int k=0; k<side; ++k) {
+                const int kU = (symmetry.sign[a] > 0 ? k : (side-k)%side);
+                offsets[a][k] = kU*strides[symmetry.axis[a]];
+                conjOffsets[a][k] = ((side-kU)%side)*strides[symmetry.axis[a]];
+                conjugated[a][k] = (symmetry.axis[a] == 0 && kU >= ORDER);
             }
 
-        // Apply Discrete Fourier Transformation
-        Dft.applyDFT(_C,_FC);
-
-        // determine new index
-				const unsigned int idx = (i+3)*7*7 + (j+3)*7 + (k+3);
-
-				// store
-				{
-					// allocate
-					assert(FC[idx]==NULL);
-                    FC[idx] = new FComplex<FReal>[opt_rc];
-          FBlas::c_copy(opt_rc, reinterpret_cast<FReal*>(_FC), 
-                        reinterpret_cast<FReal*>(FC[idx]));
-				}
-
-				elapsed_time = time.tacAndElapsed(); 
-				overall_time += elapsed_time;	
-
-				counter++;
-			}
-		}
-	}
-
-		std::cout << "The approximation of the " << counter
-              << " far-field interactions (sizeM2L= " 
-              << counter*opt_rc*sizeof(FComplex<FReal>) << " B"
-              << ") took " << overall_time << "s\n" << std::endl;
-
-    // Free _C & _FC
-    delete [] _C;
-    delete [] _FC;
-}
-
-
-
-
-
-
-
-
+        unsigned int j=0;
+        for (int k2=0; k2<side; ++k2)
+            for (int k1=0; k1<side; ++k1)
+                for (int k0=0; k0<ORDER; ++k0) {
+                    if (conjugated[0][k0] || conjugated[1][k1] || conjugated[2][k2])
+                        FCt[j] = std::conj(FCu[conjOffsets[0][k0] + conjOffsets[1][k1] + conjOffsets[2][k2]]);
+                    else
+                        FCt[j] = FCu[offsets[0][k0] + offsets[1][k1] + offsets[2][k2]];
+                    ++j;
+                }
+        return true;
+    }
+
+    template <typename MatrixKernelClass>
+    static std::string getCacheKey(const MatrixKernelClass *const MatrixKernel, const int inSeparationCriterion,
+                                   const std::string& inExtra = std::string())
+    {
+        return FUnifM2LCache::BuildKey<FReal>(MatrixKernel, order, inSeparationCriterion, "symmetric;" + inExtra);
+    }
 
-/*!  \class FUnifSymM2LHandler
+public:
+    /** The cache file of the operators (empty if the cache is disabled) */
+    const std::string& getCacheFilename() const {
+        return cacheFilename;
+    }
+
+    /** True if the operators have been loaded from the cache file */
+    bool isLoadedFromCache() const {
+        return loadedFromCache;
+    }
+
+    /** The number of canonical operators that are evaluated and stored for each level */
+    unsigned int getNbStoredOperators() const {
+        return (unsigned int)(canonicalPositions.size());
+    }
+
+    /**
+    * Expands potentials \f$x+=IDFT(X)\f$ of a target cell. This operation can be
+    * seen as part of the L2L operation.
+    *
+    * @param[in] X transformed local expansion of size \f$r\f$ (3D DFT)
+    * @param[out] x local expansion of size \f$\ell^3\f$
+    */
+    void unapplyZeroPaddingAndDFT(const std::complex<FReal> *const FX, FReal *const x) const
+    {
+        FReal Px[rc];
+        FBlas::setzero(rc,Px);
+        // Apply forward Discrete Fourier Transform
+        Dft.applyIDFTNorm(FX,Px);
+        // Unapply Zero Padding
+        for (unsigned int j=0; j<nnodes; ++j)
+            x[j]=Px[node_pos[j]];
+    }
+
+    /**
+     * Transform densities \f$Y= DFT(y)\f$ of a source cell. This operation
+     * can be seen as part of the M2M operation.
+     *
+     * @param[in] y multipole expansion of size \f$\ell^3\f$
+     * @param[out] Y transformed multipole expansion of size \f$r\f$ (3D DFT)
+     */
+    void applyZeroPaddingAndDFT(FReal *const y, std::complex<FReal> *const FY) const
+    {
+        FReal Py[rc];
+        FBlas::setzero(rc,Py);
+        // Apply Zero Padding
+        for (unsigned int i=0; i<nnodes; ++i)
+            Py[node_pos[i]]=y[i];
+        // Apply forward Discrete Fourier Transform
+        Dft.applyDFT(Py,FY);
+    }
+};
 
-	\brief Deals with all the symmetries in the arrangement of the far-field interactions
 
-	Stores permutation indices and permutation vectors to reduce 316 (7^3-3^3)
-  different far-field interactions to 16 only. We use the number 343 (7^3)
-  because it allows us to use to associate the far-field interactions based on
-  the index \f$t = 7^2(i+3) + 7(j+3) + (k+3)\f$ where \f$(i,j,k)\f$ denotes
-  the relative position of the source cell to the target cell. */
-template <int ORDER, KERNEL_FUNCTION_TYPE TYPE> class FUnifSymM2LHandler;
+/**
+ * @class FUnifSymM2LHandler
+ * Same interface as FUnifM2LHandler, but only the canonical M2L operators are stored
+ * (see FUnifSymM2LHandlerCore). The matrix kernel must be invariant by the symmetries of the cube.
+ * The transformed expansions use a 3D DFT, they cannot be mixed with the ones of FUnifM2LHandler
+ * (but they have the same size).
+ *
+ * @tparam ORDER interpolation order \f$\ell\f$
+ */
+template < class FReal, int ORDER, KERNEL_FUNCTION_TYPE TYPE> class FUnifSymM2LHandler;
 
 /*! Specialization for homogeneous kernel functions */
-template <int ORDER>
-class FUnifSymM2LHandler<ORDER, HOMOGENEOUS>
+template < class FReal, int ORDER>
+class FUnifSymM2LHandler<FReal, ORDER, HOMOGENEOUS> : public FUnifSymM2LHandlerCore<FReal, ORDER>
 {
-  static const unsigned int nnodes = ORDER*ORDER*ORDER;
-
-	// M2L operators
-    FComplex<FReal>*    K[343];
+    using Parent = FUnifSymM2LHandlerCore<FReal, ORDER>;
+    using Parent::order;
+    using Parent::rc;
 
 public:
-	
-	// permutation vectors and permutated indices
-	unsigned int pvectors[343][nnodes];
-	unsigned int pindices[343];
-
-
-	/** Constructor: with 16 small SVDs */
-	template <typename MatrixKernelClass>
-	FUnifSymM2LHandler(const MatrixKernelClass *const MatrixKernel,
-                     const FReal, const unsigned int)
-	{
-		// init all 343 item to zero, because effectively only 16 exist
-		for (unsigned int t=0; t<343; ++t)
-			K[t] = NULL;
-			
-		// set permutation vector and indices
-		const FInterpSymmetries<ORDER> Symmetries;
-		for (int i=-3; i<=3; ++i)
-			for (int j=-3; j<=3; ++j)
-				for (int k=-3; k<=3; ++k) {
-					const unsigned int idx = ((i+3) * 7 + (j+3)) * 7 + (k+3);
-					pindices[idx] = 0;
-					if (abs(i)>1 || abs(j)>1 || abs(k)>1)
-						pindices[idx] = Symmetries.getPermutationArrayAndIndex(i,j,k, pvectors[idx]);
-				}
-
-		// precompute 16 M2L operators
-		const FReal ReferenceCellWidth = FReal(2.);
-		precompute<ORDER>(MatrixKernel, ReferenceCellWidth, K);
-	}
-
-
-
-	/** Destructor */
-	~FUnifSymM2LHandler()
-	{
-		for (unsigned int t=0; t<343; ++t) if (K[t]!=NULL) delete [] K[t];
-	}
-
-
-	/*! return the t-th approximated far-field interactions*/
-    const FComplex<FReal> *const getK(const unsigned int, const unsigned int t) const
-	{	return K[t]; }
-
+    template <typename MatrixKernelClass>
+    FUnifSymM2LHandler(const MatrixKernelClass *const MatrixKernel, const unsigned int, const FReal, const int inLeafLevelSeparationCriterion = 1)
+        : Parent(inLeafLevelSeparationCriterion)
+    {
+        Parent::CheckSymmetries(MatrixKernel);
+        ComputeAndSet(MatrixKernel);
+    }
+
+    FUnifSymM2LHandler(const FUnifSymM2LHandler& other) = default;
+
+    /**
+     * Computes and sets the canonical operators
+     */
+    template <typename MatrixKernelClass>
+    void ComputeAndSet(const MatrixKernelClass *const MatrixKernel)
+    {
+        // measure time
+        TbfTimer time;
+        // check if aready set
+        if (Parent::FC) throw std::runtime_error("M2L operator already set");
+        std::unique_ptr<FReal[]> C(new FReal[Parent::getNbValuesPerLevel()]);
+
+        // Load or compute the canonical operators
+        const std::string key = Parent::getCacheKey(MatrixKernel, Parent::LeafLevelSeparationCriterion);
+        Parent::cacheFilename = GetM2LCacheFilename<FReal,order,MatrixKernelClass>(key, "m2lsym");
+        Parent::loadedFromCache = LoadOrComputeM2L(Parent::cacheFilename, key, C.get(), Parent::getNbValuesPerLevel(), [&](){
+            const FReal ReferenceCellWidth = FReal(2.);
+            Parent::computeCanonical(MatrixKernel, ReferenceCellWidth, Parent::LeafLevelSeparationCriterion, C.get());
+        });
+
+        // Transform the canonical operators in Fourier space
+        Parent::FC.reset(new std::complex<FReal>[Parent::getNbFourierValuesPerLevel()]);
+        Parent::buildLevelFC(C.get(), Parent::FC.get());
+
+        // write info
+        std::cout << (Parent::loadedFromCache ? "Load " : "Compute and set ") << Parent::getNbStoredOperators()
+                  << " symmetric M2L operators (" << long(getCanonicalMemory()) << " B, "
+                  << long(getMemory()) << " B in Fourier space) in "
+                  << time.stopAndGetElapsed() << "sec."   << std::endl;
+    }
+
+    /** The memory of the canonical operators in Fourier space (the ones used by the M2L) */
+    unsigned long long getMemory() const {
+        return Parent::getNbFourierValuesPerLevel()*sizeof(std::complex<FReal>);
+    }
+
+    /** The memory of the canonical operators in the spatial domain (the size of the cache file) */
+    unsigned long long getCanonicalMemory() const {
+        return Parent::getNbValuesPerLevel()*sizeof(FReal);
+    }
+
+    /**
+     * Same as FUnifM2LHandler::applyFC, the operator of idx is read from its canonical operator.
+     */
+    void applyFC(const unsigned int idx, const unsigned int, const FReal scale,
+                 const std::complex<FReal> *const FY, std::complex<FReal> *const FX) const
+    {
+        std::complex<FReal> FCt[Parent::opt_rc];
+        if (!Parent::buildFC(idx, Parent::FC.get(), FCt)) return;
+        // Perform entrywise product manually
+        for (unsigned int j=0; j<Parent::opt_rc; ++j){
+            FX[j] += (std::complex<FReal>(scale*FCt[j].real(), scale*FCt[j].imag()) * FY[j]);
+        }
+    }
+
+    /**
+     * Same as applyFC but for nbPairs pairs of expansions that share the same interaction idx.
+     */
+    void applyFCBatch(const unsigned int idx, const unsigned int, const FReal scale, const long int nbPairs,
+                      const std::complex<FReal> *const FYs[], std::complex<FReal> *const FXs[]) const
+    {
+        std::complex<FReal> FCt[Parent::opt_rc];
+        if (!Parent::buildFC(idx, Parent::FC.get(), FCt)) return;
+        ApplyFCBatch(FCt, scale, Parent::opt_rc, nbPairs, FYs, FXs);
+    }
 };
 
 
-
-
-
-
 /*! Specialization for non-homogeneous kernel functions */
-template <int ORDER>
-class FUnifSymM2LHandler<ORDER, NON_HOMOGENEOUS>
+template <class FReal, int ORDER>
+class FUnifSymM2LHandler<FReal, ORDER, NON_HOMOGENEOUS> : public FUnifSymM2LHandlerCore<FReal, ORDER>
 {
-  static const unsigned int nnodes = ORDER*ORDER*ORDER;
-
-	// Height of octree; needed only in the case of non-homogeneous kernel functions
-	const unsigned int TreeHeight;
-
-	// M2L operators for all levels in the octree
-    FComplex<FReal>***    K;
-
-public:
-	
-	// permutation vectors and permutated indices
-	unsigned int pvectors[343][nnodes];
-	unsigned int pindices[343];
-
-
-	/** Constructor: with 16 small SVDs */
-	template <typename MatrixKernelClass>
-	FUnifSymM2LHandler(const MatrixKernelClass *const MatrixKernel,
-                     const FReal RootCellWidth, const unsigned int inTreeHeight)
-		: TreeHeight(inTreeHeight)
-	{
-		// init all 343 item to zero, because effectively only 16 exist
-        K       = new FComplex<FReal>** [TreeHeight];
-		K[0]       = NULL; K[1]       = NULL;
-		for (unsigned int l=2; l<TreeHeight; ++l) {
-            K[l]       = new FComplex<FReal>* [343];
-			for (unsigned int t=0; t<343; ++t)
-				K[l][t]       = NULL;
-		}
-		
-
-		// set permutation vector and indices
-		const FInterpSymmetries<ORDER> Symmetries;
-		for (int i=-3; i<=3; ++i)
-			for (int j=-3; j<=3; ++j)
-				for (int k=-3; k<=3; ++k) {
-					const unsigned int idx = ((i+3) * 7 + (j+3)) * 7 + (k+3);
-					pindices[idx] = 0;
-					if (abs(i)>1 || abs(j)>1 || abs(k)>1)
-						pindices[idx] = Symmetries.getPermutationArrayAndIndex(i,j,k, pvectors[idx]);
-				}
-
-		// precompute 16 M2L operators at all levels having far-field interactions
-		FReal CellWidth = RootCellWidth / FReal(2.); // at level 1
-		CellWidth /= FReal(2.);                      // at level 2
-		for (unsigned int l=2; l<TreeHeight; ++l) {
-			precompute<ORDER>(MatrixKernel, CellWidth, K[l]);
-			CellWidth /= FReal(2.);                    // at level l+1 
-		}
-	}
-
-
-
-	/** Destructor */
-	~FUnifSymM2LHandler()
-	{
-		for (unsigned int l=0; l<TreeHeight; ++l) {
-			if (K[l]!=NULL) {
-				for (unsigned int t=0; t<343; ++t) if (K[l][t]!=NULL) delete [] K[l][t];
-				delete [] K[l];
-			}
-		}
-		delete [] K;
-	}
-
-	/*! return the t-th approximated far-field interactions*/
-    const FComplex<FReal> *const getK(const unsigned int l, const unsigned int t) const
-	{	return K[l][t]; }
-
-};
-
-
+    using Parent = FUnifSymM2LHandlerCore<FReal, ORDER>;
+    using Parent::order;
+    using Parent::rc;
 
+    /// Homogeneity specific variables
+    const unsigned int TreeHeight;
+    const FReal RootCellWidth;
 
+    unsigned long getNbValues() const {
+        return (TreeHeight > 2 ? (TreeHeight-2)*Parent::getNbValuesPerLevel() : 0);
+    }
 
+    unsigned long getNbFourierValues() const {
+        return (TreeHeight > 2 ? (TreeHeight-2)*Parent::getNbFourierValuesPerLevel() : 0);
+    }
 
+    int getSeparationCriterion(const unsigned int TreeLevel) const {
+        return (TreeLevel != TreeHeight-1 ? 1 : Parent::LeafLevelSeparationCriterion);
+    }
 
+    const std::complex<FReal>* getLevelFC(const unsigned int TreeLevel) const {
+        return Parent::FC.get() + (TreeLevel-2)*Parent::getNbFourierValuesPerLevel();
+    }
 
-//#include <fstream>
-//#include <sstream>
-//
-//
-///**
-// * Computes, compresses and stores the 16 M2L kernels in a binary file.
-// */
-//template <int ORDER, typename MatrixKernelClass>
-//static void ComputeAndCompressAndStoreInBinaryFile(const MatrixKernelClass *const MatrixKernel, const FReal Epsilon)
-//{
-//	static const unsigned int nnodes = ORDER*ORDER*ORDER;
-//
-//	// compute and compress ////////////
-//	FReal* K[343];
-//	int LowRank[343];
-//	for (unsigned int idx=0; idx<343; ++idx) { K[idx] = NULL; LowRank[idx] = 0;	}
-//	precompute<ORDER>(MatrixKernel, FReal(2.), Epsilon, K, LowRank);
-//
-//	// write to binary file ////////////
-//	FTic time; time.tic();
-//	// start computing process
-//	const char precision = (typeid(FReal)==typeid(double) ? 'd' : 'f');
-//	std::stringstream sstream;
-//	sstream << "sym2l_" << precision << "_o" << ORDER << "_e" << Epsilon << ".bin";
-//	const std::string filename(sstream.str());
-//	std::ofstream stream(filename.c_str(),
-//											 std::ios::out | std::ios::binary | std::ios::trunc);
-//	if (stream.good()) {
-//		stream.seekp(0);
-//		for (unsigned int idx=0; idx<343; ++idx)
-//			if (K[idx]!=NULL) {
-//				// 1) write index
-//				stream.write(reinterpret_cast<char*>(&idx), sizeof(int));
-//				// 2) write low rank (int)
-//				int rank = LowRank[idx];
-//				stream.write(reinterpret_cast<char*>(&rank), sizeof(int));
-//				// 3) write U and V (both: rank*nnodes * FReal)
-//				FReal *const U = K[idx];
-//				FReal *const V = K[idx] + rank*nnodes;
-//				stream.write(reinterpret_cast<char*>(U), sizeof(FReal)*rank*nnodes);
-//				stream.write(reinterpret_cast<char*>(V), sizeof(FReal)*rank*nnodes);
-//			}
-//	} else throw std::runtime_error("File could not be opened to write");
-//	stream.close();
-//	// write info
-//	//	std::cout << "Compressed M2L operators stored in binary file " << filename
-//	//					<< " in " << time.tacAndElapsed() << "sec."	<< std::endl;
-//
-//	// free memory /////////////////////
-//	for (unsigned int t=0; t<343; ++t) if (K[t]!=NULL) delete [] K[t];
-//}
-//
-//
-///**
-// * Reads the 16 compressed M2L kernels from the binary files and writes them
-// * in K and the respective low-rank in LowRank.
-// */
-//template <int ORDER>
-//void ReadFromBinaryFile(const FReal Epsilon, FReal* K[343], int LowRank[343])
-//{
-//	// compile time constants
-//	const unsigned int nnodes = ORDER*ORDER*ORDER;
-//	
-//	// find filename
-//	const char precision = (typeid(FReal)==typeid(double) ? 'd' : 'f');
-//	std::stringstream sstream;
-//	sstream << "sym2l_" << precision << "_o" << ORDER << "_e" << Epsilon << ".bin";
-//	const std::string filename(sstream.str());
-//
-//	// read binary file
-//	std::ifstream istream(filename.c_str(),
-//												std::ios::in | std::ios::binary | std::ios::ate);
-//	const std::ifstream::pos_type size = istream.tellg();
-//	if (size<=0) throw std::runtime_error("The requested binary file does not yet exist. Exit.");
-//	
-//	if (istream.good()) {
-//		istream.seekg(0);
-//		// 1) read index (int)
-//		int _idx;
-//		istream.read(reinterpret_cast<char*>(&_idx), sizeof(int));
-//		// loop to find 16 compressed m2l operators
-//		for (int idx=0; idx<343; ++idx) {
-//			K[idx] = NULL;
-//			LowRank[idx] = 0;
-//			// if it exists
-//			if (idx == _idx) {
-//				// 2) read low rank (int)
-//				int rank;
-//				istream.read(reinterpret_cast<char*>(&rank), sizeof(int));
-//				LowRank[idx] = rank;
-//				// 3) read U and V (both: rank*nnodes * FReal)
-//				K[idx] = new FReal [2*rank*nnodes];
-//				FReal *const U = K[idx];
-//				FReal *const V = K[idx] + rank*nnodes;
-//				istream.read(reinterpret_cast<char*>(U), sizeof(FReal)*rank*nnodes);
-//				istream.read(reinterpret_cast<char*>(V), sizeof(FReal)*rank*nnodes);
-//
-//				// 1) read next index
-//				istream.read(reinterpret_cast<char*>(&_idx), sizeof(int));
-//			}
-//		}
-//	}	else throw std::runtime_error("File could not be opened to read");
-//	istream.close();
-//}
-
-
+public:
+    template <typename MatrixKernelClass>
+    FUnifSymM2LHandler(const MatrixKernelClass *const MatrixKernel, const unsigned int inTreeHeight, const FReal inRootCellWidth, const int inLeafLevelSeparationCriterion = 1)
+        : Parent(inLeafLevelSeparationCriterion), TreeHeight(inTreeHeight), RootCellWidth(inRootCellWidth)
+    {
+        Parent::CheckSymmetries(MatrixKernel);
+        ComputeAndSet(MatrixKernel);
+    }
+
+    FUnifSymM2LHandler(const FUnifSymM2LHandler& other) = default;
+
+    /**
+     * Computes and sets the canonical operators of each level
+     */
+    template <typename MatrixKernelClass>
+    void ComputeAndSet(const MatrixKernelClass *const MatrixKernel)
+    {
+        // measure time
+        TbfTimer time;
+        // check if already set
+        if (Parent::FC) throw std::runtime_error("M2L operator already set");
+        std::unique_ptr<FReal[]> C(new FReal[getNbValues()]);
+
+        // The operators depend on the width of the cells at each level
+        std::stringstream extraKey;
+        extraKey << "height=" << TreeHeight << ";width=" << std::hexfloat << RootCellWidth;
+        const std::string key = Parent::getCacheKey(MatrixKernel, Parent::LeafLevelSeparationCriterion, extraKey.str());
+        Parent::cacheFilename = (getNbValues() ? GetM2LCacheFilename<FReal,order,MatrixKernelClass>(key, "m2lsym") : std::string());
+
+        // Load or compute the canonical operators at each level !! (since non homog)
+        Parent::loadedFromCache = LoadOrComputeM2L(Parent::cacheFilename, key, C.get(), getNbValues(), [&](){
+            FReal CellWidth = RootCellWidth / FReal(2.); // at level 1
+            CellWidth /= FReal(2.);                      // at level 2
+            for (unsigned int l=2; l<TreeHeight; ++l) {
+                Parent::computeCanonical(MatrixKernel, CellWidth, getSeparationCriterion(l),
+                                         C.get() + (l-2)*Parent::getNbValuesPerLevel());
+                CellWidth /= FReal(2.);                    // at level l+1
+            }
+        });
+
+        // Transform the canonical operators of each level in Fourier space
+        Parent::FC.reset(new std::complex<FReal>[getNbFourierValues()]);
+        for (unsigned int l=2; l<TreeHeight; ++l) {
+            Parent::buildLevelFC(C.get() + (l-2)*Parent::getNbValuesPerLevel(),
+                                 Parent::FC.get() + (l-2)*Parent::getNbFourierValuesPerLevel());
+        }
+
+        // write info
+        std::cout << (Parent::loadedFromCache ? "Load " : "Compute and set ") << Parent::getNbStoredOperators()
+                  << " symmetric M2L operators per level (" << long(getCanonicalMemory()) << " B, "
+                  << long(getMemory()) << " B in Fourier space) in "
+                  << time.stopAndGetElapsed() << "sec."   << std::endl;
+    }
+
+    /** The memory of the canonical operators in Fourier space (the ones used by the M2L) */
+    unsigned long long getMemory() const {
+        return getNbFourierValues()*sizeof(std::complex<FReal>);
+    }
+
+    /** The memory of the canonical operators in the spatial domain (the size of the cache file) */
+    unsigned long long getCanonicalMemory() const {
+        return getNbValues()*sizeof(FReal);
+    }
+
+    /**
+     * Same as FUnifM2LHandler::applyFC, the operator of idx is read from its canonical operator.
+     */
+    void applyFC(const unsigned int idx, const unsigned int TreeLevel, const FReal,
+                 const std::complex<FReal> *const FY, std::complex<FReal> *const FX) const
+    {
+        std::complex<FReal> FCt[Parent::opt_rc];
+        if (!Parent::buildFC(idx, getLevelFC(TreeLevel), FCt)) return;
+        // Perform entrywise product manually
+        for (unsigned int j=0; j<Parent::opt_rc; ++j){
+            FX[j] += (FCt[j] * FY[j]);
+        }
+    }
+
+    /**
+     * Same as applyFC but for nbPairs pairs of expansions that share the same interaction idx.
+     */
+    void applyFCBatch(const unsigned int idx, const unsigned int TreeLevel, const FReal, const long int nbPairs,
+                      const std::complex<FReal> *const FYs[], std::complex<FReal> *const FXs[]) const
+    {
+        std::complex<FReal> FCt[Parent::opt_rc];
+        if (!Parent::buildFC(idx, getLevelFC(TreeLevel), FCt)) return;
+        ApplyFCBatch(FCt, FReal(1), Parent::opt_rc, nbPairs, FYs, FXs);
+    }
+};
 
 
+#endif // FUNIFSYMM2LHANDLER_HPP
 
-#endif
+// [--END--]
@@ -0,0 +1,285 @@
+#ifndef TBFBINARYFMALOADER_HPP
+#define TBFBINARYFMALOADER_HPP
+
+#include "tbfglobal.hpp"
+#include "utils/tbfutils.hpp"
+
+#include <vector>
+#include <array>
+#include <cassert>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+enum class TbfBinaryFmaLayout : std::int64_t {
+    AoS = 0, // All the values of a particle are contiguous
+    SoA = 1  // All the values of index i are contiguous
+};
+
+// The binary FMA file starts with this header, followed by the box widths
+// and the box center (Dim doubles each), and the payload at payloadOffset
+// (nbParticles x nbDataPerParticle values of realSize bytes).
+struct TbfBinaryFmaHeader{
+    static constexpr char Magic[8] = {'T','B','F','F','M','A','B','\0'};
+    static constexpr std::int64_t CurrentVersion = 1;
+    static constexpr std::int64_t PayloadAlignment = 64;
+
+    char magic[8];
+    std::int64_t version;
+    std::int64_t dim;
+    std::int64_t nbDataPerParticle;
+    std::int64_t nbParticles;
+    std::int64_t realSize;
+    std::int64_t layout;
+    std::int64_t payloadOffset;
+
+    static std::int64_t GetPayloadOffset(const std::int64_t inDim){
+        const std::int64_t size = std::int64_t(sizeof(TbfBinaryFmaHeader)) + 2 * inDim * std::int64_t(sizeof(double));
+        return ((size + PayloadAlignment - 1) / PayloadAlignment) * PayloadAlignment;
+    }
+};
+
+template <class RealType, const long int Dim = 3, const long int DimArray = Dim>
+class TbfBinaryFmaLoader {
+    static_assert(Dim <= DimArray);
+
+    using ParticleType = std::array<RealType, DimArray>;
+
+    const std::string filename;
+
+    int fileDescriptor;
+    const unsigned char* mappedData;
+    long int mappedSize;
+
+    TbfBinaryFmaHeader header;
+    std::array<RealType, Dim> centerOfBox;
+    std::array<RealType, Dim> boxWidths;
+    long int nbParticles;
+
+    void close(){
+        if(mappedData){
+            munmap(const_cast<unsigned char*>(mappedData), mappedSize);
+            mappedData = nullptr;
+            mappedSize = 0;
+        }
+        if(fileDescriptor != -1){
+            ::close(fileDescriptor);
+            fileDescriptor = -1;
+        }
+        nbParticles = 0;
+    }
+
+    bool open(){
+        fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+        if(fileDescriptor == -1){
+            return false;
+        }
+
+        struct stat fileStat;
+        if(fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size < long(sizeof(TbfBinaryFmaHeader))){
+            return false;
+        }
+
+        mappedSize = static_cast<long int>(fileStat.st_size);
+        void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if(mapping == MAP_FAILED){
+            mappedSize = 0;
+            return false;
+        }
+        mappedData = static_cast<const unsigned char*>(mapping);
+
+        std::memcpy(&header, mappedData, sizeof(TbfBinaryFmaHeader));
+        if(std::memcmp(header.magic, TbfBinaryFmaHeader::Magic, sizeof(header.magic)) != 0
+                || header.version != TbfBinaryFmaHeader::CurrentVersion
+                || header.dim != Dim
+                || header.nbDataPerParticle < Dim
+                || header.nbParticles < 0
+                || (header.realSize != long(sizeof(float)) && header.realSize != long(sizeof(double)))
+                || (header.layout != std::int64_t(TbfBinaryFmaLayout::AoS) && header.layout != std::int64_t(TbfBinaryFmaLayout::SoA))
+                || header.payloadOffset < TbfBinaryFmaHeader::GetPayloadOffset(Dim)){
+            return false;
+        }
+
+        // The size of the payload is not computed because a corrupted header could make
+        // the product overflow, each factor is compared to the file size instead.
+        // The payload is accessed as FileRealType (and as RealType by viewParticles),
+        // so its offset must be aligned for both
+        const std::int64_t payloadAlignment = std::max(header.realSize, std::int64_t(alignof(RealType)));
+        if(header.payloadOffset > mappedSize
+                || header.payloadOffset % payloadAlignment != 0
+                || header.nbDataPerParticle > mappedSize
+                || header.nbParticles > mappedSize
+                || header.nbParticles > (mappedSize - header.payloadOffset) / header.realSize / header.nbDataPerParticle){
+            return false;
+        }
+
+        const double* boxValues = reinterpret_cast<const double*>(mappedData + sizeof(TbfBinaryFmaHeader));
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            boxWidths[idxDim] = RealType(boxValues[idxDim]);
+            centerOfBox[idxDim] = RealType(boxValues[Dim + idxDim]);
+        }
+
+        nbParticles = static_cast<long int>(header.nbParticles);
+
+        // The payload is read once and in order
+        madvise(const_cast<unsigned char*>(mappedData), mappedSize, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    template <class FileRealType>
+    void loadParticlesCore(ParticleType outParticles[], const long int inFirstParticle, const long int inLastParticle) const{
+        const FileRealType* payload = reinterpret_cast<const FileRealType*>(mappedData + header.payloadOffset);
+        const long int nbDataPerParticle = static_cast<long int>(header.nbDataPerParticle);
+        const long int nbValuesToLoad = std::min(DimArray, nbDataPerParticle);
+
+        if(header.layout == std::int64_t(TbfBinaryFmaLayout::AoS)){
+            for(long int idxPart = inFirstParticle ; idxPart < inLastParticle ; ++idxPart){
+                const FileRealType* particleValues = payload + idxPart * nbDataPerParticle;
+                for(long int idxVal = 0 ; idxVal < nbValuesToLoad ; ++idxVal){
+                    outParticles[idxPart][idxVal] = RealType(particleValues[idxVal]);
+                }
+            }
+        }
+        else{
+            for(long int idxVal = 0 ; idxVal < nbValuesToLoad ; ++idxVal){
+                const FileRealType* values = payload + idxVal * nbParticles;
+                for(long int idxPart = inFirstParticle ; idxPart < inLastParticle ; ++idxPart){
+                    outParticles[idxPart][idxVal] = RealType(values[idxPart]);
+                }
+            }
+        }
+    }
+
+public:
+    // Particles directly read from the mapped file (valid as long as the loader exists),
+    // it can be given to the TbfTree constructor instead of a vector
+    class ParticlesView{
+        const ParticleType* particles;
+        long int nbParticles;
+
+    public:
+        ParticlesView(const ParticleType* inParticles, const long int inNbParticles)
+            : particles(inParticles), nbParticles(inNbParticles){}
+
+        long int size() const{
+            return nbParticles;
+        }
+
+        const ParticleType& operator[](const long int inIdxParticle) const{
+            assert(0 <= inIdxParticle && inIdxParticle < nbParticles);
+            return particles[inIdxParticle];
+        }
+
+        const ParticleType* begin() const{
+            return particles;
+        }
+
+        const ParticleType* end() const{
+            return particles + nbParticles;
+        }
+    };
+
+    // Number of particles loaded per chunk (and per thread)
+    static constexpr long int DefaultChunkSize = 65536;
+
+    TbfBinaryFmaLoader(std::string inFilename) :
+        filename(std::move(inFilename)),
+        fileDescriptor(-1), mappedData(nullptr), mappedSize(0),
+        header(), centerOfBox(), boxWidths(), nbParticles(0){
+        if(open() == false){
+            close();
+        }
+    }
+
+    TbfBinaryFmaLoader(const TbfBinaryFmaLoader&) = delete;
+    TbfBinaryFmaLoader& operator=(const TbfBinaryFmaLoader&) = delete;
+
+    ~TbfBinaryFmaLoader(){
+        close();
+    }
+
+    bool isOpen() const{
+        return mappedData != nullptr;
+    }
+
+    const std::array<RealType, Dim>& getBoxCenter() const{
+        return centerOfBox;
+    }
+
+    const std::array<RealType, Dim>& getBoxWidths() const{
+        return boxWidths;
+    }
+
+    long int getNbParticles() const{
+        return nbParticles;
+    }
+
+    long int getNbDataPerParticle() const{
+        return static_cast<long int>(header.nbDataPerParticle);
+    }
+
+    TbfBinaryFmaLayout getLayout() const{
+        return TbfBinaryFmaLayout(header.layout);
+    }
+
+    auto loadAllParticles(const long int inChunkSize = DefaultChunkSize) const{
+        assert(isOpen());
+        std::vector<ParticleType> particlePositions(nbParticles);
+        const long int nbChunks = (nbParticles + inChunkSize - 1) / inChunkSize;
+
+#ifdef TBF_USE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            const long int firstParticle = idxChunk * inChunkSize;
+            const long int lastParticle = std::min(nbParticles, firstParticle + inChunkSize);
+            // Values that are not in the file are set to zero
+            if(header.nbDataPerParticle < DimArray){
+                for(long int idxPart = firstParticle ; idxPart < lastParticle ; ++idxPart){
+                    particlePositions[idxPart].fill(RealType(0));
+                }
+            }
+            if(header.realSize == long(sizeof(float))){
+                loadParticlesCore<float>(particlePositions.data(), firstParticle, lastParticle);
+            }
+            else{
+                loadParticlesCore<double>(particlePositions.data(), firstParticle, lastParticle);
+            }
+        }
+
+        return particlePositions;
+    }
+
+    // The zero-copy path is possible if the file contains AoS values of RealType
+    // with exactly DimArray values per particle
+    bool canViewParticles() const{
+        return isOpen() && header.layout == std::int64_t(TbfBinaryFmaLayout::AoS)
+                && header.realSize == long(sizeof(RealType))
+                && header.nbDataPerParticle == DimArray;
+    }
+
+    ParticlesView viewAllParticles() const{
+        assert(canViewParticles());
+        return ParticlesView(reinterpret_cast<const ParticleType*>(mappedData + header.payloadOffset), nbParticles);
+    }
+
+    template <class StreamClass>
+    friend  StreamClass& operator<<(StreamClass& inStream, const TbfBinaryFmaLoader& inLoader) {
+        inStream << "TbfBinaryFmaLoader @ " << &inLoader << "\n";
+        inStream << " - Filename: " << inLoader.filename << "\n";
+        inStream << " - Number of particles: " << inLoader.nbParticles << "\n";
+        inStream << " - Number of values per particle: " << inLoader.header.nbDataPerParticle << "\n";
+        inStream << " - Layout: " << (inLoader.header.layout == std::int64_t(TbfBinaryFmaLayout::AoS) ? "AoS" : "SoA") << "\n";
+        inStream << " - Box widths: " << TbfUtils::ArrayPrinter(inLoader.boxWidths) << "\n";
+        inStream << " - Center of box: " << TbfUtils::ArrayPrinter(inLoader.centerOfBox) << "\n";
+        return inStream;
+    }
+};
+
+#endif
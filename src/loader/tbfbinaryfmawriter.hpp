@@ -0,0 +1,140 @@
+#ifndef TBFBINARYFMAWRITER_HPP
+#define TBFBINARYFMAWRITER_HPP
+
+#include "tbfglobal.hpp"
+#include "loader/tbfbinaryfmaloader.hpp"
+
+#include <vector>
+#include <array>
+#include <cassert>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <algorithm>
+
+// Write particles in the format read by TbfBinaryFmaLoader.
+// The values of a particle are the values of inParticles[idx] followed
+// (when given) by the values of inRhs[idx], such that the result of
+// getAllParticlesData/getAllParticlesRhs can be saved as a checkpoint.
+template <class RealType, const long int Dim = 3>
+class TbfBinaryFmaWriter {
+    const std::string filename;
+    std::ofstream file;
+
+    // Number of values converted before each write
+    static constexpr long int BufferSize = 65536;
+
+    template <class ContainerClass>
+    static constexpr long int NbValuesPerElement(){
+        using ElementType = std::decay_t<decltype(std::declval<const ContainerClass&>()[0])>;
+        return static_cast<long int>(std::tuple_size<ElementType>::value);
+    }
+
+    bool writeHeader(const std::array<RealType, Dim>& inBoxCenter, const std::array<RealType, Dim>& inBoxWidths,
+                     const long int inNbParticles, const long int inNbDataPerParticle, const TbfBinaryFmaLayout inLayout){
+        TbfBinaryFmaHeader header;
+        std::memcpy(header.magic, TbfBinaryFmaHeader::Magic, sizeof(header.magic));
+        header.version = TbfBinaryFmaHeader::CurrentVersion;
+        header.dim = Dim;
+        header.nbDataPerParticle = inNbDataPerParticle;
+        header.nbParticles = inNbParticles;
+        header.realSize = sizeof(RealType);
+        header.layout = std::int64_t(inLayout);
+        header.payloadOffset = TbfBinaryFmaHeader::GetPayloadOffset(Dim);
+
+        std::vector<char> headerBuffer(header.payloadOffset, 0);
+        std::memcpy(headerBuffer.data(), &header, sizeof(TbfBinaryFmaHeader));
+        double* boxValues = reinterpret_cast<double*>(headerBuffer.data() + sizeof(TbfBinaryFmaHeader));
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            boxValues[idxDim] = double(inBoxWidths[idxDim]);
+            boxValues[Dim + idxDim] = double(inBoxCenter[idxDim]);
+        }
+
+        file.write(headerBuffer.data(), std::streamsize(headerBuffer.size()));
+        return bool(file);
+    }
+
+    template <class GetValueFunc>
+    bool writePayload(const long int inNbParticles, const long int inNbDataPerParticle,
+                      const TbfBinaryFmaLayout inLayout, GetValueFunc&& inGetValue){
+        std::vector<RealType> buffer;
+        buffer.reserve(BufferSize);
+
+        auto flush = [&](){
+            file.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(buffer.size() * sizeof(RealType)));
+            buffer.clear();
+        };
+
+        if(inLayout == TbfBinaryFmaLayout::AoS){
+            for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+                for(long int idxVal = 0 ; idxVal < inNbDataPerParticle ; ++idxVal){
+                    buffer.push_back(inGetValue(idxPart, idxVal));
+                }
+                if(long(buffer.size()) + inNbDataPerParticle > BufferSize){
+                    flush();
+                }
+            }
+        }
+        else{
+            for(long int idxVal = 0 ; idxVal < inNbDataPerParticle ; ++idxVal){
+                for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+                    buffer.push_back(inGetValue(idxPart, idxVal));
+                    if(long(buffer.size()) == BufferSize){
+                        flush();
+                    }
+                }
+            }
+        }
+        flush();
+        file.flush();
+        return bool(file);
+    }
+
+public:
+    TbfBinaryFmaWriter(std::string inFilename) :
+        filename(std::move(inFilename)),
+        file(filename.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc){
+    }
+
+    bool isOpen() const{
+        return file.is_open();
+    }
+
+    template <class ParticlesContainer>
+    bool writeParticles(const std::array<RealType, Dim>& inBoxCenter, const std::array<RealType, Dim>& inBoxWidths,
+                        const long int inNbParticles, const ParticlesContainer& inParticles,
+                        const TbfBinaryFmaLayout inLayout = TbfBinaryFmaLayout::AoS){
+        constexpr long int NbDataPerParticle = NbValuesPerElement<ParticlesContainer>();
+        static_assert(Dim <= NbDataPerParticle, "The particles must contain at least the positions");
+
+        if(writeHeader(inBoxCenter, inBoxWidths, inNbParticles, NbDataPerParticle, inLayout) == false){
+            return false;
+        }
+        return writePayload(inNbParticles, NbDataPerParticle, inLayout,
+                            [&](const long int inIdxPart, const long int inIdxVal){
+            return RealType(inParticles[inIdxPart][inIdxVal]);
+        });
+    }
+
+    template <class ParticlesContainer, class RhsContainer>
+    bool writeParticlesAndRhs(const std::array<RealType, Dim>& inBoxCenter, const std::array<RealType, Dim>& inBoxWidths,
+                              const long int inNbParticles, const ParticlesContainer& inParticles,
+                              const RhsContainer& inRhs,
+                              const TbfBinaryFmaLayout inLayout = TbfBinaryFmaLayout::AoS){
+        constexpr long int NbDataPerParticle = NbValuesPerElement<ParticlesContainer>();
+        constexpr long int NbRhsPerParticle = NbValuesPerElement<RhsContainer>();
+        static_assert(Dim <= NbDataPerParticle, "The particles must contain at least the positions");
+
+        if(writeHeader(inBoxCenter, inBoxWidths, inNbParticles, NbDataPerParticle + NbRhsPerParticle, inLayout) == false){
+            return false;
+        }
+        return writePayload(inNbParticles, NbDataPerParticle + NbRhsPerParticle, inLayout,
+                            [&](const long int inIdxPart, const long int inIdxVal){
+            return (inIdxVal < NbDataPerParticle ? RealType(inParticles[inIdxPart][inIdxVal])
+                                                 : RealType(inRhs[inIdxPart][inIdxVal - NbDataPerParticle]));
+        });
+    }
+};
+
+#endif
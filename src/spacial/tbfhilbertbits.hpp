@@ -0,0 +1,202 @@
+#ifndef TBFHILBERTBITS_HPP
+#define TBFHILBERTBITS_HPP
+
+#include "tbfglobal.hpp"
+
+#include <cstdint>
+
+// Conversion between Morton and Hilbert indexes in 2D and 3D.
+// The Hilbert index of a cell at level L is obtained by transforming
+// the L digits (Dim bits each) of its Morton index from the root,
+// such that the parent of a cell is always index >> Dim (as for Morton).
+// But the orientation of a cell depends on the number of digits above it,
+// so the level is needed to go from one order to the other.
+namespace TbfHilbertBits {
+
+struct TableCase {
+    std::uint16_t digits;
+    std::uint8_t nextState;
+};
+
+template <long int Dim>
+struct StateTables;
+
+// State 0 is the root, the Morton digit is (x << 1) | y
+template <>
+struct StateTables<2> {
+    static constexpr long int NbStates = 4;
+
+    static constexpr TableCase MortonToHilbert[NbStates][4] = {
+        { {0, 1}, {1, 0}, {3, 2}, {2, 0} },
+        { {0, 0}, {3, 3}, {1, 1}, {2, 1} },
+        { {2, 2}, {1, 2}, {3, 0}, {0, 3} },
+        { {2, 3}, {3, 1}, {1, 3}, {0, 2} },
+    };
+
+    static constexpr TableCase HilbertToMorton[NbStates][4] = {
+        { {0, 1}, {1, 0}, {3, 0}, {2, 2} },
+        { {0, 0}, {2, 1}, {3, 1}, {1, 3} },
+        { {3, 3}, {1, 2}, {0, 2}, {2, 0} },
+        { {3, 2}, {2, 3}, {0, 3}, {1, 1} },
+    };
+};
+
+// The following tables have been taken from FMB
+template <>
+struct StateTables<3> {
+    static constexpr long int NbStates = 12;
+
+    static constexpr TableCase MortonToHilbert[NbStates][8] = {
+      { { 0x0, 1}, { 0x1, 2}, { 0x3, 3}, { 0x2, 2}, { 0x7, 4}, { 0x6, 5}, { 0x4, 3}, { 0x5, 5}},
+      { { 0x0, 2}, { 0x7, 6}, { 0x1, 0}, { 0x6, 7}, { 0x3, 8}, { 0x4, 8}, { 0x2, 0}, { 0x5, 7}},
+      { { 0x0, 0}, { 0x3, 9}, { 0x7, 10}, { 0x4, 9}, { 0x1, 1}, { 0x2, 1}, { 0x6, 11}, { 0x5, 11}},
+
+      { { 0x2, 6}, { 0x3, 0}, { 0x1, 6}, { 0x0, 11}, { 0x5, 9}, { 0x4, 0}, { 0x6, 9}, { 0x7, 8}},
+      { { 0x4, 11}, { 0x3, 11}, { 0x5, 0}, { 0x2, 7}, { 0x7, 5}, { 0x0, 9}, { 0x6, 0}, { 0x1, 7}},
+      { { 0x6, 4}, { 0x5, 4}, { 0x1, 8}, { 0x2, 8}, { 0x7, 0}, { 0x4, 6}, { 0x0, 10}, { 0x3, 6}},
+
+      { { 0x4, 5}, { 0x7, 7}, { 0x3, 5}, { 0x0, 3}, { 0x5, 1}, { 0x6, 1}, { 0x2, 11}, { 0x1, 11}},
+      { { 0x6, 6}, { 0x7, 1}, { 0x5, 6}, { 0x4, 10}, { 0x1, 9}, { 0x0, 4}, { 0x2, 9}, { 0x3, 10}},
+      { { 0x2, 10}, { 0x5, 3}, { 0x3, 1}, { 0x4, 1}, { 0x1, 10}, { 0x6, 3}, { 0x0, 5}, { 0x7, 9}},
+
+      { { 0x2, 4}, { 0x1, 4}, { 0x5, 8}, { 0x6, 8}, { 0x3, 2}, { 0x0, 7}, { 0x4, 2}, { 0x7, 3}},
+      { { 0x4, 7}, { 0x5, 2}, { 0x7, 11}, { 0x6, 2}, { 0x3, 7}, { 0x2, 5}, { 0x0, 8}, { 0x1, 5}},
+      { { 0x6, 10}, { 0x1, 3}, { 0x7, 2}, { 0x0, 6}, { 0x5, 10}, { 0x2, 3}, { 0x4, 4}, { 0x3, 4}},
+    };
+
+    static constexpr TableCase HilbertToMorton[NbStates][8] = {
+      { { 0x0, 1}, { 0x1, 2}, {0x3, 2}, { 0x2, 3}, { 0x6, 3}, { 0x7, 5}, { 0x5, 5}, { 0x4, 4}},
+      { { 0x0, 2}, { 0x2, 0}, {0x6, 0}, { 0x4, 8}, { 0x5, 8}, { 0x7, 7}, { 0x3, 7}, { 0x1, 6}},
+      { { 0x0, 0}, { 0x4, 1}, {0x5, 1}, { 0x1, 9}, { 0x3, 9}, { 0x7, 11}, { 0x6, 11}, { 0x2, 10}},
+
+      { { 0x3, 11}, { 0x2, 6}, { 0x0, 6}, { 0x1, 0}, { 0x5, 0}, { 0x4, 9}, { 0x6, 9}, { 0x7, 8}},
+      { { 0x5, 9}, { 0x7, 7}, { 0x3, 7}, { 0x1, 11}, { 0x0, 11}, { 0x2, 0}, { 0x6, 0}, { 0x4, 5}},
+      { { 0x6, 10}, { 0x2, 8}, { 0x3, 8}, { 0x7, 6}, { 0x5, 6}, { 0x1, 4}, { 0x0, 4}, { 0x4, 0}},
+
+      { { 0x3, 3}, { 0x7, 11}, { 0x6, 11}, { 0x2, 5}, { 0x0, 5}, { 0x4, 1}, { 0x5, 1}, { 0x1, 7}},
+      { { 0x5, 4}, { 0x4, 9}, { 0x6, 9}, { 0x7, 10}, { 0x3, 10}, { 0x2, 6}, { 0x0, 6}, { 0x1, 1}},
+      { { 0x6, 5}, { 0x4, 10}, { 0x0, 10}, { 0x2, 1}, { 0x3, 1}, { 0x1, 3}, { 0x5, 3}, { 0x7, 9}},
+
+      { { 0x5, 7}, { 0x1, 4}, { 0x0, 4}, { 0x4, 2}, { 0x6, 2}, { 0x2, 8}, { 0x3, 8}, { 0x7, 3}},
+      { { 0x6, 8}, { 0x7, 5}, { 0x5, 5}, { 0x4, 7}, { 0x0, 7}, { 0x1, 2}, { 0x3, 2}, { 0x2, 11}},
+      { { 0x3, 6}, { 0x1, 3}, { 0x5, 3}, { 0x7, 4}, { 0x6, 4}, { 0x4, 10}, { 0x0, 10}, { 0x2, 2}},
+    };
+};
+
+template <long int Dim>
+constexpr bool HasTables(){
+    return Dim == 2 || Dim == 3;
+}
+
+// Number of levels converted per table lookup (the tables have NbStates x 2^(Dim*NbLevels) cases)
+template <long int Dim>
+constexpr long int DefaultNbLevelsPerStep(){
+    return (Dim == 2 ? 4 : 3);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// One level per step
+///////////////////////////////////////////////////////////////////////////
+
+template <long int Dim>
+inline std::uint64_t ConvertPerLevel(const TableCase (&inTable)[StateTables<Dim>::NbStates][1 << Dim],
+                                     const std::uint64_t inIndex, const long int inLevel){
+    constexpr std::uint64_t DigitMask = (std::uint64_t(1) << Dim) - 1;
+    std::uint64_t res = 0;
+    long int state = 0;
+    for(long int idxLevel = inLevel-1 ; idxLevel >= 0 ; --idxLevel){
+        const TableCase& tableCase = inTable[state][(inIndex >> (idxLevel*Dim)) & DigitMask];
+        res |= (std::uint64_t(tableCase.digits) << (idxLevel*Dim));
+        state = tableCase.nextState;
+    }
+    return res;
+}
+
+template <long int Dim>
+inline long int MortonToHilbertPerLevel(const long int inMortonIndex, const long int inLevel){
+    return static_cast<long int>(ConvertPerLevel<Dim>(StateTables<Dim>::MortonToHilbert, std::uint64_t(inMortonIndex), inLevel));
+}
+
+template <long int Dim>
+inline long int HilbertToMortonPerLevel(const long int inHilbertIndex, const long int inLevel){
+    return static_cast<long int>(ConvertPerLevel<Dim>(StateTables<Dim>::HilbertToMorton, std::uint64_t(inHilbertIndex), inLevel));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Several levels per step
+///////////////////////////////////////////////////////////////////////////
+
+// Built at compile time from the one-level tables
+template <long int Dim, long int NbLevels, bool MortonToHilbert_v>
+struct MultiLevelTable {
+    static_assert(Dim*NbLevels <= 16, "The digits of a case must fit in 16 bits");
+
+    static constexpr long int NbStates = StateTables<Dim>::NbStates;
+    static constexpr long int NbCases = (1L << (Dim*NbLevels));
+
+    TableCase cases[NbStates][NbCases];
+
+    constexpr MultiLevelTable() : cases(){
+        constexpr std::uint64_t DigitMask = (std::uint64_t(1) << Dim) - 1;
+        for(long int idxState = 0 ; idxState < NbStates ; ++idxState){
+            for(long int idxCase = 0 ; idxCase < NbCases ; ++idxCase){
+                std::uint64_t digits = 0;
+                long int state = idxState;
+                for(long int idxLevel = NbLevels-1 ; idxLevel >= 0 ; --idxLevel){
+                    const std::uint64_t digit = (std::uint64_t(idxCase) >> (idxLevel*Dim)) & DigitMask;
+                    const TableCase& tableCase = (MortonToHilbert_v ? StateTables<Dim>::MortonToHilbert[state][digit]
+                                                                    : StateTables<Dim>::HilbertToMorton[state][digit]);
+                    digits |= (std::uint64_t(tableCase.digits) << (idxLevel*Dim));
+                    state = tableCase.nextState;
+                }
+                cases[idxState][idxCase].digits = static_cast<std::uint16_t>(digits);
+                cases[idxState][idxCase].nextState = static_cast<std::uint8_t>(state);
+            }
+        }
+    }
+};
+
+template <long int Dim, long int NbLevels, bool MortonToHilbert_v>
+struct MultiLevelTableInstance {
+    static constexpr MultiLevelTable<Dim, NbLevels, MortonToHilbert_v> Table{};
+};
+
+// The first (inLevel % NbLevels) levels are converted one by one,
+// the others NbLevels at a time
+template <long int Dim, long int NbLevels, bool MortonToHilbert_v>
+inline std::uint64_t ConvertMultiLevel(const std::uint64_t inIndex, const long int inLevel){
+    constexpr std::uint64_t DigitMask = (std::uint64_t(1) << Dim) - 1;
+    constexpr std::uint64_t StepMask = (std::uint64_t(1) << (Dim*NbLevels)) - 1;
+    const auto& multiLevelCases = MultiLevelTableInstance<Dim, NbLevels, MortonToHilbert_v>::Table.cases;
+
+    std::uint64_t res = 0;
+    long int state = 0;
+    long int idxLevel = inLevel-1;
+    for(long int idxSingle = 0 ; idxSingle < (inLevel % NbLevels) ; ++idxSingle, --idxLevel){
+        const TableCase& tableCase = (MortonToHilbert_v ? StateTables<Dim>::MortonToHilbert[state][(inIndex >> (idxLevel*Dim)) & DigitMask]
+                                                        : StateTables<Dim>::HilbertToMorton[state][(inIndex >> (idxLevel*Dim)) & DigitMask]);
+        res |= (std::uint64_t(tableCase.digits) << (idxLevel*Dim));
+        state = tableCase.nextState;
+    }
+    for( ; idxLevel >= 0 ; idxLevel -= NbLevels){
+        const long int shift = (idxLevel-NbLevels+1)*Dim;
+        const TableCase& tableCase = multiLevelCases[state][(inIndex >> shift) & StepMask];
+        res |= (std::uint64_t(tableCase.digits) << shift);
+        state = tableCase.nextState;
+    }
+    return res;
+}
+
+template <long int Dim, long int NbLevels = DefaultNbLevelsPerStep<Dim>()>
+inline long int MortonToHilbert(const long int inMortonIndex, const long int inLevel){
+    return static_cast<long int>(ConvertMultiLevel<Dim, NbLevels, true>(std::uint64_t(inMortonIndex), inLevel));
+}
+
+template <long int Dim, long int NbLevels = DefaultNbLevelsPerStep<Dim>()>
+inline long int HilbertToMorton(const long int inHilbertIndex, const long int inLevel){
+    return static_cast<long int>(ConvertMultiLevel<Dim, NbLevels, false>(std::uint64_t(inHilbertIndex), inLevel));
+}
+
+}
+
+#endif
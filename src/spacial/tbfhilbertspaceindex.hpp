@@ -5,16 +5,19 @@
 
 #include "utils/tbfutils.hpp"
 #include "core/tbfinteraction.hpp"
+#include "spacial/tbfmortonbits.hpp"
+#include "spacial/tbfhilbertbits.hpp"
 
 #include <vector>
 #include <array>
 #include <cassert>
+#include <algorithm>
 
 template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false>
 class TbfHilbertSpaceIndex{
 public:
     static_assert (Dim_T > 0, "Dimension must be greater than 0" );
-    static_assert (Dim_T == 3, "Dimension must be 3 for now" );
+    static_assert (TbfHilbertBits::HasTables<Dim_T>(), "Dimension must be 2 or 3" );
 
     using IndexType = long int;
     using ConfigurationClass = ConfigurationClass_T;
@@ -35,116 +38,6 @@ protected:
         return static_cast<long int>(indexFReal);
     }
 
-    /// The following code has been taken from FMB
-
-    typedef struct {
-      unsigned char triplet; /* used for its bits */
-      short next_state; /* used as a decimal number */
-    } Hilbert_Morton_table_case_t;
-
-    static const int CHILDREN_BITS_NUMBER = 3;
-
-    static constexpr Hilbert_Morton_table_case_t Hilbert2Morton_table[12][8] = {
-      { { 0x0, 1}, { 0x1, 2}, {0x3, 2}, { 0x2, 3}, { 0x6, 3}, { 0x7, 5}, { 0x5, 5}, { 0x4, 4}},
-      { { 0x0, 2}, { 0x2, 0}, {0x6, 0}, { 0x4, 8}, { 0x5, 8}, { 0x7, 7}, { 0x3, 7}, { 0x1, 6}},
-      { { 0x0, 0}, { 0x4, 1}, {0x5, 1}, { 0x1, 9}, { 0x3, 9}, { 0x7, 11}, { 0x6, 11}, { 0x2, 10}},
-
-      { { 0x3, 11}, { 0x2, 6}, { 0x0, 6}, { 0x1, 0}, { 0x5, 0}, { 0x4, 9}, { 0x6, 9}, { 0x7, 8}},
-      { { 0x5, 9}, { 0x7, 7}, { 0x3, 7}, { 0x1, 11}, { 0x0, 11}, { 0x2, 0}, { 0x6, 0}, { 0x4, 5}},
-      { { 0x6, 10}, { 0x2, 8}, { 0x3, 8}, { 0x7, 6}, { 0x5, 6}, { 0x1, 4}, { 0x0, 4}, { 0x4, 0}},
-
-      { { 0x3, 3}, { 0x7, 11}, { 0x6, 11}, { 0x2, 5}, { 0x0, 5}, { 0x4, 1}, { 0x5, 1}, { 0x1, 7}},
-      { { 0x5, 4}, { 0x4, 9}, { 0x6, 9}, { 0x7, 10}, { 0x3, 10}, { 0x2, 6}, { 0x0, 6}, { 0x1, 1}},
-      { { 0x6, 5}, { 0x4, 10}, { 0x0, 10}, { 0x2, 1}, { 0x3, 1}, { 0x1, 3}, { 0x5, 3}, { 0x7, 9}},
-
-      { { 0x5, 7}, { 0x1, 4}, { 0x0, 4}, { 0x4, 2}, { 0x6, 2}, { 0x2, 8}, { 0x3, 8}, { 0x7, 3}},
-      { { 0x6, 8}, { 0x7, 5}, { 0x5, 5}, { 0x4, 7}, { 0x0, 7}, { 0x1, 2}, { 0x3, 2}, { 0x2, 11}},
-      { { 0x3, 6}, { 0x1, 3}, { 0x5, 3}, { 0x7, 4}, { 0x6, 4}, { 0x4, 10}, { 0x0, 10}, { 0x2, 2}},
-    };
-
-
-    static constexpr Hilbert_Morton_table_case_t Morton2Hilbert_table[12][8] = {
-      { { 0x0, 1}, { 0x1, 2}, { 0x3, 3}, { 0x2, 2}, { 0x7, 4}, { 0x6, 5}, { 0x4, 3}, { 0x5, 5}},
-      { { 0x0, 2}, { 0x7, 6}, { 0x1, 0}, { 0x6, 7}, { 0x3, 8}, { 0x4, 8}, { 0x2, 0}, { 0x5, 7}},
-      { { 0x0, 0}, { 0x3, 9}, { 0x7, 10}, { 0x4, 9}, { 0x1, 1}, { 0x2, 1}, { 0x6, 11}, { 0x5, 11}},
-
-      { { 0x2, 6}, { 0x3, 0}, { 0x1, 6}, { 0x0, 11}, { 0x5, 9}, { 0x4, 0}, { 0x6, 9}, { 0x7, 8}},
-      { { 0x4, 11}, { 0x3, 11}, { 0x5, 0}, { 0x2, 7}, { 0x7, 5}, { 0x0, 9}, { 0x6, 0}, { 0x1, 7}},
-      { { 0x6, 4}, { 0x5, 4}, { 0x1, 8}, { 0x2, 8}, { 0x7, 0}, { 0x4, 6}, { 0x0, 10}, { 0x3, 6}},
-
-      { { 0x4, 5}, { 0x7, 7}, { 0x3, 5}, { 0x0, 3}, { 0x5, 1}, { 0x6, 1}, { 0x2, 11}, { 0x1, 11}},
-      { { 0x6, 6}, { 0x7, 1}, { 0x5, 6}, { 0x4, 10}, { 0x1, 9}, { 0x0, 4}, { 0x2, 9}, { 0x3, 10}},
-      { { 0x2, 10}, { 0x5, 3}, { 0x3, 1}, { 0x4, 1}, { 0x1, 10}, { 0x6, 3}, { 0x0, 5}, { 0x7, 9}},
-
-      { { 0x2, 4}, { 0x1, 4}, { 0x5, 8}, { 0x6, 8}, { 0x3, 2}, { 0x0, 7}, { 0x4, 2}, { 0x7, 3}},
-      { { 0x4, 7}, { 0x5, 2}, { 0x7, 11}, { 0x6, 2}, { 0x3, 7}, { 0x2, 5}, { 0x0, 8}, { 0x1, 5}},
-      { { 0x6, 10}, { 0x1, 3}, { 0x7, 2}, { 0x0, 6}, { 0x5, 10}, { 0x2, 3}, { 0x4, 4}, { 0x3, 4}},
-    };
-
-
-    long int Hilbert2Morton(long int Hilbert_ind) const{
-      long int mask = 0x7LL;
-      long int h;
-      long int shift = 0;
-      long int current_state = 0;
-      long int Hilbert_triplet;
-      long int Morton_triplet; /* can NOT be defined as an "unsigned char"! */
-      long int res = 0x0LL;
-
-      shift = (configuration.getTreeHeight()-1) * CHILDREN_BITS_NUMBER;
-      mask <<= shift; /* Set the mask on the triplet of bits corresponding to the first level. */
-
-      for (h=configuration.getTreeHeight(); h>0; --h){
-        Hilbert_triplet = (Hilbert_ind & mask) >> shift; /* Get the triplet of bits corresponding
-                                                          * to the current level. */
-
-        /* Get the corresponding triplet with Morton ordering: */
-        Morton_triplet = Hilbert2Morton_table[current_state][Hilbert_triplet].triplet;
-        /* Get state for next iteration: */
-        current_state = Hilbert2Morton_table[current_state][Hilbert_triplet].next_state;
-
-        /* Write Morton triplet at the place according to the current level: */
-        res |= (Morton_triplet << shift);
-
-        mask >>= CHILDREN_BITS_NUMBER;
-        shift -= CHILDREN_BITS_NUMBER;
-      }
-
-      return res;
-    }
-
-
-    long int Morton2Hilbert(long int Morton_ind) const {
-      long int mask = 0x7LL;
-      long int h;
-      long int shift = 0;
-      long int current_state = 0;
-      long int  Hilbert_triplet;  /* can NOT be defined as an "unsigned char"! */
-      long int Morton_triplet;
-      long int res = 0x0LL;
-
-      shift = (configuration.getTreeHeight()-1) * CHILDREN_BITS_NUMBER;
-      mask <<= shift; /* Set the mask on the triplet of bits corresponding to the first level. */
-
-      for (h=configuration.getTreeHeight(); h>0; --h){
-        Morton_triplet = (Morton_ind & mask) >> shift; /* Get the triplet of bits corresponding
-                                                        * to the current level. */
-
-        /* Get the corresponding triplet with Morton ordering: */
-        Hilbert_triplet = Morton2Hilbert_table[current_state][Morton_triplet].triplet;
-        /* Get state for next iteration: */
-        current_state = Morton2Hilbert_table[current_state][Morton_triplet].next_state;
-
-        /* Write Morton triplet at the place according to the current level: */
-        res |= (Hilbert_triplet << shift);
-
-        mask >>= CHILDREN_BITS_NUMBER;
-        shift -= CHILDREN_BITS_NUMBER;
-      }
-
-      return res;
-    }
-
 public:
     TbfHilbertSpaceIndex(const ConfigurationClass& inConfiguration)
         : configuration(inConfiguration){
@@ -154,6 +47,18 @@ public:
         return (IndexType(1) << (inLevel * Dim));
     }
 
+    IndexType getUpperBoundAtLeafLevel() const{
+        return getUpperBound(configuration.getTreeHeight()-1);
+    }
+
+    IndexType getBoxLimit(const long int inLevel) const{
+        return (IndexType(1) << (inLevel));
+    }
+
+    IndexType getBoxLimitAtLeafLevel() const{
+        return getBoxLimit(configuration.getTreeHeight()-1);
+    }
+
     template <class PositionType>
     IndexType getIndexFromPosition(const PositionType& inPos) const {
         std::array<long int,Dim> host;
@@ -161,7 +66,48 @@ public:
             host[idxDim] = getTreeCoordinate( inPos[idxDim] - configuration.getBoxCorner()[idxDim], idxDim);
         }
 
-        return Morton2Hilbert(getIndexFromBoxPos(host));
+        return getIndexFromBoxPos(host);
+    }
+
+    // Same as getIndexFromPosition for the positions [inFirst, inLast[ of inPositions.
+    // The Morton indexes are computed by blocks with the magic bits,
+    // and then converted with the multi-level tables.
+    template <class ContainerClass>
+    void getIndexesFromPositions(const ContainerClass& inPositions, const long int inFirst, const long int inLast,
+                                 IndexType outIndexes[]) const {
+        constexpr long int BlockSize = 64;
+        const long int leafLevel = configuration.getTreeHeight()-1;
+        const long int lastCoordinate = (1 << leafLevel)-1;
+
+        long int coordinates[Dim][BlockSize];
+
+        for(long int idxFirstInBlock = inFirst ; idxFirstInBlock < inLast ; idxFirstInBlock += BlockSize){
+            const long int nbInBlock = std::min(BlockSize, inLast - idxFirstInBlock);
+
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                const RealType boxCorner = configuration.getBoxCorner()[idxDim];
+                const RealType boxWidth = configuration.getBoxWidths()[idxDim];
+                const RealType leafWidth = configuration.getLeafWidths()[idxDim];
+                for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                    const RealType relativePosition = inPositions[idxFirstInBlock + idxPos][idxDim] - boxCorner;
+                    assert(relativePosition >= 0 && relativePosition <= boxWidth);
+                    coordinates[idxDim][idxPos] = (relativePosition == boxWidth ? lastCoordinate
+                                                                                : static_cast<long int>(relativePosition / leafWidth));
+                }
+            }
+
+            IndexType*const indexes = outIndexes + (idxFirstInBlock - inFirst);
+            for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                std::uint64_t index = 0;
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    index |= (TbfMortonBits::SpreadMagicBits<Dim>(std::uint64_t(coordinates[idxDim][idxPos])) << (Dim - idxDim - 1));
+                }
+                indexes[idxPos] = static_cast<IndexType>(index);
+            }
+            for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                indexes[idxPos] = TbfHilbertBits::MortonToHilbert<Dim>(indexes[idxPos], leafLevel);
+            }
+        }
     }
 
     std::array<RealType,Dim> getRealPosFromBoxPos(const std::array<long int,Dim>& inPos) const {
@@ -176,29 +122,16 @@ public:
         return host;
     }
 
-    std::array<long int,Dim> getBoxPosFromIndex(IndexType inMindexHilbert) const{
-        IndexType inMindex = Hilbert2Morton(inMindexHilbert);
-        IndexType mask = 0x1LL;
-
-        std::array<long int,Dim> boxPos;
-
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            boxPos[idxDim] = 0;
-        }
-
-        while(inMindex >= mask) {
-            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
-                boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
-                inMindex >>= 1;
-            }
-
-            boxPos[0] |= static_cast<long int>(inMindex & mask);
-
-            mask <<= 1;
-        }
+    // The orientation of the curve in a cell depends on its level,
+    // the versions without level are for the leaves
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inIndex, const long int inLevel) const{
+        return TbfMortonBits::Decode<Dim>(TbfHilbertBits::HilbertToMorton<Dim>(inIndex, inLevel));
+    }
 
-        return boxPos;
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inIndex) const{
+        return getBoxPosFromIndex(inIndex, configuration.getTreeHeight()-1);
     }
+
 #ifdef __NVCC__
     __device__ __host__
 #endif
@@ -210,33 +143,21 @@ public:
         return inIndexChild & static_cast<long int>(~(((~0UL)>>Dim)<<Dim));
     }
 
+    // Position of the child in its parent in Morton order (as expected by the kernels)
+    long int childPositionFromParent(const IndexType inIndexChild, const long int inChildLevel) const {
+        return TbfHilbertBits::HilbertToMorton<Dim>(inIndexChild, inChildLevel) & static_cast<long int>(~(((~0UL)>>Dim)<<Dim));
+    }
+
     const auto& getConfiguration() const{
         return configuration;
     }
 
-    IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos) const{
-        IndexType index = 0x0LL;
-        IndexType mask = 0x1LL;
-
-        bool shouldContinue = false;
-
-        std::array<IndexType,Dim> mcoord;
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
-            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-        }
-
-        while(shouldContinue){
-            shouldContinue = false;
-            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
-                index |= (mcoord[idxDim] & mask);
-                mask <<= 1;
-                mcoord[idxDim] <<= (Dim-1);
-                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-            }
-        }
+    IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos, const long int inLevel) const{
+        return TbfHilbertBits::MortonToHilbert<Dim>(TbfMortonBits::Encode<Dim>(inBoxPos), inLevel);
+    }
 
-        return Morton2Hilbert(index);
+    IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos) const{
+        return getIndexFromBoxPos(inBoxPos, configuration.getTreeHeight()-1);
     }
 
     IndexType getChildIndexFromParent(const IndexType inParentIndex, const long int inChild) const{
@@ -261,10 +182,10 @@ public:
         const long int boxLimiteParent = (1 << (inLevel-1));
 
         const IndexType cellIndex = inMIndex;
-        const auto cellPos = getBoxPosFromIndex(cellIndex);
+        const auto cellPos = getBoxPosFromIndex(cellIndex, inLevel);
 
         const IndexType parentCellIndex = getParentIndex(cellIndex);
-        const auto parentCellPos = getBoxPosFromIndex(parentCellIndex);
+        const auto parentCellPos = getBoxPosFromIndex(parentCellIndex, inLevel-1);
 
 
         std::array<long int, Dim> minLimits;
@@ -325,11 +246,11 @@ public:
                     }
                 }
             }
-            const IndexType otherParentIndex = getIndexFromBoxPos(otherParentPos);
+            const IndexType otherParentIndex = getIndexFromBoxPos(otherParentPos, inLevel-1);
 
             for(long int idxChild = 0 ; idxChild < (1<<Dim) ; ++idxChild){
                 const IndexType childIndex = getChildIndexFromParent(otherParentIndex, idxChild);
-                auto childPos = getBoxPosFromIndex(childIndex);
+                auto childPos = getBoxPosFromIndex(childIndex, inLevel);
 
                 bool isTooClose = true;
                 for(int idxDim = 0 ; isTooClose && idxDim < Dim ; ++idxDim){
@@ -394,10 +315,10 @@ public:
 
         for(long int idxCell = 0 ; idxCell < inGroup.getNbCells() ; ++idxCell){
             const IndexType cellIndex = inGroup.getCellSpacialIndex(idxCell);
-            const auto cellPos = getBoxPosFromIndex(cellIndex);
+            const auto cellPos = getBoxPosFromIndex(cellIndex, inLevel);
 
             const IndexType parentCellIndex = getParentIndex(cellIndex);
-            const auto parentCellPos = getBoxPosFromIndex(parentCellIndex);
+            const auto parentCellPos = getBoxPosFromIndex(parentCellIndex, inLevel-1);
 
 
             std::array<long int, Dim> minLimits;
@@ -458,12 +379,12 @@ public:
                         }
                     }
                 }
-                const IndexType otherParentIndex = getIndexFromBoxPos(otherParentPos);
+                const IndexType otherParentIndex = getIndexFromBoxPos(otherParentPos, inLevel-1);
 
 
                 for(long int idxChild = 0 ; idxChild < (1<<Dim) ; ++idxChild){
                     const IndexType childIndex = getChildIndexFromParent(otherParentIndex, idxChild);
-                    auto childPos = getBoxPosFromIndex(childIndex);
+                    auto childPos = getBoxPosFromIndex(childIndex, inLevel);
 
                     bool isTooClose = true;
                     for(int idxDim = 0 ; isTooClose && idxDim < Dim ; ++idxDim){
@@ -520,7 +441,7 @@ public:
         std::vector<IndexType> indexes;
         indexes.reserve(TbfUtils::lipow(3,Dim)/2);
 
-        const auto cellPos = getBoxPosFromIndex(cellIndex);
+        const auto cellPos = getBoxPosFromIndex(cellIndex, inLevel);
 
         std::array<long int, Dim> minLimits;
         std::array<long int, Dim> maxLimits;
@@ -591,7 +512,7 @@ public:
                     }
                 }
 
-                const IndexType otherIndex = getIndexFromBoxPos(otherPos);
+                const IndexType otherIndex = getIndexFromBoxPos(otherPos, inLevel);
 
                 // We cannot compare with otherIndex < cellIndex due to periodicity
                 if(upperExclusion == false || TbfUtils::lipow(3, Dim)/2 < arrayPos){
@@ -622,7 +543,7 @@ public:
 
         for(long int idxCell = 0 ; idxCell < inGroup.getNbLeaves() ; ++idxCell){
             const IndexType cellIndex = inGroup.getLeafSpacialIndex(idxCell);
-            const auto cellPos = getBoxPosFromIndex(cellIndex);
+            const auto cellPos = getBoxPosFromIndex(cellIndex, inLevel);
 
             std::array<long int, Dim> minLimits;
             std::array<long int, Dim> maxLimits;
@@ -690,7 +611,7 @@ public:
                         }
                     }
 
-                    const IndexType otherIndex = getIndexFromBoxPos(otherPos);
+                    const IndexType otherIndex = getIndexFromBoxPos(otherPos, inLevel);
 
                     // We cannot compare with otherIndex < cellIndex due to periodicity
                     if(upperExclusion == false || TbfUtils::lipow(3, Dim)/2 < arrayPos){
@@ -823,6 +744,16 @@ public:
         return arrayPos;
     }
 
+    auto getColorsIdxAtLeafLevel(const IndexType inLeafIndex) const{
+        const auto leafPos = getBoxPosFromIndex(inLeafIndex);
+        long int colorIdx = 0;
+        for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            colorIdx *= 3;
+            colorIdx += (leafPos[idxDim]%3);
+        }
+        return colorIdx;
+    }
+
     template <class StreamClass>
     friend  StreamClass& operator<<(StreamClass& inStream, const TbfHilbertSpaceIndex& inSpaceSystem) {
         inStream << "TbfHilbertSpaceIndex @ " << &inSpaceSystem << "\n";
@@ -0,0 +1,231 @@
+#ifndef TBFMORTONBITS_HPP
+#define TBFMORTONBITS_HPP
+
+#include "tbfglobal.hpp"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__BMI2__) && !defined(__NVCC__)
+#include <immintrin.h>
+#define TBF_MORTON_USE_BMI2
+#endif
+
+// Interleaving of the box coordinates into a Morton index.
+// Bit b of the coordinate d is bit (b*Dim + Dim-1-d) of the index,
+// such that the coordinate 0 gives the most significant bit of each group.
+// Encode/Decode use pdep/pext if BMI2 is available at compile time,
+// the magic-bits shifts in 2D and 3D otherwise, and the original loops
+// for the other dimensions.
+namespace TbfMortonBits {
+
+constexpr bool HasBmi2(){
+#ifdef TBF_MORTON_USE_BMI2
+    return true;
+#else
+    return false;
+#endif
+}
+
+template <long int Dim>
+constexpr bool HasMagicBits(){
+    return Dim == 1 || Dim == 2 || Dim == 3;
+}
+
+// One bit every Dim bits, starting from bit 0
+template <long int Dim>
+constexpr std::uint64_t SpreadMask(){
+    std::uint64_t mask = 0;
+    for(long int idxBit = 0 ; idxBit < 64 ; idxBit += Dim){
+        mask |= (std::uint64_t(1) << idxBit);
+    }
+    return mask;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Original loops
+///////////////////////////////////////////////////////////////////////////
+
+template <long int Dim>
+inline long int EncodeLoop(const std::array<long int,Dim>& inBoxPos){
+    long int index = 0x0LL;
+    long int mask = 0x1LL;
+
+    bool shouldContinue = false;
+
+    std::array<long int,Dim> mcoord;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
+        shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+    }
+
+    while(shouldContinue){
+        shouldContinue = false;
+        for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
+            index |= (mcoord[idxDim] & mask);
+            mask <<= 1;
+            mcoord[idxDim] <<= (Dim-1);
+            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+        }
+    }
+
+    return index;
+}
+
+template <long int Dim>
+inline std::array<long int,Dim> DecodeLoop(long int inMindex){
+    long int mask = 0x1LL;
+
+    std::array<long int,Dim> boxPos;
+
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        boxPos[idxDim] = 0;
+    }
+
+    while(inMindex >= mask) {
+        for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
+            boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
+            inMindex >>= 1;
+        }
+
+        boxPos[0] |= static_cast<long int>(inMindex & mask);
+
+        mask <<= 1;
+    }
+
+    return boxPos;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Magic bits
+///////////////////////////////////////////////////////////////////////////
+
+template <long int Dim>
+inline std::uint64_t SpreadMagicBits(std::uint64_t inValue){
+    static_assert(HasMagicBits<Dim>(), "Magic bits are only available in 1D, 2D and 3D");
+    if constexpr(Dim == 1){
+        return inValue;
+    }
+    else if constexpr(Dim == 2){
+        inValue &= 0x00000000FFFFFFFFULL;
+        inValue = (inValue | (inValue << 16)) & 0x0000FFFF0000FFFFULL;
+        inValue = (inValue | (inValue << 8))  & 0x00FF00FF00FF00FFULL;
+        inValue = (inValue | (inValue << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+        inValue = (inValue | (inValue << 2))  & 0x3333333333333333ULL;
+        inValue = (inValue | (inValue << 1))  & 0x5555555555555555ULL;
+        return inValue;
+    }
+    else{
+        inValue &= 0x00000000001FFFFFULL;
+        inValue = (inValue | (inValue << 32)) & 0x001F00000000FFFFULL;
+        inValue = (inValue | (inValue << 16)) & 0x001F0000FF0000FFULL;
+        inValue = (inValue | (inValue << 8))  & 0x100F00F00F00F00FULL;
+        inValue = (inValue | (inValue << 4))  & 0x10C30C30C30C30C3ULL;
+        inValue = (inValue | (inValue << 2))  & 0x1249249249249249ULL;
+        return inValue;
+    }
+}
+
+template <long int Dim>
+inline std::uint64_t CompactMagicBits(std::uint64_t inValue){
+    static_assert(HasMagicBits<Dim>(), "Magic bits are only available in 1D, 2D and 3D");
+    if constexpr(Dim == 1){
+        return inValue;
+    }
+    else if constexpr(Dim == 2){
+        inValue &= 0x5555555555555555ULL;
+        inValue = (inValue | (inValue >> 1))  & 0x3333333333333333ULL;
+        inValue = (inValue | (inValue >> 2))  & 0x0F0F0F0F0F0F0F0FULL;
+        inValue = (inValue | (inValue >> 4))  & 0x00FF00FF00FF00FFULL;
+        inValue = (inValue | (inValue >> 8))  & 0x0000FFFF0000FFFFULL;
+        inValue = (inValue | (inValue >> 16)) & 0x00000000FFFFFFFFULL;
+        return inValue;
+    }
+    else{
+        inValue &= 0x1249249249249249ULL;
+        inValue = (inValue | (inValue >> 2))  & 0x10C30C30C30C30C3ULL;
+        inValue = (inValue | (inValue >> 4))  & 0x100F00F00F00F00FULL;
+        inValue = (inValue | (inValue >> 8))  & 0x001F0000FF0000FFULL;
+        inValue = (inValue | (inValue >> 16)) & 0x001F00000000FFFFULL;
+        inValue = (inValue | (inValue >> 32)) & 0x00000000001FFFFFULL;
+        return inValue;
+    }
+}
+
+template <long int Dim>
+inline long int EncodeMagicBits(const std::array<long int,Dim>& inBoxPos){
+    std::uint64_t index = 0;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        index |= (SpreadMagicBits<Dim>(std::uint64_t(inBoxPos[idxDim])) << (Dim - idxDim - 1));
+    }
+    return static_cast<long int>(index);
+}
+
+template <long int Dim>
+inline std::array<long int,Dim> DecodeMagicBits(const long int inMindex){
+    std::array<long int,Dim> boxPos;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        boxPos[idxDim] = static_cast<long int>(CompactMagicBits<Dim>(std::uint64_t(inMindex) >> (Dim - idxDim - 1)));
+    }
+    return boxPos;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BMI2
+///////////////////////////////////////////////////////////////////////////
+
+#ifdef TBF_MORTON_USE_BMI2
+template <long int Dim>
+inline long int EncodeBmi2(const std::array<long int,Dim>& inBoxPos){
+    std::uint64_t index = 0;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        index |= _pdep_u64(std::uint64_t(inBoxPos[idxDim]), SpreadMask<Dim>() << (Dim - idxDim - 1));
+    }
+    return static_cast<long int>(index);
+}
+
+template <long int Dim>
+inline std::array<long int,Dim> DecodeBmi2(const long int inMindex){
+    std::array<long int,Dim> boxPos;
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        boxPos[idxDim] = static_cast<long int>(_pext_u64(std::uint64_t(inMindex), SpreadMask<Dim>() << (Dim - idxDim - 1)));
+    }
+    return boxPos;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// Best available
+///////////////////////////////////////////////////////////////////////////
+
+template <long int Dim>
+inline long int Encode(const std::array<long int,Dim>& inBoxPos){
+#ifdef TBF_MORTON_USE_BMI2
+    return EncodeBmi2<Dim>(inBoxPos);
+#else
+    if constexpr(HasMagicBits<Dim>()){
+        return EncodeMagicBits<Dim>(inBoxPos);
+    }
+    else{
+        return EncodeLoop<Dim>(inBoxPos);
+    }
+#endif
+}
+
+template <long int Dim>
+inline std::array<long int,Dim> Decode(const long int inMindex){
+#ifdef TBF_MORTON_USE_BMI2
+    return DecodeBmi2<Dim>(inMindex);
+#else
+    if constexpr(HasMagicBits<Dim>()){
+        return DecodeMagicBits<Dim>(inMindex);
+    }
+    else{
+        return DecodeLoop<Dim>(inMindex);
+    }
+#endif
+}
+
+}
+
+#endif
@@ -5,10 +5,12 @@
 
 #include "utils/tbfutils.hpp"
 #include "core/tbfinteraction.hpp"
+#include "spacial/tbfmortonbits.hpp"
 
 #include <vector>
 #include <array>
 #include <cassert>
+#include <algorithm>
 
 template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false>
 class TbfMortonSpaceIndex{
@@ -65,6 +67,54 @@ public:
         return getIndexFromBoxPos(host);
     }
 
+    // Same as getIndexFromPosition for the positions [inFirst, inLast[ of inPositions.
+    // The coordinates are computed by blocks and encoded with the magic bits
+    // (when available) such that the compiler can vectorize the loops.
+    template <class ContainerClass>
+    void getIndexesFromPositions(const ContainerClass& inPositions, const long int inFirst, const long int inLast,
+                                 IndexType outIndexes[]) const {
+        constexpr long int BlockSize = 64;
+        const long int lastCoordinate = (1 << (configuration.getTreeHeight()-1))-1;
+
+        long int coordinates[Dim][BlockSize];
+
+        for(long int idxFirstInBlock = inFirst ; idxFirstInBlock < inLast ; idxFirstInBlock += BlockSize){
+            const long int nbInBlock = std::min(BlockSize, inLast - idxFirstInBlock);
+
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                const RealType boxCorner = configuration.getBoxCorner()[idxDim];
+                const RealType boxWidth = configuration.getBoxWidths()[idxDim];
+                const RealType leafWidth = configuration.getLeafWidths()[idxDim];
+                for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                    const RealType relativePosition = inPositions[idxFirstInBlock + idxPos][idxDim] - boxCorner;
+                    assert(relativePosition >= 0 && relativePosition <= boxWidth);
+                    coordinates[idxDim][idxPos] = (relativePosition == boxWidth ? lastCoordinate
+                                                                                : static_cast<long int>(relativePosition / leafWidth));
+                }
+            }
+
+            IndexType*const indexes = outIndexes + (idxFirstInBlock - inFirst);
+            if constexpr(TbfMortonBits::HasMagicBits<Dim>()){
+                for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                    std::uint64_t index = 0;
+                    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        index |= (TbfMortonBits::SpreadMagicBits<Dim>(std::uint64_t(coordinates[idxDim][idxPos])) << (Dim - idxDim - 1));
+                    }
+                    indexes[idxPos] = static_cast<IndexType>(index);
+                }
+            }
+            else{
+                for(long int idxPos = 0 ; idxPos < nbInBlock ; ++idxPos){
+                    std::array<long int,Dim> boxPos;
+                    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        boxPos[idxDim] = coordinates[idxDim][idxPos];
+                    }
+                    indexes[idxPos] = getIndexFromBoxPos(boxPos);
+                }
+            }
+        }
+    }
+
     std::array<RealType,Dim> getRealPosFromBoxPos(const std::array<long int,Dim>& inPos) const {
         const std::array<RealType,Dim> boxCorner(configuration.getBoxCenter(),-(configuration.getBoxWidths()/2));
 
@@ -77,27 +127,13 @@ public:
         return host;
     }
 
-    std::array<long int,Dim> getBoxPosFromIndex(IndexType inMindex) const{
-        IndexType mask = 0x1LL;
-
-        std::array<long int,Dim> boxPos;
-
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            boxPos[idxDim] = 0;
-        }
-
-        while(inMindex >= mask) {
-            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
-                boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
-                inMindex >>= 1;
-            }
-
-            boxPos[0] |= static_cast<long int>(inMindex & mask);
-
-            mask <<= 1;
-        }
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inMindex) const{
+        return TbfMortonBits::Decode<Dim>(inMindex);
+    }
 
-        return boxPos;
+    // The Morton index does not depend on the level (same interface as Hilbert)
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inMindex, const long int /*inLevel*/) const{
+        return getBoxPosFromIndex(inMindex);
     }
 #ifdef __NVCC__
     __device__ __host__
@@ -110,33 +146,20 @@ public:
         return inIndexChild & static_cast<long int>(~(((~0UL)>>Dim)<<Dim));
     }
 
+    long int childPositionFromParent(const IndexType inIndexChild, const long int /*inChildLevel*/) const {
+        return childPositionFromParent(inIndexChild);
+    }
+
     const auto& getConfiguration() const{
         return configuration;
     }
 
     IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos) const{
-        IndexType index = 0x0LL;
-        IndexType mask = 0x1LL;
-
-        bool shouldContinue = false;
-
-        std::array<IndexType,Dim> mcoord;
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
-            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-        }
-
-        while(shouldContinue){
-            shouldContinue = false;
-            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
-                index |= (mcoord[idxDim] & mask);
-                mask <<= 1;
-                mcoord[idxDim] <<= (Dim-1);
-                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-            }
-        }
+        return TbfMortonBits::Encode<Dim>(inBoxPos);
+    }
 
-        return index;
+    IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos, const long int /*inLevel*/) const{
+        return getIndexFromBoxPos(inBoxPos);
     }
 
     IndexType getChildIndexFromParent(const IndexType inParentIndex, const long int inChild) const{
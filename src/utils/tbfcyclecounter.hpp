@@ -0,0 +1,63 @@
+#ifndef TBFCYCLECOUNTER_HPP
+#define TBFCYCLECOUNTER_HPP
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TBF_USE_RDTSC
+#endif
+
+// A cheap time stamp to measure very short calls:
+// the time stamp counter on x86, the steady clock in nanoseconds otherwise.
+// The values are only meaningful as differences taken on the same core.
+class TbfCycleCounter {
+public:
+    using CycleType = unsigned long long;
+
+    static CycleType GetCycles(){
+#ifdef TBF_USE_RDTSC
+        return static_cast<CycleType>(__rdtsc());
+#else
+        return static_cast<CycleType>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static constexpr bool UseTimeStampCounter(){
+#ifdef TBF_USE_RDTSC
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Calibrated once against the steady clock
+    static double GetCyclesPerSecond(){
+        static const double cyclesPerSecond = Calibrate();
+        return cyclesPerSecond;
+    }
+
+    static double CyclesToSeconds(const CycleType inCycles){
+        return double(inCycles)/GetCyclesPerSecond();
+    }
+
+private:
+    static double Calibrate(){
+        if(UseTimeStampCounter() == false){
+            return 1e9;
+        }
+        using ClockType = std::chrono::steady_clock;
+        const auto startTime = ClockType::now();
+        const CycleType startCycles = GetCycles();
+        auto endTime = ClockType::now();
+        while(endTime - startTime < std::chrono::milliseconds(20)){
+            endTime = ClockType::now();
+        }
+        const CycleType endCycles = GetCycles();
+        const double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+        return double(endCycles - startCycles)/elapsed;
+    }
+};
+
+#endif
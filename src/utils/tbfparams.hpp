@@ -5,6 +5,8 @@
 #include <iostream>
 #include <cstring>
 #include <vector>
+#include <memory>
+#include <cassert>
 
 namespace TbfParams{
     const static int NotFound = -1;
@@ -0,0 +1,157 @@
+#ifndef TBFTASKTRACER_HPP
+#define TBFTASKTRACER_HPP
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+
+// Record the tasks executed by the parallel algorithms (one event per task)
+// and export them in the Chrome trace-event format, which can be opened with
+// chrome://tracing or https://ui.perfetto.dev
+class TbfTaskTracer {
+public:
+    struct Event{
+        const char* name;
+        long int level;
+        long int idxGroup;
+        // The source group (the lower one for the M2M and the upper one for the L2L), -1 if none
+        long int idxOtherGroup;
+        // The particles for the P2M/L2P, the cells of the lower group for the M2M/L2L
+        // and the pairs of cells or leaves for the M2L/P2P
+        long int nbInteractions;
+        long int idxThread;
+        // In nanoseconds since the creation (or the last reset) of the tracer
+        long int startTime;
+        long int endTime;
+    };
+
+    // Record an event from its construction to its destruction, does nothing if the tracer is null
+    class Scope{
+        TbfTaskTracer* tracer;
+        const char* name;
+        long int level;
+        long int idxGroup;
+        long int idxOtherGroup;
+        long int nbInteractions;
+        long int startTime;
+
+    public:
+        Scope(TbfTaskTracer* inTracer, const char* inName, const long int inLevel, const long int inIdxGroup,
+              const long int inIdxOtherGroup, const long int inNbInteractions)
+            : tracer(inTracer), name(inName), level(inLevel), idxGroup(inIdxGroup),
+              idxOtherGroup(inIdxOtherGroup), nbInteractions(inNbInteractions),
+              startTime(inTracer ? inTracer->getTime() : 0){
+        }
+
+        ~Scope(){
+            if(tracer){
+                tracer->addEvent(name, level, idxGroup, idxOtherGroup, nbInteractions, startTime, tracer->getTime());
+            }
+        }
+
+        // When it is only known during the task
+        void setNbInteractions(const long int inNbInteractions){
+            nbInteractions = inNbInteractions;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    using ClockType = std::chrono::steady_clock;
+
+    ClockType::time_point origin;
+
+    mutable std::mutex eventsMutex;
+    std::vector<Event> events;
+    // The position of a thread gives its index in the events
+    std::vector<std::thread::id> threadIds;
+
+    long int getThreadIndex(const std::thread::id inThreadId){
+        for(long int idxThread = 0 ; idxThread < static_cast<long int>(threadIds.size()) ; ++idxThread){
+            if(threadIds[idxThread] == inThreadId){
+                return idxThread;
+            }
+        }
+        threadIds.emplace_back(inThreadId);
+        return static_cast<long int>(threadIds.size())-1;
+    }
+
+public:
+    TbfTaskTracer() : origin(ClockType::now()){}
+
+    TbfTaskTracer(const TbfTaskTracer&) = delete;
+    TbfTaskTracer& operator=(const TbfTaskTracer&) = delete;
+
+    void reset(){
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.clear();
+        threadIds.clear();
+        origin = ClockType::now();
+    }
+
+    long int getTime() const{
+        return static_cast<long int>(std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - origin).count());
+    }
+
+    void addEvent(const char* inName, const long int inLevel, const long int inIdxGroup, const long int inIdxOtherGroup,
+                  const long int inNbInteractions, const long int inStartTime, const long int inEndTime){
+        const std::thread::id threadId = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.emplace_back(Event{inName, inLevel, inIdxGroup, inIdxOtherGroup, inNbInteractions,
+                                  getThreadIndex(threadId), inStartTime, inEndTime});
+    }
+
+    // Must not be called while tasks are running
+    const std::vector<Event>& getEvents() const{
+        return events;
+    }
+
+    long int getNbThreads() const{
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        return static_cast<long int>(threadIds.size());
+    }
+
+    template <class StreamClass>
+    void writeChromeTrace(StreamClass& inStream) const{
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        inStream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        const char* separator = "\n";
+        for(long int idxThread = 0 ; idxThread < static_cast<long int>(threadIds.size()) ; ++idxThread){
+            inStream << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << idxThread
+                     << ",\"args\":{\"name\":\"Thread " << idxThread << "\"}}";
+            separator = ",\n";
+        }
+        // The format of the caller is restored at the end
+        const auto previousFlags = inStream.flags();
+        const auto previousPrecision = inStream.precision();
+        inStream << std::fixed << std::setprecision(3);
+        for(const Event& event : events){
+            // The timestamps are in microseconds
+            inStream << separator << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.idxThread
+                     << ",\"ts\":" << double(event.startTime)/1000. << ",\"dur\":" << double(event.endTime - event.startTime)/1000.
+                     << ",\"args\":{\"level\":" << event.level << ",\"group\":" << event.idxGroup
+                     << ",\"source group\":" << event.idxOtherGroup << ",\"interactions\":" << event.nbInteractions << "}}";
+            separator = ",\n";
+        }
+        inStream << "\n]}\n";
+        inStream.flags(previousFlags);
+        inStream.precision(previousPrecision);
+    }
+
+    bool exportChromeTrace(const std::string& inFilename) const{
+        std::ofstream file(inFilename, std::ofstream::out | std::ofstream::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+        writeChromeTrace(file);
+        return file.good();
+    }
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <utility>
 #include <iterator>
 #include <array>
+#include <algorithm>
 
 namespace TbfUtils {
 template <bool...>
@@ -210,6 +211,31 @@ constexpr long int lower_bound_indexes(long int first, const long int last, cons
     return first;
 }
 
+// Same as lower_bound_indexes but the search starts from inHint (usually the result
+// of the previous search), and gallops forward from it such that a sequence of
+// increasing values costs O(log(distance)) per search instead of O(log(last-first)).
+template<class T, class Compare>
+constexpr long int lower_bound_indexes_from_hint(const long int first, const long int last, long int inHint, const T& value, Compare comp)
+{
+    inHint = std::max(first, std::min(last, inHint));
+
+    if(inHint != last && comp(inHint, value)){
+        long int lowerLimit = inHint + 1;
+        long int step = 1;
+        while(lowerLimit + step - 1 < last && comp(lowerLimit + step - 1, value)){
+            lowerLimit += step;
+            step *= 2;
+        }
+        return lower_bound_indexes(lowerLimit, std::min(last, lowerLimit + step - 1), value, comp);
+    }
+
+    if(inHint == first || comp(inHint - 1, value)){
+        return inHint;
+    }
+
+    return lower_bound_indexes(first, inHint - 1, value, comp);
+}
+
 
 template <typename T, std::size_t...Is>
 constexpr std::array<T, sizeof...(Is)>
@@ -13,6 +13,9 @@
 #include "kernels/testkernel/tbftestkernel.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
 
+#include <set>
+#include <map>
+
 
 template <class AlgorithmClass>
 class TestTestKernel : public UTester< TestTestKernel<AlgorithmClass> > {
@@ -238,6 +241,196 @@ class TestTestKernel : public UTester< TestTestKernel<AlgorithmClass> > {
 
             UASSERTETRUE(int(indexExist.size()) == NbParticles);
         }
+
+        {
+            TreeClass tree(configuration, particlePositions, NbElementsPerBlock, OneGroupPerParent);
+
+            // Build the interaction lists of the tree before it is modified
+            AlgorithmClass algorithm(configuration);
+            algorithm.execute(tree, TbfAlgorithmUtils::TbfP2P);
+
+            // Get the particles of each leaf, and the values of each cell, for comparing two trees
+            auto getLeaves = [](TreeClass& inTree){
+                std::map<long int, std::set<long int>> leaves;
+                inTree.applyToAllLeaves([&leaves](auto&& leafHeader, const long int* particleIndexes,
+                                        const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> /*particleRhsPtr*/){
+                    leaves[leafHeader.spaceIndex].insert(particleIndexes, particleIndexes + leafHeader.nbParticles);
+                });
+                return leaves;
+            };
+            auto getCells = [](TreeClass& inTree){
+                std::map<std::pair<long int, long int>, std::pair<long int, long int>> cells;
+                inTree.applyToAllCells([&cells](const long int inLevel, auto&& cellHeader,
+                                       const std::optional<std::reference_wrapper<MultipoleClass>> cellMultipole,
+                                       const std::optional<std::reference_wrapper<LocalClass>> cellLocal){
+                    cells[std::make_pair(inLevel, cellHeader.spaceIndex)] = std::make_pair((*cellMultipole).get()[0], (*cellLocal).get()[0]);
+                });
+                return cells;
+            };
+
+            auto getRhs = [NbParticles](TreeClass& inTree){
+                std::vector<long int> rhs(NbParticles, -1);
+                inTree.applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
+                                        const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                    for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        rhs[particleIndexes[idxPart]] = particleRhsPtr[0][idxPart];
+                    }
+                });
+                return rhs;
+            };
+
+            std::vector<std::array<RealType, Dim>> movedPositions = particlePositions;
+
+            // The tree is rebuilt several times to check that the groups stay bounded
+            for(long int idxMove = 0 ; idxMove < 3 ; ++idxMove){
+                for(long int idxPart = idxMove ; idxPart < NbParticles ; idxPart += 3){
+                    for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        movedPositions[idxPart][idxDim] = BoxWidths[idxDim] - movedPositions[idxPart][idxDim];
+                    }
+                }
+
+                tree.applyToAllLeaves([&movedPositions](auto&& leafHeader, const long int* particleIndexes,
+                                      const std::array<RealType*, Dim> particleDataPtr, const std::array<long int*, 1> particleRhsPtr){
+                    for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        for(int idxData = 0 ; idxData < Dim ; ++idxData){
+                            particleDataPtr[idxData][idxPart] = movedPositions[particleIndexes[idxPart]][idxData];
+                        }
+                        particleRhsPtr[0][idxPart] = 0;
+                    }
+                });
+
+                const long int nbMigrants = tree.rebuildIncremental();
+                UASSERTETRUE(0 <= nbMigrants && nbMigrants <= NbParticles);
+                UASSERTEEQUAL(tree.rebuildIncremental(), 0L);
+
+                for(const auto& particleGroup : tree.getParticleGroups()){
+                    UASSERTETRUE(particleGroup.getNbLeaves() <= tree.getNbElementsPerGroup());
+                }
+
+                tree.applyToAllLeaves([this, &movedPositions, &spacialSystem](auto&& leafHeader, const long int* particleIndexes,
+                                      const std::array<RealType*, Dim> particleDataPtr, const std::array<long int*, 1> /*particleRhsPtr*/){
+                    for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        std::array<RealType, Dim> pos;
+                        for(int idxData = 0 ; idxData < Dim ; ++idxData){
+                            pos[idxData] = particleDataPtr[idxData][idxPart];
+                        }
+                        UASSERTETRUE(movedPositions[particleIndexes[idxPart]] == pos);
+                        UASSERTEEQUAL(spacialSystem.getIndexFromPosition(pos), leafHeader.spaceIndex);
+                    }
+                });
+
+                TreeClass treeFromScratch(configuration, movedPositions, NbElementsPerBlock, OneGroupPerParent);
+
+                UASSERTETRUE(getLeaves(tree) == getLeaves(treeFromScratch));
+
+                // The cells are not reset when no particle changed of leaf
+                tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                     const std::optional<std::reference_wrapper<MultipoleClass>> cellMultipole,
+                                     const std::optional<std::reference_wrapper<LocalClass>> cellLocal){
+                    (*cellMultipole).get()[0] = 0;
+                    (*cellLocal).get()[0] = 0;
+                });
+
+                algorithm.execute(tree);
+                AlgorithmClass algorithmFromScratch(configuration);
+                algorithmFromScratch.execute(treeFromScratch);
+
+                UASSERTETRUE(getCells(tree) == getCells(treeFromScratch));
+
+                const auto rhs = getRhs(tree);
+                const auto rhsFromScratch = getRhs(treeFromScratch);
+                for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                    UASSERTEEQUAL(rhs[idxPart], rhsFromScratch[idxPart]);
+                    UASSERTEEQUAL(rhs[idxPart], NbParticles-1);
+                }
+            }
+        }
+    }
+
+    void CoreReplay(const long int NbParticles, const long int NbElementsPerBlock,
+                    const bool OneGroupPerParent, const long int TreeHeight){
+        const int Dim = 3;
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        constexpr long int NbDataValuesPerParticle = Dim;
+        constexpr long int NbRhsValuesPerParticle = 1;
+        using MultipoleClass = std::array<long int,1>;
+        using LocalClass = std::array<long int,1>;
+
+        using TreeClass = TbfTree<RealType,
+                                  RealType,
+                                  NbDataValuesPerParticle,
+                                  long int,
+                                  NbRhsValuesPerParticle,
+                                  MultipoleClass,
+                                  LocalClass>;
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        TreeClass tree(configuration, particlePositions, NbElementsPerBlock, OneGroupPerParent);
+
+        auto getCells = [&tree](){
+            std::map<std::pair<long int, long int>, std::pair<long int, long int>> cells;
+            tree.applyToAllCells([&cells](const long int inLevel, auto&& cellHeader,
+                                 const std::optional<std::reference_wrapper<MultipoleClass>> cellMultipole,
+                                 const std::optional<std::reference_wrapper<LocalClass>> cellLocal){
+                cells[std::make_pair(inLevel, cellHeader.spaceIndex)] = std::make_pair((*cellMultipole).get()[0], (*cellLocal).get()[0]);
+                // Reset for the next execution
+                (*cellMultipole).get()[0] = 0;
+                (*cellLocal).get()[0] = 0;
+            });
+            return cells;
+        };
+
+        auto getRhs = [&tree, NbParticles](){
+            std::vector<long int> rhs(NbParticles, -1);
+            tree.applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
+                                  const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    rhs[particleIndexes[idxPart]] = particleRhsPtr[0][idxPart];
+                    // Reset for the next execution
+                    particleRhsPtr[0][idxPart] = 0;
+                }
+            });
+            return rhs;
+        };
+
+        // The first execution builds the interaction lists, the next ones replay them
+        AlgorithmClass algorithm(configuration);
+        algorithm.execute(tree);
+        const auto cellsFirst = getCells();
+        const auto rhsFirst = getRhs();
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            UASSERTEEQUAL(rhsFirst[idxPart], NbParticles-1);
+        }
+
+        for(long int idxExecute = 0 ; idxExecute < 2 ; ++idxExecute){
+            algorithm.execute(tree);
+            UASSERTETRUE(getCells() == cellsFirst);
+            const auto rhs = getRhs();
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                UASSERTEEQUAL(rhs[idxPart], rhsFirst[idxPart]);
+            }
+        }
     }
 
     void TestBasic() {
@@ -262,8 +455,21 @@ class TestTestKernel : public UTester< TestTestKernel<AlgorithmClass> > {
         }
     }
 
+    void TestReplay() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 1000 ; idxNbParticles *= 10){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 100, 10000000}}){
+                for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
+                    for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+                        CoreReplay(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                    }
+                }
+            }
+        }
+    }
+
     void SetTests() {
         Parent::AddTest(&TestTestKernel<AlgorithmClass>::TestBasic, "Basic test based on the test kernel");
+        Parent::AddTest(&TestTestKernel<AlgorithmClass>::TestReplay, "Execute several times with the same algorithm");
     }
 };
 
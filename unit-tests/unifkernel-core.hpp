@@ -16,9 +16,10 @@
 #include "utils/tbfaccuracychecker.hpp"
 
 
-template <class RealType, template <typename T1, typename T2, typename T3> class TestAlgorithmClass>
-class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmClass> > {
-    using Parent = UTester< TestUnifKernel<RealType, TestAlgorithmClass> >;
+template <class RealType, template <typename T1, typename T2, typename T3> class TestAlgorithmClass,
+          template <class, class, int, int, class> class UnifKernelClass = FUnifKernel>
+class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmClass, UnifKernelClass> > {
+    using Parent = UTester< TestUnifKernel<RealType, TestAlgorithmClass, UnifKernelClass> >;
 
     void CorePart(const long int NbParticles, const long int NbElementsPerBlock,
                   const bool OneGroupPerParent, const long int TreeHeight){
@@ -66,7 +67,7 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
 
         using MultipoleClass = MultipoleData;
         using LocalClass = LocalData;
-        using KernelClass = FUnifKernel<RealType, FInterpMatrixKernelR<RealType>, ORDER>;
+        using KernelClass = UnifKernelClass<RealType, FInterpMatrixKernelR<RealType>, ORDER, Dim, TbfDefaultSpaceIndexType<RealType>>;
 
         using AlgorithmClass = TestAlgorithmClass<RealType, KernelClass, TbfDefaultSpaceIndexType<RealType> >;
         using TreeClass = TbfTree<RealType,
@@ -201,7 +202,7 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
     }
 
     void SetTests() {
-        Parent::AddTest(&TestUnifKernel<RealType, TestAlgorithmClass>::TestBasic, "Basic test based on the uniform kernel");
+        Parent::AddTest(&TestUnifKernel<RealType, TestAlgorithmClass, UnifKernelClass>::TestBasic, "Basic test based on the uniform kernel");
     }
 };
 
@@ -0,0 +1,252 @@
+#include "UTester.hpp"
+
+#include "utils/tbfrandom.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbftree.hpp"
+#include "loader/tbfbinaryfmaloader.hpp"
+#include "loader/tbfbinaryfmawriter.hpp"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+
+class TestBinaryFmaLoader : public UTester< TestBinaryFmaLoader > {
+    using Parent = UTester< TestBinaryFmaLoader >;
+
+    using RealType = double;
+    static const long int Dim = 3;
+
+    const std::string filename = "utest-binaryfmaloader.tmp.bfma";
+
+    const std::array<RealType, Dim> BoxWidths{{1, 2, 3}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 1, 1.5}};
+
+    std::vector<std::array<RealType, Dim+1>> GenerateParticles(const long int inNbParticles) const{
+        TbfRandom<RealType, Dim> randomGenerator(BoxWidths);
+        std::vector<std::array<RealType, Dim+1>> particles(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            const auto position = randomGenerator.getNewItem();
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                particles[idxPart][idxDim] = position[idxDim] + BoxCenter[idxDim] - BoxWidths[idxDim]/2;
+            }
+            particles[idxPart][Dim] = RealType(idxPart);
+        }
+        return particles;
+    }
+
+    void TestRoundTrip() {
+        const long int NbParticles = 1000;
+        const auto particles = GenerateParticles(NbParticles);
+
+        for(const auto layout : {TbfBinaryFmaLayout::AoS, TbfBinaryFmaLayout::SoA}){
+            {
+                TbfBinaryFmaWriter<RealType, Dim> writer(filename);
+                UASSERTETRUE(writer.isOpen());
+                UASSERTETRUE(writer.writeParticles(BoxCenter, BoxWidths, NbParticles, particles, layout));
+            }
+            {
+                TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(filename);
+                UASSERTETRUE(loader.isOpen());
+                UASSERTEEQUAL(loader.getNbParticles(), NbParticles);
+                UASSERTEEQUAL(loader.getNbDataPerParticle(), Dim+1);
+                UASSERTETRUE(loader.getBoxWidths() == BoxWidths);
+                UASSERTETRUE(loader.getBoxCenter() == BoxCenter);
+                UASSERTEEQUAL(loader.canViewParticles(), layout == TbfBinaryFmaLayout::AoS);
+
+                // Small chunks to have several of them
+                const auto loadedParticles = loader.loadAllParticles(77);
+                UASSERTETRUE(loadedParticles == particles);
+
+                if(loader.canViewParticles()){
+                    const auto view = loader.viewAllParticles();
+                    UASSERTEEQUAL(view.size(), NbParticles);
+                    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                        UASSERTETRUE(view[idxPart] == particles[idxPart]);
+                    }
+                }
+            }
+            {
+                // Only the positions
+                TbfBinaryFmaLoader<RealType, Dim, Dim> loader(filename);
+                UASSERTETRUE(loader.isOpen());
+                UASSERTETRUE(loader.canViewParticles() == false);
+                const auto loadedParticles = loader.loadAllParticles();
+                for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        UASSERTEEQUAL(loadedParticles[idxPart][idxDim], particles[idxPart][idxDim]);
+                    }
+                }
+            }
+            {
+                // More values than in the file
+                TbfBinaryFmaLoader<RealType, Dim, Dim+2> loader(filename);
+                UASSERTETRUE(loader.isOpen());
+                const auto loadedParticles = loader.loadAllParticles();
+                for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                    for(long int idxVal = 0 ; idxVal < Dim+1 ; ++idxVal){
+                        UASSERTEEQUAL(loadedParticles[idxPart][idxVal], particles[idxPart][idxVal]);
+                    }
+                    UASSERTEEQUAL(loadedParticles[idxPart][Dim+1], RealType(0));
+                }
+            }
+        }
+
+        std::remove(filename.c_str());
+    }
+
+    void TestConversion() {
+        const long int NbParticles = 100;
+        const auto particles = GenerateParticles(NbParticles);
+
+        {
+            TbfBinaryFmaWriter<float, Dim> writer(filename);
+            const std::array<float, Dim> floatBoxWidths{{1, 2, 3}};
+            const std::array<float, Dim> floatBoxCenter{{0.5, 1, 1.5}};
+            UASSERTETRUE(writer.writeParticles(floatBoxCenter, floatBoxWidths, NbParticles, particles));
+        }
+        {
+            TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(filename);
+            UASSERTETRUE(loader.isOpen());
+            UASSERTETRUE(loader.canViewParticles() == false);
+            const auto loadedParticles = loader.loadAllParticles();
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                for(long int idxVal = 0 ; idxVal < Dim+1 ; ++idxVal){
+                    UASSERTEEQUAL(loadedParticles[idxPart][idxVal], RealType(float(particles[idxPart][idxVal])));
+                }
+            }
+        }
+        {
+            // Wrong dimension
+            TbfBinaryFmaLoader<RealType, 2, 2> loader(filename);
+            UASSERTETRUE(loader.isOpen() == false);
+            UASSERTEEQUAL(loader.getNbParticles(), 0L);
+        }
+        {
+            TbfBinaryFmaLoader<RealType, Dim> loader("utest-binaryfmaloader.does-not-exist");
+            UASSERTETRUE(loader.isOpen() == false);
+        }
+
+        std::remove(filename.c_str());
+    }
+
+    template <class ValueType>
+    void WriteInFile(const std::string& inFilename, const long int inPosition, const ValueType inValue){
+        std::fstream file(inFilename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(inPosition);
+        file.write(reinterpret_cast<const char*>(&inValue), sizeof(ValueType));
+    }
+
+    void TestCorruptedHeader() {
+        const long int NbParticles = 100;
+        const auto particles = GenerateParticles(NbParticles);
+
+        const std::int64_t validOffset = TbfBinaryFmaHeader::GetPayloadOffset(Dim);
+        const std::vector<std::pair<long int, std::int64_t>> corruptions{{
+            // The product nbParticles * nbDataPerParticle * realSize overflows to 0
+            {long(offsetof(TbfBinaryFmaHeader, nbParticles)), std::int64_t(1) << 61},
+            {long(offsetof(TbfBinaryFmaHeader, nbParticles)), NbParticles + 1},
+            {long(offsetof(TbfBinaryFmaHeader, nbDataPerParticle)), std::int64_t(1) << 62},
+            {long(offsetof(TbfBinaryFmaHeader, payloadOffset)), std::int64_t(1) << 62},
+            // Not aligned for double
+            {long(offsetof(TbfBinaryFmaHeader, payloadOffset)), validOffset + 4},
+        }};
+
+        for(const auto& corruption : corruptions){
+            {
+                TbfBinaryFmaWriter<RealType, Dim> writer(filename);
+                UASSERTETRUE(writer.writeParticles(BoxCenter, BoxWidths, NbParticles, particles));
+            }
+            {
+                TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(filename);
+                UASSERTETRUE(loader.isOpen());
+            }
+
+            WriteInFile(filename, corruption.first, corruption.second);
+            {
+                TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(filename);
+                UASSERTETRUE(loader.isOpen() == false);
+                UASSERTEEQUAL(loader.getNbParticles(), 0L);
+            }
+        }
+
+        std::remove(filename.c_str());
+    }
+
+    void TestTreeCheckpoint() {
+        const long int NbParticles = 2000;
+        const auto particles = GenerateParticles(NbParticles);
+
+        constexpr long int NbDataValuesPerParticle = Dim+1;
+        constexpr long int NbRhsValuesPerParticle = 2;
+        using TreeClass = TbfTree<RealType, RealType, NbDataValuesPerParticle, RealType, NbRhsValuesPerParticle,
+                                  std::array<RealType,1>, std::array<RealType,1>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(4, BoxWidths, BoxCenter);
+
+        {
+            TbfBinaryFmaWriter<RealType, Dim> writer(filename);
+            UASSERTETRUE(writer.writeParticles(BoxCenter, BoxWidths, NbParticles, particles));
+        }
+
+        TbfBinaryFmaLoader<RealType, Dim, Dim+1> loader(filename);
+        UASSERTETRUE(loader.canViewParticles());
+
+        // The tree can be built directly from the mapped file
+        TreeClass treeFromVector(configuration, particles, 100);
+        TreeClass treeFromView(configuration, loader.viewAllParticles(), 100);
+        UASSERTEEQUAL(treeFromView.getNbParticles(), NbParticles);
+
+        const auto dataFromVector = treeFromVector.getAllParticlesData();
+        const auto dataFromView = treeFromView.getAllParticlesData();
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            UASSERTETRUE(dataFromVector[idxPart] == dataFromView[idxPart]);
+        }
+
+        // Save the data and the rhs
+        auto rhs = treeFromView.getAllParticlesRhs();
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            rhs[idxPart][0] = RealType(2*idxPart);
+            rhs[idxPart][1] = RealType(3*idxPart);
+        }
+
+        const std::string checkpointFilename = filename + ".checkpoint";
+        {
+            TbfBinaryFmaWriter<RealType, Dim> writer(checkpointFilename);
+            UASSERTETRUE(writer.writeParticlesAndRhs(BoxCenter, BoxWidths, NbParticles, dataFromView, rhs,
+                                                     TbfBinaryFmaLayout::SoA));
+        }
+        {
+            TbfBinaryFmaLoader<RealType, Dim, NbDataValuesPerParticle+NbRhsValuesPerParticle> checkpoint(checkpointFilename);
+            UASSERTETRUE(checkpoint.isOpen());
+            UASSERTEEQUAL(checkpoint.getNbDataPerParticle(), NbDataValuesPerParticle+NbRhsValuesPerParticle);
+            const auto loadedParticles = checkpoint.loadAllParticles();
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                for(long int idxVal = 0 ; idxVal < NbDataValuesPerParticle ; ++idxVal){
+                    UASSERTEEQUAL(loadedParticles[idxPart][idxVal], dataFromView[idxPart][idxVal]);
+                }
+                UASSERTEEQUAL(loadedParticles[idxPart][NbDataValuesPerParticle], RealType(2*idxPart));
+                UASSERTEEQUAL(loadedParticles[idxPart][NbDataValuesPerParticle+1], RealType(3*idxPart));
+            }
+        }
+
+        std::remove(checkpointFilename.c_str());
+        std::remove(filename.c_str());
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestBinaryFmaLoader::TestRoundTrip, "Test to write and read binary FMA files");
+        Parent::AddTest(&TestBinaryFmaLoader::TestCorruptedHeader, "Test to reject binary FMA files with invalid headers");
+        Parent::AddTest(&TestBinaryFmaLoader::TestConversion, "Test the conversion and the invalid files");
+        Parent::AddTest(&TestBinaryFmaLoader::TestTreeCheckpoint, "Test to build a tree from the mapped file and to save it");
+    }
+};
+
+// You must do this
+TestClass(TestBinaryFmaLoader)
+
+
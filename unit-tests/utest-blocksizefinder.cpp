@@ -0,0 +1,140 @@
+#include "UTester.hpp"
+
+#include "utils/tbfutils.hpp"
+#include "utils/tbfrandom.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "algorithms/tbfblocksizefinder.hpp"
+#include "core/tbftree.hpp"
+
+#include <vector>
+#include <array>
+#include <set>
+
+class TestBlockSizeFinder : public UTester< TestBlockSizeFinder > {
+    using Parent = UTester< TestBlockSizeFinder >;
+
+    using RealType = double;
+    static const long int Dim = 3;
+    using SpacialConfiguration = TbfSpacialConfiguration<RealType, Dim>;
+    using SpaceIndexType = TbfMortonSpaceIndex<Dim, SpacialConfiguration>;
+    using IndexType = typename SpaceIndexType::IndexType;
+
+    std::vector<std::array<RealType, Dim>> generatePositions(const SpacialConfiguration& inConfiguration, const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        return particlePositions;
+    }
+
+    template <class ... ParticleContainers>
+    void checkStatistics(const SpacialConfiguration& inConfiguration, const TbfBlockSizeFinder::Statistics& inStats,
+                         const ParticleContainers& ... inParticlePositions){
+        const SpaceIndexType spaceSystem(inConfiguration);
+        const long int treeHeight = inConfiguration.getTreeHeight();
+
+        std::set<IndexType> cellIndexes;
+        long int nbParticles = 0;
+        for(const auto* particles : {&inParticlePositions...}){
+            for(const auto& position : *particles){
+                cellIndexes.insert(spaceSystem.getIndexFromPosition(position));
+            }
+            nbParticles += static_cast<long int>(std::size(*particles));
+        }
+
+        UASSERTEEQUAL(inStats.nbParticles, nbParticles);
+        UASSERTEEQUAL(static_cast<long int>(inStats.nbCellsPerLevel.size()), treeHeight);
+
+        for(long int idxLevel = treeHeight-1 ; idxLevel >= 0 ; --idxLevel){
+            UASSERTEEQUAL(inStats.nbCellsPerLevel[idxLevel], static_cast<long int>(cellIndexes.size()));
+            std::set<IndexType> parentIndexes;
+            for(const IndexType index : cellIndexes){
+                parentIndexes.insert(spaceSystem.getParentIndex(index));
+            }
+            cellIndexes = std::move(parentIndexes);
+        }
+    }
+
+    void TestStatistics() {
+        for(long int idxHeight = 1 ; idxHeight < 8 ; ++idxHeight){
+            for(const long int nbParticles : std::vector<long int>{{0, 1, 100, 20000}}){
+                const SpacialConfiguration configuration(idxHeight, TbfUtils::make_array<RealType, Dim>(1),
+                                                         TbfUtils::make_array<RealType, Dim>(0.5));
+                const auto positions = generatePositions(configuration, nbParticles);
+                const auto otherPositions = generatePositions(configuration, nbParticles/2+1);
+
+                const auto stats = TbfBlockSizeFinder::ComputeStatistics<RealType>(positions, configuration);
+                checkStatistics(configuration, stats, positions);
+
+                const auto statsTsm = TbfBlockSizeFinder::ComputeStatisticsTsm<RealType>(positions, otherPositions, configuration);
+                checkStatistics(configuration, statsTsm, positions, otherPositions);
+            }
+        }
+    }
+
+    void TestEstimate() {
+        const SpacialConfiguration configuration(6, TbfUtils::make_array<RealType, Dim>(1),
+                                                 TbfUtils::make_array<RealType, Dim>(0.5));
+        const auto positions = generatePositions(configuration, 50000);
+        const auto stats = TbfBlockSizeFinder::ComputeStatistics<RealType>(positions, configuration);
+
+        for(const int nbThreads : std::vector<int>{{1, 2, 8, 64}}){
+            const int blockSize = TbfBlockSizeFinder::EstimateFromStatistics(stats, nbThreads);
+            UASSERTEEQUAL(static_cast<long int>(blockSize), std::max(1L, stats.getNbLeaves()/(nbThreads*2)));
+            UASSERTEEQUAL(TbfBlockSizeFinder::Estimate<RealType>(positions, configuration, nbThreads), blockSize);
+
+            const int blockSizeCostModel = TbfBlockSizeFinder::EstimateWithCostModel(stats, nbThreads);
+            UASSERTETRUE(1 <= blockSizeCostModel && blockSizeCostModel <= stats.getNbLeaves());
+            UASSERTETRUE(TbfBlockSizeFinder::EstimateCost(stats, blockSizeCostModel, nbThreads)
+                         <= TbfBlockSizeFinder::EstimateCost(stats, blockSize, nbThreads));
+            UASSERTEEQUAL(TbfBlockSizeFinder::Estimate<RealType>(positions, configuration, nbThreads, true), blockSizeCostModel);
+        }
+
+        const TbfBlockSizeFinder::Statistics emptyStats;
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateFromStatistics(emptyStats, 4), 1);
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateWithCostModel(emptyStats, 4), 1);
+    }
+
+    void TestTreeBlockSize() {
+        using TreeClass = TbfTree<RealType, RealType, 0, RealType, 0, std::array<RealType, 1>, std::array<RealType, 1>, SpaceIndexType>;
+        const int nbThreads = static_cast<int>(std::thread::hardware_concurrency());
+
+        const SpacialConfiguration configuration(6, TbfUtils::make_array<RealType, Dim>(1),
+                                                 TbfUtils::make_array<RealType, Dim>(0.5));
+        const auto positions = generatePositions(configuration, 20000);
+        const auto stats = TbfBlockSizeFinder::ComputeStatistics<RealType, std::vector<std::array<RealType, Dim>>, SpaceIndexType>(positions, configuration);
+
+        {
+            TreeClass tree(configuration, positions);
+            UASSERTEEQUAL(tree.getNbElementsPerGroup(), static_cast<long int>(TbfBlockSizeFinder::EstimateFromStatistics(stats, nbThreads)));
+            UASSERTEEQUAL(tree.getNbElementsPerGroup(), std::max(1L, stats.getNbLeaves()/(nbThreads*2)));
+        }
+        {
+            TreeClass tree(configuration, positions, TbfBlockSizeFinder::CostModelBlockSize);
+            UASSERTEEQUAL(tree.getNbElementsPerGroup(), static_cast<long int>(TbfBlockSizeFinder::EstimateWithCostModel(stats, nbThreads)));
+        }
+        {
+            TreeClass tree(configuration, positions, 7);
+            UASSERTEEQUAL(tree.getNbElementsPerGroup(), 7L);
+            long int nbLeaves = 0;
+            for(const auto& group : tree.getParticleGroups()){
+                UASSERTETRUE(group.getNbLeaves() <= 7);
+                nbLeaves += group.getNbLeaves();
+            }
+            UASSERTEEQUAL(nbLeaves, stats.getNbLeaves());
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestBlockSizeFinder::TestStatistics, "Per level statistics of the block size finder");
+        Parent::AddTest(&TestBlockSizeFinder::TestEstimate, "Block size estimation");
+        Parent::AddTest(&TestBlockSizeFinder::TestTreeBlockSize, "Block size selected by the tree");
+    }
+};
+
+// You must do this
+TestClass(TestBlockSizeFinder)
+
+
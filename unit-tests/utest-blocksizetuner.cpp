@@ -0,0 +1,107 @@
+#include "UTester.hpp"
+
+#include "utils/tbfrandom.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbftree.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/tbfblocksizetuner.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+
+#include <vector>
+#include <array>
+
+class TestBlockSizeTuner : public UTester< TestBlockSizeTuner > {
+    using Parent = UTester< TestBlockSizeTuner >;
+
+    using RealType = double;
+    static const long int Dim = 3;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+    using TreeClass = TbfTree<RealType,
+                              RealType,
+                              Dim,
+                              long int,
+                              1,
+                              std::array<long int,1>,
+                              std::array<long int,1>>;
+
+    void TestBasic() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(20000);
+        for(auto& position : particlePositions){
+            position = randomGenerator.getNewItem();
+        }
+
+        TbfBlockSizeTuner::ClearCache();
+
+        TbfBlockSizeTuner::Parameters parameters;
+        parameters.maxSubsampleSize = 3000;
+
+        const auto result = TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(configuration, particlePositions, parameters);
+        UASSERTETRUE(result.blockSize >= 1);
+        UASSERTETRUE(result.fromCache == false);
+        UASSERTETRUE(result.subsampleSize <= parameters.maxSubsampleSize);
+        UASSERTETRUE(result.subsampleTreeHeight <= configuration.getTreeHeight());
+        UASSERTETRUE(result.timings.size() >= 1);
+
+        const auto resultCached = TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(configuration, particlePositions, parameters);
+        UASSERTETRUE(resultCached.fromCache);
+        UASSERTEEQUAL(resultCached.blockSize, result.blockSize);
+
+        // Any change of the configuration or of the parameters must not use the cache
+        auto isFromCache = [&particlePositions](const auto& inConfiguration, const TbfBlockSizeTuner::Parameters& inParameters){
+            return TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(inConfiguration, particlePositions, inParameters).fromCache;
+        };
+        {
+            const TbfSpacialConfiguration<RealType, Dim> otherConfiguration(5, {{2, 2, 2}}, {{1, 1, 1}});
+            UASSERTETRUE(isFromCache(otherConfiguration, parameters) == false);
+        }
+        {
+            TbfBlockSizeTuner::Parameters otherParameters = parameters;
+            otherParameters.operationsToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearField;
+            UASSERTETRUE(isFromCache(configuration, otherParameters) == false);
+        }
+        {
+            TbfBlockSizeTuner::Parameters otherParameters = parameters;
+            otherParameters.oneGroupPerParent = true;
+            UASSERTETRUE(isFromCache(configuration, otherParameters) == false);
+        }
+        {
+            TbfBlockSizeTuner::Parameters otherParameters = parameters;
+            otherParameters.cacheKey = "other kernel parameters";
+            UASSERTETRUE(isFromCache(configuration, otherParameters) == false);
+            UASSERTETRUE(isFromCache(configuration, otherParameters));
+        }
+        UASSERTETRUE(isFromCache(configuration, parameters));
+
+        parameters.useCache = false;
+        parameters.candidates = std::vector<long int>{{4, 1, 4, 16}};
+        const auto resultCandidates = TbfBlockSizeTuner::Tune<AlgorithmClass, TreeClass>(configuration, particlePositions, parameters);
+        UASSERTETRUE(resultCandidates.fromCache == false);
+        UASSERTEEQUAL(static_cast<long int>(resultCandidates.timings.size()), 3L);
+
+        // The tuned value must give a valid tree
+        TreeClass tree(configuration, particlePositions, result.blockSize);
+        AlgorithmClass algorithm(configuration);
+        algorithm.execute(tree);
+        tree.applyToAllLeaves([this](auto&& leafHeader, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], 20000L-1);
+            }
+        });
+
+        TbfBlockSizeTuner::ClearCache();
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestBlockSizeTuner::TestBasic, "Basic test for the block size tuner");
+    }
+};
+
+// You must do this
+TestClass(TestBlockSizeTuner)
+
+
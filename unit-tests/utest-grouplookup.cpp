@@ -0,0 +1,162 @@
+#include "UTester.hpp"
+
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfutils.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbfcellscontainer.hpp"
+#include "core/tbfparticlescontainer.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+
+class TestGroupLookup : public UTester< TestGroupLookup > {
+    using Parent = UTester< TestGroupLookup >;
+
+    using RealType = double;
+    static const long int Dim = 3;
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using IndexType = typename SpaceIndexType::IndexType;
+
+    void TestLowerBoundFromHint() {
+        std::mt19937 randomEngine(0);
+        std::vector<long int> values(200);
+        for(auto& value : values){
+            value = long(randomEngine() % 500);
+        }
+        std::sort(values.begin(), values.end());
+
+        const long int nbValues = static_cast<long int>(values.size());
+        for(long int value = -2 ; value < 503 ; ++value){
+            const long int expected = long(std::lower_bound(values.begin(), values.end(), value) - values.begin());
+            for(long int hint = -1 ; hint <= nbValues + 1 ; hint += 7){
+                const long int found = TbfUtils::lower_bound_indexes_from_hint(0, nbValues, hint, value,
+                                                                               [&values](const long int idx, const long int val){
+                    return values[idx] < val;
+                });
+                UASSERTEEQUAL(found, expected);
+            }
+        }
+    }
+
+    template <class GroupClass, class GetIndexFunc>
+    void CheckLookups(const GroupClass& inGroup, const long int inNbElements, GetIndexFunc&& inGetIndex){
+        const IndexType firstIndex = inGetIndex(0);
+        const IndexType lastIndex = inGetIndex(inNbElements-1);
+
+        std::vector<IndexType> queries;
+        for(IndexType index = std::max(IndexType(0), firstIndex - 3) ; index <= lastIndex + 3 ; ++index){
+            queries.push_back(index);
+        }
+
+        auto expectedPosition = [&](const IndexType inIndex) -> long int {
+            for(long int idxElement = 0 ; idxElement < inNbElements ; ++idxElement){
+                if(inGetIndex(idxElement) == inIndex){
+                    return idxElement;
+                }
+            }
+            return -1;
+        };
+
+        // Increasing order
+        long int cursor = 0;
+        for(const IndexType index : queries){
+            const long int expected = expectedPosition(index);
+            const auto found = inGroup.getElementFromSpacialIndex(index);
+            const auto foundCursor = inGroup.getElementFromSpacialIndex(index, cursor);
+            UASSERTEEQUAL(bool(found), expected != -1);
+            UASSERTEEQUAL(bool(foundCursor), expected != -1);
+            if(expected != -1){
+                UASSERTEEQUAL(*found, expected);
+                UASSERTEEQUAL(*foundCursor, expected);
+            }
+        }
+
+        // The cursor must remain valid when the order is not monotone
+        std::shuffle(queries.begin(), queries.end(), std::mt19937(1));
+        cursor = 0;
+        for(const IndexType index : queries){
+            const long int expected = expectedPosition(index);
+            const auto foundCursor = inGroup.getElementFromSpacialIndex(index, cursor);
+            UASSERTEEQUAL(bool(foundCursor), expected != -1);
+            if(expected != -1){
+                UASSERTEEQUAL(*foundCursor, expected);
+            }
+        }
+    }
+
+    void TestCellsContainer() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const SpaceIndexType spacialSystem(configuration);
+
+        using CellsContainerClass = TbfCellsContainer<RealType, std::array<long int,1>, std::array<long int,1>>;
+
+        {
+            // Consecutive indexes with a few holes, the table must be built
+            std::vector<IndexType> indexes;
+            for(IndexType index = 100 ; index < 400 ; ++index){
+                if(index % 7 != 0){
+                    indexes.push_back(index);
+                }
+            }
+            CellsContainerClass cells(indexes, spacialSystem);
+            UASSERTETRUE(cells.hasDenseIndexTable());
+            CheckLookups(cells, cells.getNbCells(), [&cells](const long int idx){ return cells.getCellSpacialIndex(idx); });
+
+            cells.clearDenseIndexTable();
+            UASSERTETRUE(cells.hasDenseIndexTable() == false);
+            CheckLookups(cells, cells.getNbCells(), [&cells](const long int idx){ return cells.getCellSpacialIndex(idx); });
+        }
+        {
+            // Sparse indexes, the table must not be built
+            std::vector<IndexType> indexes;
+            for(IndexType index = 5 ; index < 4000 ; index += 37){
+                indexes.push_back(index);
+            }
+            CellsContainerClass cells(indexes, spacialSystem);
+            UASSERTETRUE(cells.hasDenseIndexTable() == false);
+            CheckLookups(cells, cells.getNbCells(), [&cells](const long int idx){ return cells.getCellSpacialIndex(idx); });
+
+            UASSERTETRUE(cells.buildDenseIndexTable(100));
+            CheckLookups(cells, cells.getNbCells(), [&cells](const long int idx){ return cells.getCellSpacialIndex(idx); });
+        }
+    }
+
+    void TestParticlesContainer() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(4, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const SpaceIndexType spacialSystem(configuration);
+
+        using ParticlesContainerClass = TbfParticlesContainer<RealType, RealType, Dim, long int, 1>;
+
+        for(const long int nbParticles : {20L, 3000L}){
+            TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+            std::vector<std::array<RealType, Dim>> particlePositions(nbParticles);
+            for(auto& position : particlePositions){
+                position = randomGenerator.getNewItem();
+            }
+
+            ParticlesContainerClass particles(spacialSystem, particlePositions);
+            // 3000 particles in 512 leaves fill the index range
+            if(nbParticles == 3000){
+                UASSERTETRUE(particles.hasDenseIndexTable());
+            }
+            CheckLookups(particles, particles.getNbLeaves(), [&particles](const long int idx){ return particles.getLeafSpacialIndex(idx); });
+
+            particles.clearDenseIndexTable();
+            CheckLookups(particles, particles.getNbLeaves(), [&particles](const long int idx){ return particles.getLeafSpacialIndex(idx); });
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestGroupLookup::TestLowerBoundFromHint, "Test the lower bound from a hint");
+        Parent::AddTest(&TestGroupLookup::TestCellsContainer, "Test the lookups in the cells container");
+        Parent::AddTest(&TestGroupLookup::TestParticlesContainer, "Test the lookups in the particles container");
+    }
+};
+
+// You must do this
+TestClass(TestGroupLookup)
+
+
@@ -3,20 +3,30 @@
 #include "utils/tbfutils.hpp"
 #include "spacial/tbfhilbertspaceindex.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfhilbertbits.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
 
 #include <set>
+#include <random>
+#include <complex>
 
 class TestHilbert : public UTester< TestHilbert > {
     using Parent = UTester< TestHilbert >;
 
-    void TestBasic() {
-        const int Dim = 3;
-        const long int TreeHeight = 5;
+    template <long int Dim>
+    void CheckBasic() {
+        const long int TreeHeight = (Dim == 2 ? 7 : 5);
 
         using RealType = double;
 
-        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
-        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+        const auto BoxWidths = TbfUtils::make_array<RealType, Dim>(1);
+        const auto BoxCenter = TbfUtils::make_array<RealType, Dim>(0.5);
 
         const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
         const TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > hilbert(configuration);
@@ -32,11 +42,11 @@ class TestHilbert : public UTester< TestHilbert > {
             std::set<IndexType> generatedChildIndexes;
 
             for(IndexType idx = 0 ; idx < hilbert.getUpperBound(idxLevel) ; ++idx){
-                auto pos = hilbert.getBoxPosFromIndex(idx);
+                auto pos = hilbert.getBoxPosFromIndex(idx, idxLevel);
                 UASSERTETRUE(generatedPositions.find(pos) == generatedPositions.end());
                 generatedPositions.insert(pos);
 
-                UASSERTETRUE(idx == hilbert.getIndexFromBoxPos(pos));
+                UASSERTETRUE(idx == hilbert.getIndexFromBoxPos(pos, idxLevel));
 
                 for(long int idxChild = 0 ; idxChild < hilbert.getNbChildrenPerCell() ; ++idxChild){
                     auto childIndex = hilbert.getChildIndexFromParent(idx, idxChild);
@@ -49,11 +59,11 @@ class TestHilbert : public UTester< TestHilbert > {
 
                 {
                     const auto parent = hilbert.getParentIndex(idx);
-                    const auto parentPos = hilbert.getBoxPosFromIndex(parent);
+                    const auto parentPos = hilbert.getBoxPosFromIndex(parent, idxLevel-1);
 
                     const auto interactionList = hilbert.getInteractionListForIndex(idx, idxLevel);
                     for(auto interaction : interactionList){
-                        const auto posInteraction = hilbert.getBoxPosFromIndex(interaction);
+                        const auto posInteraction = hilbert.getBoxPosFromIndex(interaction, idxLevel);
 
                         {
                             bool atLeastOneMoreThanOne = false;
@@ -70,7 +80,7 @@ class TestHilbert : public UTester< TestHilbert > {
                             bool atLeastOneMoreThanZero = false;
 
                             const auto interactionParent = hilbert.getParentIndex(interaction);
-                            const auto interactionParentPos = hilbert.getBoxPosFromIndex(interactionParent);
+                            const auto interactionParentPos = hilbert.getBoxPosFromIndex(interactionParent, idxLevel-1);
                             for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
                                 UASSERTETRUE(std::abs(parentPos[idxDim] - interactionParentPos[idxDim]) <= 1);
                                 if(std::abs(pos[idxDim] - posInteraction[idxDim]) > 0){
@@ -85,7 +95,7 @@ class TestHilbert : public UTester< TestHilbert > {
                 {
                     const auto interactionList = hilbert.getNeighborListForIndex(idx, idxLevel);
                     for(auto interaction : interactionList){
-                        const auto posInteraction = hilbert.getBoxPosFromIndex(interaction);
+                        const auto posInteraction = hilbert.getBoxPosFromIndex(interaction, idxLevel);
 
                         {
                             bool atLeastOneMoreThanZero = false;
@@ -104,8 +114,232 @@ class TestHilbert : public UTester< TestHilbert > {
         }
     }
 
+    void TestBasic() {
+        CheckBasic<2>();
+        CheckBasic<3>();
+    }
+
+    template <long int Dim>
+    void CheckCurve() {
+        const long int TreeHeight = (Dim == 2 ? 8 : 6);
+
+        using RealType = double;
+
+        const auto BoxWidths = TbfUtils::make_array<RealType, Dim>(1);
+        const auto BoxCenter = TbfUtils::make_array<RealType, Dim>(0.5);
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+        const TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > hilbert(configuration);
+        const TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > morton(configuration);
+
+        using IndexType = typename TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> >::IndexType;
+
+        for(long int idxLevel = 1 ; idxLevel < TreeHeight ; ++idxLevel){
+            auto previousPos = hilbert.getBoxPosFromIndex(0, idxLevel);
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                UASSERTEEQUAL(previousPos[idxDim], 0L);
+            }
+
+            for(IndexType idx = 0 ; idx < hilbert.getUpperBound(idxLevel) ; ++idx){
+                const auto pos = hilbert.getBoxPosFromIndex(idx, idxLevel);
+
+                // Two consecutive cells are face neighbors
+                if(idx != 0){
+                    long int distance = 0;
+                    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        distance += std::abs(pos[idxDim] - previousPos[idxDim]);
+                    }
+                    UASSERTEEQUAL(distance, 1L);
+                }
+                previousPos = pos;
+
+                // The parent contains the cell
+                const auto parentPos = hilbert.getBoxPosFromIndex(hilbert.getParentIndex(idx), idxLevel-1);
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    UASSERTEEQUAL(parentPos[idxDim], pos[idxDim]/2);
+                }
+
+                // The position in the parent is the one of Morton
+                UASSERTEEQUAL(hilbert.childPositionFromParent(idx, idxLevel),
+                              morton.childPositionFromParent(morton.getIndexFromBoxPos(pos)));
+            }
+        }
+
+        // The versions without level are for the leaves
+        std::mt19937_64 randomEngine(Dim);
+        for(long int idxTest = 0 ; idxTest < 1000 ; ++idxTest){
+            const IndexType idx = static_cast<IndexType>(randomEngine() % static_cast<unsigned long>(hilbert.getUpperBoundAtLeafLevel()));
+            UASSERTETRUE(hilbert.getBoxPosFromIndex(idx) == hilbert.getBoxPosFromIndex(idx, TreeHeight-1));
+            UASSERTEEQUAL(hilbert.getIndexFromBoxPos(hilbert.getBoxPosFromIndex(idx)), idx);
+        }
+    }
+
+    void TestCurve() {
+        CheckCurve<2>();
+        CheckCurve<3>();
+    }
+
+    template <long int Dim, long int NbLevels>
+    void CheckMultiLevel() {
+        std::mt19937_64 randomEngine(Dim*NbLevels);
+        const long int MaxLevel = 63/Dim;
+        for(long int idxTest = 0 ; idxTest < 10000 ; ++idxTest){
+            const long int level = idxTest % (MaxLevel+1);
+            const long int mortonIndex = (level == 0 ? 0 : static_cast<long int>(randomEngine() & ((1UL << (level*Dim)) - 1)));
+            const long int hilbertIndex = TbfHilbertBits::MortonToHilbertPerLevel<Dim>(mortonIndex, level);
+            UASSERTEEQUAL((TbfHilbertBits::MortonToHilbert<Dim, NbLevels>(mortonIndex, level)), hilbertIndex);
+            UASSERTEEQUAL((TbfHilbertBits::HilbertToMorton<Dim, NbLevels>(hilbertIndex, level)), mortonIndex);
+            UASSERTEEQUAL(TbfHilbertBits::HilbertToMortonPerLevel<Dim>(hilbertIndex, level), mortonIndex);
+        }
+    }
+
+    void TestMultiLevel() {
+        CheckMultiLevel<2, 1>();
+        CheckMultiLevel<2, 2>();
+        CheckMultiLevel<2, 3>();
+        CheckMultiLevel<2, 4>();
+        CheckMultiLevel<3, 1>();
+        CheckMultiLevel<3, 2>();
+        CheckMultiLevel<3, 3>();
+    }
+
+    template <long int Dim>
+    void CheckBatchedIndexes() {
+        using RealType = double;
+
+        const auto BoxWidths = TbfUtils::make_array<RealType, Dim>(2);
+        const auto BoxCenter = TbfUtils::make_array<RealType, Dim>(0);
+
+        for(long int treeHeight : {1, 2, 5, 10}){
+            const TbfSpacialConfiguration<RealType, Dim> configuration(treeHeight, BoxWidths, BoxCenter);
+            const TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > hilbert(configuration);
+
+            const long int NbPositions = 1000;
+            TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+            std::vector<std::array<RealType, Dim>> positions(NbPositions);
+            for(auto& position : positions){
+                position = randomGenerator.getNewItem();
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    position[idxDim] += configuration.getBoxCorner()[idxDim];
+                }
+            }
+            // Limits of the box
+            positions[0] = configuration.getBoxCorner();
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                positions[1][idxDim] = configuration.getBoxCorner()[idxDim] + BoxWidths[idxDim];
+            }
+
+            std::vector<long int> indexes(NbPositions);
+            hilbert.getIndexesFromPositions(positions, 0, NbPositions, indexes.data());
+            for(long int idxPos = 0 ; idxPos < NbPositions ; ++idxPos){
+                UASSERTEEQUAL(indexes[idxPos], hilbert.getIndexFromPosition(positions[idxPos]));
+            }
+
+            // Sub-range not aligned on the blocks
+            std::vector<long int> subIndexes(NbPositions);
+            hilbert.getIndexesFromPositions(positions, 3, NbPositions-5, subIndexes.data());
+            for(long int idxPos = 3 ; idxPos < NbPositions-5 ; ++idxPos){
+                UASSERTEEQUAL(subIndexes[idxPos-3], indexes[idxPos]);
+            }
+        }
+    }
+
+    void TestBatchedIndexes() {
+        CheckBatchedIndexes<2>();
+        CheckBatchedIndexes<3>();
+    }
+
+    template <class SpaceIndexType, class ConfigurationClass, class ParticlesClass>
+    auto ComputeRotation(const ConfigurationClass& inConfiguration, const ParticlesClass& inParticlePositions){
+        using RealType = typename ConfigurationClass::RealType;
+        const int Dim = 3;
+        const unsigned int P = 6;
+        constexpr long int VectorSize = ((P+2)*(P+1))/2;
+        using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+        using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+        using TreeClass = TbfTree<RealType, RealType, Dim+1, RealType, 4,
+                                  MultipoleClass, LocalClass, SpaceIndexType>;
+        using KernelClass = FRotationKernel<RealType, P, SpaceIndexType>;
+        using AlgorithmClass = TbfAlgorithm<RealType, KernelClass, SpaceIndexType>;
+
+        TreeClass tree(inConfiguration, inParticlePositions, 50);
+        AlgorithmClass algorithm(inConfiguration);
+        algorithm.execute(tree);
+
+        std::vector<std::array<RealType, 4>> results(inParticlePositions.size());
+        tree.applyToAllLeaves([&results](auto&& leafHeader, const long int* particleIndexes,
+                              const std::array<RealType*, Dim+1> /*particleDataPtr*/,
+                              const std::array<RealType*, 4> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                    results[particleIndexes[idxPart]][idxValue] = particleRhsPtr[idxValue][idxPart];
+                }
+            }
+        });
+        return results;
+    }
+
+    void TestAlgorithm() {
+        const int Dim = 3;
+        const long int NbParticles = 2000;
+        const long int TreeHeight = 4;
+
+        using RealType = double;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        using SpaceIndexType = TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>>;
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            const auto pos = randomGenerator.getNewItem();
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                particlePositions[idxPart][idxDim] = pos[idxDim];
+            }
+            particlePositions[idxPart][Dim] = RealType(0.01);
+        }
+
+        {
+            using TreeClass = TbfTree<RealType, RealType, Dim+1, long int, 1,
+                                      std::array<long int,1>, std::array<long int,1>, SpaceIndexType>;
+            using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType, SpaceIndexType>, SpaceIndexType>;
+
+            TreeClass tree(configuration, particlePositions, 50);
+            AlgorithmClass algorithm(configuration);
+            algorithm.execute(tree);
+
+            tree.applyToAllLeaves([this, NbParticles](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                  const std::array<RealType*, Dim+1> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                }
+            });
+        }
+        {
+            // The kernels receive the positions of the children in Morton order
+            const auto resultsMorton = ComputeRotation<TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>>>(configuration, particlePositions);
+            const auto resultsHilbert = ComputeRotation<SpaceIndexType>(configuration, particlePositions);
+
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                    UASSERTETRUE(std::abs(resultsMorton[idxPart][idxValue] - resultsHilbert[idxPart][idxValue])
+                                 <= 1e-9 * (1 + std::abs(resultsMorton[idxPart][idxValue])));
+                }
+            }
+        }
+    }
+
     void SetTests() {
         Parent::AddTest(&TestHilbert::TestBasic, "Basic test for Hilbert");
+        Parent::AddTest(&TestHilbert::TestCurve, "Test the continuity and the hierarchy of the curve");
+        Parent::AddTest(&TestHilbert::TestMultiLevel, "Test the multi-level tables");
+        Parent::AddTest(&TestHilbert::TestBatchedIndexes, "Test the batched computation of the indexes");
+        Parent::AddTest(&TestHilbert::TestAlgorithm, "Test an FMM with the Hilbert ordering");
     }
 };
 
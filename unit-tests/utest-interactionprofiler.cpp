@@ -0,0 +1,176 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftimer.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "kernels/counterkernels/tbfinteractioncounter.hpp"
+#include "kernels/counterkernels/tbfinteractiontimer.hpp"
+#include "kernels/counterkernels/tbfinteractionprofiler.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+
+#include <sstream>
+#include <string>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+class TestInteractionProfiler : public UTester< TestInteractionProfiler > {
+    using Parent = UTester< TestInteractionProfiler >;
+    using RealType = double;
+    using ProfilerClass = TbfInteractionProfiler<TbfTestKernel<RealType>>;
+
+    void TestHistogram() {
+        using Histogram = ProfilerClass::Histogram;
+
+        UASSERTEEQUAL(Histogram::GetBinIndex(0), 0L);
+        UASSERTEEQUAL(Histogram::GetBinIndex(1), 1L);
+        UASSERTEEQUAL(Histogram::GetBinIndex(2), 2L);
+        UASSERTEEQUAL(Histogram::GetBinIndex(3), 2L);
+        UASSERTEEQUAL(Histogram::GetBinIndex(4), 3L);
+        for(long int idxBin = 1 ; idxBin < 40 ; ++idxBin){
+            UASSERTEEQUAL(Histogram::GetBinIndex(Histogram::GetBinMinSize(idxBin)), idxBin);
+            UASSERTEEQUAL(Histogram::GetBinIndex(Histogram::GetBinMaxSize(idxBin)), idxBin);
+        }
+
+        ProfilerClass::Profile profile1;
+        profile1.add(ProfilerClass::M2L_OP, 2, 3, 100);
+        profile1.add(ProfilerClass::M2L_OP, 2, 2, 50);
+        profile1.add(ProfilerClass::P2M_OP, -1, 10, 20);
+
+        ProfilerClass::Profile profile2;
+        profile2.add(ProfilerClass::M2L_OP, 3, 189, 1000);
+        profile2.add(ProfilerClass::M2L_OP, 2, 3, 10);
+
+        const auto profile = ProfilerClass::Profile::Reduce(profile1, profile2);
+        {
+            const auto bin = profile.getHistogram(ProfilerClass::M2L_OP, 2).bins[2];
+            UASSERTEEQUAL(bin.nbCalls, 3L);
+            UASSERTEEQUAL(bin.sumSizes, 8L);
+            UASSERTEEQUAL(bin.sumCycles, 160ULL);
+            UASSERTEEQUAL(bin.minCycles, 10ULL);
+            UASSERTEEQUAL(bin.maxCycles, 100ULL);
+        }
+        {
+            const auto total = profile.getTotal(ProfilerClass::M2L_OP);
+            UASSERTEEQUAL(total.nbCalls, 4L);
+            UASSERTEEQUAL(total.sumSizes, 197L);
+            UASSERTEEQUAL(total.sumCycles, 1160ULL);
+        }
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2M_OP).nbCalls, 1L);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::L2L_OP).nbCalls, 0L);
+        UASSERTEEQUAL(static_cast<long int>(profile.getHistogram(ProfilerClass::L2L_OP, 5).bins.size()), 0L);
+
+        std::ostringstream csv;
+        profile.writeCsv(csv);
+        UASSERTEEQUAL(csv.str().find("M2L,2,2,3,3,8,160,10,100\n") != std::string::npos, true);
+        UASSERTEEQUAL(csv.str().find("M2L,3,128,255,1,189,1000,1000,1000\n") != std::string::npos, true);
+        UASSERTEEQUAL(csv.str().find("P2M,-1,8,15,1,10,20,20,20\n") != std::string::npos, true);
+    }
+
+    void TestTimerMerge() {
+        TbfTimer timer1;
+        TbfTimer timer2;
+        for(long int idx = 0 ; idx < 1000000 ; ++idx){
+            timer1.start();
+            timer1.stop();
+        }
+        timer2.stop();
+        const double cumulated1 = timer1.getCumulated();
+        const double cumulated2 = timer2.getCumulated();
+        timer1.merge(timer2);
+        UASSERTETRUE(timer1.getCumulated() > cumulated1);
+        UASSERTETRUE(timer1.getCumulated() > cumulated2);
+
+        using TimerClass = TbfInteractionTimer<TbfTestKernel<RealType>>;
+        TimerClass::Timers timers1;
+        timers1.P2P = timer1;
+        TimerClass::Timers timers2;
+        timers2.P2P = timer2;
+        const auto timers = TimerClass::Reduce(timers1, timers2);
+        UASSERTETRUE(timers.P2P.getCumulated() > timer1.getCumulated());
+    }
+
+    void CorePart(const long int NbParticles, const long int NbElementsPerBlock, const long int TreeHeight){
+        const int Dim = 3;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        using MultipoleClass = std::array<long int,1>;
+        using LocalClass = std::array<long int,1>;
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, MultipoleClass, LocalClass>;
+        using KernelClass = TbfInteractionCounter<TbfInteractionProfiler<TbfTestKernel<RealType>>>;
+        using ReduceTypeCounter = KernelClass::TbfInteractionCounter::ReduceType;
+        using ReduceTypeProfiler = KernelClass::TbfInteractionProfiler::ReduceType;
+        using AlgorithmClass = TbfOpenmpAlgorithm<RealType, KernelClass>;
+
+        TreeClass tree(configuration, particlePositions, NbElementsPerBlock);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.execute(tree);
+
+        auto counters = ReduceTypeCounter();
+        auto profile = ReduceTypeProfiler();
+
+        algorithm.applyToAllKernels([&](const auto& inKernel){
+            counters = ReduceTypeCounter::Reduce(counters, inKernel.KernelClass::getReduceData());
+            profile = ReduceTypeProfiler::Reduce(profile, inKernel.TbfInteractionProfiler<TbfTestKernel<RealType>>::getReduceData());
+        });
+
+        long int nbLeaves = 0;
+        tree.applyToAllLeaves([&nbLeaves](auto&& /*leafHeader*/, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> /*particleRhsPtr*/){
+            nbLeaves += 1;
+        });
+
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2M_OP).nbCalls, nbLeaves);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2M_OP).sumSizes, NbParticles);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::L2P_OP).nbCalls, nbLeaves);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::L2P_OP).sumSizes, NbParticles);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2PInner_OP).nbCalls, nbLeaves);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::M2M_OP).sumSizes, counters.M2M);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::M2L_OP).sumSizes, counters.M2L);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::L2L_OP).sumSizes, counters.L2L);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2P_OP).sumSizes, counters.P2P);
+        UASSERTEEQUAL(profile.getTotal(ProfilerClass::P2PInner_OP).sumSizes, counters.P2PInner);
+
+        for(const long int idxOperator : {ProfilerClass::M2M_OP, ProfilerClass::M2L_OP, ProfilerClass::L2L_OP}){
+            UASSERTEEQUAL(profile.getHistogram(idxOperator, -1).getTotal().nbCalls, 0L);
+            UASSERTEEQUAL(profile.getHistogram(idxOperator, 0).getTotal().nbCalls, 0L);
+            UASSERTEEQUAL(profile.getHistogram(idxOperator, TreeHeight).getTotal().nbCalls, 0L);
+        }
+    }
+
+    void TestExecute() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 10000 ; idxNbParticles *= 10){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 50, 10000}}){
+                for(long int idxTreeHeight = 3 ; idxTreeHeight <= 5 ; ++idxTreeHeight){
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxTreeHeight);
+                }
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestInteractionProfiler::TestHistogram, "Test the histograms of the profiler");
+        Parent::AddTest(&TestInteractionProfiler::TestTimerMerge, "Test the reduction of the timers");
+        Parent::AddTest(&TestInteractionProfiler::TestExecute, "Test the profiler with the OpenMP algorithm");
+    }
+};
+
+// You must do this
+TestClass(TestInteractionProfiler)
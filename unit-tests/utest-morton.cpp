@@ -4,7 +4,11 @@
 #include "spacial/tbfmortonspaceindex.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 
+#include "spacial/tbfmortonbits.hpp"
+#include "utils/tbfrandom.hpp"
+
 #include <set>
+#include <random>
 
 class TestMorton : public UTester< TestMorton > {
     using Parent = UTester< TestMorton >;
@@ -155,9 +159,99 @@ class TestMorton : public UTester< TestMorton > {
         }
     }
     
+    template <long int Dim>
+    void CheckEncodings(){
+        std::mt19937_64 randomEngine(Dim);
+        // The original loops do not end for the largest coordinates
+        const long int MaxBitsLoop = std::min(21L, 40L/Dim);
+        const long int MaxBits = (TbfMortonBits::HasBmi2() || TbfMortonBits::HasMagicBits<Dim>() ? std::min(21L, 63L/Dim) : MaxBitsLoop);
+
+        for(long int idxTest = 0 ; idxTest < 10000 ; ++idxTest){
+            std::array<long int,Dim> boxPos;
+            const long int nbBits = 1 + (idxTest % MaxBits);
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                boxPos[idxDim] = static_cast<long int>(randomEngine() & ((1UL << nbBits) - 1));
+            }
+
+            const long int index = TbfMortonBits::Encode<Dim>(boxPos);
+            UASSERTETRUE(index >= 0);
+            UASSERTETRUE(TbfMortonBits::Decode<Dim>(index) == boxPos);
+            if(nbBits <= MaxBitsLoop){
+                UASSERTEEQUAL(TbfMortonBits::EncodeLoop<Dim>(boxPos), index);
+                UASSERTETRUE(TbfMortonBits::DecodeLoop<Dim>(index) == boxPos);
+            }
+            if constexpr(TbfMortonBits::HasMagicBits<Dim>()){
+                UASSERTEEQUAL(TbfMortonBits::EncodeMagicBits<Dim>(boxPos), index);
+                UASSERTETRUE(TbfMortonBits::DecodeMagicBits<Dim>(index) == boxPos);
+            }
+#ifdef TBF_MORTON_USE_BMI2
+            UASSERTEEQUAL(TbfMortonBits::EncodeBmi2<Dim>(boxPos), index);
+            UASSERTETRUE(TbfMortonBits::DecodeBmi2<Dim>(index) == boxPos);
+#endif
+        }
+    }
+
+    template <long int Dim>
+    void CheckBatchedIndexes(){
+        using RealType = double;
+        const long int TreeHeight = 7;
+
+        std::array<RealType, Dim> BoxWidths;
+        std::array<RealType, Dim> BoxCenter;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            BoxWidths[idxDim] = RealType(idxDim+1);
+            BoxCenter[idxDim] = RealType(0.5);
+        }
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+        const TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > morton(configuration);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        const long int NbParticles = 1000;
+        std::vector<std::array<RealType, Dim>> positions(NbParticles);
+        for(auto& position : positions){
+            position = randomGenerator.getNewItem();
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                position[idxDim] += configuration.getBoxCorner()[idxDim];
+            }
+        }
+        // The upper border is a special case
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            positions[0][idxDim] = configuration.getBoxCorner()[idxDim] + configuration.getBoxWidths()[idxDim];
+            positions[1][idxDim] = configuration.getBoxCorner()[idxDim];
+        }
+
+        const long int First = 3;
+        std::vector<long int> indexes(NbParticles - First);
+        morton.getIndexesFromPositions(positions, First, NbParticles, indexes.data());
+        for(long int idxPart = First ; idxPart < NbParticles ; ++idxPart){
+            UASSERTEEQUAL(indexes[idxPart-First], morton.getIndexFromPosition(positions[idxPart]));
+        }
+
+        morton.getIndexesFromPositions(positions, 0, 2, indexes.data());
+        UASSERTEEQUAL(indexes[0], morton.getUpperBoundAtLeafLevel()-1);
+        UASSERTEEQUAL(indexes[1], 0L);
+    }
+
+    void TestEncodings() {
+        CheckEncodings<1>();
+        CheckEncodings<2>();
+        CheckEncodings<3>();
+        CheckEncodings<4>();
+    }
+
+    void TestBatchedIndexes() {
+        CheckBatchedIndexes<1>();
+        CheckBatchedIndexes<2>();
+        CheckBatchedIndexes<3>();
+        CheckBatchedIndexes<4>();
+    }
+
     void SetTests() {
         Parent::AddTest(&TestMorton::TestBasic, "Basic test for Morton");
         Parent::AddTest(&TestMorton::TestBasicPeriodic, "Basic test for Morton (periodic)");
+        Parent::AddTest(&TestMorton::TestEncodings, "Test the Morton encodings");
+        Parent::AddTest(&TestMorton::TestBatchedIndexes, "Test the batched indexes from positions");
     }
 };
 
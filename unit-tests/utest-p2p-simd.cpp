@@ -0,0 +1,385 @@
+#include "UTester.hpp"
+
+#include "utils/tbfrandom.hpp"
+#include "kernels/P2P/FP2PR.hpp"
+#include "kernels/P2P/FP2PRSimd.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include <vector>
+#include <cmath>
+
+class TestP2PSimd : public UTester< TestP2PSimd > {
+    using Parent = UTester< TestP2PSimd >;
+
+    template <class RealType>
+    struct ParticlesBuffer{
+        std::array<std::vector<RealType>, 4> values;
+        std::array<std::vector<RealType>, 4> rhs;
+
+        ParticlesBuffer(const long int inNbParticles, const RealType inPhysicalValue, TbfRandom<RealType, 3>& inRandomGenerator){
+            for(auto& vec : values){
+                vec.resize(inNbParticles);
+            }
+            for(auto& vec : rhs){
+                vec.resize(inNbParticles, 0);
+            }
+            for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+                auto pos = inRandomGenerator.getNewItem();
+                values[0][idxPart] = pos[0];
+                values[1][idxPart] = pos[1];
+                values[2][idxPart] = pos[2];
+                values[3][idxPart] = inPhysicalValue;
+            }
+        }
+
+        std::array<const RealType*, 4> getValues() const{
+            return {{values[0].data(), values[1].data(), values[2].data(), values[3].data()}};
+        }
+
+        std::array<RealType*, 4> getRhs(){
+            return {{rhs[0].data(), rhs[1].data(), rhs[2].data(), rhs[3].data()}};
+        }
+    };
+
+    template <class RealType>
+    void CheckRhs(const ParticlesBuffer<RealType>& inScalar, const ParticlesBuffer<RealType>& inSimd){
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            TbfAccuracyChecker<RealType> accuracy;
+            for(long int idxPart = 0 ; idxPart < static_cast<long int>(inScalar.rhs[idxValue].size()) ; ++idxPart){
+                accuracy.addValues(inScalar.rhs[idxValue][idxPart], inSimd.rhs[idxValue][idxPart]);
+            }
+            if constexpr (std::is_same<float, RealType>::value){
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-4);
+            }
+            else{
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-12);
+            }
+        }
+    }
+
+    template <class RealType>
+    void CorePart(const FP2PRSimd::Isa inIsa, const long int inNbSources, const long int inNbTargets){
+        const std::array<RealType, 3> BoxWidths{{1, 1, 1}};
+        TbfRandom<RealType, 3> randomGenerator(BoxWidths);
+
+        ParticlesBuffer<RealType> sources(inNbSources, RealType(0.01), randomGenerator);
+        ParticlesBuffer<RealType> targets(inNbTargets, RealType(0.02), randomGenerator);
+        ParticlesBuffer<RealType> sourcesScalar = sources;
+        ParticlesBuffer<RealType> targetsScalar = targets;
+
+        std::array<RealType*, 4> sourcesValuesScalar{{sourcesScalar.values[0].data(), sourcesScalar.values[1].data(),
+                                                      sourcesScalar.values[2].data(), sourcesScalar.values[3].data()}};
+        std::array<RealType*, 4> targetsValuesScalar{{targetsScalar.values[0].data(), targetsScalar.values[1].data(),
+                                                      targetsScalar.values[2].data(), targetsScalar.values[3].data()}};
+        auto sourcesRhsScalar = sourcesScalar.getRhs();
+        auto targetsRhsScalar = targetsScalar.getRhs();
+
+        UASSERTETRUE(FP2PRSimd::FullMutual<RealType>(inIsa, sources.getValues(), sources.getRhs(), inNbSources,
+                                                     targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template FullMutualScalar<RealType>(sourcesValuesScalar, sourcesRhsScalar, inNbSources,
+                                                   targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        UASSERTETRUE(FP2PRSimd::GenericInner<RealType>(inIsa, targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template GenericInnerScalar<RealType>(targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        UASSERTETRUE(FP2PRSimd::GenericFullRemote<RealType>(inIsa, sources.getValues(), inNbSources,
+                                                            targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template GenericFullRemoteScalar<RealType>(sourcesValuesScalar, inNbSources,
+                                                          targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        CheckRhs(sourcesScalar, sources);
+        CheckRhs(targetsScalar, targets);
+    }
+
+    void TestAllIsa() {
+        UASSERTETRUE(FP2PRSimd::IsAvailable(FP2PRSimd::GetIsa()));
+        UASSERTETRUE(FP2PRSimd::FullMutual<double>(FP2PRSimd::Isa::Scalar, {}, {}, 0, {}, {}, 0) == false);
+
+        for(const FP2PRSimd::Isa isa : {FP2PRSimd::Isa::StdSimd, FP2PRSimd::Isa::Avx2, FP2PRSimd::Isa::Avx512}){
+            if(FP2PRSimd::IsAvailable(isa)){
+                std::cout << " - Test " << FP2PRSimd::GetIsaName(isa) << std::endl;
+                // 700 sources use several tiles in FullMutual
+                for(const long int nbSources : {1L, 7L, 16L, 33L, 200L, 700L}){
+                    for(const long int nbTargets : {1L, 2L, 5L, 31L, 150L}){
+                        CorePart<double>(isa, nbSources, nbTargets);
+                        CorePart<float>(isa, nbSources, nbTargets);
+                    }
+                }
+            }
+        }
+    }
+
+    void CoreMixed(const FP2PRSimd::Isa inIsa, const long int inNbSources, const long int inNbTargets, const double inOffset){
+        const std::array<double, 3> BoxWidths{{1, 1, 1}};
+        TbfRandom<double, 3> randomGenerator(BoxWidths);
+
+        ParticlesBuffer<double> sources(inNbSources, 0.01, randomGenerator);
+        ParticlesBuffer<double> targets(inNbTargets, 0.02, randomGenerator);
+        for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+            for(auto& pos : sources.values[idxDim]){
+                pos += inOffset;
+            }
+            for(auto& pos : targets.values[idxDim]){
+                pos += inOffset;
+            }
+        }
+        ParticlesBuffer<double> sourcesScalar = sources;
+        ParticlesBuffer<double> targetsScalar = targets;
+
+        std::array<double*, 4> sourcesValuesScalar{{sourcesScalar.values[0].data(), sourcesScalar.values[1].data(),
+                                                    sourcesScalar.values[2].data(), sourcesScalar.values[3].data()}};
+        std::array<double*, 4> targetsValuesScalar{{targetsScalar.values[0].data(), targetsScalar.values[1].data(),
+                                                    targetsScalar.values[2].data(), targetsScalar.values[3].data()}};
+        auto sourcesRhsScalar = sourcesScalar.getRhs();
+        auto targetsRhsScalar = targetsScalar.getRhs();
+
+        UASSERTETRUE(FP2PRSimd::FullMutualMixed<double>(inIsa, sources.getValues(), sources.getRhs(), inNbSources,
+                                                        targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template FullMutualScalar<double>(sourcesValuesScalar, sourcesRhsScalar, inNbSources,
+                                                 targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        UASSERTETRUE(FP2PRSimd::GenericInnerMixed<double>(inIsa, targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template GenericInnerScalar<double>(targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        UASSERTETRUE(FP2PRSimd::GenericFullRemoteMixed<double>(inIsa, sources.getValues(), inNbSources,
+                                                               targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template GenericFullRemoteScalar<double>(sourcesValuesScalar, inNbSources,
+                                                        targetsValuesScalar, targetsRhsScalar, inNbTargets);
+
+        for(const auto& [scalar, mixed] : {std::make_pair(&sourcesScalar, &sources), std::make_pair(&targetsScalar, &targets)}){
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                TbfAccuracyChecker<double> accuracy;
+                for(long int idxPart = 0 ; idxPart < static_cast<long int>(scalar->rhs[idxValue].size()) ; ++idxPart){
+                    accuracy.addValues(scalar->rhs[idxValue][idxPart], mixed->rhs[idxValue][idxPart]);
+                }
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-5);
+            }
+        }
+    }
+
+    void TestMixed() {
+        UASSERTETRUE(FP2PRSimd::GenericInnerMixed<float>(FP2PRSimd::GetIsa(), {}, {}, 0) == false);
+        UASSERTETRUE(FP2PRSimd::GenericInnerMixed<double>(FP2PRSimd::Isa::Scalar, {}, {}, 0) == false);
+
+        for(const FP2PRSimd::Isa isa : {FP2PRSimd::Isa::Avx2, FP2PRSimd::Isa::Avx512}){
+            if(FP2PRSimd::IsMixedAvailable(isa)){
+                std::cout << " - Test " << FP2PRSimd::GetIsaName(isa) << std::endl;
+                for(const long int nbSources : {1L, 7L, 16L, 33L, 200L}){
+                    for(const long int nbTargets : {1L, 2L, 5L, 31L, 150L}){
+                        CoreMixed(isa, nbSources, nbTargets, 0);
+                        CoreMixed(isa, nbSources, nbTargets, 1000);
+                    }
+                }
+            }
+        }
+
+        // The precision policy of FP2PR falls back to the native version when mixed is not possible
+        {
+            const std::array<float, 3> BoxWidths{{1, 1, 1}};
+            TbfRandom<float, 3> randomGenerator(BoxWidths);
+            ParticlesBuffer<float> targets(50, 0.01f, randomGenerator);
+            ParticlesBuffer<float> targetsNative = targets;
+            std::array<float*, 4> targetsValues{{targets.values[0].data(), targets.values[1].data(),
+                                                 targets.values[2].data(), targets.values[3].data()}};
+            std::array<float*, 4> targetsValuesNative{{targetsNative.values[0].data(), targetsNative.values[1].data(),
+                                                       targetsNative.values[2].data(), targetsNative.values[3].data()}};
+            auto targetsRhs = targets.getRhs();
+            auto targetsRhsNative = targetsNative.getRhs();
+            FP2PR::template GenericInner<float>(FP2PR::Precision::Mixed, targetsValues, targetsRhs, 50);
+            FP2PR::template GenericInner<float>(targetsValuesNative, targetsRhsNative, 50);
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                UASSERTETRUE(targets.rhs[idxValue] == targetsNative.rhs[idxValue]);
+            }
+        }
+    }
+
+    // The tiling requested by the kernels (setP2PTiling) goes through FP2PR down to the SIMD P2P
+    template <class RealType>
+    void CoreTilingSwitch(const long int inNbSources, const long int inNbTargets){
+        const std::array<RealType, 3> BoxWidths{{1, 1, 1}};
+        TbfRandom<RealType, 3> randomGenerator(BoxWidths);
+
+        ParticlesBuffer<RealType> sources(inNbSources, RealType(0.01), randomGenerator);
+        ParticlesBuffer<RealType> targets(inNbTargets, RealType(0.02), randomGenerator);
+        ParticlesBuffer<RealType> sourcesScalar = sources;
+        ParticlesBuffer<RealType> targetsScalar = targets;
+
+        auto sourcesRhs = sources.getRhs();
+        auto targetsRhs = targets.getRhs();
+        auto sourcesRhsScalar = sourcesScalar.getRhs();
+        auto targetsRhsScalar = targetsScalar.getRhs();
+
+        FP2PR::template FullMutual<RealType>(FP2PR::Precision::Native, sources.getValues(), sourcesRhs, inNbSources,
+                                             targets.getValues(), targetsRhs, inNbTargets, {}, true);
+        FP2PR::template FullMutualScalar<RealType>(sourcesScalar.getValues(), sourcesRhsScalar, inNbSources,
+                                                   targetsScalar.getValues(), targetsRhsScalar, inNbTargets);
+
+        CheckRhs(sourcesScalar, sources);
+        CheckRhs(targetsScalar, targets);
+    }
+
+    void TestTilingSwitch() {
+        for(const long int nbSources : {1L, FP2PRSimd::FullMutualTileSize<float>() + 3, 3*FP2PRSimd::FullMutualTileSize<double>() + 5}){
+            for(const long int nbTargets : {1L, 31L}){
+                CoreTilingSwitch<float>(nbSources, nbTargets);
+                CoreTilingSwitch<double>(nbSources, nbTargets);
+            }
+        }
+    }
+
+    // Compare the P2P with a shift of the sources to the P2P with a shifted copy of the sources
+    template <class RealType>
+    void CoreShift(const FP2PRSimd::Isa inIsa, const bool inMixed, const long int inNbSources, const long int inNbTargets){
+        const std::array<RealType, 3> BoxWidths{{1, 1, 1}};
+        TbfRandom<RealType, 3> randomGenerator(BoxWidths);
+        const std::array<RealType, 3> sourcesShift{{-1, 0, 1}};
+
+        ParticlesBuffer<RealType> sources(inNbSources, RealType(0.01), randomGenerator);
+        ParticlesBuffer<RealType> targets(inNbTargets, RealType(0.02), randomGenerator);
+        ParticlesBuffer<RealType> sourcesCopy = sources;
+        ParticlesBuffer<RealType> targetsCopy = targets;
+        for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+            for(auto& pos : sourcesCopy.values[idxDim]){
+                pos += sourcesShift[idxDim];
+            }
+        }
+
+        if(inIsa == FP2PRSimd::Isa::Scalar){
+            auto sourcesRhs = sources.getRhs();
+            auto targetsRhs = targets.getRhs();
+            auto sourcesCopyRhs = sourcesCopy.getRhs();
+            auto targetsCopyRhs = targetsCopy.getRhs();
+            FP2PR::template FullMutualScalar<RealType>(sources.getValues(), sourcesRhs, inNbSources,
+                                                       targets.getValues(), targetsRhs, inNbTargets, sourcesShift);
+            FP2PR::template FullMutualScalar<RealType>(sourcesCopy.getValues(), sourcesCopyRhs, inNbSources,
+                                                       targetsCopy.getValues(), targetsCopyRhs, inNbTargets);
+            FP2PR::template GenericFullRemoteScalar<RealType>(sources.getValues(), inNbSources,
+                                                              targets.getValues(), targetsRhs, inNbTargets, sourcesShift);
+            FP2PR::template GenericFullRemoteScalar<RealType>(sourcesCopy.getValues(), inNbSources,
+                                                              targetsCopy.getValues(), targetsCopyRhs, inNbTargets);
+        }
+        else if(inMixed){
+            if constexpr (std::is_same<double, RealType>::value){
+                UASSERTETRUE(FP2PRSimd::FullMutualMixed<double>(inIsa, sources.getValues(), sources.getRhs(), inNbSources,
+                                                                targets.getValues(), targets.getRhs(), inNbTargets, sourcesShift));
+                UASSERTETRUE(FP2PRSimd::FullMutualMixed<double>(inIsa, sourcesCopy.getValues(), sourcesCopy.getRhs(), inNbSources,
+                                                                targetsCopy.getValues(), targetsCopy.getRhs(), inNbTargets));
+                UASSERTETRUE(FP2PRSimd::GenericFullRemoteMixed<double>(inIsa, sources.getValues(), inNbSources,
+                                                                       targets.getValues(), targets.getRhs(), inNbTargets, sourcesShift));
+                UASSERTETRUE(FP2PRSimd::GenericFullRemoteMixed<double>(inIsa, sourcesCopy.getValues(), inNbSources,
+                                                                       targetsCopy.getValues(), targetsCopy.getRhs(), inNbTargets));
+            }
+        }
+        else{
+            for(const bool useTiling : {false, true}){
+                UASSERTETRUE(FP2PRSimd::FullMutual<RealType>(inIsa, sources.getValues(), sources.getRhs(), inNbSources,
+                                                             targets.getValues(), targets.getRhs(), inNbTargets, useTiling, sourcesShift));
+                UASSERTETRUE(FP2PRSimd::FullMutual<RealType>(inIsa, sourcesCopy.getValues(), sourcesCopy.getRhs(), inNbSources,
+                                                             targetsCopy.getValues(), targetsCopy.getRhs(), inNbTargets, useTiling));
+            }
+            UASSERTETRUE(FP2PRSimd::GenericFullRemote<RealType>(inIsa, sources.getValues(), inNbSources,
+                                                                targets.getValues(), targets.getRhs(), inNbTargets, sourcesShift));
+            UASSERTETRUE(FP2PRSimd::GenericFullRemote<RealType>(inIsa, sourcesCopy.getValues(), inNbSources,
+                                                                targetsCopy.getValues(), targetsCopy.getRhs(), inNbTargets));
+        }
+
+        for(const auto& [copy, shifted] : {std::make_pair(&sourcesCopy, &sources), std::make_pair(&targetsCopy, &targets)}){
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                TbfAccuracyChecker<RealType> accuracy;
+                accuracy.addManyValues(copy->rhs[idxValue].data(), shifted->rhs[idxValue].data(),
+                                       static_cast<long int>(copy->rhs[idxValue].size()));
+                if constexpr (std::is_same<float, RealType>::value){
+                    UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-4);
+                }
+                else{
+                    UASSERTETRUE(accuracy.getRelativeL2Norm() < (inMixed ? 1e-5 : 1e-12));
+                }
+            }
+        }
+    }
+
+    void TestShift() {
+        for(const FP2PRSimd::Isa isa : {FP2PRSimd::Isa::Scalar, FP2PRSimd::Isa::StdSimd, FP2PRSimd::Isa::Avx2, FP2PRSimd::Isa::Avx512}){
+            if(FP2PRSimd::IsAvailable(isa)){
+                std::cout << " - Test " << FP2PRSimd::GetIsaName(isa) << std::endl;
+                for(const long int nbSources : {1L, 7L, 33L, 700L}){
+                    for(const long int nbTargets : {1L, 5L, 31L}){
+                        CoreShift<double>(isa, false, nbSources, nbTargets);
+                        CoreShift<float>(isa, false, nbSources, nbTargets);
+                        if(FP2PRSimd::IsMixedAvailable(isa)){
+                            CoreShift<double>(isa, true, nbSources, nbTargets);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // The distances are scaled such that their squares are outside the float range
+    // (the double versions must not depend on a single precision approximation)
+    void CoreFloatLimits(const FP2PRSimd::Isa inIsa, const long int inNbSources, const long int inNbTargets, const double inScale){
+        const std::array<double, 3> BoxWidths{{1, 1, 1}};
+        TbfRandom<double, 3> randomGenerator(BoxWidths);
+
+        ParticlesBuffer<double> sources(inNbSources, 1, randomGenerator);
+        ParticlesBuffer<double> targets(inNbTargets, 2, randomGenerator);
+        for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+            for(auto& pos : sources.values[idxDim]){
+                pos *= inScale;
+            }
+            for(auto& pos : targets.values[idxDim]){
+                pos = (pos + (idxDim == 0 ? 2 : 0)) * inScale;
+            }
+        }
+        ParticlesBuffer<double> sourcesScalar = sources;
+        ParticlesBuffer<double> targetsScalar = targets;
+        auto sourcesRhsScalar = sourcesScalar.getRhs();
+        auto targetsRhsScalar = targetsScalar.getRhs();
+
+        UASSERTETRUE(FP2PRSimd::FullMutual<double>(inIsa, sources.getValues(), sources.getRhs(), inNbSources,
+                                                   targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template FullMutualScalar<double>(sourcesScalar.getValues(), sourcesRhsScalar, inNbSources,
+                                                 targetsScalar.getValues(), targetsRhsScalar, inNbTargets);
+
+        UASSERTETRUE(FP2PRSimd::GenericFullRemote<double>(inIsa, sources.getValues(), inNbSources,
+                                                          targets.getValues(), targets.getRhs(), inNbTargets));
+        FP2PR::template GenericFullRemoteScalar<double>(sourcesScalar.getValues(), inNbSources,
+                                                        targetsScalar.getValues(), targetsRhsScalar, inNbTargets);
+
+        for(const auto& [scalar, simd] : {std::make_pair(&sourcesScalar, &sources), std::make_pair(&targetsScalar, &targets)}){
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                TbfAccuracyChecker<double> accuracy;
+                for(long int idxPart = 0 ; idxPart < static_cast<long int>(scalar->rhs[idxValue].size()) ; ++idxPart){
+                    UASSERTETRUE(std::isfinite(simd->rhs[idxValue][idxPart]));
+                    accuracy.addValues(scalar->rhs[idxValue][idxPart], simd->rhs[idxValue][idxPart]);
+                }
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-14);
+            }
+        }
+    }
+
+    void TestFloatLimits() {
+        for(const FP2PRSimd::Isa isa : {FP2PRSimd::Isa::StdSimd, FP2PRSimd::Isa::Avx2, FP2PRSimd::Isa::Avx512}){
+            if(FP2PRSimd::IsAvailable(isa)){
+                std::cout << " - Test " << FP2PRSimd::GetIsaName(isa) << std::endl;
+                // FLT_MIN is about 1e-38 and FLT_MAX about 3e38
+                for(const double scale : {1e-30, 1e-20, 1e-19, 1., 1e19, 1e20, 1e30}){
+                    for(const long int nbSources : {1L, 7L, 33L}){
+                        CoreFloatLimits(isa, nbSources, 31L, scale);
+                    }
+                }
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestP2PSimd::TestAllIsa, "Test the SIMD P2P against the scalar ones");
+        Parent::AddTest(&TestP2PSimd::TestMixed, "Test the mixed precision P2P against the scalar ones");
+        Parent::AddTest(&TestP2PSimd::TestTilingSwitch, "Test the P2P with the tiling enabled through FP2PR");
+        Parent::AddTest(&TestP2PSimd::TestShift, "Test the P2P with a shift of the sources (periodic images)");
+        Parent::AddTest(&TestP2PSimd::TestFloatLimits, "Test the double P2P with distances outside the float range");
+    }
+};
+
+// You must do this
+TestClass(TestP2PSimd)
@@ -0,0 +1,81 @@
+#include "UTester.hpp"
+
+#include "utils/tbfutils.hpp"
+#include "utils/tbfrandom.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbfparticlesorter.hpp"
+
+#include <vector>
+#include <array>
+
+class TestParticleSorter : public UTester< TestParticleSorter > {
+    using Parent = UTester< TestParticleSorter >;
+
+    template <long int Dim>
+    void CoreTest(const long int inTreeHeight, const long int inNbParticles){
+        using RealType = double;
+        using SpacialConfiguration = TbfSpacialConfiguration<RealType, Dim>;
+        using SpaceIndexType = TbfMortonSpaceIndex<Dim, SpacialConfiguration>;
+        using SorterClass = TbfParticleSorter<RealType, SpaceIndexType>;
+
+        const std::array<RealType, Dim> BoxWidths = TbfUtils::make_array<RealType, Dim>(1);
+        const std::array<RealType, Dim> BoxCenter = TbfUtils::make_array<RealType, Dim>(0.5);
+
+        const SpacialConfiguration configuration(inTreeHeight, BoxWidths, BoxCenter);
+        const SpaceIndexType spaceSystem(configuration);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        SorterClass sorterStd(spaceSystem, particlePositions, SorterClass::SortMethod::StdSort);
+        SorterClass sorterRadix(spaceSystem, particlePositions, SorterClass::SortMethod::ParallelRadix);
+
+        UASSERTEEQUAL(sorterStd.getNbParticles(), inNbParticles);
+        UASSERTEEQUAL(sorterRadix.getNbParticles(), inNbParticles);
+        UASSERTEEQUAL(sorterStd.getNbLeaves(), sorterRadix.getNbLeaves());
+
+        for(long int idxLeaf = 0 ; idxLeaf < sorterStd.getNbLeaves() ; ++idxLeaf){
+            UASSERTEEQUAL(sorterStd.getSpacialIndexForLeaf(idxLeaf), sorterRadix.getSpacialIndexForLeaf(idxLeaf));
+            UASSERTEEQUAL(sorterStd.getNbParticlesInLeaf(idxLeaf), sorterRadix.getNbParticlesInLeaf(idxLeaf));
+        }
+
+        std::vector<bool> particleFound(inNbParticles, false);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            UASSERTEEQUAL(sorterStd.getSpacialIndexForParticle(idxPart), sorterRadix.getSpacialIndexForParticle(idxPart));
+            if(idxPart){
+                UASSERTETRUE(sorterRadix.getSpacialIndexForParticle(idxPart-1) <= sorterRadix.getSpacialIndexForParticle(idxPart));
+            }
+
+            const long int originalIdx = sorterRadix.getParticleIndex(idxPart);
+            UASSERTETRUE(0 <= originalIdx && originalIdx < inNbParticles);
+            UASSERTETRUE(particleFound[originalIdx] == false);
+            particleFound[originalIdx] = true;
+            UASSERTEEQUAL(spaceSystem.getIndexFromPosition(particlePositions[originalIdx]), sorterRadix.getSpacialIndexForParticle(idxPart));
+        }
+    }
+
+    void TestBasic() {
+        for(long int idxHeight = 1 ; idxHeight < 9 ; ++idxHeight){
+            CoreTest<3>(idxHeight, 1000);
+            CoreTest<2>(idxHeight, 1000);
+        }
+        CoreTest<3>(8, 50000);
+        CoreTest<3>(12, 50000);
+        CoreTest<2>(16, 50000);
+        CoreTest<3>(4, 0);
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestParticleSorter::TestBasic, "Basic test for the particle sorter");
+    }
+};
+
+// You must do this
+TestClass(TestParticleSorter)
+
+
@@ -0,0 +1,164 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+class TestPriorities : public UTester< TestPriorities > {
+    using Parent = UTester< TestPriorities >;
+    using RealType = double;
+    static const int Dim = 3;
+
+    using MultipoleClass = std::array<long int,1>;
+    using LocalClass = std::array<long int,1>;
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, MultipoleClass, LocalClass>;
+
+    void TestStatic() {
+        for(long int idxTreeHeight = 2 ; idxTreeHeight <= 8 ; ++idxTreeHeight){
+            const int treeHeight = int(idxTreeHeight);
+            TbfAlgorithmUtils::TbfOperationsPriorities priorities(idxTreeHeight);
+            UASSERTEEQUAL(priorities.getPolicy(), TbfAlgorithmUtils::TbfStaticPriorities);
+            UASSERTEEQUAL(priorities.getNbSubPriorities(), 1);
+
+            UASSERTEEQUAL(priorities.getP2PPriority(), 0);
+            UASSERTEEQUAL(priorities.getL2PPriority(), 1);
+            UASSERTEEQUAL(priorities.getP2MPriority(), 2+3*treeHeight);
+            for(int idxLevel = 0 ; idxLevel < treeHeight ; ++idxLevel){
+                UASSERTEEQUAL(priorities.getL2LPriority(idxLevel), 2+treeHeight-idxLevel-1);
+                UASSERTEEQUAL(priorities.getM2LPriority(idxLevel), 2+treeHeight+treeHeight-idxLevel-1);
+                UASSERTEEQUAL(priorities.getM2MPriority(idxLevel), 2+2*treeHeight+treeHeight-idxLevel-1);
+                // The group does not change anything
+                UASSERTEEQUAL(priorities.getM2LPriority(idxLevel, 3), priorities.getM2LPriority(idxLevel));
+            }
+            UASSERTEEQUAL(priorities.getP2PPriority(5), priorities.getP2PPriority());
+        }
+    }
+
+    void TestWorkload() {
+        const long int TreeHeight = 5;
+        const long int NbParticles = 5000;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        // Half of the particles are concentrated in a corner
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+            if(idxPart%2){
+                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    particlePositions[idxPart][idxDim] *= 0.1;
+                }
+            }
+        }
+
+        TreeClass tree(configuration, particlePositions, 8);
+
+        TbfAlgorithmUtils::TbfOperationsPriorities priorities(TreeHeight, TbfAlgorithmUtils::TbfWorkloadPriorities);
+        const int nbSub = priorities.getNbSubPriorities();
+        UASSERTEEQUAL(nbSub, TbfAlgorithmUtils::TbfOperationsPriorities::NbWorkloadSubPriorities);
+
+        priorities.updateWorkload(tree);
+
+        // The bands of the operators must not overlap
+        UASSERTEEQUAL(priorities.getL2PPriority(), priorities.getP2PPriority()+nbSub);
+        UASSERTEEQUAL(priorities.getL2LPriority(TreeHeight-1), priorities.getL2PPriority()+nbSub);
+        UASSERTEEQUAL(priorities.getM2LPriority(TreeHeight-1), priorities.getL2LPriority(0)+nbSub);
+        UASSERTEEQUAL(priorities.getM2MPriority(TreeHeight-1), priorities.getM2LPriority(0)+nbSub);
+        UASSERTEEQUAL(priorities.getP2MPriority(), priorities.getM2MPriority(0)+nbSub);
+
+        const auto& particleGroups = tree.getParticleGroups();
+        long int idxMostParticles = 0;
+        long int idxFewestParticles = 0;
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            for(const int priority : {priorities.getP2PPriority(idxGroup), priorities.getL2PPriority(idxGroup)-priorities.getL2PPriority(),
+                                      priorities.getP2MPriority(idxGroup)-priorities.getP2MPriority()}){
+                UASSERTETRUE(0 <= priority && priority < nbSub);
+            }
+            if(particleGroups[idxMostParticles].getNbParticles() < particleGroups[idxGroup].getNbParticles()){
+                idxMostParticles = idxGroup;
+            }
+            if(particleGroups[idxGroup].getNbParticles() < particleGroups[idxFewestParticles].getNbParticles()){
+                idxFewestParticles = idxGroup;
+            }
+        }
+        UASSERTETRUE(priorities.getP2MPriority(idxFewestParticles) <= priorities.getP2MPriority(idxMostParticles));
+        UASSERTEEQUAL(priorities.getP2MPriority(idxMostParticles), priorities.getP2MPriority()+nbSub-1);
+
+        for(long int idxLevel = 2 ; idxLevel < TreeHeight ; ++idxLevel){
+            const long int nbGroups = static_cast<long int>(std::size(tree.getCellGroupsAtLevel(idxLevel)));
+            bool hasHighPriority = false;
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                const int subPriority = priorities.getM2LPriority(idxLevel, idxGroup) - priorities.getM2LPriority(idxLevel);
+                UASSERTETRUE(0 <= subPriority && subPriority < nbSub);
+                UASSERTEEQUAL(priorities.getM2MPriority(idxLevel, idxGroup) - priorities.getM2MPriority(idxLevel), subPriority);
+                UASSERTEEQUAL(priorities.getL2LPriority(idxLevel-1, idxGroup) - priorities.getL2LPriority(idxLevel-1), subPriority);
+                hasHighPriority |= (subPriority == nbSub-1);
+            }
+            UASSERTETRUE(nbGroups == 0 || hasHighPriority);
+            // The first group contains the corner with most of the particles
+            if(nbGroups){
+                UASSERTEEQUAL(priorities.getM2LPriority(idxLevel, 0) - priorities.getM2LPriority(idxLevel), nbSub-1);
+            }
+        }
+
+        priorities.setPolicy(TbfAlgorithmUtils::TbfStaticPriorities);
+        UASSERTEEQUAL(priorities.getNbSubPriorities(), 1);
+        UASSERTEEQUAL(priorities.getM2LPriority(2, 0), priorities.getM2LPriority(2));
+    }
+
+    void TestExecute() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 10000 ; idxNbParticles *= 10){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 50, 10000}}){
+                for(long int idxTreeHeight = 3 ; idxTreeHeight <= 5 ; ++idxTreeHeight){
+                    const long int NbParticles = idxNbParticles;
+                    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+                    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+                    const TbfSpacialConfiguration<RealType, Dim> configuration(idxTreeHeight, BoxWidths, BoxCenter);
+
+                    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+                    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+                    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                        particlePositions[idxPart] = randomGenerator.getNewItem();
+                    }
+
+                    TreeClass tree(configuration, particlePositions, idxNbElementsPerBlock);
+
+                    TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>> algorithm(configuration);
+                    algorithm.setPriorityPolicy(TbfAlgorithmUtils::TbfWorkloadPriorities);
+                    algorithm.execute(tree);
+
+                    tree.applyToAllLeaves([this, NbParticles](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                        for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                            UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestPriorities::TestStatic, "Test the static priorities");
+        Parent::AddTest(&TestPriorities::TestWorkload, "Test the workload priorities");
+        Parent::AddTest(&TestPriorities::TestExecute, "Test the OpenMP algorithm with the workload priorities");
+    }
+};
+
+// You must do this
+TestClass(TestPriorities)
@@ -0,0 +1,98 @@
+#include "UTester.hpp"
+
+#include "utils/tbfutils.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbfm2lbatch.hpp"
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <random>
+#include <functional>
+#include <cmath>
+
+class TestRotationKernelM2LBatch : public UTester< TestRotationKernelM2LBatch > {
+    using Parent = UTester< TestRotationKernelM2LBatch >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    static const int P = 8;
+    static const long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+    using KernelClass = FRotationKernel<RealType, P>;
+
+    void TestCompareWithM2L() {
+        const long int TreeHeight = 5;
+        const long int Level = 3;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        KernelClass kernel(configuration);
+
+        // Some well-separated relative positions, with a number of pairs
+        // that is not a multiple of the block size
+        std::vector<long int> positions;
+        for(long int idxPos = 0 ; idxPos < 343 ; idxPos += 5){
+            const long int x = (idxPos/49) - 3;
+            const long int y = ((idxPos/7)%7) - 3;
+            const long int z = (idxPos%7) - 3;
+            if(std::max(std::abs(x), std::max(std::abs(y), std::abs(z))) >= 2){
+                positions.push_back(idxPos);
+            }
+        }
+
+        const long int NbTargets = 13;
+        std::mt19937 randomEngine(0);
+        std::uniform_real_distribution<RealType> distribution(-1, 1);
+
+        std::vector<MultipoleClass> multipoles(NbTargets * positions.size());
+        for(auto& multipole : multipoles){
+            for(auto& value : multipole){
+                value = std::complex<RealType>(distribution(randomEngine), distribution(randomEngine));
+            }
+        }
+
+        std::vector<LocalClass> localsRef(NbTargets);
+        std::vector<LocalClass> localsBatch(NbTargets);
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            localsRef[idxTarget].fill(std::complex<RealType>(0));
+            localsBatch[idxTarget].fill(std::complex<RealType>(0));
+        }
+
+        const int targetSymb = 0;
+        TbfM2LBatch<int, MultipoleClass, LocalClass> batch;
+
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            std::vector<std::reference_wrapper<const MultipoleClass>> sources;
+            for(long int idxPos = 0 ; idxPos < static_cast<long int>(positions.size()) ; ++idxPos){
+                const MultipoleClass& source = multipoles[idxTarget * positions.size() + idxPos];
+                sources.emplace_back(source);
+                batch.addInteraction(targetSymb, localsBatch[idxTarget], source, positions[idxPos]);
+            }
+            kernel.M2L(targetSymb, Level, sources, positions.data(), static_cast<long int>(positions.size()),
+                       localsRef[idxTarget]);
+        }
+
+        static_assert(TbfKernelHasM2LBatch<KernelClass, decltype(batch)>::value, "Must have M2LBatch");
+        kernel.M2LBatch(Level, batch);
+
+        for(long int idxTarget = 0 ; idxTarget < NbTargets ; ++idxTarget){
+            for(long int idxValue = 0 ; idxValue < VectorSize ; ++idxValue){
+                const RealType tolerance = 1e-12 * std::max(RealType(1), std::abs(localsRef[idxTarget][idxValue]));
+                UASSERTETRUE(std::abs(localsRef[idxTarget][idxValue] - localsBatch[idxTarget][idxValue]) <= tolerance);
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestRotationKernelM2LBatch::TestCompareWithM2L, "Test the batched M2L of the rotation kernel");
+    }
+};
+
+// You must do this
+TestClass(TestRotationKernelM2LBatch)
+
+
@@ -0,0 +1,259 @@
+#include "UTester.hpp"
+
+#include "utils/tbfutils.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "kernels/rotationkernel/FSpherical.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <random>
+#include <cmath>
+#include <memory>
+
+// Compare the P2M and L2P of FRotationKernel, which process the particles by blocks,
+// with a per-particle implementation of the same formulas (FSpherical, atan2, cos and sin).
+class TestRotationKernelP2ML2P : public UTester< TestRotationKernelP2ML2P > {
+    using Parent = UTester< TestRotationKernelP2ML2P >;
+
+    struct LeafSymbolicData{
+        std::array<long int, 3> boxCoord;
+    };
+
+    template <class RealType, int P>
+    struct Reference{
+        static const int SizeArray = ((P+2)*(P+1))/2;
+
+        RealType factorials[2*P+1];
+
+        Reference(){
+            factorials[0] = 1;
+            for(int idx = 1 ; idx <= 2*P ; ++idx){
+                factorials[idx] = RealType(idx) * factorials[idx-1];
+            }
+        }
+
+        static void ComputeLegendre(RealType legendre[], const RealType inCosTheta, const RealType inSinTheta){
+            legendre[0] = 1;
+            legendre[1] = inCosTheta;
+            legendre[2] = -inSinTheta;
+            for(int l = 2 ; l <= P ; ++l){
+                const int index_l = (l*(l+1))/2;
+                const int index_l1 = ((l-1)*l)/2;
+                const int index_l2 = ((l-2)*(l-1))/2;
+                for(int m = 0 ; m < l - 1 ; ++m){
+                    legendre[index_l+m] = (RealType(2*l-1) * inCosTheta * legendre[index_l1+m]
+                                           - RealType(l+m-1) * legendre[index_l2+m]) / RealType(l-m);
+                }
+                legendre[index_l+l-1] = RealType(2*l-1) * inCosTheta * legendre[index_l1+l-1];
+                legendre[index_l+l] = RealType(2*l-1) * (-inSinTheta) * legendre[index_l1+l-1];
+            }
+        }
+
+        void P2M(const std::array<RealType, 3>& inCenter, const std::array<std::vector<RealType>, 4>& inParticles,
+                 std::complex<RealType> w[]) const {
+            const RealType PIDiv2 = RealType(3.14159265358979323846264338327950288419716939937510582097494459230781640628620899863L/2.0);
+            const RealType i_pow_m[4] = {0, PIDiv2, 2*PIDiv2, -PIDiv2};
+            for(long int idxPart = 0 ; idxPart < long(inParticles[0].size()) ; ++idxPart){
+                const FSpherical<RealType> sph(std::array<RealType, 3>{{inParticles[0][idxPart] - inCenter[0],
+                                                                        inParticles[1][idxPart] - inCenter[1],
+                                                                        inParticles[2][idxPart] - inCenter[2]}});
+                RealType legendre[SizeArray];
+                ComputeLegendre(legendre, sph.getCosTheta(), sph.getSinTheta());
+
+                RealType q_aPowL = inParticles[3][idxPart];
+                int index_l_m = 0;
+                for(int l = 0 ; l <= P ; ++l){
+                    for(int m = 0 ; m <= l ; ++m, ++index_l_m){
+                        const RealType angle = RealType(m) * sph.getPhi() + i_pow_m[m & 0x3];
+                        const RealType magnitude = q_aPowL * legendre[index_l_m] / factorials[l+m];
+                        w[index_l_m] += std::complex<RealType>(magnitude * std::cos(angle), magnitude * std::sin(angle));
+                    }
+                    q_aPowL *= sph.getR();
+                }
+            }
+        }
+
+        void L2P(const std::array<RealType, 3>& inCenter, const std::complex<RealType> u[],
+                 const std::array<std::vector<RealType>, 4>& inParticles, std::array<std::vector<RealType>, 4>& inOutRhs) const {
+            const RealType PIDiv2 = RealType(3.14159265358979323846264338327950288419716939937510582097494459230781640628620899863L/2.0);
+            const RealType i_pow_m[4] = {0, PIDiv2, 2*PIDiv2, -PIDiv2};
+            for(long int idxPart = 0 ; idxPart < long(inParticles[0].size()) ; ++idxPart){
+                const FSpherical<RealType> sph(std::array<RealType, 3>{{inParticles[0][idxPart] - inCenter[0],
+                                                                        inParticles[1][idxPart] - inCenter[1],
+                                                                        inParticles[2][idxPart] - inCenter[2]}});
+                const RealType r = sph.getR();
+                RealType legendre[SizeArray];
+                ComputeLegendre(legendre, sph.getCosTheta(), sph.getSinTheta());
+
+                RealType minus_r_pow_l_div_fact_lm[SizeArray];
+                RealType minus_r_pow_l_legendre_div_fact_lm[SizeArray];
+                {
+                    int index_lm = 0;
+                    RealType minus_r_pow_l = 1;
+                    for(int l = 0 ; l <= P ; ++l){
+                        for(int m = 0 ; m <= l ; ++m, ++index_lm){
+                            minus_r_pow_l_div_fact_lm[index_lm] = minus_r_pow_l / factorials[l+m];
+                            minus_r_pow_l_legendre_div_fact_lm[index_lm] = minus_r_pow_l_div_fact_lm[index_lm] * legendre[index_lm];
+                        }
+                        minus_r_pow_l *= -r;
+                    }
+                }
+                RealType cos_m_phi_i_pow_m[P+1];
+                RealType sin_m_phi_i_pow_m[P+1];
+                for(int m = 0 ; m <= P ; ++m){
+                    const RealType m_phi_i_pow_m = RealType(m) * sph.getPhi() + i_pow_m[m & 0x3];
+                    cos_m_phi_i_pow_m[m] = std::cos(m_phi_i_pow_m);
+                    sin_m_phi_i_pow_m[m] = std::sin(m_phi_i_pow_m);
+                }
+
+                RealType Fr = 0;
+                RealType FO = 0;
+                RealType Fp = 0;
+                RealType magnitude = u[0].real() * minus_r_pow_l_legendre_div_fact_lm[0];
+                int index_lm = 1;
+                for(int l = 1 ; l <= P ; ++l){
+                    const RealType fl = RealType(l);
+                    Fr += fl * u[index_lm].real() * minus_r_pow_l_legendre_div_fact_lm[index_lm];
+                    FO += u[index_lm].real() * minus_r_pow_l_div_fact_lm[index_lm]
+                          * (fl * (sph.getCosTheta()*legendre[index_lm] - legendre[index_lm-l]) / sph.getSinTheta());
+                    magnitude += u[index_lm].real() * minus_r_pow_l_legendre_div_fact_lm[index_lm];
+                    ++index_lm;
+                    for(int m = 1 ; m <= l ; ++m, ++index_lm){
+                        const RealType coef = minus_r_pow_l_legendre_div_fact_lm[index_lm];
+                        const RealType I_real = coef * cos_m_phi_i_pow_m[m];
+                        const RealType I_imag = coef * sin_m_phi_i_pow_m[m];
+                        Fr += 2 * fl * (u[index_lm].real() * I_real - u[index_lm].imag() * I_imag);
+                        Fp -= 2 * RealType(m) * (u[index_lm].real() * I_imag + u[index_lm].imag() * I_real);
+                        magnitude += RealType(2.0) * (u[index_lm].real() * I_real - u[index_lm].imag() * I_imag);
+
+                        const RealType legendre_l_minus_1 = (m == l) ? RealType(0.0) : RealType(l+m)*legendre[index_lm-l];
+                        const RealType dcoef = minus_r_pow_l_div_fact_lm[index_lm] * ((fl * sph.getCosTheta()*legendre[index_lm]
+                                                                                      - legendre_l_minus_1) / sph.getSinTheta());
+                        FO += RealType(2.0) * (u[index_lm].real() * dcoef * cos_m_phi_i_pow_m[m]
+                                               - u[index_lm].imag() * dcoef * sin_m_phi_i_pow_m[m]);
+                    }
+                }
+                Fr /= r;
+                FO /= r;
+                Fp /= r * sph.getSinTheta();
+
+                const RealType cosPhi = std::cos(sph.getPhi());
+                const RealType sinPhi = std::sin(sph.getPhi());
+                const RealType q = inParticles[3][idxPart];
+                inOutRhs[0][idxPart] += (cosPhi * sph.getSinTheta() * Fr + cosPhi * sph.getCosTheta() * FO - sinPhi * Fp) * q;
+                inOutRhs[1][idxPart] += (sinPhi * sph.getSinTheta() * Fr + sinPhi * sph.getCosTheta() * FO + cosPhi * Fp) * q;
+                inOutRhs[2][idxPart] += (sph.getCosTheta() * Fr - sph.getSinTheta() * FO) * q;
+                inOutRhs[3][idxPart] += magnitude;
+            }
+        }
+    };
+
+    template <class RealType, int P>
+    void CoreTest(const long int inNbParticles, const bool inWithZAxis){
+        using KernelClass = FRotationKernel<RealType, P>;
+        const int SizeArray = Reference<RealType, P>::SizeArray;
+        const RealType epsilon = (std::is_same<float, RealType>::value ? RealType(1e-5) : RealType(1e-12));
+
+        const long int TreeHeight = 4;
+        const TbfSpacialConfiguration<RealType, 3> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        // The precomputed coefficients of the kernel are too large for the stack
+        std::unique_ptr<KernelClass> kernel(new KernelClass(configuration));
+        const Reference<RealType, P> reference;
+
+        const LeafSymbolicData leafIndex{{{2, 5, 1}}};
+        const auto leafWidths = configuration.getLeafWidths();
+        std::array<RealType, 3> center;
+        for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+            center[idxDim] = configuration.getBoxCorner()[idxDim] + (RealType(leafIndex.boxCoord[idxDim]) + RealType(.5)) * leafWidths[idxDim];
+        }
+
+        std::mt19937 randomEngine(static_cast<unsigned int>(inNbParticles));
+        std::uniform_real_distribution<RealType> distribution(-RealType(0.5), RealType(0.5));
+
+        std::array<std::vector<RealType>, 4> particles;
+        for(auto& vec : particles){
+            vec.resize(inNbParticles);
+        }
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+                particles[idxDim][idxPart] = center[idxDim] + distribution(randomEngine) * leafWidths[idxDim];
+            }
+            particles[3][idxPart] = RealType(0.1) + RealType(idxPart%5);
+            // Some particles on the z axis of the cell (sin(theta) == 0)
+            if(inWithZAxis && idxPart%3 == 0){
+                particles[0][idxPart] = center[0];
+                particles[1][idxPart] = center[1];
+            }
+        }
+        const std::array<const RealType*, 4> particlesPtr{{particles[0].data(), particles[1].data(),
+                                                           particles[2].data(), particles[3].data()}};
+
+        // P2M
+        {
+            std::vector<std::complex<RealType>> multipoleReference(SizeArray);
+            std::vector<std::complex<RealType>> multipole(SizeArray);
+            reference.P2M(center, particles, multipoleReference.data());
+            kernel->P2M(leafIndex, nullptr, particlesPtr, inNbParticles, multipole);
+
+            TbfAccuracyChecker<RealType> accuracy;
+            for(int idxValue = 0 ; idxValue < SizeArray ; ++idxValue){
+                UASSERTETRUE(std::isfinite(multipole[idxValue].real()) && std::isfinite(multipole[idxValue].imag()));
+                accuracy.addValues(multipoleReference[idxValue].real(), multipole[idxValue].real());
+                accuracy.addValues(multipoleReference[idxValue].imag(), multipole[idxValue].imag());
+            }
+            UASSERTETRUE(accuracy.getRelativeL2Norm() < epsilon);
+        }
+
+        // L2P
+        {
+            std::vector<std::complex<RealType>> local(SizeArray);
+            for(auto& value : local){
+                value = std::complex<RealType>(distribution(randomEngine), distribution(randomEngine));
+            }
+
+            std::array<std::vector<RealType>, 4> rhsReference;
+            std::array<std::vector<RealType>, 4> rhs;
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                rhsReference[idxValue].resize(inNbParticles, RealType(1));
+                rhs[idxValue].resize(inNbParticles, RealType(1));
+            }
+            std::array<RealType*, 4> rhsPtr{{rhs[0].data(), rhs[1].data(), rhs[2].data(), rhs[3].data()}};
+
+            reference.L2P(center, local.data(), particles, rhsReference);
+            kernel->L2P(leafIndex, local, nullptr, particlesPtr, rhsPtr, inNbParticles);
+
+            for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                TbfAccuracyChecker<RealType> accuracy;
+                for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+                    // The forces are not defined on the z axis, for both implementations
+                    UASSERTEEQUAL(bool(std::isfinite(rhsReference[idxValue][idxPart])), bool(std::isfinite(rhs[idxValue][idxPart])));
+                    if(std::isfinite(rhsReference[idxValue][idxPart])){
+                        accuracy.addValues(rhsReference[idxValue][idxPart], rhs[idxValue][idxPart]);
+                    }
+                }
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < epsilon);
+            }
+        }
+    }
+
+    void TestBasic() {
+        for(const long int nbParticles : {1L, 15L, 16L, 17L, 33L}){
+            for(const bool withZAxis : {false, true}){
+                CoreTest<double, 4>(nbParticles, withZAxis);
+                CoreTest<double, 12>(nbParticles, withZAxis);
+                CoreTest<float, 8>(nbParticles, withZAxis);
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestRotationKernelP2ML2P::TestBasic, "Compare the block P2M/L2P with a per-particle reference");
+    }
+};
+
+// You must do this
+TestClass(TestRotationKernelP2ML2P)
@@ -0,0 +1,175 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftasktracer.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <map>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+class TestTaskTracer : public UTester< TestTaskTracer > {
+    using Parent = UTester< TestTaskTracer >;
+    using RealType = double;
+
+    static long int CountOccurrences(const std::string& inText, const std::string& inPattern){
+        long int nbOccurrences = 0;
+        for(auto pos = inText.find(inPattern) ; pos != std::string::npos ; pos = inText.find(inPattern, pos+1)){
+            nbOccurrences += 1;
+        }
+        return nbOccurrences;
+    }
+
+    void TestBasic() {
+        TbfTaskTracer tracer;
+
+        {
+            std::ostringstream output;
+            tracer.writeChromeTrace(output);
+            UASSERTEEQUAL(CountOccurrences(output.str(), "\"ph\":\"X\""), 0L);
+            UASSERTETRUE(output.str().find(",\n]") == std::string::npos);
+        }
+        {
+            TbfTaskTracer::Scope disabledScope(nullptr, "M2L", 2, 3, 4, 5);
+        }
+        UASSERTEEQUAL(static_cast<long int>(tracer.getEvents().size()), 0L);
+        {
+            TbfTaskTracer::Scope scope(&tracer, "M2L", 2, 3, 4, 5);
+        }
+        {
+            TbfTaskTracer::Scope scope(&tracer, "P2M", 6, 7, -1, 8);
+        }
+        UASSERTEEQUAL(static_cast<long int>(tracer.getEvents().size()), 2L);
+        UASSERTEEQUAL(tracer.getNbThreads(), 1L);
+
+        const auto& event = tracer.getEvents()[0];
+        UASSERTEEQUAL(std::string(event.name), std::string("M2L"));
+        UASSERTEEQUAL(event.level, 2L);
+        UASSERTEEQUAL(event.idxGroup, 3L);
+        UASSERTEEQUAL(event.idxOtherGroup, 4L);
+        UASSERTEEQUAL(event.nbInteractions, 5L);
+        UASSERTEEQUAL(event.idxThread, 0L);
+        UASSERTETRUE(0 <= event.startTime && event.startTime <= event.endTime);
+        UASSERTETRUE(event.endTime <= tracer.getEvents()[1].startTime);
+
+        std::ostringstream output;
+        tracer.writeChromeTrace(output);
+        UASSERTEEQUAL(CountOccurrences(output.str(), "\"ph\":\"X\""), 2L);
+        UASSERTEEQUAL(CountOccurrences(output.str(), "\"ph\":\"M\""), 1L);
+        UASSERTEEQUAL(CountOccurrences(output.str(), "\"source group\":4"), 1L);
+
+        // The format of the stream must not be changed
+        {
+            std::ostringstream outputWithFormat;
+            outputWithFormat << std::scientific << std::setprecision(10);
+            const auto flags = outputWithFormat.flags();
+            tracer.writeChromeTrace(outputWithFormat);
+            UASSERTETRUE(outputWithFormat.flags() == flags);
+            UASSERTEEQUAL(static_cast<long int>(outputWithFormat.precision()), 10L);
+        }
+
+        tracer.reset();
+        UASSERTEEQUAL(static_cast<long int>(tracer.getEvents().size()), 0L);
+        UASSERTEEQUAL(tracer.getNbThreads(), 0L);
+    }
+
+    void CorePart(const long int NbParticles, const long int NbElementsPerBlock, const long int TreeHeight,
+                  const bool inPrivateP2PAccumulation){
+        const int Dim = 3;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        using MultipoleClass = std::array<long int,1>;
+        using LocalClass = std::array<long int,1>;
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, MultipoleClass, LocalClass>;
+        using AlgorithmClass = TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        TreeClass tree(configuration, particlePositions, NbElementsPerBlock);
+
+        TbfTaskTracer tracer;
+
+        AlgorithmClass algorithm(configuration);
+        UASSERTETRUE(algorithm.getTracer() == nullptr);
+        algorithm.setTracer(&tracer);
+        UASSERTETRUE(algorithm.getTracer() == &tracer);
+        algorithm.setPrivateP2PAccumulation(inPrivateP2PAccumulation);
+
+        algorithm.execute(tree);
+
+        tree.applyToAllLeaves([this, NbParticles](auto&& leafHeader, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+            }
+        });
+
+        const long int nbParticleGroups = tree.getNbParticleGroups();
+
+        std::map<std::string, long int> nbEventsPerName;
+        long int nbParticlesP2M = 0;
+        for(const auto& event : tracer.getEvents()){
+            nbEventsPerName[event.name] += 1;
+            UASSERTETRUE(0 <= event.startTime && event.startTime <= event.endTime);
+            UASSERTETRUE(0 <= event.idxThread && event.idxThread < tracer.getNbThreads());
+            UASSERTETRUE(0 <= event.level && event.level < TreeHeight);
+            UASSERTETRUE(0 <= event.idxGroup && event.idxGroup < static_cast<long int>(std::size(tree.getCellGroupsAtLevel(event.level))));
+            UASSERTETRUE(-1 <= event.idxOtherGroup);
+            UASSERTETRUE(0 <= event.nbInteractions);
+            if(std::string(event.name) == "P2M"){
+                nbParticlesP2M += event.nbInteractions;
+            }
+        }
+        UASSERTETRUE(tracer.getNbThreads() <= omp_get_max_threads());
+
+        UASSERTEEQUAL(nbEventsPerName["P2M"], nbParticleGroups);
+        UASSERTEEQUAL(nbEventsPerName["L2P"], nbParticleGroups);
+        UASSERTEEQUAL(nbEventsPerName["P2P"], nbParticleGroups);
+        UASSERTEEQUAL(nbEventsPerName["P2P-REDUCE"], (inPrivateP2PAccumulation ? nbParticleGroups : 0));
+        UASSERTEEQUAL(nbParticlesP2M, NbParticles);
+
+        std::ostringstream output;
+        tracer.writeChromeTrace(output);
+        UASSERTEEQUAL(CountOccurrences(output.str(), "\"ph\":\"X\""), static_cast<long int>(tracer.getEvents().size()));
+        UASSERTEEQUAL(CountOccurrences(output.str(), "\"ph\":\"M\""), tracer.getNbThreads());
+    }
+
+    void TestExecute() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 10000 ; idxNbParticles *= 10){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 50, 10000}}){
+                for(long int idxTreeHeight = 3 ; idxTreeHeight <= 5 ; ++idxTreeHeight){
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxTreeHeight, false);
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxTreeHeight, true);
+                }
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTaskTracer::TestBasic, "Test the task tracer");
+        Parent::AddTest(&TestTaskTracer::TestExecute, "Test the tracing of the OpenMP algorithm");
+    }
+};
+
+// You must do this
+TestClass(TestTaskTracer)
@@ -0,0 +1,124 @@
+#include "testkernel-core.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "kernels/counterkernels/tbfinteractioncounter.hpp"
+#include "core/tbfm2lbatch.hpp"
+
+// Test kernel that uses the group-level M2L
+template <class RealType_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+class TbfTestKernelM2LBatch : public TbfTestKernel<RealType_T, SpaceIndexType_T> {
+    // Checked by the test after the execution
+    long int nbInteractionsInBatches = 0;
+    long int nbInteractionsApplied = 0;
+    long int nbWrongInteractionIndexes = 0;
+
+public:
+    using TbfTestKernel<RealType_T, SpaceIndexType_T>::TbfTestKernel;
+
+    template <class M2LBatchClass>
+    void M2LBatch(const long int /*inLevel*/, M2LBatchClass& inBatch) {
+        inBatch.groupByInteractionIndex(TbfUtils::lipow(7, SpaceIndexType_T::Dim));
+        inBatch.applyPerInteractionIndex([&](const long int inInteractionIndex, const auto* inInteractions, const long int inNbInteractions){
+            for(long int idxInteraction = 0 ; idxInteraction < inNbInteractions ; ++idxInteraction){
+                if(inInteractions[idxInteraction].interactionIndex != inInteractionIndex){
+                    nbWrongInteractionIndexes += 1;
+                }
+                (*inInteractions[idxInteraction].target)[0] += (*inInteractions[idxInteraction].source)[0];
+            }
+            nbInteractionsApplied += inNbInteractions;
+        });
+        nbInteractionsInBatches += inBatch.size();
+    }
+
+    long int getNbInteractionsInBatches() const{
+        return nbInteractionsInBatches;
+    }
+
+    long int getNbInteractionsApplied() const{
+        return nbInteractionsApplied;
+    }
+
+    long int getNbWrongInteractionIndexes() const{
+        return nbWrongInteractionIndexes;
+    }
+};
+
+static_assert(TbfKernelHasM2LBatch<TbfTestKernelM2LBatch<double>,
+                                   TbfM2LBatch<int, std::array<long int,1>, std::array<long int,1>>>::value, "Batch check");
+static_assert(TbfKernelHasM2LBatch<TbfInteractionCounter<TbfTestKernelM2LBatch<double>>,
+                                   TbfM2LBatch<int, std::array<long int,1>, std::array<long int,1>>>::value, "Batch check");
+static_assert(!TbfKernelHasM2LBatch<TbfInteractionCounter<TbfTestKernel<double>>,
+                                    TbfM2LBatch<int, std::array<long int,1>, std::array<long int,1>>>::value, "Batch check");
+
+template <class RealType>
+class TestM2LBatchCounters : public UTester< TestM2LBatchCounters<RealType> > {
+    using Parent = UTester< TestM2LBatchCounters<RealType> >;
+
+    void CorePart(const long int NbParticles, const long int TreeHeight){
+        const int Dim = 3;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, std::array<long int,1>, std::array<long int,1>>;
+        using BatchAlgorithmClass = typename TbfAlgorithmSelecter::type<RealType, TbfInteractionCounter<TbfTestKernelM2LBatch<RealType>>>;
+        using ReferenceAlgorithmClass = typename TbfAlgorithmSelecter::type<RealType, TbfInteractionCounter<TbfTestKernel<RealType>>>;
+
+        long int nbInteractionsInBatches = 0;
+        long int nbInteractionsApplied = 0;
+        long int nbWrongInteractionIndexes = 0;
+        long int nbM2LBatch = 0;
+        {
+            TreeClass tree(configuration, particlePositions);
+            BatchAlgorithmClass algorithm(configuration);
+            algorithm.execute(tree);
+
+            algorithm.applyToAllKernels([&](const auto& inKernel){
+                nbInteractionsInBatches += inKernel.getNbInteractionsInBatches();
+                nbInteractionsApplied += inKernel.getNbInteractionsApplied();
+                nbWrongInteractionIndexes += inKernel.getNbWrongInteractionIndexes();
+                nbM2LBatch += inKernel.getReduceData().M2L;
+            });
+        }
+
+        long int nbM2LReference = 0;
+        {
+            TreeClass tree(configuration, particlePositions);
+            ReferenceAlgorithmClass algorithm(configuration);
+            algorithm.execute(tree);
+
+            algorithm.applyToAllKernels([&](const auto& inKernel){
+                nbM2LReference += inKernel.getReduceData().M2L;
+            });
+        }
+
+        UASSERTEEQUAL(nbWrongInteractionIndexes, 0L);
+        UASSERTEEQUAL(nbInteractionsApplied, nbInteractionsInBatches);
+        UASSERTEEQUAL(nbInteractionsInBatches, nbM2LBatch);
+        UASSERTEEQUAL(nbInteractionsInBatches, nbM2LReference);
+        UASSERTETRUE(NbParticles < 2 || TreeHeight < 3 || nbInteractionsInBatches > 0);
+    }
+
+    void TestCounters() {
+        for(long int idxHeight = 1 ; idxHeight < 6 ; ++idxHeight){
+            for(const long int nbParticles : std::vector<long int>{{1, 100, 2000}}){
+                CorePart(nbParticles, idxHeight);
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestM2LBatchCounters<RealType>::TestCounters, "Check the interactions seen by the group-level M2L");
+    }
+};
+
+// Both the generic test and the batch counters are run
+int main(void){
+    using AlgoTestClass = TestTestKernel<TbfAlgorithmSelecter::type<double, TbfInteractionCounter<TbfTestKernelM2LBatch<double>>>>;
+    AlgoTestClass controllerKernel;
+    TestM2LBatchCounters<double> controllerCounters;
+    return controllerKernel.Run() + controllerCounters.Run();
+}
@@ -0,0 +1,91 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+class TestPrivateP2P : public UTester< TestPrivateP2P > {
+    using Parent = UTester< TestPrivateP2P >;
+    using RealType = double;
+
+    void CorePart(const long int NbParticles, const long int NbElementsPerBlock, const long int TreeHeight){
+        const int Dim = 3;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        using MultipoleClass = std::array<long int,1>;
+        using LocalClass = std::array<long int,1>;
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, MultipoleClass, LocalClass>;
+        using AlgorithmClass = TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        TreeClass tree(configuration, particlePositions, NbElementsPerBlock);
+
+        AlgorithmClass algorithm(configuration);
+        UASSERTETRUE(algorithm.getPrivateP2PAccumulation() == false);
+        algorithm.setPrivateP2PAccumulation(true);
+        UASSERTETRUE(algorithm.getPrivateP2PAccumulation());
+
+        algorithm.execute(tree);
+
+        tree.applyToAllLeaves([this, NbParticles](auto&& leafHeader, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+            }
+        });
+
+        // The private buffers must be empty again for the next execution
+        algorithm.execute(tree, TbfAlgorithmUtils::TbfP2P);
+
+        tree.applyToAllLeaves([this, &tree, TreeHeight, NbParticles](auto&& leafHeader, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            const auto indexes = tree.getSpacialSystem().getNeighborListForIndex(leafHeader.spaceIndex, TreeHeight-1);
+            long int nbNeighbors = leafHeader.nbParticles - 1;
+            for(auto index : indexes){
+                auto groupForLeaf = tree.findGroupWithLeaf(index);
+                if(groupForLeaf){
+                    nbNeighbors += (*groupForLeaf).first.get().getNbParticlesInLeaf((*groupForLeaf).second);
+                }
+            }
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1 + nbNeighbors);
+            }
+        });
+    }
+
+    void TestBasic() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 10000 ; idxNbParticles *= 10){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 50, 10000}}){
+                for(long int idxTreeHeight = 3 ; idxTreeHeight <= 5 ; ++idxTreeHeight){
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxTreeHeight);
+                }
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestPrivateP2P::TestBasic, "Test the private accumulation of the P2P in the OpenMP algorithm");
+    }
+};
+
+// You must do this
+TestClass(TestPrivateP2P)
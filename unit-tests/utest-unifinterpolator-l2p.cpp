@@ -0,0 +1,100 @@
+#include "UTester.hpp"
+
+#include "kernels/unifkernel/FUnifInterpolator.hpp"
+#include "kernels/unifkernel/FInterpMatrixKernel.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include <array>
+#include <vector>
+
+class TestUnifInterpolatorL2P : public UTester< TestUnifInterpolatorL2P > {
+    using Parent = UTester< TestUnifInterpolatorL2P >;
+
+    template <class RealType, int ORDER>
+    void CoreTest(const long int inNbParticles){
+        using InterpolatorClass = FUnifInterpolator<RealType, ORDER, FInterpMatrixKernelR<RealType>>;
+        constexpr long int nnodes = TensorTraits<ORDER>::nnodes;
+
+        const std::array<RealType, 3> center{{RealType(0.5), RealType(0.25), RealType(-1)}};
+        const RealType width = RealType(0.5);
+        const std::array<RealType, 3> boxWidths{{width, width, width}};
+
+        TbfRandom<RealType, 3> randomGenerator(boxWidths);
+
+        std::array<std::vector<RealType>, 4> particles;
+        for(auto& vec : particles){
+            vec.resize(inNbParticles);
+        }
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            const auto pos = randomGenerator.getNewItem();
+            for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+                particles[idxDim][idxPart] = pos[idxDim] + center[idxDim] - width/2;
+            }
+            particles[3][idxPart] = RealType(0.1) + RealType(idxPart%5);
+        }
+        // Some particles on the border of the cell
+        if(inNbParticles > 2){
+            for(int idxDim = 0 ; idxDim < 3 ; ++idxDim){
+                particles[idxDim][0] = center[idxDim] - width/2;
+                particles[idxDim][1] = center[idxDim] + width/2;
+            }
+        }
+
+        std::vector<RealType> localExpansion(nnodes);
+        for(long int idxNode = 0 ; idxNode < nnodes ; ++idxNode){
+            localExpansion[idxNode] = RealType(1)/RealType(idxNode%11+1) - RealType(idxNode%3);
+        }
+
+        std::array<std::vector<RealType>, 4> rhsReference;
+        std::array<std::vector<RealType>, 4> rhsTotal;
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            rhsReference[idxValue].resize(inNbParticles, RealType(idxValue));
+            rhsTotal[idxValue].resize(inNbParticles, RealType(idxValue));
+        }
+
+        const std::array<const RealType*, 4> particlesPtr{{particles[0].data(), particles[1].data(),
+                                                           particles[2].data(), particles[3].data()}};
+        std::array<RealType*, 4> rhsReferencePtr{{rhsReference[0].data(), rhsReference[1].data(),
+                                                  rhsReference[2].data(), rhsReference[3].data()}};
+        std::array<RealType*, 4> rhsTotalPtr{{rhsTotal[0].data(), rhsTotal[1].data(),
+                                              rhsTotal[2].data(), rhsTotal[3].data()}};
+
+        const InterpolatorClass interpolator;
+        interpolator.applyL2P(center, width, localExpansion.data(), std::move(particlesPtr),
+                              std::move(rhsReferencePtr), inNbParticles);
+        interpolator.applyL2PGradient(center, width, localExpansion.data(), std::move(particlesPtr),
+                                      std::move(rhsReferencePtr), inNbParticles);
+        interpolator.applyL2PTotal(center, width, localExpansion.data(), std::move(particlesPtr),
+                                   std::move(rhsTotalPtr), inNbParticles);
+
+        for(int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+            TbfAccuracyChecker<RealType> accuracy;
+            accuracy.addManyValues(rhsReference[idxValue].data(), rhsTotal[idxValue].data(), inNbParticles);
+            if constexpr (std::is_same<float, RealType>::value){
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-4);
+            }
+            else{
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-12);
+            }
+        }
+    }
+
+    void TestBasic() {
+        for(const long int nbParticles : {1L, 3L, 16L, 17L, 100L, 1000L}){
+            CoreTest<double, 3>(nbParticles);
+            CoreTest<double, 5>(nbParticles);
+            CoreTest<double, 8>(nbParticles);
+            CoreTest<float, 5>(nbParticles);
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestUnifInterpolatorL2P::TestBasic, "Compare the fused L2P with L2P and L2P gradient");
+    }
+};
+
+// You must do this
+TestClass(TestUnifInterpolatorL2P)
+
+
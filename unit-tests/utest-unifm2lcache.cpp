@@ -0,0 +1,213 @@
+#include "UTester.hpp"
+
+#include "kernels/unifkernel/FUnifM2LCache.hpp"
+#include "kernels/unifkernel/FUnifM2LHandler.hpp"
+#include "kernels/unifkernel/FInterpMatrixKernel.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include <complex>
+#include <string>
+
+#include <unistd.h>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_FFTW
+// -- END --
+
+class TestUnifM2LCache : public UTester< TestUnifM2LCache > {
+    using Parent = UTester< TestUnifM2LCache >;
+
+    std::string cacheDirectory;
+
+    void SetCacheDirectory(){
+        char directoryTemplate[] = "/tmp/tbfmm-m2l-cache-XXXXXX";
+        const char* directory = mkdtemp(directoryTemplate);
+        UASSERTETRUE(directory != nullptr);
+        cacheDirectory = (directory ? directory : ".");
+        setenv("TBFMM_M2L_CACHE_DIR", cacheDirectory.c_str(), 1);
+    }
+
+    void RemoveFile(const std::string& inFilename){
+        std::remove(inFilename.c_str());
+    }
+
+    void TestRoundTrip(){
+        SetCacheDirectory();
+
+        std::vector<std::complex<double>> values(1000);
+        for(std::size_t idx = 0 ; idx < values.size() ; ++idx){
+            values[idx] = std::complex<double>(double(idx)*0.5, -double(idx));
+        }
+        const std::string key = "roundtrip-key";
+        const std::string filename = FUnifM2LCache::GetFilename("roundtrip", key);
+        UASSERTETRUE(filename.find(cacheDirectory) == 0);
+
+        std::vector<std::complex<double>> loaded(values.size());
+        UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()) == false);
+
+        UASSERTETRUE(FUnifM2LCache::Save(filename, key, values.data(), values.size()));
+        UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()));
+        UASSERTETRUE(loaded == values);
+
+        // Another key, size or value type does not match
+        UASSERTETRUE(FUnifM2LCache::Load(filename, "other-key-ab", loaded.data(), loaded.size()) == false);
+        UASSERTETRUE(FUnifM2LCache::Load(filename, "roundtrip-kez", loaded.data(), loaded.size()) == false);
+        UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()-1) == false);
+        std::vector<std::complex<float>> loadedFloat(values.size()*2);
+        UASSERTETRUE(FUnifM2LCache::Load(filename, key, loadedFloat.data(), values.size()) == false);
+
+        RemoveFile(filename);
+    }
+
+    void TestCorruption(){
+        SetCacheDirectory();
+
+        std::vector<double> values(257);
+        for(std::size_t idx = 0 ; idx < values.size() ; ++idx){
+            values[idx] = 1.0/double(idx+1);
+        }
+        const std::string key = "corruption-key";
+        const std::string filename = FUnifM2LCache::GetFilename("corruption", key);
+        UASSERTETRUE(FUnifM2LCache::Save(filename, key, values.data(), values.size()));
+
+        std::vector<char> content;
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+        UASSERTETRUE(content.size() > values.size()*sizeof(double));
+
+        auto writeContent = [&filename](const std::vector<char>& inContent){
+            std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+            stream.write(inContent.data(), std::streamsize(inContent.size()));
+        };
+
+        std::vector<double> loaded(values.size());
+
+        // A modified value
+        {
+            std::vector<char> corrupted = content;
+            corrupted[corrupted.size()-3] = char(corrupted[corrupted.size()-3] ^ 0x10);
+            writeContent(corrupted);
+            UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()) == false);
+        }
+        // A truncated file
+        {
+            std::vector<char> corrupted(content.begin(), content.end()-8);
+            writeContent(corrupted);
+            UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()) == false);
+        }
+        // Another version (just after the magic)
+        {
+            std::vector<char> corrupted = content;
+            corrupted[8] = char(corrupted[8] + 1);
+            writeContent(corrupted);
+            UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()) == false);
+        }
+        // Not a cache file
+        {
+            writeContent(std::vector<char>(10, 'a'));
+            UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()) == false);
+        }
+        // The original is still valid
+        {
+            writeContent(content);
+            UASSERTETRUE(FUnifM2LCache::Load(filename, key, loaded.data(), loaded.size()));
+            UASSERTETRUE(loaded == values);
+        }
+
+        RemoveFile(filename);
+    }
+
+    template <class RealType, int ORDER, class MatrixKernelClass>
+    std::vector<std::complex<RealType>> ApplyAllFC(const FUnifM2LHandler<RealType, ORDER, MatrixKernelClass::Type>& inHandler,
+                                                   const unsigned int inTreeHeight){
+        constexpr unsigned int rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1);
+        constexpr unsigned int opt_rc = rc/2+1;
+        std::vector<std::complex<RealType>> FY(opt_rc);
+        for(unsigned int idx = 0 ; idx < opt_rc ; ++idx){
+            FY[idx] = std::complex<RealType>(RealType(1)/RealType(idx+1), RealType(idx%7));
+        }
+        std::vector<std::complex<RealType>> results;
+        for(unsigned int idxLevel = 2 ; idxLevel < inTreeHeight ; ++idxLevel){
+            for(unsigned int idxInteraction = 0 ; idxInteraction < 343 ; ++idxInteraction){
+                std::vector<std::complex<RealType>> FX(opt_rc);
+                inHandler.applyFC(idxInteraction, idxLevel, RealType(1), FY.data(), FX.data());
+                results.insert(results.end(), FX.begin(), FX.end());
+            }
+        }
+        return results;
+    }
+
+    template <class RealType, int ORDER, class MatrixKernelClass, class OtherMatrixKernelClass>
+    void CoreHandler(const MatrixKernelClass& inMatrixKernel, const OtherMatrixKernelClass& inOtherMatrixKernel){
+        using M2LHandlerClass = FUnifM2LHandler<RealType, ORDER, MatrixKernelClass::Type>;
+        const unsigned int TreeHeight = 5;
+        const RealType BoxWidth = 1;
+
+        auto applyAllFC = [this, TreeHeight](const M2LHandlerClass& inHandler){
+            return ApplyAllFC<RealType, ORDER, MatrixKernelClass>(inHandler, TreeHeight);
+        };
+
+        SetCacheDirectory();
+
+        // Disabled when no directory is given
+        unsetenv("TBFMM_M2L_CACHE_DIR");
+        UASSERTETRUE(FUnifM2LCache::IsEnabled() == false);
+        const M2LHandlerClass reference(&inMatrixKernel, TreeHeight, BoxWidth);
+        const auto referenceResults = applyAllFC(reference);
+        UASSERTEEQUAL(reference.getCacheFilename(), std::string());
+
+        setenv("TBFMM_M2L_CACHE_DIR", cacheDirectory.c_str(), 1);
+        UASSERTETRUE(FUnifM2LCache::IsEnabled());
+        const M2LHandlerClass computed(&inMatrixKernel, TreeHeight, BoxWidth);
+        UASSERTETRUE(computed.isLoadedFromCache() == false);
+        UASSERTETRUE(computed.getCacheFilename() != std::string());
+        UASSERTETRUE(std::ifstream(computed.getCacheFilename()).good());
+        UASSERTETRUE(applyAllFC(computed) == referenceResults);
+
+        const M2LHandlerClass loaded(&inMatrixKernel, TreeHeight, BoxWidth);
+        UASSERTETRUE(loaded.isLoadedFromCache());
+        UASSERTEEQUAL(loaded.getCacheFilename(), computed.getCacheFilename());
+        UASSERTETRUE(applyAllFC(loaded) == referenceResults);
+
+        // The copies share the operators
+        const M2LHandlerClass copy(loaded);
+        UASSERTETRUE(applyAllFC(copy) == referenceResults);
+
+        // Another separation criterion or other kernel parameters must not use the same file
+        const M2LHandlerClass otherCriterion(&inMatrixKernel, TreeHeight, BoxWidth, 0);
+        UASSERTETRUE(otherCriterion.isLoadedFromCache() == false);
+        UASSERTETRUE(otherCriterion.getCacheFilename() != computed.getCacheFilename());
+
+        const M2LHandlerClass otherKernel(&inOtherMatrixKernel, TreeHeight, BoxWidth);
+        UASSERTETRUE(otherKernel.isLoadedFromCache() == false);
+        UASSERTETRUE(otherKernel.getCacheFilename() != computed.getCacheFilename());
+
+        for(const M2LHandlerClass* handler : {&computed, &otherCriterion, &otherKernel}){
+            RemoveFile(handler->getCacheFilename());
+        }
+        rmdir(cacheDirectory.c_str());
+    }
+
+    void TestHandlerHomogeneous(){
+        CoreHandler<double, 4>(FInterpMatrixKernelR<double>(), FInterpMatrixKernelRR<double>());
+        CoreHandler<float, 3>(FInterpMatrixKernelR<float>(), FInterpMatrixKernelRR<float>());
+    }
+
+    void TestHandlerNonHomogeneous(){
+        CoreHandler<double, 3>(FInterpMatrixKernelAPLUSRR<double>(0.25), FInterpMatrixKernelAPLUSRR<double>(0.5));
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestUnifM2LCache::TestRoundTrip, "Test save and load");
+        Parent::AddTest(&TestUnifM2LCache::TestCorruption, "Test invalid files");
+        Parent::AddTest(&TestUnifM2LCache::TestHandlerHomogeneous, "Test the homogeneous M2L handler");
+        Parent::AddTest(&TestUnifM2LCache::TestHandlerNonHomogeneous, "Test the non homogeneous M2L handler");
+    }
+};
+
+// You must do this
+TestClass(TestUnifM2LCache)
@@ -0,0 +1,144 @@
+#include "UTester.hpp"
+
+#include "kernels/unifkernel/FUnifM2LHandler.hpp"
+#include "kernels/unifkernel/FUnifSymM2LHandler.hpp"
+#include "kernels/unifkernel/FInterpMatrixKernel.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include <cstdlib>
+#include <vector>
+#include <complex>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_FFTW
+// -- END --
+
+class TestUnifSymM2LHandler : public UTester< TestUnifSymM2LHandler > {
+    using Parent = UTester< TestUnifSymM2LHandler >;
+
+    // The transformed expansions of the two handlers use different DFTs,
+    // so the local expansions are compared after the inverse DFT
+    template <class RealType, int ORDER, class MatrixKernelClass>
+    void CoreCompare(const MatrixKernelClass& inMatrixKernel, const int inSeparationCriterion){
+        using FullHandlerClass = FUnifM2LHandler<RealType, ORDER, MatrixKernelClass::Type>;
+        using SymHandlerClass = FUnifSymM2LHandler<RealType, ORDER, MatrixKernelClass::Type>;
+        constexpr unsigned int nnodes = ORDER*ORDER*ORDER;
+        constexpr unsigned int rc = (2*ORDER-1)*(2*ORDER-1)*(2*ORDER-1);
+        constexpr unsigned int symOptRc = (2*ORDER-1)*(2*ORDER-1)*ORDER;
+        constexpr long int NbPairs = 3;
+        const unsigned int TreeHeight = 5;
+        const RealType BoxWidth = 1;
+
+        const FullHandlerClass fullHandler(&inMatrixKernel, TreeHeight, BoxWidth, inSeparationCriterion);
+        const SymHandlerClass symHandler(&inMatrixKernel, TreeHeight, BoxWidth, inSeparationCriterion);
+        // The copies share the canonical operators
+        const SymHandlerClass symHandlerCopy(symHandler);
+
+        UASSERTEEQUAL(symHandler.getNbStoredOperators(), (inSeparationCriterion >= 1 ? 16U : inSeparationCriterion == 0 ? 19U : 20U));
+        UASSERTETRUE(symHandler.getCanonicalMemory()*10 < fullHandler.getMemory());
+        UASSERTETRUE(symHandler.getMemory()*10 < fullHandler.getMemory());
+
+        std::mt19937 randomEngine(ORDER);
+        std::uniform_real_distribution<RealType> distribution(-1, 1);
+        std::vector<RealType> ys(NbPairs*nnodes);
+        for(auto& value : ys){
+            value = distribution(randomEngine);
+        }
+        std::vector<std::complex<RealType>> FYsFull(NbPairs*rc);
+        std::vector<std::complex<RealType>> FYsSym(NbPairs*rc);
+        for(long int idxPair = 0 ; idxPair < NbPairs ; ++idxPair){
+            fullHandler.applyZeroPaddingAndDFT(&ys[idxPair*nnodes], &FYsFull[idxPair*rc]);
+            symHandler.applyZeroPaddingAndDFT(&ys[idxPair*nnodes], &FYsSym[idxPair*rc]);
+        }
+
+        for(unsigned int idxLevel = 2 ; idxLevel < TreeHeight ; ++idxLevel){
+            TbfAccuracyChecker<RealType> accuracy;
+            for(unsigned int idxInteraction = 0 ; idxInteraction < 343 ; ++idxInteraction){
+                std::vector<std::complex<RealType>> FXsFull(NbPairs*rc);
+                std::vector<std::complex<RealType>> FXsSym(NbPairs*rc);
+                std::vector<std::complex<RealType>> FXsSymBatch(NbPairs*rc);
+                std::vector<RealType> xsFull(NbPairs*nnodes);
+                std::vector<RealType> xsSym(NbPairs*nnodes);
+
+                const std::complex<RealType>* FYsSymPtr[NbPairs];
+                std::complex<RealType>* FXsSymBatchPtr[NbPairs];
+                for(long int idxPair = 0 ; idxPair < NbPairs ; ++idxPair){
+                    fullHandler.applyFC(idxInteraction, idxLevel, RealType(1.5), &FYsFull[idxPair*rc], &FXsFull[idxPair*rc]);
+                    symHandler.applyFC(idxInteraction, idxLevel, RealType(1.5), &FYsSym[idxPair*rc], &FXsSym[idxPair*rc]);
+                    FYsSymPtr[idxPair] = &FYsSym[idxPair*rc];
+                    FXsSymBatchPtr[idxPair] = &FXsSymBatch[idxPair*rc];
+                }
+                symHandlerCopy.applyFCBatch(idxInteraction, idxLevel, RealType(1.5), NbPairs, FYsSymPtr, FXsSymBatchPtr);
+
+                for(long int idxPair = 0 ; idxPair < NbPairs ; ++idxPair){
+                    fullHandler.unapplyZeroPaddingAndDFT(&FXsFull[idxPair*rc], &xsFull[idxPair*nnodes]);
+                    symHandler.unapplyZeroPaddingAndDFT(&FXsSym[idxPair*rc], &xsSym[idxPair*nnodes]);
+                }
+
+                // Neighbors share interpolation nodes, which is singular for homogeneous kernels
+                if(std::all_of(xsFull.begin(), xsFull.end(), [](const RealType inValue){ return std::isfinite(inValue); }) == false){
+                    continue;
+                }
+                for(unsigned int idxValue = 0 ; idxValue < NbPairs*nnodes ; ++idxValue){
+                    accuracy.addValues(xsFull[idxValue], xsSym[idxValue]);
+                }
+                for(long int idxPair = 0 ; idxPair < NbPairs ; ++idxPair){
+                    for(unsigned int idxValue = 0 ; idxValue < symOptRc ; ++idxValue){
+                        const auto sym = FXsSym[idxPair*rc + idxValue];
+                        UASSERTETRUE(std::abs(sym - FXsSymBatch[idxPair*rc + idxValue])
+                                     <= std::numeric_limits<RealType>::epsilon()*std::abs(sym)*10);
+                    }
+                }
+            }
+            if constexpr (std::is_same<float, RealType>::value){
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-5);
+            }
+            else{
+                UASSERTETRUE(accuracy.getRelativeL2Norm() < 1e-13);
+            }
+        }
+    }
+
+    void TestHomogeneous(){
+        unsetenv("TBFMM_M2L_CACHE_DIR");
+        for(const int separationCriterion : {1, 0, -1}){
+            CoreCompare<double, 4>(FInterpMatrixKernelR<double>(), separationCriterion);
+        }
+        CoreCompare<double, 5>(FInterpMatrixKernelRR<double>(), 1);
+        CoreCompare<float, 3>(FInterpMatrixKernelR<float>(), 1);
+    }
+
+    void TestNonHomogeneous(){
+        unsetenv("TBFMM_M2L_CACHE_DIR");
+        for(const int separationCriterion : {1, 0}){
+            CoreCompare<double, 4>(FInterpMatrixKernelAPLUSRR<double>(0.1), separationCriterion);
+        }
+    }
+
+    void TestNotSymmetric(){
+        unsetenv("TBFMM_M2L_CACHE_DIR");
+        FInterpMatrixKernelRH<double> matrixKernel;
+        matrixKernel.LX = 2;
+        bool hasThrown = false;
+        try{
+            FUnifSymM2LHandler<double, 3, FInterpMatrixKernelRH<double>::Type> handler(&matrixKernel, 4, 1.);
+        }
+        catch(const std::runtime_error&){
+            hasThrown = true;
+        }
+        UASSERTETRUE(hasThrown);
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestUnifSymM2LHandler::TestHomogeneous, "Compare with the full M2L handler (homogeneous)");
+        Parent::AddTest(&TestUnifSymM2LHandler::TestNonHomogeneous, "Compare with the full M2L handler (non homogeneous)");
+        Parent::AddTest(&TestUnifSymM2LHandler::TestNotSymmetric, "Test a matrix kernel without symmetries");
+    }
+};
+
+// You must do this
+TestClass(TestUnifSymM2LHandler)